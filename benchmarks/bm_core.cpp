@@ -8,6 +8,12 @@
 #include <xci/core/string.h>
 #include <xci/core/container/StringPool.h>
 
+#ifndef _WIN32
+#include <xci/core/FileTree.h>
+#include <fstream>
+#include <atomic>
+#endif
+
 using namespace xci::core;
 
 
@@ -73,4 +79,50 @@ static void bm_string_pool_nodup(benchmark::State& state)
 BENCHMARK(bm_string_pool_nodup)->Range(8, 8<<10);
 
 
+#ifndef _WIN32
+// Synthetic wide tree: 5 levels of 8 subdirs (37449 dirs), each dir contains 8 files
+static const fs::path& synthetic_tree()
+{
+    static struct Tree {
+        fs::path root = fs::temp_directory_path() / "xci_bm_file_tree";
+        Tree() {
+            fs::remove_all(root);
+            make(root, 5);
+        }
+        ~Tree() { fs::remove_all(root); }
+        void make(const fs::path& dir, int depth) {
+            fs::create_directory(dir);
+            for (int i = 0; i != 8; ++i)
+                std::ofstream(dir / ("file" + std::to_string(i)));
+            if (depth == 0)
+                return;
+            for (int i = 0; i != 8; ++i)
+                make(dir / ("dir" + std::to_string(i)), depth - 1);
+        }
+    } tree;
+    return tree.root;
+}
+
+
+// Scaling of FileTree with number of threads (like `ff -j N`)
+static void bm_file_tree(benchmark::State& state)
+{
+    const auto& root = synthetic_tree();
+    const int num_threads = int(state.range(0)) - 1;  // without the main thread
+    std::atomic_int64_t files = 0;
+    for (auto _ : state) {
+        FileTree ft(num_threads, [&files](int, const FileTree::PathNode&, FileTree::Type t) {
+            if (t == FileTree::File)
+                files.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        });
+        ft.walk(root);
+        ft.main_worker();
+    }
+    state.counters["files"] = benchmark::Counter(double(files), benchmark::Counter::kIsRate);
+}
+BENCHMARK(bm_file_tree)->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+#endif
+
+
 BENCHMARK_MAIN();
@@ -5,8 +5,19 @@
 // Licensed under the Apache License, Version 2.0 (see LICENSE file)
 
 #include <benchmark/benchmark.h>
+#include <xci/script/Interpreter.h>
+#include <xci/script/Builtin.h>
 #include <xci/script/Parser.h>
 #include <xci/script/ast/fold_tuple.h>
+#include <xci/script/NativeDelegate.h>
+#include <xci/script/native/list_kernels.h>
+#include <xci/vfs/Vfs.h>
+#include <xci/config.h>
+
+#include <numeric>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
 
 using namespace xci::script;
 using std::string;
@@ -28,6 +39,35 @@ struct SimpleParser {
 };
 
 
+// Compile the input once, then run its main function repeatedly
+struct SimpleProgram {
+    xci::vfs::Vfs vfs;
+    Interpreter interpreter {vfs};
+    std::shared_ptr<Module> module;
+
+    SimpleProgram(const std::string& input, Compiler::Flags flags = Compiler::Flags::Default) {
+        vfs.mount(XCI_SHARE);
+        interpreter.configure(flags);
+        const auto name = intern("bm");
+        module = std::make_shared<Module>(interpreter.module_manager(), name);
+        module->import_module("builtin");
+        module->import_module("std");
+        const auto src_id = interpreter.source_manager().add_source(name, input);
+        ast::Module ast;
+        interpreter.parser().parse(src_id, ast);
+        interpreter.compiler().compile(module->get_main_scope(), ast);
+    }
+
+    void run() {
+        auto& machine = interpreter.machine();
+        const auto& main_fn = module->get_main_function();
+        machine.call(main_fn, [](TypedValue&& invoked) { invoked.decref(); });
+        auto result = machine.stack().pull_typed(main_fn.effective_return_type());
+        result.decref();
+    }
+};
+
+
 static void bm_parser_tuple(benchmark::State& state) {
     std::string input = "0";
     for (int i = 1; i < state.range(0); ++i) {
@@ -117,4 +157,513 @@ static void bm_parser_toplevel_expr(benchmark::State& state) {
 BENCHMARK(bm_parser_toplevel_expr)->Range(1, 1<<8);
 
 
+// Strings up to StringV::max_inline_size are not allocated on heap
+static void run_string_concat(benchmark::State& state, const char* a, const char* b) {
+    SimpleProgram program(fmt::format(
+        "loop = fun (n:Int, acc:Int) -> Int {{ if n == 0 then acc else "
+        "loop (n - 1, if \"{0}\" + \"{1}\" == \"{0}{1}\" then acc + 1 else acc) }}; "
+        "loop ({2}, 0)", a, b, state.range(0)));
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void bm_string_concat_inline(benchmark::State& state) {
+    run_string_concat(state, "key", "42");
+}
+BENCHMARK(bm_string_concat_inline)->Range(1, 1<<10);
+
+static void bm_string_concat_heap(benchmark::State& state) {
+    run_string_concat(state, "a longer string ", "which lives on heap");
+}
+BENCHMARK(bm_string_concat_heap)->Range(1, 1<<10);
+
+
+static void bm_string_from_chars(benchmark::State& state) {
+    SimpleProgram program(fmt::format(
+        "loop = fun (n:Int, acc:Int) -> Int {{ if n == 0 then acc else "
+        "loop (n - 1, if ['a', 'b', 'c'].String == \"abc\" then acc + 1 else acc) }}; "
+        "loop ({}, 0)", state.range(0)));
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_string_from_chars)->Range(1, 1<<10);
+
+
+// Call a native function with scalar args through its delegate (no Values are created)
+static void bm_native_call_scalar(benchmark::State& state) {
+    auto w = native::AutoWrap{xci::core::ToFunctionPtr(
+            [](int64_t a, int32_t b, double c) { return double(a + b) * c; })};
+    const NativeDelegate fn = w.native_wrapper();
+    Stack stack;
+    for (auto _ : state) {
+        stack.push(value::Float64(0.5));
+        stack.push(value::Int32(2));
+        stack.push(value::Int64(40));
+        fn(stack);
+        benchmark::DoNotOptimize(stack.pull<value::Float64>());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_native_call_scalar);
+
+
+// Two chained maps - the intermediate list is not created when fused
+static void run_map_map(benchmark::State& state, Compiler::Flags flags) {
+    std::string list;
+    for (int64_t i = 0; i != state.range(0); ++i) {
+        if (i != 0)
+            list += ',';
+        list += std::to_string(i);
+    }
+    SimpleProgram program(fmt::format(
+        "f = fun l:[Int] -> UInt {{ len (map (succ, map (succ, l))) }}; f [{}]", list), flags);
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void bm_map_map(benchmark::State& state) {
+    run_map_map(state, Compiler::Flags::O1);
+}
+BENCHMARK(bm_map_map)->Range(1<<4, 1<<8);
+
+static void bm_map_map_fused(benchmark::State& state) {
+    run_map_map(state, Compiler::Flags::O1 | Compiler::Flags::FuseListOps);
+}
+BENCHMARK(bm_map_map_fused)->Range(1<<4, 1<<8);
+
+
+// 1M small writes to /dev/null, unbuffered (0) or buffered (1)
+static void bm_stream_write(benchmark::State& state) {
+    FILE* f = fopen("/dev/null", "w");
+    if (f == nullptr) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    Stream out(Stream::FdRef{fileno(f)});
+    OutputBuffers buffers;
+    buffers.set_buffering(out, state.range(0) ? OutputBuffers::Buffering::Full : OutputBuffers::Buffering::None);
+    const std::string_view piece = "hello, ";
+    for (auto _ : state) {
+        for (int i = 0; i != 1'000'000; ++i)
+            buffers.write(out, piece);
+        buffers.flush(out);
+    }
+    buffers.flush_all();
+    fclose(f);
+    state.SetItemsProcessed(state.iterations() * 1'000'000);
+    state.SetBytesProcessed(state.iterations() * 1'000'000 * piece.size());
+}
+BENCHMARK(bm_stream_write)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+#ifdef _WIN32
+static int open_devnull() { return _open("NUL", _O_WRONLY); }
+#else
+static int open_devnull() { return ::open("/dev/null", O_WRONLY); }
+#endif
+
+// A script writing 100k small pieces to an owned fd stream (/dev/null),
+// unbuffered (0) or buffered (1)
+static void bm_script_write_fd(benchmark::State& state) {
+    const int fd = open_devnull();
+    if (fd == -1) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    SimpleProgram program(
+        "fold (fun (acc:Int, x:Int) -> Int { write \"hello, \"; acc + 1 }, 0, range (0, 100000))");
+    auto& stack = program.interpreter.machine().stack();
+    value::Stream out {Stream(Stream::Fd{fd})};
+    stack.output_buffers().set_buffering(out.value(),
+            state.range(0) ? OutputBuffers::Buffering::Full : OutputBuffers::Buffering::None);
+    stack.swap_stream_out(out);  // the stack owns the fd now, it's closed with the machine
+    out.decref();  // the original stdout
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * 100'000);
+}
+BENCHMARK(bm_script_write_fd)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+
+// Native map/filter/fold should scale linearly with the list length
+static void bm_list_map_filter_fold(benchmark::State& state) {
+    SimpleProgram program(fmt::format(
+        "l = range (0, {}); "
+        "fold (fun (acc:Int, x:Int) -> Int {{ acc + x }}, 0, "
+        "filter (fun x:Int -> Bool {{ x % 3 == 0 }}, map (succ, l)))", state.range(0)));
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_list_map_filter_fold)->RangeMultiplier(4)->Range(1<<10, 1<<22);
+
+
+// Build a list by repeated concatenation of single-element lists (`l + [x]`)
+static void bm_list_append(benchmark::State& state) {
+    const auto ti = ti_int();
+    for (auto _ : state) {
+        value::List list(0, ti);
+        value::List item(1, ti);
+        for (int64_t i = 0; i != state.range(0); ++i) {
+            item.set_value(0, value::Int(i));
+            list.get<ListV>().extend(item.get<ListV>(), ti);
+        }
+        benchmark::DoNotOptimize(list.length());
+        list.decref();
+        item.decref();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_list_append)->Range(1<<10, 1<<20);
+
+
+// Create N cycles of two lists, then free them with the cycle collector.
+// Counter `freed_bytes` is the memory which would leak without the collector.
+static void bm_cycle_collect(benchmark::State& state) {
+    auto& cc = CycleCollector::thread_instance();
+    cc.set_enabled(true);
+    cc.set_threshold(0);
+    const auto elem_ti = ti_list(ti_int());
+    size_t freed_bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (int64_t i = 0; i != state.range(0); ++i) {
+            value::List a(1, elem_ti);
+            value::List b(1, elem_ti);
+            a.set_value(0, b);
+            b.set_value(0, a);
+        }
+        state.ResumeTiming();
+        freed_bytes += cc.collect().bytes;
+    }
+    cc.set_enabled(false);
+    state.counters["freed_bytes"] = benchmark::Counter(double(freed_bytes),
+                                                       benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(bm_cycle_collect)->Range(1<<6, 1<<16);
+
+
+// Overhead of tracking container slots: allocate and free N lists,
+// with the collector disabled (0) or enabled (1)
+static void bm_cycle_tracking(benchmark::State& state) {
+    auto& cc = CycleCollector::thread_instance();
+    cc.set_enabled(state.range(0) != 0);
+    cc.set_threshold(0);
+    const auto ti = ti_int();
+    for (auto _ : state) {
+        for (int i = 0; i != 1000; ++i) {
+            value::List list(1, ti);
+            benchmark::DoNotOptimize(list.heapslot());
+            list.decref();
+        }
+    }
+    cc.set_enabled(false);
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(bm_cycle_tracking)->Arg(0)->Arg(1);
+
+
+static void bm_list_sum(benchmark::State& state) {
+    std::vector<int64_t> data(state.range(0));
+    std::iota(data.begin(), data.end(), 0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(native::list_sum<int64_t>(data));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(native::list_kernels_isa());
+}
+BENCHMARK(bm_list_sum)->Range(1<<6, 1<<16);
+
+
+static void bm_list_find(benchmark::State& state) {
+    std::vector<float> data(state.range(0), 1.0f);
+    data.back() = 2.0f;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(native::list_find<float>(data, 2.0f));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(native::list_kernels_isa());
+}
+BENCHMARK(bm_list_find)->Range(1<<6, 1<<16);
+
+
+// Look up every key in a map of N entries
+static void bm_map_lookup(benchmark::State& state) {
+    const auto kt = ti_int();
+    const auto vt = ti_int();
+    value::Map map(kt, vt);
+    for (int64_t i = 0; i != state.range(0); ++i)
+        map.get<MapV>().insert(value::Int(i * 7), value::Int(i), kt, vt);
+    for (auto _ : state) {
+        for (int64_t i = 0; i != state.range(0); ++i)
+            benchmark::DoNotOptimize(map.get<MapV>().get(value::Int(i * 7), kt, vt));
+    }
+    map.decref();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_map_lookup)->Range(1<<4, 1<<12);
+
+
+// The same lookups in a list of (key, value) tuples, by linear scan
+static void bm_map_lookup_list_scan(benchmark::State& state) {
+    const auto item_ti = ti_tuple(ti_int(), ti_int());
+    value::List list(state.range(0), item_ti);
+    for (int64_t i = 0; i != state.range(0); ++i)
+        list.set_value(i, value::Tuple{value::Int(i * 7), value::Int(i)});
+    for (auto _ : state) {
+        for (int64_t i = 0; i != state.range(0); ++i) {
+            const value::Int key(i * 7);
+            for (size_t j = 0; j != list.length(); ++j) {
+                const auto item = list.value_at(j, item_ti);
+                if (item.get<TupleV>().value_at(0) == key) {
+                    benchmark::DoNotOptimize(item.get<TupleV>().value_at(1));
+                    break;
+                }
+            }
+        }
+    }
+    list.decref();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_map_lookup_list_scan)->Range(1<<4, 1<<12);
+
+
+// Checked arithmetic of the interpreter (builtin::add, mul, exp) per type.
+// The operands go through DoNotOptimize, so the overflow check can't be folded.
+template<class T>
+static void bm_checked_add(benchmark::State& state) {
+    T a = 1, b = 3;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(b);
+        benchmark::DoNotOptimize(builtin::add(a, b));
+    }
+}
+BENCHMARK_TEMPLATE(bm_checked_add, int32_t);
+BENCHMARK_TEMPLATE(bm_checked_add, int64_t);
+BENCHMARK_TEMPLATE(bm_checked_add, uint64_t);
+BENCHMARK_TEMPLATE(bm_checked_add, int128);
+BENCHMARK_TEMPLATE(bm_checked_add, double);
+
+template<class T>
+static void bm_checked_mul(benchmark::State& state) {
+    T a = 12345, b = 6789;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(b);
+        benchmark::DoNotOptimize(builtin::mul(a, b));
+    }
+}
+BENCHMARK_TEMPLATE(bm_checked_mul, int32_t);
+BENCHMARK_TEMPLATE(bm_checked_mul, int64_t);
+BENCHMARK_TEMPLATE(bm_checked_mul, uint64_t);
+BENCHMARK_TEMPLATE(bm_checked_mul, int128);
+BENCHMARK_TEMPLATE(bm_checked_mul, uint128);
+BENCHMARK_TEMPLATE(bm_checked_mul, double);
+
+template<class T>
+static void bm_checked_exp(benchmark::State& state) {
+    T x = 3, n = T(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(x);
+        benchmark::DoNotOptimize(n);
+        benchmark::DoNotOptimize(builtin::exp(x, n));
+    }
+}
+BENCHMARK_TEMPLATE(bm_checked_exp, int32_t)->Arg(2)->Arg(19);
+BENCHMARK_TEMPLATE(bm_checked_exp, int64_t)->Arg(2)->Arg(39);
+BENCHMARK_TEMPLATE(bm_checked_exp, int128)->Arg(2)->Arg(80);
+BENCHMARK_TEMPLATE(bm_checked_exp, double)->Arg(2)->Arg(39);
+
+
+// ----------------------------------------------------------------------------
+// VM suite: parse, compilation passes, std import, execution of workloads
+//
+// Run it with a Release build and compare against a baseline:
+//
+//     bm_script --benchmark_filter=bm_vm_ --benchmark_out=vm.json --benchmark_out_format=json
+//     compare.py benchmarks baseline.json vm.json    # from google/benchmark tools
+
+// Representative program for the compiler benchmarks - recursion, loops,
+// lists, strings, closures and generic functions specialized to several types
+static constexpr const char* vm_suite_source = R"(
+fib = fun n:Int -> Int { if n < 2 then n else fib (n - 1) + fib (n - 2) }
+loop = fun (n:Int, acc:Int) -> Int { if n == 0 then acc else loop (n - 1, acc + n * 3 % 7) }
+build = fun (n:Int, acc:[Int]) -> [Int] { if n == 0 then acc else build (n - 1, acc + [n]) }
+repeat = fun (n:Int, s:String) -> String { fold (fun (acc:String, x:Int) -> String { acc + s }, "", range (0, n)) }
+adder = fun a:Int { fun b:Int -> Int { a + b } }
+twice = fun<T> x:T -> T { x + x }
+sum_sq = fun l:[Int] -> Int { fold (fun (acc:Int, x:Int) -> Int { acc + x * x }, 0, l) }
+fib 10; loop (10, 0); len (build (10, []:[Int])); repeat (3, "ab")
+adder 1 2; twice 1; twice 1.5; twice 2d; twice 3u; sum_sq [1, 2, 3]
+)";
+
+
+static void bm_vm_parse(benchmark::State& state) {
+    SimpleParser parser(vm_suite_source);
+    for (auto _ : state) {
+        auto mod = parser.parse();
+        benchmark::DoNotOptimize(mod);
+    }
+}
+BENCHMARK(bm_vm_parse);
+
+
+// Compile the suite source with a set of passes. The flags bring in
+// their dependencies (see Compiler::Flags), so the cost of a single pass
+// is the difference to the previous set. Parsing is not measured.
+static void bm_vm_compile(benchmark::State& state, Compiler::Flags flags) {
+    xci::vfs::Vfs vfs;
+    vfs.mount(XCI_SHARE);
+    Interpreter interpreter {vfs};
+    interpreter.configure(flags);
+    const auto name = intern("bm");
+    const auto src_id = interpreter.source_manager().add_source(name, vm_suite_source);
+    std::shared_ptr<Module> module;
+    std::unique_ptr<ast::Module> ast;
+    for (auto _ : state) {
+        state.PauseTiming();
+        // the previous module is destroyed here, outside of the timing
+        module = std::make_shared<Module>(interpreter.module_manager(), name);
+        module->import_module("builtin");
+        module->import_module("std");  // imported only once, then cached
+        ast = std::make_unique<ast::Module>();
+        interpreter.parser().parse(src_id, *ast);
+        state.ResumeTiming();
+        interpreter.compiler().compile(module->get_main_scope(), *ast);
+    }
+}
+BENCHMARK_CAPTURE(bm_vm_compile, pp_tuple, Compiler::Flags::PPTuple);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_dot_call, Compiler::Flags::PPTuple | Compiler::Flags::PPDotCall);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_paren, Compiler::Flags::PPTuple | Compiler::Flags::PPDotCall | Compiler::Flags::PPParen);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_symbols, Compiler::Flags::PPSymbols);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_fuse_list_ops, Compiler::Flags::OPFuseListOps);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_decl, Compiler::Flags::PPDecl);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_types, Compiler::Flags::PPTypes);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_spec, Compiler::Flags::PPSpec);
+BENCHMARK_CAPTURE(bm_vm_compile, pp_nonlocals, Compiler::Flags::PPNonlocals);
+BENCHMARK_CAPTURE(bm_vm_compile, cp_compile, Compiler::Flags::CPCompile);
+BENCHMARK_CAPTURE(bm_vm_compile, op_copy_drop, Compiler::Flags::CPCompile | Compiler::Flags::OPCopyDrop);
+BENCHMARK_CAPTURE(bm_vm_compile, op_tail_call, Compiler::Flags::CPCompile | Compiler::Flags::OPTailCall);
+BENCHMARK_CAPTURE(bm_vm_compile, op_native_call, Compiler::Flags::CPCompile | Compiler::Flags::OPNativeCall);
+BENCHMARK_CAPTURE(bm_vm_compile, cp_assemble, Compiler::Flags::CPAssemble);
+BENCHMARK_CAPTURE(bm_vm_compile, o1, Compiler::Flags::O1);
+BENCHMARK_CAPTURE(bm_vm_compile, o2, Compiler::Flags::O2);
+
+
+// Import std module into a fresh interpreter (read, parse, compile std.fire)
+static void bm_vm_import_std(benchmark::State& state) {
+    xci::vfs::Vfs vfs;
+    vfs.mount(XCI_SHARE);
+    for (auto _ : state) {
+        Interpreter interpreter {vfs};
+        benchmark::DoNotOptimize(interpreter.module_manager().import_module("std"));
+    }
+}
+BENCHMARK(bm_vm_import_std)->Unit(benchmark::kMillisecond);
+
+
+// Execution of the workloads, compiled once with Default flags (O1).
+// N is the workload size, items/s counts the loop iterations or the calls.
+static void run_workload(benchmark::State& state, const std::string& input, int64_t items) {
+    SimpleProgram program(input);
+    for (auto _ : state) {
+        program.run();
+    }
+    state.SetItemsProcessed(state.iterations() * items);
+}
+
+// Naive recursion, two non-tail calls per level
+static void bm_vm_fib(benchmark::State& state) {
+    const auto n = state.range(0);
+    // calls(n) = 1 + calls(n-1) + calls(n-2), calls(0) = calls(1) = 1
+    int64_t calls = 1, prev = 1;
+    for (int64_t i = 2; i <= n; ++i)
+        calls = std::exchange(prev, calls) + calls + 1;
+    run_workload(state, fmt::format(
+            "fib = fun n:Int -> Int {{ if n < 2 then n else fib (n - 1) + fib (n - 2) }}; "
+            "fib {}", n), calls);
+}
+BENCHMARK(bm_vm_fib)->DenseRange(10, 20, 5);
+
+// Tail-recursive loop with integer arithmetic
+static void bm_vm_numeric_loop(benchmark::State& state) {
+    run_workload(state, fmt::format(
+            "loop = fun (n:Int, acc:Int) -> Int {{ if n == 0 then acc else loop (n - 1, acc + n * 3 % 7) }}; "
+            "loop ({}, 0)", state.range(0)), state.range(0));
+}
+BENCHMARK(bm_vm_numeric_loop)->Range(1<<6, 1<<14);
+
+// Build a list by appending one element at a time
+static void bm_vm_list_build(benchmark::State& state) {
+    run_workload(state, fmt::format(
+            "build = fun (n:Int, acc:[Int]) -> [Int] {{ if n == 0 then acc else build (n - 1, acc + [n]) }}; "
+            "len (build ({}, []:[Int]))", state.range(0)), state.range(0));
+}
+BENCHMARK(bm_vm_list_build)->Range(1<<6, 1<<12);
+
+// Concatenate and compare strings (the result is on heap). The comparison
+// walks the common prefix, i.e. the whole accumulated string.
+static void bm_vm_string_processing(benchmark::State& state) {
+    run_workload(state, fmt::format(
+            "s = fold (fun (acc:String, x:Int) -> String {{ t = acc + \"ab\"; if t < acc then acc else t }}, \"\", range (0, {})); "
+            "len (cast_to_chars s)", state.range(0)), state.range(0));
+}
+BENCHMARK(bm_vm_string_processing)->Range(1<<6, 1<<12);
+
+// Create a closure in each iteration and call it
+static void bm_vm_closures(benchmark::State& state) {
+    run_workload(state, fmt::format(
+            "adder = fun a:Int {{ fun b:Int -> Int {{ a + b }} }}; "
+            "loop = fun (n:Int, acc:Int) -> Int {{ if n == 0 then acc else loop (n - 1, adder n acc) }}; "
+            "loop ({}, 0)", state.range(0)), state.range(0));
+}
+BENCHMARK(bm_vm_closures)->Range(1<<6, 1<<14);
+
+// Generic function specialized for four types, called in a loop
+static void bm_vm_generic(benchmark::State& state) {
+    run_workload(state, fmt::format(
+            "twice = fun<T> x:T -> T {{ x + x }}; "
+            "loop = fun (n:Int, acc:Int) -> Int {{ if n == 0 then acc else "
+            "loop (n - 1, acc + twice n + (twice 1.5).Int + (twice 2d).Int + (twice 3u).Int) }}; "
+            "loop ({}, 0)", state.range(0)), state.range(0));
+}
+BENCHMARK(bm_vm_generic)->Range(1<<6, 1<<14);
+
+// Host program calls a small function repeatedly: Machine::call with args
+// and result as Values (0), or PreparedCall with raw args and result (1)
+static void bm_vm_host_call(benchmark::State& state) {
+    SimpleProgram program("sub = fun (a:Int, b:Int) -> Int { a - b }; sub (3, 2)");
+    auto& machine = program.interpreter.machine();
+    const auto& fn = *program.module->get_function(program.module->find_function(intern("sub")));
+    int64_t acc = 0;
+    if (state.range(0) == 0) {
+        const auto return_type = fn.effective_return_type();
+        for (auto _ : state) {
+            machine.stack().push(value::Int(3));
+            machine.stack().push(value::Int(acc));
+            machine.call(fn);
+            auto result = machine.stack().pull_typed(return_type);
+            acc = result.value().to_int64() & 0xff;
+            result.decref();
+        }
+    } else {
+        PreparedCall sub {machine, fn};
+        for (auto _ : state)
+            acc = sub.call<int64_t>(acc, int64_t{3}) & 0xff;
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_vm_host_call)->Arg(0)->Arg(1);
+
+
 BENCHMARK_MAIN();
@@ -14,6 +14,19 @@ endif()
 
 check_cxx_source_compiles("using float128 = __float128; int main() {}" HAVE_GNU_EXT_FLOAT128)
 
+check_cxx_source_compiles("
+#include <fcntl.h>
+#include <sys/stat.h>
+int main() { struct statx stx; return statx(AT_FDCWD, \".\", 0, STATX_TYPE, &stx); }
+" HAVE_STATX)
+
+# io_uring(7) with the ops needed by IoRing (Linux 5.6 headers), used via raw syscalls
+check_cxx_source_compiles("
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+int main() { return IORING_OP_OPENAT + IORING_OP_READ + IORING_OP_CLOSE + IORING_REGISTER_PROBE + __NR_io_uring_setup; }
+" HAVE_IO_URING)
+
 check_cxx_source_compiles("
 #include <string>
 #ifdef __GLIBCXX__
@@ -7,29 +7,121 @@
 #include "FileTree.h"
 #include <xci/core/log.h>
 
+#ifdef HAVE_STATX
+#include <sys/sysmacros.h>  // makedev
+#endif
+
 namespace xci::core {
 
 
+bool FileTree::PathNode::stat(struct stat& st, unsigned fields) const
+{
+#ifdef HAVE_STATX
+    unsigned mask = 0;
+    if (fields & StatType)
+        mask |= STATX_TYPE;
+    if (fields & StatMode)
+        mask |= STATX_TYPE | STATX_MODE;
+    if (fields & StatSize)
+        mask |= STATX_SIZE | STATX_BLOCKS;
+    if (fields == StatAll)
+        mask = STATX_BASIC_STATS;
+
+    // don't sync with remote filesystems, we're just listing
+    constexpr int flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC;
+    struct statx stx = {};
+    int rc;
+    if (m_fd != -1)
+        rc = ::statx(m_fd, "", flags | AT_EMPTY_PATH, mask, &stx);
+    else if (m_parent && m_parent->fd() != -1)
+        rc = ::statx(m_parent->fd(), name().data(), flags, mask, &stx);
+    else
+        rc = ::statx(AT_FDCWD, file_path().data(), flags, mask, &stx);
+    if (rc != 0)
+        return false;
+    if ((stx.stx_mask & mask) != mask) {
+        // the filesystem didn't report some of the requested fields
+        return stat(st);
+    }
+
+    // copy only the fields reported in stx_mask, the others are zero
+    st = {};
+    st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    st.st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+    st.st_blksize = blksize_t(stx.stx_blksize);
+    if (stx.stx_mask & STATX_TYPE)
+        st.st_mode |= stx.stx_mode & S_IFMT;
+    if (stx.stx_mask & STATX_MODE)
+        st.st_mode |= stx.stx_mode & ~S_IFMT;
+    if (stx.stx_mask & STATX_INO)
+        st.st_ino = stx.stx_ino;
+    if (stx.stx_mask & STATX_NLINK)
+        st.st_nlink = stx.stx_nlink;
+    if (stx.stx_mask & STATX_UID)
+        st.st_uid = stx.stx_uid;
+    if (stx.stx_mask & STATX_GID)
+        st.st_gid = stx.stx_gid;
+    if (stx.stx_mask & STATX_SIZE)
+        st.st_size = off_t(stx.stx_size);
+    if (stx.stx_mask & STATX_BLOCKS)
+        st.st_blocks = blkcnt_t(stx.stx_blocks);
+    if (stx.stx_mask & STATX_ATIME)
+        st.st_atim = {stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec};
+    if (stx.stx_mask & STATX_MTIME)
+        st.st_mtim = {stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec};
+    if (stx.stx_mask & STATX_CTIME)
+        st.st_ctim = {stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec};
+    return true;
+#else
+    (void) fields;
+    return stat(st);
+#endif
+}
+
+
 void FileTree::enqueue(int tn, RcPtr<PathNode> path_node)
 {
-    // Skip locking and queuing if all workers are (apparently) busy.
-    if (m_busy.load(std::memory_order_relaxed) >= m_busy_max) {
-        TRACE("skip lock ({} busy)", m_busy.load(std::memory_order_relaxed));
-        read(tn, std::move(path_node));
+    // the ownership is moved to the deque
+    auto* node = path_node.release();
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (!m_jobs[tn].push(node)) {
+        // The deque is full - process the item in this thread
+        // (better than blocking and doing nothing)
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        TRACE("[{}] deque full, read directly", tn);
+        read(tn, RcPtr{node});
         return;
     }
 
-    std::unique_lock lock(m_mutex);
-    if (!m_job) {
-        m_busy.fetch_add(1, std::memory_order_release);
-        m_job = std::move(path_node);
-        lock.unlock();
-        m_cv.notify_one();
-    } else {
-        // process the item in this thread
-        // (better than blocking and doing nothing)
-        lock.unlock();
-        read(tn, std::move(path_node));
+    // Wake up an idle worker. The fence pairs with the one in worker():
+    // either we see the worker idle, or the worker sees the pushed job.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_idle.load(std::memory_order_relaxed) != 0) {
+        m_wakeup.fetch_add(1, std::memory_order_release);
+        m_wakeup.notify_one();
+    }
+}
+
+
+auto FileTree::take_job(int tn) -> RcPtr<PathNode>
+{
+    if (auto* node = m_jobs[tn].pop())
+        return RcPtr{node};
+    // steal from the others, starting from the next one
+    for (int i = 1; i != m_num_workers; ++i) {
+        if (auto* node = m_jobs[(tn + i) % m_num_workers].steal())
+            return RcPtr{node};
+    }
+    return {};
+}
+
+
+void FileTree::finish_job()
+{
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // all done, wake up the sleeping workers to finish
+        m_wakeup.fetch_add(1, std::memory_order_release);
+        m_wakeup.notify_all();
     }
 }
 
@@ -37,26 +129,31 @@ void FileTree::enqueue(int tn, RcPtr<PathNode> path_node)
 void FileTree::worker(int tn)
 {
     TRACE("[{}] worker start", tn);
-    while(m_busy.load(std::memory_order_acquire) != 0) {
-        std::unique_lock lock(m_mutex);
-        while (!m_job) {
-            m_cv.wait(lock);
-            if (m_busy.load(std::memory_order_acquire) == 0) {
-                lock.unlock();
-                goto finish;
-            }
+    for (;;) {
+        auto path = take_job(tn);
+        if (!path && m_idle_cb) {
+            m_idle_cb(tn);
+            path = take_job(tn);
+        }
+        if (!path) {
+            if (m_pending.load(std::memory_order_acquire) == 0)
+                break;
+            // Prepare to sleep, then check for jobs again (see enqueue)
+            const auto wakeup = m_wakeup.load(std::memory_order_acquire);
+            m_idle.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            path = take_job(tn);
+            if (!path && m_pending.load(std::memory_order_acquire) != 0)
+                m_wakeup.wait(wakeup, std::memory_order_acquire);
+            m_idle.fetch_sub(1, std::memory_order_relaxed);
+            if (!path)
+                continue;
         }
-        // clear m_job by moving it away - it's important to move into temp variable
-        auto path = std::move(m_job);
-        assert(!m_job);  // cleared
-        lock.unlock();
 
-        TRACE("[{}] worker read ({} busy)", tn, m_busy.load(std::memory_order_relaxed));
+        TRACE("[{}] worker read ({} pending)", tn, m_pending.load(std::memory_order_relaxed));
         read(tn, std::move(path));
-        m_busy.fetch_sub(1, std::memory_order_release);
+        finish_job();
     }
-finish:
-    m_cv.notify_all();
     TRACE("[{}] worker finish", tn);
 }
 
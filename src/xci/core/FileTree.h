@@ -10,6 +10,7 @@
 #include <xci/core/string.h>
 #include <xci/core/listdir.h>
 #include <xci/core/mixin.h>
+#include <xci/core/container/ChaseLevDeque.h>
 #include <xci/config.h>
 
 #include <string>
@@ -17,8 +18,7 @@
 #include <functional>
 #include <thread>
 #include <atomic>
-#include <mutex>
-#include <condition_variable>
+#include <memory>
 #include <filesystem>
 #include <algorithm>  // sort
 #include <cstring>
@@ -53,6 +53,8 @@ public:
         }
 
         RcPtr& operator=(RcPtr&& rhs) noexcept {
+            if (ptr != nullptr)
+                ptr->decref();
             this->ptr = rhs.ptr;
             rhs.ptr = nullptr;
             return *this;
@@ -63,6 +65,9 @@ public:
 
         explicit operator bool() const { return ptr != nullptr; }
 
+        /// Give up the ownership, the caller is responsible for calling decref
+        T* release() { T* p = ptr; ptr = nullptr; return p; }
+
     private:
         T* ptr = nullptr;
     };
@@ -75,11 +80,11 @@ public:
     // - when releasing a pointer, call decref()
     // Users of FileTree don't need to bother, they get only a reference,
     // which is not expected to live outside the callback body.
+    // To keep the node longer (e.g. for async processing), use share().
     class PathNode: NonCopyable, NonMovable {
         /// Internal constructor. Storage for path is allocated by caller.
-        /// \param path         Char storage for the path, it must have (at least) dir_len + name_len chars (+ 1 for slash)
-        ///                     If name_len is not 0, a single slash character needs to be appended at the end
-        ///                     (This avoids string concatenation in `dir_name` method).
+        /// \param path         Char storage for the path, it must have (at least) dir_len + name_len chars + 1 for nul terminator
+        ///                     (The terminator allows passing the name or the path to syscalls without a copy).
         /// \param dir_len      Length of directory part of the path, including trailing slash,
         ///                     e.g. "/", "/etc/", "./" or "" (blank directory is alternative for "./")
         /// \param name_len     Length of name part of the path, not including any slashes or nul terminator
@@ -106,32 +111,34 @@ public:
             const unsigned int name_len = (last_slash_pos == std::string::npos) ? path.size() : path.size() - last_slash_pos - 1;
             const unsigned int dir_len = path.size() - name_len;
 
-            // allocate storage
-            const bool need_trailing_slash = name_len != 0;
-            char* buffer = new char[sizeof(PathNode) + path.size() + int(need_trailing_slash)];
+            // allocate storage for (path + '\0')
+            char* buffer = new char[sizeof(PathNode) + path.size() + 1];
             auto* path_node = new(buffer) PathNode(dir_len, name_len);
 
-            // write path to storage
-            std::memcpy(path_node->m_path_storage, path.data(), path.size());
-            if (need_trailing_slash)
-                path_node->m_path_storage[path.size()] = '/';
+            // write path to storage (including the terminator)
+            std::memcpy(path_node->m_path_storage, path.c_str(), path.size() + 1);
             return RcPtr{path_node};
         }
 
         static RcPtr<PathNode> make(PathNode& parent, std::string_view name)
         {
-            auto parent_dir = parent.dir_path();
+            // parent dir path is parent's file path + '/' (unless it's root or blank)
+            const auto parent_path = parent.file_path();
+            const bool need_slash = parent.has_name();
 
-            // allocate storage for (parent_dir + name + '/')
-            const unsigned int dir_len = parent_dir.size();
+            // allocate storage for (parent_path + '/' + name + '\0')
+            const unsigned int dir_len = parent_path.size() + int(need_slash);
             const unsigned int name_len = name.size();
             char* buffer = new char[sizeof(PathNode) + dir_len + name_len + 1];
             auto* path_node = new(buffer) PathNode(dir_len, name_len, parent);
 
             // write path to storage
-            std::memcpy(path_node->m_path_storage, parent_dir.data(), dir_len);
-            std::memcpy(path_node->m_path_storage + dir_len, name.data(), name_len);
-            path_node->m_path_storage[dir_len + name_len] = '/';
+            char* storage = path_node->m_path_storage;
+            std::memcpy(storage, parent_path.data(), parent_path.size());
+            if (need_slash)
+                storage[dir_len - 1] = '/';
+            std::memcpy(storage + dir_len, name.data(), name_len);
+            storage[dir_len + name_len] = '\0';
             return RcPtr{path_node};
         }
 
@@ -139,22 +146,30 @@ public:
             ++m_refcount;
         }
 
-        void decref() {
+        /// Get a new owning pointer to this node, to keep it alive after the callback returns
+        RcPtr<const PathNode> share() const {
+            ++m_refcount;
+            return RcPtr{this};
+        }
+
+        void decref() const {
             if (--m_refcount == 0) {
                 this->~PathNode();
-                char* buffer = reinterpret_cast<char*>(this);
+                const char* buffer = reinterpret_cast<const char*>(this);
                 delete[] buffer;
             }
         }
 
         /// Get contained path as directory path with trailing slash
-        std::string_view dir_path() const {
-            if (m_name_len == 0)
-                return {m_path_storage, m_dir_len};
-            return {m_path_storage, m_dir_len + m_name_len + 1};  // 1 for trailing slash
+        std::string dir_path() const {
+            std::string res(file_path());
+            if (m_name_len != 0)
+                res += '/';
+            return res;
         }
 
         /// Get contained path as file path (no trailing slash with exception of root "/")
+        /// The data is NUL-terminated - `file_path().data()` can be passed to syscalls.
         std::string_view file_path() const {
             return {m_path_storage, m_dir_len + m_name_len};
         }
@@ -165,6 +180,7 @@ public:
         }
 
         /// Get name part of contained path
+        /// The data is NUL-terminated - `name().data()` can be passed to syscalls.
         std::string_view name() const {
             return {m_path_storage + m_dir_len, m_name_len};
         }
@@ -187,13 +203,21 @@ public:
             }
         }
 
+        /// File type from directory entry (DT_REG, DT_DIR etc.), DT_UNKNOWN if not known.
+        /// This is available without stat, but not all filesystems provide it.
+        unsigned char dir_entry_type() const { return m_dir_entry_type; }
+        void set_dir_entry_type(unsigned char d_type) { m_dir_entry_type = d_type; }
+
+        /// File type as in st_mode (S_IFREG, S_IFDIR etc.), or 0 if not known without stat
+        mode_t type_hint() const { return m_dir_entry_type == DT_UNKNOWN ? 0 : DTTOIF(m_dir_entry_type); }
+
         bool stat(struct stat& st) const {
             int rc;
             if (m_fd == -1) {
                 if (!m_parent || m_parent->fd() == -1) {
-                    rc = ::lstat(std::string(file_path()).c_str(), &st);
+                    rc = ::lstat(file_path().data(), &st);
                 } else {
-                    rc = ::fstatat(m_parent->fd(), std::string(name()).c_str(), &st, AT_SYMLINK_NOFOLLOW);
+                    rc = ::fstatat(m_parent->fd(), name().data(), &st, AT_SYMLINK_NOFOLLOW);
                 }
             } else {
                 rc = ::fstat(m_fd, &st);
@@ -201,13 +225,28 @@ public:
             return rc == 0;
         }
 
+        /// Fields requested from stat(st, fields)
+        enum StatFields : unsigned {
+            StatType = 1,       // st_mode & S_IFMT
+            StatMode = 2,       // st_mode (type and permissions)
+            StatSize = 4,       // st_size, st_blocks
+            StatAll = ~0u,      // all fields, same as stat(st)
+        };
+
+        /// Stat only the requested fields (bitwise OR of StatFields).
+        /// Uses statx where available, the filesystem may skip the work
+        /// for the other fields. Only the fields reported by statx are set,
+        /// the others are zero (st_dev, st_rdev and st_blksize are always set).
+        /// Falls back to full stat when some requested field wasn't reported.
+        bool stat(struct stat& st, unsigned fields) const;
+
         bool readlink(std::string& target) const {
             target.resize(PATH_MAX);
             ssize_t res;
             if (has_parent() && parent_fd() != -1)
-                res = ::readlinkat(parent_fd(), std::string(name()).c_str(), target.data(), target.size());
+                res = ::readlinkat(parent_fd(), name().data(), target.data(), target.size());
             else
-                res = ::readlink(std::string(file_path()).c_str(), target.data(), target.size());
+                res = ::readlink(file_path().data(), target.data(), target.size());
             if (res < 0)
                 return false;
             target.resize(res);
@@ -216,8 +255,8 @@ public:
 
         int open(int oflag = O_RDONLY | O_NOFOLLOW | O_CLOEXEC) const {
             if (has_parent() && parent_fd() != -1)
-                return ::openat(parent_fd(), std::string(name()).c_str(), oflag);
-            return ::open(std::string(file_path()).c_str(), oflag);
+                return ::openat(parent_fd(), name().data(), oflag);
+            return ::open(file_path().data(), oflag);
         }
 
         /// Is this a node from input, i.e. `walk()`?
@@ -233,12 +272,13 @@ public:
 
     private:
         RcPtr<PathNode> m_parent;
-        std::atomic_int m_refcount {1};
+        mutable std::atomic_int m_refcount {1};
         unsigned int m_dir_len = 0;
         unsigned int m_name_len = 0;
         int m_fd = -1;
         int m_depth = 0;  // depth from input
-        char m_path_storage[0];
+        unsigned char m_dir_entry_type = DT_UNKNOWN;
+        char m_path_storage[0];  // dir + name + '\0'
     };
 
     enum Type {
@@ -252,10 +292,17 @@ public:
     /// for Directories, return true to descend, false to skip
     using NodeCallback = std::function<bool(int tn, const PathNode&, Type)>;
 
+    /// Called by a worker when it has no more directories to read (before going
+    /// to sleep or finishing). Use it to complete any work deferred by NodeCallback.
+    using IdleCallback = std::function<void(int tn)>;
+
     /// \param num_threads      Number of threads FileTree should spawn.
     ///                         Can be zero, but don't forget to call worker() from main thread.
-    explicit FileTree(int num_threads, NodeCallback&& cb)
-        : m_cb(std::move(cb)), m_busy_max(num_threads + 1)
+    explicit FileTree(int num_threads, NodeCallback&& cb, IdleCallback&& idle_cb = {})
+        : m_cb(std::move(cb)),
+          m_idle_cb(std::move(idle_cb)),
+          m_jobs(std::make_unique<JobDeque[]>(num_threads + 1)),
+          m_num_workers(num_threads + 1)
     {
         assert(m_cb);
         m_workers.reserve(num_threads);
@@ -264,11 +311,7 @@ public:
         }
     }
 
-    ~FileTree() {
-        // join threads
-        for (auto& t : m_workers)
-            t.join();
-    }
+    ~FileTree() { join(); }
 
     void walk_cwd() {
         // open "." but show entries without "./" prefix in reporting
@@ -291,16 +334,32 @@ public:
         enqueue(0, std::move(node));
     }
 
+    /// Run worker in main thread, wait for the other workers to finish.
+    /// All callbacks were called when this returns.
     void main_worker() {
-        m_busy.fetch_sub(1, std::memory_order_release);  // main worker is counted as busy from start (see ctor)
+        finish_job();  // main thread is counted as a pending job from start (see m_pending)
         worker(0);
+        join();
     }
 
 private:
+    void join() {
+        for (auto& t : m_workers) {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
     void enqueue(int tn, RcPtr<PathNode> path_node);
 
     void worker(int tn);
 
+    // Pop a job from own deque or steal one from other workers
+    RcPtr<PathNode> take_job(int tn);
+
+    // Decrement m_pending, wake up all workers when it reaches zero
+    void finish_job();
+
     void read(int tn, RcPtr<PathNode> path) {
         thread_local DirEntryArena arena;
         DirEntryArenaGuard arena_guard(arena);
@@ -327,6 +386,7 @@ private:
 
         for (const auto* entry : entries) {
             auto entry_node = PathNode::make(*path, {entry->d_name, strlen(entry->d_name)});
+            entry_node->set_dir_entry_type(entry->d_type);
 
             if ((entry->d_type & DT_DIR) == DT_DIR || entry->d_type == DT_UNKNOWN) {
                 // readdir says it's a dir or it doesn't know
@@ -376,25 +436,33 @@ private:
     }
 
     NodeCallback m_cb;
-
-    RcPtr<PathNode> m_job;
+    IdleCallback m_idle_cb;
+
+    // Each worker pushes the directories to be read into its own deque,
+    // idle workers steal them. When the deque is full, the directory is read
+    // immediately by the same thread. The capacity bounds number of open FDs
+    // held by the queued directories.
+    static constexpr size_t job_deque_capacity = 16;
+    using JobDeque = ChaseLevDeque<PathNode*, job_deque_capacity>;
+    std::unique_ptr<JobDeque[]> m_jobs;  // one per worker, index = tn
     std::vector<std::thread> m_workers;
-    std::mutex m_mutex;  // sync access to job from workers and CV
-    std::condition_variable m_cv;
-
-    // busy counter has three purposes:
-    // * to keep workers alive while main thread submits work via walk()
-    //   - the counter starts at 1 and main_worker() decrements it
-    // * to keep workers alive when a job is posted via m_job
-    //   - it's incremented when posting a job
-    // * to keep workers alive while other workers are processing jobs
-    //   - more jobs might be added by the processing
-    //   - when worker finishes processing, it decrements the counter
-    //     (this pairs with job posting)
-    std::atomic_int m_busy {1};
+
+    // Termination detection - number of jobs queued or being processed:
+    // * it starts at 1 to keep workers alive while main thread submits work
+    //   via walk(), main_worker() then decrements it
+    // * it's incremented before a job is pushed to a deque
+    // * it's decremented when a worker finishes processing the job
+    //   (more jobs might have been added by the processing)
+    // The work is done when it reaches zero.
+    std::atomic_int m_pending {1};
+
+    // Idle workers sleep on m_wakeup (C++20 atomic wait), it's incremented
+    // to wake them up when a job is pushed or when the work is done.
+    std::atomic_uint32_t m_wakeup {0};
+    std::atomic_int m_idle {0};  // number of workers preparing to sleep or sleeping
 
     // total workers, including the main one
-    int m_busy_max;
+    int m_num_workers;
 };
 
 } // namespace xci::core
@@ -0,0 +1,241 @@
+// IoRing.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "IoRing.h"
+#include <xci/core/log.h>
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <cerrno>
+
+namespace xci::core {
+
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+// The ring indexes are shared with the kernel
+static unsigned load_acquire(unsigned* p) { return std::atomic_ref(*p).load(std::memory_order_acquire); }
+static void store_release(unsigned* p, unsigned v) { std::atomic_ref(*p).store(v, std::memory_order_release); }
+
+
+IoRing::IoRing(unsigned entries)
+{
+    io_uring_params params = {};
+    const int fd = sys_io_uring_setup(entries, &params);
+    if (fd == -1) {
+        log::debug("IoRing: io_uring_setup: {m}");
+        return;
+    }
+
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+        m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+    constexpr int prot = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_SHARED | MAP_POPULATE;
+    m_sq_ring = mmap(nullptr, m_sq_ring_size, prot, flags, fd, IORING_OFF_SQ_RING);
+    if (m_sq_ring == MAP_FAILED) {
+        log::error("IoRing: mmap: {m}");
+        m_sq_ring = nullptr;
+        ::close(fd);
+        return;
+    }
+    if (single_mmap) {
+        m_cq_ring = m_sq_ring;
+    } else {
+        m_cq_ring = mmap(nullptr, m_cq_ring_size, prot, flags, fd, IORING_OFF_CQ_RING);
+        if (m_cq_ring == MAP_FAILED) {
+            log::error("IoRing: mmap: {m}");
+            m_cq_ring = nullptr;
+            munmap(m_sq_ring, m_sq_ring_size);
+            m_sq_ring = nullptr;
+            ::close(fd);
+            return;
+        }
+    }
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqes_size, prot, flags, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        log::error("IoRing: mmap: {m}");
+        if (!single_mmap)
+            munmap(m_cq_ring, m_cq_ring_size);
+        munmap(m_sq_ring, m_sq_ring_size);
+        m_sq_ring = m_cq_ring = nullptr;
+        ::close(fd);
+        return;
+    }
+
+    auto* sq = static_cast<char*>(m_sq_ring);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sq_tail_shared = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+    m_sq_tail = m_sq_submitted = *m_sq_tail_shared;
+
+    auto* cq = static_cast<char*>(m_cq_ring);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    m_fd = fd;
+
+    // Query supported operations (Linux 5.6+). Older kernels have io_uring,
+    // but not the operations we need, they will report no support.
+    constexpr unsigned max_ops = 256;
+    auto probe_buf = std::make_unique<char[]>(sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_buf.get());
+    std::memset(probe, 0, sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op));
+    if (sys_io_uring_register(m_fd, IORING_REGISTER_PROBE, probe, max_ops) == 0) {
+        for (unsigned i = 0; i != probe->ops_len && i != max_ops; ++i) {
+            if (probe->ops[i].flags & IO_URING_OP_SUPPORTED)
+                m_supported_ops.set(probe->ops[i].op);
+        }
+    }
+}
+
+
+IoRing::~IoRing()
+{
+    if (m_fd == -1)
+        return;
+    munmap(m_sqes, m_sqes_size);
+    if (m_cq_ring != m_sq_ring)
+        munmap(m_cq_ring, m_cq_ring_size);
+    munmap(m_sq_ring, m_sq_ring_size);
+    ::close(m_fd);
+}
+
+
+bool IoRing::supports(unsigned op) const
+{
+    return op < m_supported_ops.size() && m_supported_ops.test(op);
+}
+
+
+io_uring_sqe* IoRing::next_sqe()
+{
+    if (m_sq_tail - load_acquire(m_sq_head) >= m_sq_entries)
+        return nullptr;  // full
+    const unsigned index = m_sq_tail & m_sq_mask;
+    io_uring_sqe* sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    m_sq_array[index] = index;
+    ++m_sq_tail;
+    return sqe;
+}
+
+
+bool IoRing::prep_openat(int dir_fd, const char* path, int flags, uint64_t user_data)
+{
+    io_uring_sqe* sqe = next_sqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = dir_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(path);
+    sqe->open_flags = unsigned(flags);
+    sqe->user_data = user_data;
+    return true;
+}
+
+
+bool IoRing::prep_read(int fd, void* buf, unsigned size, uint64_t offset, uint64_t user_data)
+{
+    io_uring_sqe* sqe = next_sqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    return true;
+}
+
+
+bool IoRing::prep_close(int fd, uint64_t user_data)
+{
+    io_uring_sqe* sqe = next_sqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    return true;
+}
+
+
+bool IoRing::submit(unsigned wait_nr)
+{
+    // publish the prepared entries to the kernel
+    store_release(m_sq_tail_shared, m_sq_tail);
+    const unsigned to_submit = m_sq_tail - m_sq_submitted;
+    if (to_submit == 0 && wait_nr == 0)
+        return true;
+    const unsigned flags = wait_nr != 0 ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        const int rc = sys_io_uring_enter(m_fd, to_submit, wait_nr, flags);
+        if (rc == -1) {
+            if (errno == EINTR)
+                continue;
+            return false;  // EAGAIN, EBUSY: pop some completions and try again
+        }
+        // some entries might not be consumed, they stay prepared for next submit
+        m_sq_submitted += unsigned(rc);
+        return true;
+    }
+}
+
+
+void IoRing::discard_prepared(std::vector<uint64_t>& out)
+{
+    for (unsigned tail = m_sq_submitted; tail != m_sq_tail; ++tail)
+        out.push_back(m_sqes[tail & m_sq_mask].user_data);
+    // the kernel consumes the entries only in io_uring_enter, it's safe to move the tail back
+    m_sq_tail = m_sq_submitted;
+    store_release(m_sq_tail_shared, m_sq_tail);
+}
+
+
+bool IoRing::pop(Completion& completion)
+{
+    const unsigned head = *m_cq_head;
+    if (head == load_acquire(m_cq_tail))
+        return false;
+    const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+    completion = {cqe.user_data, cqe.res};
+    store_release(m_cq_head, head + 1);
+    return true;
+}
+
+
+} // namespace xci::core
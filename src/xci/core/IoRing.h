@@ -0,0 +1,113 @@
+// IoRing.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_CORE_IO_RING_H
+#define XCI_CORE_IO_RING_H
+
+#include <xci/core/mixin.h>
+
+#include <bitset>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace xci::core {
+
+
+/// Minimal wrapper for Linux io_uring(7), using raw syscalls (no liburing).
+///
+/// Operations are prepared into the submission queue, submitted by `submit()`
+/// in a single syscall, and their results are popped from the completion queue.
+/// Each operation carries `user_data`, which is returned with its completion.
+///
+/// The kernel might not support io_uring or it might be disabled
+/// (seccomp in containers, sysctl kernel.io_uring_disabled). Check `operator bool`
+/// after construction and `supports()` for particular operations,
+/// and fall back to plain syscalls when not available.
+///
+/// Not thread-safe - use one ring per thread.
+class IoRing: private NonCopyable {
+public:
+    /// \param entries  Size of the submission queue (rounded up to power of two by the kernel).
+    ///                 The completion queue is twice as large.
+    explicit IoRing(unsigned entries);
+    ~IoRing();
+
+    /// Was the ring created?
+    explicit operator bool() const { return m_fd != -1; }
+
+    /// Is the operation (IORING_OP_*) supported by the kernel?
+    bool supports(unsigned op) const;
+
+    // -------------------------------------------------------------------------
+    // Prepare operations. Each returns false if the submission queue is full.
+    // The arguments (path, buffer) must stay valid until the operation completes.
+
+    bool prep_openat(int dir_fd, const char* path, int flags, uint64_t user_data);
+    bool prep_read(int fd, void* buf, unsigned size, uint64_t offset, uint64_t user_data);
+    bool prep_close(int fd, uint64_t user_data);
+
+    // -------------------------------------------------------------------------
+    // Submit and complete
+
+    /// Submit the prepared operations, wait until at least `wait_nr` operations are completed.
+    /// \returns    false on error (see errno)
+    bool submit(unsigned wait_nr = 0);
+
+    struct Completion {
+        uint64_t user_data;
+        int32_t res;  // result of the syscall or -errno
+    };
+
+    /// Pop a completion from the queue, if there is any. Doesn't block.
+    bool pop(Completion& completion);
+
+    /// Number of prepared operations not yet submitted
+    unsigned num_prepared() const { return m_sq_tail - m_sq_submitted; }
+
+    /// Take back the prepared operations which were not submitted,
+    /// e.g. to release their resources after `submit()` failed.
+    /// Their `user_data` is appended to `out`.
+    void discard_prepared(std::vector<uint64_t>& out);
+
+private:
+    io_uring_sqe* next_sqe();
+
+    int m_fd = -1;
+
+    // submission queue (shared with kernel)
+    unsigned* m_sq_head = nullptr;
+    unsigned* m_sq_tail_shared = nullptr;
+    unsigned* m_sq_array = nullptr;
+    io_uring_sqe* m_sqes = nullptr;
+    unsigned m_sq_mask = 0;
+    unsigned m_sq_entries = 0;
+    unsigned m_sq_tail = 0;  // local copy, published in submit()
+    unsigned m_sq_submitted = 0;
+
+    // completion queue (shared with kernel)
+    unsigned* m_cq_head = nullptr;
+    unsigned* m_cq_tail = nullptr;
+    io_uring_cqe* m_cqes = nullptr;
+    unsigned m_cq_mask = 0;
+
+    // mmapped memory
+    void* m_sq_ring = nullptr;
+    size_t m_sq_ring_size = 0;
+    void* m_cq_ring = nullptr;
+    size_t m_cq_ring_size = 0;
+    size_t m_sqes_size = 0;
+
+    std::bitset<256> m_supported_ops;
+};
+
+
+} // namespace xci::core
+
+#endif // include guard
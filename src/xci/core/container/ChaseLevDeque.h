@@ -0,0 +1,115 @@
+// ChaseLevDeque.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_CORE_CHASE_LEV_DEQUE_H
+#define XCI_CORE_CHASE_LEV_DEQUE_H
+
+#include <atomic>
+#include <array>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+namespace xci::core {
+
+
+/// Lock-free work-stealing deque (Chase, Lev: Dynamic Circular Work-Stealing Deque),
+/// with fixed capacity and memory ordering as in Lê et al.:
+/// Correct and Efficient Work-Stealing for Weak Memory Models (PPoPP 2013)
+///
+/// The owner thread pushes and pops items at the bottom (LIFO),
+/// other threads steal items from the top (FIFO).
+///
+/// The capacity is fixed, `push` fails when the deque is full.
+/// The owner can then process the item by itself. This also bounds
+/// the resources held by the queued items.
+///
+/// The items must be trivially copyable (e.g. raw pointers).
+/// Null value (T{}) is returned by `pop` and `steal` when there is no item.
+template <class T, size_t Capacity>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    /// Owner only: add the item at bottom
+    /// \returns false if the deque is full (the item was not added)
+    bool push(T item) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t t = m_top.load(std::memory_order_acquire);
+        if (b - t >= int64_t(Capacity))
+            return false;
+        m_items[size_t(b) & mask].store(item, std::memory_order_relaxed);
+        // publish the item to thieves (release store instead of the paper's
+        // release fence - equivalent, but understood by ThreadSanitizer)
+        m_bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Owner only: take the item from bottom (the last pushed one)
+    T pop() {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        if (t > b) {
+            // empty
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return T{};
+        }
+        T item = m_items[size_t(b) & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // the last item - race with thieves
+            if (!m_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = T{};  // stolen
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /// Any thread: take the item from top (the oldest one)
+    /// Retries when losing a race with another thief or the owner,
+    /// returns null only when the deque is empty.
+    T steal() {
+        for (;;) {
+            int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = m_bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return T{};  // empty
+            T item = m_items[size_t(t) & mask].load(std::memory_order_relaxed);
+            if (m_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+                return item;
+        }
+    }
+
+    /// Any thread: approximate number of items (exact for the owner when no thief is active)
+    size_t size() const {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t t = m_top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr size_t mask = Capacity - 1;
+    static constexpr size_t cache_line = 64;
+
+    // top and bottom are written by different threads, keep them on separate cache lines
+    alignas(cache_line) std::atomic<int64_t> m_top {0};
+    alignas(cache_line) std::atomic<int64_t> m_bottom {0};
+    alignas(cache_line) std::array<std::atomic<T>, Capacity> m_items {};
+};
+
+
+} // namespace xci::core
+
+#endif // include guard
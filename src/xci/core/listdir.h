@@ -54,7 +54,8 @@ namespace xci::core {
 // recursive arena for sys_dirent_t records
 class DirEntryArena {
 public:
-    static constexpr size_t block_size = 16 << 10;
+    // large enough for ~2000 typical entries in single getdents call
+    static constexpr size_t block_size = 64 << 10;
 
     char* get_block() {
         if (m_next == m_blocks.size()) {
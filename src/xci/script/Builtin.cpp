@@ -9,10 +9,13 @@
 #include <xci/core/string.h>
 #include <xci/compat/macros.h>
 #include <xci/script/typing/type_index.h>
+#include <xci/script/native/list_kernels.h>
 #include <xci/script/Error.h>
+#include <xci/script/Iterator.h>
 
 #include <range/v3/view/enumerate.hpp>
 
+#include <numeric>
 #include <sstream>
 
 namespace xci::script {
@@ -20,6 +23,18 @@ namespace xci::script {
 using ranges::views::enumerate;
 
 
+void builtin::throw_integer_overflow()
+{
+    throw value_out_of_range("Integer overflow");
+}
+
+
+void builtin::throw_division_by_zero()
+{
+    throw value_out_of_range("Division by zero");
+}
+
+
 const char* builtin::op_to_function_name(ast::Operator::Op op)
 {
     using Op = ast::Operator;
@@ -69,6 +84,7 @@ BuiltinModule::BuiltinModule(ModuleManager& module_manager) : Module(module_mana
     add_intrinsics();
     add_types();
     add_string_functions();
+    add_list_functions();
     add_io_functions();
     add_introspections();
 }
@@ -143,6 +159,25 @@ void BuiltinModule::add_intrinsics()
     add_symbol("__list_length", Symbol::Instruction, Index(Opcode::ListLength));
     add_symbol("__list_slice", Symbol::Instruction, Index(Opcode::ListSlice));
     add_symbol("__list_concat", Symbol::Instruction, Index(Opcode::ListConcat));
+    add_symbol("__list_map", Symbol::Instruction, Index(Opcode::ListMap));
+    add_symbol("__list_filter", Symbol::Instruction, Index(Opcode::ListFilter));
+    add_symbol("__list_fold", Symbol::Instruction, Index(Opcode::ListFold));
+    add_symbol("__list_zip", Symbol::Instruction, Index(Opcode::ListZip));
+    add_symbol("__map_from_list", Symbol::Instruction, Index(Opcode::MapFromList));
+    add_symbol("__map_length", Symbol::Instruction, Index(Opcode::MapLength));
+    add_symbol("__map_get", Symbol::Instruction, Index(Opcode::MapGet));
+    add_symbol("__map_contains", Symbol::Instruction, Index(Opcode::MapContains));
+    add_symbol("__map_insert", Symbol::Instruction, Index(Opcode::MapInsert));
+    add_symbol("__map_remove", Symbol::Instruction, Index(Opcode::MapRemove));
+    add_symbol("__map_items", Symbol::Instruction, Index(Opcode::MapItems));
+    add_symbol("__iter_from_list", Symbol::Instruction, Index(Opcode::IterFromList));
+    add_symbol("__iter_map", Symbol::Instruction, Index(Opcode::IterMap));
+    add_symbol("__iter_filter", Symbol::Instruction, Index(Opcode::IterFilter));
+    add_symbol("__iter_take", Symbol::Instruction, Index(Opcode::IterTake));
+    add_symbol("__iter_iterate", Symbol::Instruction, Index(Opcode::IterIterate));
+    add_symbol("__iter_fold", Symbol::Instruction, Index(Opcode::IterFold));
+    add_symbol("__iter_collect", Symbol::Instruction, Index(Opcode::IterCollect));
+    add_symbol("__memo", Symbol::Instruction, Index(Opcode::Memo));
     add_symbol("__cast", Symbol::Instruction, Index(Opcode::Cast));
 
     // two args
@@ -282,8 +317,8 @@ static void string_equal(Stack& stack, void*, void*)
     auto s1 = stack.pull<value::String>();
     auto s2 = stack.pull<value::String>();
     bool res;
-    if (s1.get<StringV>().slot == s2.get<StringV>().slot)
-        res = true;  // same instance on heap
+    if (s1.get<StringV>().is_same(s2.get<StringV>()))
+        res = true;  // same instance on heap, or same inline data
     else
         res = s1.value() == s2.value();
     s1.decref();
@@ -297,8 +332,8 @@ static void string_compare(Stack& stack, void*, void*)
     auto s1 = stack.pull<value::String>();
     auto s2 = stack.pull<value::String>();
     int res;
-    if (s1.get<StringV>().slot == s2.get<StringV>().slot)
-        res = 0;  // same instance on heap
+    if (s1.get<StringV>().is_same(s2.get<StringV>()))
+        res = 0;  // same instance on heap, or same inline data
     else
         res = s1.value().compare(s2.value());
     s1.decref();
@@ -320,10 +355,190 @@ void BuiltinModule::add_string_functions()
 }
 
 
+// Elements of a numeric list, as a span of native type
+template <class T>
+static std::span<const T> list_elements(const Value& list)
+{
+    const auto& list_v = list.get<ListV>();
+    return {reinterpret_cast<const T*>(list_v.raw_data()), list_v.length()};
+}
+
+
+template <class T>
+static void numeric_list_sum(Stack& stack, void*, void*)
+{
+    auto list = stack.pull(ti_list(native::make_type_info<T>()));
+    T res;
+    try {
+        res = native::list_sum(list_elements<T>(list));  // throws on integer overflow
+    } catch (...) {
+        list.decref();
+        throw;
+    }
+    list.decref();
+    stack.push(Value(res));
+}
+
+
+template <class T, bool Min>
+static void numeric_list_minmax(Stack& stack, void*, void*)
+{
+    auto list = stack.pull(ti_list(native::make_type_info<T>()));
+    const auto elems = list_elements<T>(list);
+    if (elems.empty()) {
+        list.decref();
+        throw index_out_of_bounds(0, 0);
+    }
+    const T res = Min ? native::list_min(elems) : native::list_max(elems);
+    list.decref();
+    stack.push(Value(res));
+}
+
+
+template <class T>
+static void numeric_list_dot(Stack& stack, void*, void*)
+{
+    auto lhs = stack.pull(ti_list(native::make_type_info<T>()));
+    auto rhs = stack.pull(ti_list(native::make_type_info<T>()));
+    const auto a = list_elements<T>(lhs);
+    const auto b = list_elements<T>(rhs);
+    if (a.size() != b.size()) {
+        lhs.decref();
+        rhs.decref();
+        throw value_out_of_range("List length mismatch");
+    }
+    T res;
+    try {
+        res = native::list_dot(a, b);  // throws on integer overflow
+    } catch (...) {
+        lhs.decref();
+        rhs.decref();
+        throw;
+    }
+    lhs.decref();
+    rhs.decref();
+    stack.push(Value(res));
+}
+
+
+// Elementwise operation, the result is written in place of `lhs` if possible
+template <class T, void (*F)(std::span<const T>, std::span<const T>, std::span<T>)>
+static void numeric_list_elementwise(Stack& stack, void*, void*)
+{
+    const auto elem_ti = native::make_type_info<T>();
+    auto lhs = stack.pull(ti_list(TypeInfo(elem_ti)));
+    auto rhs = stack.pull(ti_list(TypeInfo(elem_ti)));
+    const auto a = list_elements<T>(lhs);
+    const auto b = list_elements<T>(rhs);
+    if (a.size() != b.size()) {
+        lhs.decref();
+        rhs.decref();
+        throw value_out_of_range("List length mismatch");
+    }
+    Value out = lhs;
+    if (lhs.heapslot()->refcount() == 1)
+        lhs = Value();  // reuse the slot, it's owned by `out` now
+    else
+        out = Value(ListV(a.size(), elem_ti));
+    auto* out_data = reinterpret_cast<T*>(out.get<ListV>().raw_data());
+    try {
+        F(a, b, {out_data, a.size()});  // throws on integer overflow
+    } catch (...) {
+        out.decref();
+        lhs.decref();
+        rhs.decref();
+        throw;
+    }
+    lhs.decref();
+    rhs.decref();
+    stack.push(out);
+}
+
+
+template <class T>
+static void numeric_list_find(Stack& stack, void*, void*)
+{
+    auto list = stack.pull(ti_list(native::make_type_info<T>()));
+    const T v = stack.pull(native::make_type_info<T>()).template get<T>();
+    const auto elems = list_elements<T>(list);
+    const size_t idx = native::list_find(elems, v);
+    list.decref();
+    stack.push(value::Int(idx == elems.size() ? -1 : int64_t(idx)));
+}
+
+
+template <class T>
+static void numeric_list_equal(Stack& stack, void*, void*)
+{
+    auto lhs = stack.pull(ti_list(native::make_type_info<T>()));
+    auto rhs = stack.pull(ti_list(native::make_type_info<T>()));
+    const bool res = native::list_equal(list_elements<T>(lhs), list_elements<T>(rhs));
+    lhs.decref();
+    rhs.decref();
+    stack.push(value::Bool(res));
+}
+
+
+template <class T>
+static void add_numeric_list_functions(Module& module)
+{
+    const auto ti_elem = [] { return native::make_type_info<T>(); };
+    const auto ti_list_elem = [&ti_elem] { return ti_list(ti_elem()); };
+    const auto ti_two_lists = [&ti_list_elem] { return ti_tuple(ti_list_elem(), ti_list_elem()); };
+    module.add_native_function("list_sum", ti_list_elem(), ti_elem(), numeric_list_sum<T>);
+    module.add_native_function("list_min", ti_list_elem(), ti_elem(), numeric_list_minmax<T, true>);
+    module.add_native_function("list_max", ti_list_elem(), ti_elem(), numeric_list_minmax<T, false>);
+    module.add_native_function("list_dot", ti_two_lists(), ti_elem(), numeric_list_dot<T>);
+    module.add_native_function("list_add", ti_two_lists(), ti_list_elem(),
+                               numeric_list_elementwise<T, native::list_add<T>>);
+    module.add_native_function("list_sub", ti_two_lists(), ti_list_elem(),
+                               numeric_list_elementwise<T, native::list_sub<T>>);
+    module.add_native_function("list_mul", ti_two_lists(), ti_list_elem(),
+                               numeric_list_elementwise<T, native::list_mul<T>>);
+    module.add_native_function("list_find", ti_tuple(ti_list_elem(), ti_elem()), ti_int(), numeric_list_find<T>);
+    module.add_native_function("list_equal", ti_two_lists(), ti_bool(), numeric_list_equal<T>);
+}
+
+
+static void list_range(Stack& stack, void*, void*)
+{
+    const auto start = stack.pull<value::Int>().value();
+    const auto stop = stack.pull<value::Int>().value();
+    const size_t len = stop > start ? size_t(stop - start) : 0;
+    ListV res(len, ti_int());
+    auto* data = reinterpret_cast<int64_t*>(res.raw_data());
+    std::iota(data, data + len, start);
+    stack.push(Value(std::move(res)));
+}
+
+
+static void iter_range(Stack& stack, void*, void*)
+{
+    const auto start = stack.pull<value::Int>().value();
+    const auto stop = stack.pull<value::Int>().value();
+    stack.push(value::Iter(make_range_generator(start, stop)));
+}
+
+
+void BuiltinModule::add_list_functions()
+{
+    // range (start, stop) -> [start, start+1, ..., stop-1]
+    add_native_function("range", ti_tuple(ti_int(), ti_int()), ti_list(ti_int()), list_range);
+    // lazy variant, the numbers are generated on demand
+    add_native_function("iter_range", ti_tuple(ti_int(), ti_int()), ti_iter(ti_int()), iter_range);
+
+    // Vectorized operations on lists of numbers, see native/list_kernels.h
+    add_numeric_list_functions<int32_t>(*this);
+    add_numeric_list_functions<int64_t>(*this);
+    add_numeric_list_functions<float>(*this);
+    add_numeric_list_functions<double>(*this);
+}
+
+
 static void write_bytes(Stack& stack, void*, void*)
 {
     auto arg = stack.pull<value::Bytes>();
-    stack.stream_out().write(arg.value());
+    stack.output_buffers().write(stack.stream_out(), arg.value());
     arg.decref();
 }
 
@@ -331,21 +546,56 @@ static void write_bytes(Stack& stack, void*, void*)
 static void write_string(Stack& stack, void*, void*)
 {
     auto arg = stack.pull<value::String>();
-    stack.stream_out().write(arg.value());
+    stack.output_buffers().write(stack.stream_out(), arg.value());
     arg.decref();
 }
 
 
 static void flush_out(Stack& stack, void*, void*)
 {
-    stack.stream_out().flush();
+    stack.output_buffers().flush(stack.stream_out());
+}
+
+
+static OutputBuffers::Buffering buffering_mode(std::string_view mode)
+{
+    if (mode == "none")
+        return OutputBuffers::Buffering::None;
+    if (mode == "line")
+        return OutputBuffers::Buffering::Line;
+    if (mode == "full")
+        return OutputBuffers::Buffering::Full;
+    throw value_out_of_range(fmt::format("Buffering mode \"{}\" (expected none, line or full)", mode));
+}
+
+
+static void set_buffering(Stack& stack, void*, void*)
+{
+    auto stream = stack.pull<value::Stream>();
+    auto mode = stack.pull<value::String>();
+    const auto mode_v = buffering_mode(mode.value());
+    mode.decref();
+    stack.output_buffers().set_buffering(stream.value(), mode_v);
+    stream.decref();
+}
+
+
+static void set_buffering_size(Stack& stack, void*, void*)
+{
+    auto stream = stack.pull<value::Stream>();
+    auto mode = stack.pull<value::String>();
+    const auto size = stack.pull<value::UInt>().value();
+    const auto mode_v = buffering_mode(mode.value());
+    mode.decref();
+    stack.output_buffers().set_buffering(stream.value(), mode_v, size);
+    stream.decref();
 }
 
 
 static void write_error(Stack& stack, void*, void*)
 {
     auto arg = stack.pull<value::String>();
-    stack.stream_err().write(arg.value());
+    stack.output_buffers().write(stack.stream_err(), arg.value());
     arg.decref();
 }
 
@@ -353,11 +603,18 @@ static void write_error(Stack& stack, void*, void*)
 static void read_string(Stack& stack, void*, void*)
 {
     auto arg = stack.pull<value::UInt>();
-    auto s = stack.stream_in().read(arg.value());
+    auto s = stack.output_buffers().read(stack.stream_in(), arg.value());
     stack.push(value::String(s));
 }
 
 
+static void read_lines(Stack& stack, void*, void*)
+{
+    auto stream = stack.pull<value::Stream>();
+    stack.push(value::Iter(make_lines_generator(std::move(stream))));
+}
+
+
 static void open_file(Stack& stack, void*, void*)
 {
     auto path = stack.pull<value::String>();
@@ -467,23 +724,27 @@ void BuiltinModule::add_io_functions()
     add_symbol("stderr", Symbol::Value, add_value(TypedValue{value::Stream(script::Stream::default_stderr())}));
     add_symbol("null", Symbol::Value, add_value(TypedValue{value::Stream(script::Stream::null())}));
 
-    // functions
-    add_native_function("write", ti_string(), ti_void(), write_string);
-    add_native_function("write", ti_bytes(), ti_void(), write_bytes);
-    add_native_function("flush", ti_void(), ti_void(), flush_out);
-    add_native_function("error", ti_string(), ti_void(), write_error);
-    add_native_function("read", ti_uint(), ti_string(), read_string);
-    add_native_function("open", ti_tuple(ti_string(), ti_string()), ti_stream(), open_file);
-    add_native_function("__streams", ti_void(), TypeInfo(streams), internal_streams);
-
-    add_native_function("enter", ti_stream(), ti_stream(), output_stream_enter1);
-    add_native_function("leave", ti_stream(), ti_void(), output_stream_leave1);
-    add_native_function("enter", ti_tuple(ti_stream(), ti_stream()), ti_tuple(ti_stream(), ti_stream()), output_stream_enter2);
-    add_native_function("leave", ti_tuple(ti_stream(), ti_stream()), ti_void(), output_stream_leave2);
-    add_native_function("enter", ti_tuple(ti_stream(), ti_stream(), ti_stream()), ti_tuple(ti_stream(), ti_stream(), ti_stream()), output_stream_enter3);
-    add_native_function("leave", ti_tuple(ti_stream(), ti_stream(), ti_stream()), ti_void(), output_stream_leave3);
-    add_native_function("enter", TypeInfo(streams), TypeInfo(streams), output_stream_enter3);
-    add_native_function("leave", TypeInfo(streams), ti_void(), output_stream_leave3);
+    // functions - all of them do I/O, mark them to prevent memoization
+    const auto io = [](SymbolPointer sym) { sym.get_generic_scope().function().set_io(); };
+    io(add_native_function("write", ti_string(), ti_void(), write_string));
+    io(add_native_function("write", ti_bytes(), ti_void(), write_bytes));
+    io(add_native_function("flush", ti_void(), ti_void(), flush_out));
+    io(add_native_function("set_buffering", ti_tuple(ti_stream(), ti_string()), ti_void(), set_buffering));
+    io(add_native_function("set_buffering", ti_tuple(ti_stream(), ti_string(), ti_uint()), ti_void(), set_buffering_size));
+    io(add_native_function("error", ti_string(), ti_void(), write_error));
+    io(add_native_function("read", ti_uint(), ti_string(), read_string));
+    io(add_native_function("lines", ti_stream(), ti_iter(ti_string()), read_lines));
+    io(add_native_function("open", ti_tuple(ti_string(), ti_string()), ti_stream(), open_file));
+    io(add_native_function("__streams", ti_void(), TypeInfo(streams), internal_streams));
+
+    io(add_native_function("enter", ti_stream(), ti_stream(), output_stream_enter1));
+    io(add_native_function("leave", ti_stream(), ti_void(), output_stream_leave1));
+    io(add_native_function("enter", ti_tuple(ti_stream(), ti_stream()), ti_tuple(ti_stream(), ti_stream()), output_stream_enter2));
+    io(add_native_function("leave", ti_tuple(ti_stream(), ti_stream()), ti_void(), output_stream_leave2));
+    io(add_native_function("enter", ti_tuple(ti_stream(), ti_stream(), ti_stream()), ti_tuple(ti_stream(), ti_stream(), ti_stream()), output_stream_enter3));
+    io(add_native_function("leave", ti_tuple(ti_stream(), ti_stream(), ti_stream()), ti_void(), output_stream_leave3));
+    io(add_native_function("enter", TypeInfo(streams), TypeInfo(streams), output_stream_enter3));
+    io(add_native_function("leave", TypeInfo(streams), ti_void(), output_stream_leave3));
 }
 
 
@@ -535,7 +796,7 @@ static void introspect_subtypes(Stack& stack, void*, void*)
     }
     const ModuleManager& mm = stack.module_manager();
     value::List res(1, ti_type_index());
-    if (ti.is_list()) {
+    if (ti.is_list() || ti.is_iter()) {
         res.set_value(0, value::TypeIndex(int32_t(get_type_index(mm, ti.elem_type()))));
     } else {
         res.set_value(0, value::TypeIndex(int32_t(get_type_index(mm, ti))));
@@ -43,75 +43,176 @@ constexpr T shift_right( T&& lhs, uint8_t rhs ) noexcept {
     return std::forward<T>(lhs) >> rhs;
 }
 
+// Integer types, including 128-bit (which are not std::is_integral in strict mode)
+template<class T>
+constexpr bool is_integer_v = std::is_integral_v<T> || std::is_same_v<T, uint128> || std::is_same_v<T, int128>;
+
+template<class T>
+constexpr bool is_signed_integer_v = is_integer_v<T> && T(-1) < T(0);
+
+// Throw ValueOutOfRange. Out of line, so the checked operations
+// are compiled to the plain instruction + conditional jump.
+[[noreturn]] void throw_integer_overflow();
+[[noreturn]] void throw_division_by_zero();
+
+
+// Primitives for the checked integer arithmetic.
+// Compute the result, wrapping around, return true if it overflowed.
+
+template<class T>
+constexpr bool add_overflow(T lhs, T rhs, T& res) {
+#if defined(__GNUC__)
+    return __builtin_add_overflow(lhs, rhs, &res);
+#else
+    using U = xci::make_unsigned_t<T>;
+    res = T(U(lhs) + U(rhs));
+    if constexpr (is_signed_integer_v<T>)
+        return ((lhs ^ res) & (rhs ^ res)) < 0;  // both operands have different sign than result
+    else
+        return res < lhs;
+#endif
+}
+
+template<class T>
+constexpr bool sub_overflow(T lhs, T rhs, T& res) {
+#if defined(__GNUC__)
+    return __builtin_sub_overflow(lhs, rhs, &res);
+#else
+    using U = xci::make_unsigned_t<T>;
+    res = T(U(lhs) - U(rhs));
+    if constexpr (is_signed_integer_v<T>)
+        return ((lhs ^ rhs) & (lhs ^ res)) < 0;  // operands differ in sign and result has sign of rhs
+    else
+        return lhs < rhs;
+#endif
+}
+
+// 128-bit multiplication from 64-bit halves, avoids library call
+// (Clang emits __muloti4 for __builtin_mul_overflow, which is not in libgcc)
+constexpr bool mul_overflow_u128(uint128 lhs, uint128 rhs, uint128& res) {
+    const auto lhs_hi = uint64_t(lhs >> 64);
+    const auto rhs_hi = uint64_t(rhs >> 64);
+    const auto lhs_lo = uint64_t(lhs);
+    const auto rhs_lo = uint64_t(rhs);
+    // without overflow, at most one of the cross products is non-zero
+    const uint128 cross = uint128(lhs_hi) * rhs_lo + uint128(lhs_lo) * rhs_hi;
+    const uint128 low = uint128(lhs_lo) * rhs_lo;
+    res = low + (cross << 64);
+    return (lhs_hi != 0 && rhs_hi != 0) || (cross >> 64) != 0 || res < low;
+}
+
+constexpr bool mul_overflow_i128(int128 lhs, int128 rhs, int128& res) {
+    const bool negative = (lhs < 0) != (rhs < 0);
+    const uint128 lhs_abs = lhs < 0 ? uint128(0) - uint128(lhs) : uint128(lhs);
+    const uint128 rhs_abs = rhs < 0 ? uint128(0) - uint128(rhs) : uint128(rhs);
+    uint128 res_abs = 0;
+    const bool overflow = mul_overflow_u128(lhs_abs, rhs_abs, res_abs);
+    res = negative ? int128(uint128(0) - res_abs) : int128(res_abs);
+    // the magnitude of the negative result may be one larger
+    const uint128 limit = (uint128(1) << 127) - !negative;
+    return overflow || res_abs > limit;
+}
+
+template<class T>
+constexpr bool mul_overflow(T lhs, T rhs, T& res) {
+    if constexpr (std::is_same_v<T, uint128>) {
+        return mul_overflow_u128(lhs, rhs, res);
+    } else if constexpr (std::is_same_v<T, int128>) {
+        return mul_overflow_i128(lhs, rhs, res);
+    } else {
+#if defined(__GNUC__)
+        return __builtin_mul_overflow(lhs, rhs, &res);
+#else
+        // compute in wider type and check the range
+        using W = std::conditional_t<sizeof(T) < 8,
+                  std::conditional_t<is_signed_integer_v<T>, int64_t, uint64_t>,
+                  std::conditional_t<is_signed_integer_v<T>, int128, uint128>>;
+        W wide = 0;
+        if constexpr (sizeof(T) < 8)
+            wide = W(lhs) * W(rhs);
+        else if constexpr (is_signed_integer_v<T>)
+            mul_overflow_i128(lhs, rhs, wide);
+        else
+            mul_overflow_u128(lhs, rhs, wide);
+        res = T(wide);
+        return wide < W(std::numeric_limits<T>::min()) || wide > W(std::numeric_limits<T>::max());
+#endif
+    }
+}
+
+
 // Safe add with overflow check
 template<class T>
 constexpr T add(const T& lhs, const T& rhs ) {
-#if defined(__GNUC__)
-    if constexpr (std::is_integral_v<T>) {
+    if constexpr (is_integer_v<T>) {
         T r;
-        if (__builtin_add_overflow(lhs, rhs, &r))
-            throw value_out_of_range("Integer overflow");
+        if (add_overflow(lhs, rhs, r)) [[unlikely]]
+            throw_integer_overflow();
         return r;
     } else
-#endif
         return lhs + rhs;
 }
 
 template<class T>
 constexpr T sub(const T& lhs, const T& rhs ) {
-#if defined(__GNUC__)
-    if constexpr (std::is_integral_v<T>) {
-         T r;
-         if (__builtin_sub_overflow(lhs, rhs, &r))
-            throw value_out_of_range("Integer overflow");
-         return r;
+    if constexpr (is_integer_v<T>) {
+        T r;
+        if (sub_overflow(lhs, rhs, r)) [[unlikely]]
+            throw_integer_overflow();
+        return r;
     } else
-#endif
-         return lhs - rhs;
+        return lhs - rhs;
 }
 
 template<class T>
 constexpr T mul(const T& lhs, const T& rhs ) {
-#if defined(__GNUC__)
-    // Note: fails to link with int128 on Linux with Clang (undefined reference to `__muloti4')
-    if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
-         T r;
-         if (__builtin_mul_overflow(lhs, rhs, &r))
-            throw value_out_of_range("Integer overflow");
-         return r;
+    if constexpr (is_integer_v<T>) {
+        T r;
+        if (mul_overflow(lhs, rhs, r)) [[unlikely]]
+            throw_integer_overflow();
+        return r;
     } else
-#endif
-         return lhs * rhs;
+        return lhs * rhs;
 }
 
 template<class T>
 constexpr T div(const T& lhs, const T& rhs ) {
-    if constexpr (std::is_integral_v<T>) {
-         if (rhs == 0)
-            throw value_out_of_range("Division by zero");
-         return lhs / rhs;
+    if constexpr (is_integer_v<T>) {
+        if (rhs == 0) [[unlikely]]
+            throw_division_by_zero();
+        if constexpr (is_signed_integer_v<T>) {
+            // MIN / -1 overflows (and traps on x86)
+            if (rhs == T(-1)) [[unlikely]]
+                return sub(T(0), lhs);
+        }
+        return lhs / rhs;
     } else
-         return lhs / rhs;
+        return lhs / rhs;
 }
 
 template<class T>
 constexpr T mod(const T& lhs, const T& rhs ) {
-    if constexpr (std::is_integral_v<T> || std::is_same_v<T, uint128> || std::is_same_v<T, int128>) {
-         if (rhs == 0)
-            throw value_out_of_range("Division by zero");
-         return lhs % rhs;
+    if constexpr (is_integer_v<T>) {
+        if (rhs == 0) [[unlikely]]
+            throw_division_by_zero();
+        if constexpr (is_signed_integer_v<T>) {
+            // MIN % -1 would trap on x86, the result is always zero
+            if (rhs == T(-1)) [[unlikely]]
+                return T(0);
+        }
+        return lhs % rhs;
     } else if constexpr (std::is_same_v<T, float>) {
-         return fmodf(lhs, rhs);
+        return fmodf(lhs, rhs);
     } else if constexpr (std::is_same_v<T, double>) {
-         return fmod(lhs, rhs);
+        return fmod(lhs, rhs);
     } else if constexpr (std::is_same_v<T, long double> || std::is_same_v<T, float128>) {
-         return fmodl(lhs, rhs);
+        return fmodl(lhs, rhs);
     }
 }
 
 template<class T>
 constexpr T unsafe_mod(const T& lhs, const T& rhs ) noexcept {
-    if constexpr (std::is_integral_v<T> || std::is_same_v<T, uint128> || std::is_same_v<T, int128>) {
+    if constexpr (is_integer_v<T>) {
         return lhs % rhs;
     } else if constexpr (std::is_same_v<T, float>) {
         return fmodf(lhs, rhs);
@@ -122,25 +223,33 @@ constexpr T unsafe_mod(const T& lhs, const T& rhs ) noexcept {
     }
 }
 
+// Power with overflow check
+// Integer power with negative exponent is truncated like the division: 1 / x ^ -n
 template<class T>
-constexpr T exp(T x, T n ) noexcept
+constexpr T exp(T x, T n )
 {
-    if constexpr (std::is_integral_v<T> || std::is_same_v<T, uint128> || std::is_same_v<T, int128>) {
-         // https://en.wikipedia.org/wiki/Exponentiation_by_squaring
-         if (n == 0)
-            return 1;
-         if (n < 0) {
-            x = 1 / x;
-            n = -n;
-         }
-         T res = 1;
-         while (n > 1) {
+    if constexpr (is_integer_v<T>) {
+        if constexpr (is_signed_integer_v<T>) {
+            if (n < 0) {
+                if (x == 0)
+                    throw_division_by_zero();
+                if (x == 1 || x == T(-1))
+                    return (n & 1) ? x : T(1);
+                return T(0);
+            }
+        }
+        // https://en.wikipedia.org/wiki/Exponentiation_by_squaring
+        // The square is computed only when a higher bit of `n` needs it,
+        // so its overflow means the result overflows too.
+        T res = 1;
+        for (;;) {
             if (n & 1)
-                res *= x;
-            x *= x;
+                res = mul(res, x);
             n >>= 1;
-         }
-         return res * x;
+            if (n == 0)
+                return res;
+            x = mul(x, x);
+        }
     } else if constexpr (std::is_same_v<T, float>) {
          return powf(x, n);
     } else if constexpr (std::is_same_v<T, double>) {
@@ -163,6 +272,7 @@ private:
     void add_intrinsics();
     void add_types();
     void add_string_functions();
+    void add_list_functions();
     void add_io_functions();
     void add_introspections();
 
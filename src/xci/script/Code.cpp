@@ -78,6 +78,25 @@ std::ostream& operator<<(std::ostream& os, Opcode v)
         case Opcode::ListLength:        return os << "LIST_LENGTH";
         case Opcode::ListSlice:         return os << "LIST_SLICE";
         case Opcode::ListConcat:        return os << "LIST_CONCAT";
+        case Opcode::ListMap:           return os << "LIST_MAP";
+        case Opcode::ListFilter:        return os << "LIST_FILTER";
+        case Opcode::ListFold:          return os << "LIST_FOLD";
+        case Opcode::ListZip:           return os << "LIST_ZIP";
+        case Opcode::MapFromList:       return os << "MAP_FROM_LIST";
+        case Opcode::MapLength:         return os << "MAP_LENGTH";
+        case Opcode::MapGet:            return os << "MAP_GET";
+        case Opcode::MapContains:       return os << "MAP_CONTAINS";
+        case Opcode::MapInsert:         return os << "MAP_INSERT";
+        case Opcode::MapRemove:         return os << "MAP_REMOVE";
+        case Opcode::MapItems:          return os << "MAP_ITEMS";
+        case Opcode::IterFromList:      return os << "ITER_FROM_LIST";
+        case Opcode::IterMap:           return os << "ITER_MAP";
+        case Opcode::IterFilter:        return os << "ITER_FILTER";
+        case Opcode::IterTake:          return os << "ITER_TAKE";
+        case Opcode::IterIterate:       return os << "ITER_ITERATE";
+        case Opcode::IterFold:          return os << "ITER_FOLD";
+        case Opcode::IterCollect:       return os << "ITER_COLLECT";
+        case Opcode::Memo:              return os << "MEMO";
         case Opcode::Invoke:            return os << "INVOKE";
         case Opcode::LoadStatic:        return os << "LOAD_STATIC";
         case Opcode::LoadModule:        return os << "LOAD_MODULE";
@@ -92,6 +111,7 @@ std::ostream& operator<<(std::ostream& os, Opcode v)
         case Opcode::TailCall0:         return os << "TAIL_CALL0";
         case Opcode::TailCall1:         return os << "TAIL_CALL1";
         case Opcode::TailCall:          return os << "TAIL_CALL";
+        case Opcode::CallNative:        return os << "CALL_NATIVE";
         case Opcode::Execute:           return os << "EXECUTE";
         case Opcode::MakeClosure:       return os << "MAKE_CLOSURE";
         case Opcode::MakeList:          return os << "MAKE_LIST";
@@ -100,6 +120,7 @@ std::ostream& operator<<(std::ostream& os, Opcode v)
         case Opcode::DecRef:            return os << "DEC_REF";
         case Opcode::Jump:              return os << "JUMP";
         case Opcode::JumpIfNot:         return os << "JUMP_IF_NOT";
+        case Opcode::JumpBack:          return os << "JUMP_BACK";
         case Opcode::Ret:               return os << "RET";
         case Opcode::Annotation:        return os << "(ANNOTATION)";
     }
@@ -18,6 +18,8 @@
 namespace xci::script {
 
 
+// The values are saved in compiled modules, increment Module::format_version
+// when adding or reordering the opcodes.
 enum class Opcode: uint8_t {
     // --------------------------------------------------------------
     // A0 (no operands)
@@ -152,14 +154,39 @@ enum class Opcode: uint8_t {
     ListLength,             // operand = elem type (type index), get list length - pull the list, push length:UInt32
     ListSlice,              // operand = elem type, slice a list - pull the list, pull begin:Int, end:Int, step:Int, push sliced list
     ListConcat,             // operand = elem type, concat two lists - pull a, b lists from stack, push a + b
+    ListMap,                // operand = (elem, result) tuple type, pull function, list, call the function for each elem, push list of results
+    ListFilter,             // operand = elem type, pull function (predicate), list, push list of elems for which the predicate returned true
+    ListFold,               // operand = (elem, acc) tuple type, pull function, initial acc, list, call the function with (acc, elem) for each elem, push final acc
+    ListZip,                // operand = (a, b) tuple type, pull a, b lists, push list of (a, b) tuples (length of the shorter list)
+
+    MapFromList,            // operand = map type (type index), pull a list of (key, value) tuples, push a new map
+    MapLength,              // operand = map type, pull the map, push number of entries:UInt
+    MapGet,                 // operand = map type, pull the map, key, default value, push the value for key (or the default)
+    MapContains,            // operand = map type, pull the map, key, push Bool
+    MapInsert,              // operand = map type, pull the map, key, value, push the map with the entry inserted or replaced
+    MapRemove,              // operand = map type, pull the map, key, push the map without the entry
+    MapItems,               // operand = map type, pull the map, push list of (key, value) tuples
+
+    IterFromList,           // operand = elem type, pull a list, push an iterator over its elements
+    IterMap,                // operand = (elem, result) tuple type, pull function, iterator, push an iterator which calls the function on each elem when stepped
+    IterFilter,             // operand = elem type, pull function (predicate), iterator, push an iterator which skips the elems for which the predicate returned false
+    IterTake,               // operand = elem type, pull n:Int, iterator, push an iterator which ends after n elems
+    IterIterate,            // operand = elem type, pull function, initial value, push infinite iterator of (init, f init, f (f init), ...)
+    IterFold,               // operand = (elem, acc) tuple type, pull function, initial acc, iterator, step the iterator to the end, calling the function with (acc, elem), push final acc
+    IterCollect,            // operand = elem type, pull iterator, step it to the end, push list of the elems
+
+    Memo,                   // operand = (arg, result) tuple type, pull function, arg, push cached result or call the function and cache the result
 
     Invoke,                 // operand = type index in current module, pull value from stack, invoke it
 
+    JumpBack,               // operand = relative jump (-N bytes, counted from the end of this instruction) - unconditional
+
     // --------------------------------------------------------------
     // L2 (two LEB128-encoded operands)
 
     Call,                   // operand1 = idx of imported module, operand2 = idx of function in the module, call it, pull args from stack, push result back
     TailCall,               // same as Call, but pop stack frame before the call
+    CallNative,             // operand1 = 0 for current module or 1 + idx of imported module, operand2 = idx of native function in the module, call it directly (no stack frame)
 
     MakeList,               // operand1 = number of elements, operand2 = elem type (type index), pulls number elems from stack, creates list on heap, pushes list handle back to stack
 
@@ -177,7 +204,7 @@ enum class Opcode: uint8_t {
     B1First = Cast,
     B1Last = JumpIfNot,
     L1First = LoadStatic,
-    L1Last = Invoke,
+    L1Last = JumpBack,
     L2First = Call,
     L2Last = Annotation,
 };
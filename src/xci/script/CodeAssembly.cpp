@@ -10,10 +10,13 @@
 
 #include <range/v3/view/enumerate.hpp>
 
+#include <map>
+
 namespace xci::script {
 
 using namespace xci::core;
 using xci::data::leb128_decode;
+using xci::data::leb128_length;
 using ranges::views::enumerate;
 
 
@@ -43,6 +46,28 @@ void CodeAssembly::disassemble_labels(size_t addr, std::vector<Label>& labels)
 void CodeAssembly::disassemble(const Code& code)
 {
     std::vector<Label> labels;
+
+    // Find targets of backward jumps first, their labels appear before the jump
+    std::map<size_t, size_t> back_labels;  // addr -> label index
+    for (auto it = code.begin(); it != code.end(); ) {
+        const auto opcode = static_cast<Opcode>(*it); ++it;
+        if (opcode >= Opcode::B1First && opcode <= Opcode::B1Last)
+            ++it;
+        else if (opcode >= Opcode::L1First && opcode <= Opcode::L1Last) {
+            const auto arg = leb128_decode<size_t>(it);
+            if (opcode == Opcode::JumpBack) {
+                const size_t target = size_t(it - code.begin()) - arg;
+                if (back_labels.try_emplace(target, labels.size()).second)
+                    labels.push_back({.addr = target});
+            }
+        }
+        else if (opcode >= Opcode::L2First && opcode <= Opcode::L2Last) {
+            leb128_decode<size_t>(it);
+            leb128_decode<size_t>(it);
+        }
+    }
+    disassemble_labels(0, labels);
+
     auto it = code.begin();
     while (it != code.end()) {
         Instruction& instr = m_instr.emplace_back();
@@ -60,6 +85,12 @@ void CodeAssembly::disassemble(const Code& code)
         }
         else if (instr.opcode >= Opcode::L1First && instr.opcode <= Opcode::L1Last) {
             instr.args.first = leb128_decode<size_t>(it);
+            if (instr.opcode == Opcode::JumpBack) {
+                // replace by annotation, the label was already placed
+                instr.args.second = back_labels[size_t(it - code.begin()) - instr.args.first];
+                instr.args.first = size_t(instr.opcode);
+                instr.opcode = Opcode::Annotation;
+            }
         }
         else if (instr.opcode >= Opcode::L2First && instr.opcode <= Opcode::L2Last) {
             instr.args = std::make_pair(leb128_decode<size_t>(it), leb128_decode<size_t>(it));
@@ -77,7 +108,7 @@ void CodeAssembly::disassemble(const Code& code)
 void CodeAssembly::assemble_repeat_jumps(Code& code, std::vector<Label>& labels)
 {
     for (auto& label : labels) {
-        if (label.processed)
+        if (label.processed || !label.jumped)
             continue;
         if (code.size() - label.addr > 255 - 21 - 2) {
             // 21 is the longest instruction code possible (L2 with two max size_t args)
@@ -102,11 +133,25 @@ void CodeAssembly::assemble_to(Code& code)
             if (annot == Annotation::Jump || annot == Annotation::JumpIfNot) {
                 code.add_B1(Opcode(annot), 0);
                 labels[label_idx].addr = code.size();
+                labels[label_idx].jumped = true;
+            } else if (annot == Annotation::JumpBack) {
+                const auto& label = labels[label_idx];
+                assert(label.processed);
+                // The offset is counted from the end of the instruction,
+                // which depends on the length of the encoded offset
+                const size_t base = code.size() + 1;
+                unsigned len = 1;
+                while (leb128_length(base + len - label.addr) > len)
+                    ++len;
+                code.add_L1(Opcode::JumpBack, base + len - label.addr);
             } else if (annot == Annotation::Label) {
                 auto& label = labels[label_idx];
-                size_t jump = code.size() - label.addr;
-                assert(jump <= 255);
-                code.set(label.addr - 1, uint8_t(jump));
+                if (label.jumped) {
+                    size_t jump = code.size() - label.addr;
+                    assert(jump <= 255);
+                    code.set(label.addr - 1, uint8_t(jump));
+                } else
+                    label.addr = code.size();  // target of backward jump
                 label.processed = true;
             }
             // else: ignore, do not generate any code
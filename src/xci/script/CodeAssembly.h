@@ -21,6 +21,7 @@ public:
         Label = 1000,                          // arg2 = index of label, removed during assembly
         Jump = size_t(Opcode::Jump),           // arg2 = index of label, replaced by Opcode::Jump
         JumpIfNot = size_t(Opcode::JumpIfNot), // arg2 = index of label, replaced by Opcode::JumpIfNot
+        JumpBack = size_t(Opcode::JumpBack),   // arg2 = index of label (placed before), replaced by Opcode::JumpBack
     };
 
     struct Instruction {
@@ -76,6 +77,7 @@ public:
     void pop_back() { m_instr.pop_back(); }
     void remove(size_t idx) { m_instr.erase(m_instr.begin() + idx); }
     void remove(size_t idx, size_t count) { m_instr.erase(m_instr.begin() + idx, m_instr.begin() + idx + count); }
+    void insert(size_t idx, const Instruction& instr) { m_instr.insert(m_instr.begin() + idx, instr); }
 
     bool operator==(const CodeAssembly& rhs) const { return m_instr == rhs.m_instr; }
 
@@ -87,8 +89,10 @@ public:
 private:
     struct Label {
         size_t addr;  // disassembly: address where the label will appear
-                      // assembly: base address for computing jump offset
+                      // assembly: base address for computing jump offset,
+                      //           or address of the label for backward jump
         bool processed = false;
+        bool jumped = false;  // assembly: forward jump was generated
     };
     void disassemble_labels(size_t addr, std::vector<Label>& labels);
     void assemble_repeat_jumps(Code& code, std::vector<Label>& labels);
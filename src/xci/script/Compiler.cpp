@@ -15,10 +15,15 @@
 #include "ast/fold_dot_call.h"
 #include "ast/fold_tuple.h"
 #include "ast/fold_paren.h"
+#include "ast/fuse_list_ops.h"
 #include "code/optimize_tail_call.h"
 #include "code/optimize_copy_drop.h"
+#include "code/optimize_native_call.h"
+#include "code/check_memo.h"
+#include "code/verify_bytecode.h"
 #include "typing/type_index.h"
 #include "Stack.h"
+#include <xci/core/log.h>
 #include <xci/compat/macros.h>
 
 #include <ranges>
@@ -390,12 +395,25 @@ public:
         m_intrinsic = v.intrinsic;
         m_instruction_args.clear();
 
-        m_callable = false;
-        if (v.arg)
-            v.arg->apply(*this);
+        size_t field_ofs;
+        const TypeInfo* field_ti;
+        if (find_in_frame(v, field_ofs, field_ti)) {
+            // Field of a struct parameter or nonlocal (`a.b.c`) - copy just the field,
+            // instead of copying the whole struct and dropping the other fields
+            // COPY <frame_offset> <size>
+            code().add_L2(Opcode::Copy, field_ofs, field_ti->size());
+            field_ti->foreach_heap_slot([this](size_t offset) {
+                // INC_REF <stack_offset>
+                code().add_L1(Opcode::IncRef, offset);
+            });
+        } else {
+            m_callable = false;
+            if (v.arg)
+                v.arg->apply(*this);
 
-        m_callable = true;
-        v.callable->apply(*this);
+            m_callable = true;
+            v.callable->apply(*this);
+        }
 
         // add executes for each call that results in function which consumes more args
         if (v.wrapped_execs > 1) {
@@ -534,6 +552,45 @@ private:
     Function& function() { return m_scope.function(); }
     CodeAssembly& code() { return function().asm_code(); }
 
+    // Find the value of `expr` in the frame of current function.
+    // The expression is either a parameter / nonlocal reference,
+    // or a (possibly nested) struct item access on it, e.g. `a.b.c`.
+    // Returns false if the value is not in frame (e.g. a struct returned from a call).
+    bool find_in_frame(const ast::Expression& expr, size_t& offset, const TypeInfo*& ti) {
+        if (const auto* ref = dynamic_cast<const ast::Reference*>(&expr)) {
+            const auto& sym = *ref->identifier.symbol;
+            if (sym.type() == Symbol::Parameter && sym.depth() == 0) {
+                ti = &function().parameter(sym.index());
+                offset = function().parameter_offset(sym.index()) + function().raw_size_of_nonlocals();
+                return true;
+            }
+            if (sym.type() == Symbol::Nonlocal) {
+                ti = &ref->ti;
+                offset = m_scope.nonlocal_raw_offset(sym.index(), ref->ti);
+                return true;
+            }
+            return false;
+        }
+        const auto* call = dynamic_cast<const ast::Call*>(&expr);
+        if (call == nullptr || !call->arg || call->intrinsic || call->wrapped_execs != 0)
+            return false;
+        const auto* item_ref = dynamic_cast<const ast::Reference*>(call->callable.get());
+        if (item_ref == nullptr || item_ref->identifier.symbol->type() != Symbol::StructItem)
+            return false;
+        if (!find_in_frame(*call->arg, offset, ti) || !ti->underlying().is_struct())
+            return false;
+        // the first item is on top, i.e. at the lowest offset
+        const auto& name = item_ref->identifier.symbol->name();
+        for (const auto& item : ti->underlying().subtypes()) {
+            if (item.key() == name) {
+                ti = &item;
+                return true;
+            }
+            offset += item.size();
+        }
+        return false;
+    }
+
     void make_closure(const Scope& scope) {
         if (!scope.has_nonlocals())
             return;
@@ -656,6 +713,9 @@ void Compiler::compile(Scope& scope, ast::Module& ast)
     if ((m_flags & Flags::ResolveSymbols) == Flags::ResolveSymbols)
         resolve_symbols(scope, ast.body);
 
+    if ((m_flags & Flags::FuseListOps) == Flags::FuseListOps)
+        fuse_list_ops(scope, ast.body);
+
     if ((m_flags & Flags::ResolveDecl) == Flags::ResolveDecl)
         resolve_decl(scope, ast.body);
 
@@ -674,8 +734,11 @@ void Compiler::compile(Scope& scope, ast::Module& ast)
     if ((m_flags & Flags::FoldConstExpr) == Flags::FoldConstExpr)
         fold_const_expr(func, ast.body);
 
-    if ((m_flags & Flags::CompileFunctions) == Flags::CompileFunctions)
+    if ((m_flags & Flags::CompileFunctions) == Flags::CompileFunctions) {
         compile_function(scope, ast.body);
+        // functions passed to `memo` must be pure
+        foreach_asm_fn_in_module(scope.module(), check_memo_functions);
+    }
 
     // TODO
 //    if ((m_flags & Flags::InlineFunctions) == Flags::InlineFunctions)
@@ -687,8 +750,22 @@ void Compiler::compile(Scope& scope, ast::Module& ast)
     if ((m_flags & Flags::OptimizeTailCall) == Flags::OptimizeTailCall)
         foreach_asm_fn_in_module(scope.module(), optimize_tail_call);
 
+    if ((m_flags & Flags::OptimizeNativeCall) == Flags::OptimizeNativeCall)
+        foreach_asm_fn_in_module(scope.module(), optimize_native_call);
+
     if ((m_flags & Flags::AssembleFunctions) == Flags::AssembleFunctions)
-        foreach_asm_fn_in_module(scope.module(), [](Function& fn){ fn.assembly_to_bytecode(); });
+        foreach_asm_fn_in_module(scope.module(), [](Function& fn){
+            fn.assembly_to_bytecode();
+            // verified functions run on the fast path in Machine,
+            // the rest stays on the checked path
+            try {
+                verify_bytecode(fn);
+            } catch (const ScriptError& e) {
+                // the compiled code should always pass, this is a bug
+                // in the compiler or the verifier (tests check is_verified)
+                core::log::warning("Compiler: bytecode of '{}' not verified: {}", fn.qualified_name(), e.what());
+            }
+        });
 }
 
 
@@ -36,14 +36,16 @@ public:
         InlineFunctions     = 0x0002u << 16,
         OptimizeCopyDrop    = 0x0004u << 16,
         OptimizeTailCall    = 0x0008u << 16,
+        FuseListOps         = 0x0010u << 16,
+        OptimizeNativeCall  = 0x0020u << 16,
 
         // Bit masks
         MandatoryMask       = 0xffffu,
         OptimizationMask    = 0xffffu << 16,
 
         // Predefined optimization levels
-        OptLevel1       = OptimizeTailCall | OptimizeCopyDrop,
-        OptLevel2       = OptLevel1 | FoldConstExpr | InlineFunctions,
+        OptLevel1       = OptimizeTailCall | OptimizeCopyDrop | OptimizeNativeCall,
+        OptLevel2       = OptLevel1 | FoldConstExpr | InlineFunctions | FuseListOps,
 
         // ---------------------------------------------------------------------
         // The following flags are safe to use individually
@@ -66,6 +68,8 @@ public:
         // Optimization passes
         OPCopyDrop      = OptimizeCopyDrop | CPCompile,
         OPTailCall      = OptimizeTailCall | CPCompile,
+        OPFuseListOps   = FuseListOps | PPSymbols,
+        OPNativeCall    = OptimizeNativeCall | CPCompile,
 
         // All mandatory passes, no optimization
         Mandatory       = CPAssemble,
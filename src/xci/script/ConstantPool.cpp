@@ -0,0 +1,180 @@
+// ConstantPool.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "ConstantPool.h"
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace xci::script {
+
+
+static bool has_heap_slot(const TypeInfo& ti)
+{
+    bool res = false;
+    ti.foreach_heap_slot([&res](size_t) { res = true; });
+    return res;
+}
+
+
+// Raw content of a value which can be pooled, nullopt for other values
+static std::optional<std::string_view> pooled_content(const TypedValue& v)
+{
+    if (v.value().heapslot() == nullptr)
+        return {};  // not on heap (plain data, inline or empty string, empty list)
+    const TypeInfo& ti = v.type_info().underlying();
+    if (ti.is_string())
+        return v.get<StringV>().value();
+    if (ti.is_list() && ti.elem_type().size() != 0 && !has_heap_slot(ti.elem_type())) {
+        const auto& list = v.get<ListV>();
+        return std::string_view(reinterpret_cast<const char*>(list.raw_data()),
+                                list.length() * ti.elem_type().size());
+    }
+    return {};
+}
+
+
+static uint64_t content_hash(const TypedValue& v, std::string_view content)
+{
+    return std::hash<std::string_view>{}(content)
+           ^ uint64_t(v.type_info().underlying().type()) * 0x9e3779b97f4a7c15;
+}
+
+
+ConstantPool::~ConstantPool()
+{
+    for (auto& [hash, entry] : m_entries) {
+        entry.value.value().heapslot()->make_mortal();
+        entry.value.decref();
+    }
+}
+
+
+TypedValue ConstantPool::intern(TypedValue&& value)
+{
+    const auto content = pooled_content(value);
+    if (!content)
+        return std::move(value);
+
+    const uint64_t hash = content_hash(value, *content);
+    const auto [begin, end] = m_entries.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        Entry& entry = it->second;
+        if (entry.value.type_info() == value.type_info() && pooled_content(entry.value) == content) {
+            ++entry.uses;
+            if (value.value().heapslot()->slot() != entry.value.value().heapslot()->slot()) {
+                ++m_stats.hits;
+                m_stats.bytes_saved += content->size();
+                value.decref();
+            }
+            return entry.value;
+        }
+    }
+
+    ++m_stats.misses;
+    const HeapSlot& slot = *value.value().heapslot();
+    if (slot.refcount() != 1) {
+        // The slot is shared with someone else (e.g. AST literal, or another pool),
+        // which could still use it after it's freed by the pool. Make own copy.
+        const TypeInfo& ti = value.type_info().underlying();
+        TypedValue copy;
+        if (ti.is_string()) {
+            copy = TypedValue(value::String(*content), value.type_info());
+        } else {
+            value::List list(content->size() / ti.elem_type().size(), ti.elem_type());
+            std::memcpy(list.get<ListV>().raw_data(), content->data(), content->size());
+            copy = TypedValue(std::move(list), value.type_info());
+        }
+        value.decref();
+        value = std::move(copy);
+    }
+    value.value().heapslot()->make_immortal();
+    m_entries.emplace(hash, Entry{value, 1});
+    return std::move(value);
+}
+
+
+void ConstantPool::release(TypedValue&& value)
+{
+    const auto content = pooled_content(value);
+    if (content && value.value().heapslot()->is_immortal()) {
+        const auto [begin, end] = m_entries.equal_range(content_hash(value, *content));
+        for (auto it = begin; it != end; ++it) {
+            Entry& entry = it->second;
+            if (entry.value.value().heapslot()->slot() != value.value().heapslot()->slot())
+                continue;
+            if (--entry.uses == 0) {
+                entry.value.value().heapslot()->make_mortal();
+                entry.value.decref();
+                m_entries.erase(it);
+            }
+            return;
+        }
+    }
+    value.decref();
+}
+
+
+void ConstantPool::make_mortal(std::byte* data, const TypeInfo& type_info)
+{
+    const TypeInfo& ti = type_info.underlying();
+    switch (ti.type()) {
+        case Type::String: {
+            StringV str;
+            str.read(data);
+            if (!str.is_inline() && str.slot.is_immortal())
+                StringV(str.value()).write(data);
+            break;
+        }
+        case Type::List: {
+            HeapSlot slot;
+            slot.read(data);
+            if (!slot)
+                break;
+            ListV list(std::move(slot));
+            const TypeInfo& elem_ti = ti.elem_type();
+            if (list.slot.is_immortal()) {
+                // pooled lists contain only plain data, no need to incref the elements
+                list = ListV(list.length(), elem_ti, list.raw_data());
+                list.slot.write(data);
+            }
+            if (has_heap_slot(elem_ti)) {
+                const size_t elem_size = elem_ti.size();
+                std::byte* elem = list.raw_data();
+                for (size_t i = 0; i != list.length(); ++i, elem += elem_size)
+                    make_mortal(elem, elem_ti);
+            }
+            break;
+        }
+        case Type::Map: {
+            HeapSlot slot;
+            slot.read(data);
+            if (!slot)
+                break;
+            const TypeInfo& key_ti = ti.map_key_type();
+            const TypeInfo& value_ti = ti.map_value_type();
+            if (!has_heap_slot(key_ti) && !has_heap_slot(value_ti))
+                break;
+            MapV(std::move(slot)).foreach_raw(key_ti, value_ti, [&](std::byte* key, std::byte* value) {
+                make_mortal(key, key_ti);
+                make_mortal(value, value_ti);
+            });
+            break;
+        }
+        case Type::Tuple:
+        case Type::Struct:
+            for (const auto& sub_ti : ti.subtypes()) {
+                make_mortal(data, sub_ti);
+                data += sub_ti.size();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+} // namespace xci::script
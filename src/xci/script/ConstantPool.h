@@ -0,0 +1,81 @@
+// ConstantPool.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_CONSTANT_POOL_H
+#define XCI_SCRIPT_CONSTANT_POOL_H
+
+#include "Value.h"
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+namespace xci::script {
+
+
+/// Pool of immutable constants shared by all modules of a ModuleManager
+///
+/// Static values which live on heap (strings, lists of plain data)
+/// are deduplicated across the modules: each distinct constant is stored
+/// once, and the modules share its heap slot. The pooled slots are immortal
+/// (see HeapSlot::make_immortal), copying them to stack doesn't touch
+/// the refcount and they are never freed by decref. Instead, the pool counts
+/// the modules' uses of each constant (`intern` / `release`) and frees it
+/// when the last module using it releases it. Each Module holds a shared
+/// pointer to the pool, so the pool outlives all modules which reference it.
+///
+/// The values which leave the VM (results of Machine::call, invoked values,
+/// PreparedCall results) must not keep pointing to the pooled slots,
+/// which might be freed when the module is unloaded. The Machine replaces
+/// them by mortal copies, see `make_mortal`.
+///
+/// Other values (plain data, type indexes, streams...) are not pooled.
+/// Type indexes are local to a module, they can't be shared.
+
+class ConstantPool {
+public:
+    ConstantPool() = default;
+    ConstantPool(const ConstantPool&) = delete;
+    ConstantPool& operator=(const ConstantPool&) = delete;
+    ~ConstantPool();
+
+    // Return the pooled equivalent of the value, taking over the reference.
+    // When the value is not in the pool yet, it's added (made immortal).
+    // Each call counts one use of the constant, balance it by `release`.
+    // Values which can't be pooled are returned unchanged.
+    TypedValue intern(TypedValue&& value);
+
+    // Release a value returned by `intern`. The pooled constant is freed
+    // with its last use. Values which are not pooled are just decref'd.
+    void release(TypedValue&& value);
+
+    // Replace pooled constants in raw value data (as laid out on stack)
+    // by mortal copies. Walks into tuples, structs, lists and maps.
+    // Closures and iterators are not walked - they can't outlive their module anyway.
+    static void make_mortal(std::byte* data, const TypeInfo& type_info);
+
+    struct Stats {
+        size_t hits = 0;        // the constant was already in the pool
+        size_t misses = 0;      // the constant was added to the pool
+        size_t bytes_saved = 0; // heap bytes not allocated thanks to the hits
+    };
+    const Stats& stats() const { return m_stats; }
+
+    // Number of pooled constants
+    size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        TypedValue value;
+        size_t uses;
+    };
+    std::unordered_multimap<uint64_t, Entry> m_entries;  // hash of content -> constant
+    Stats m_stats;
+};
+
+
+} // namespace xci::script
+
+#endif // include guard
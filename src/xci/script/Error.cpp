@@ -50,6 +50,8 @@ std::ostream& operator<<(std::ostream& os, ErrorCode v)
         case ErrorCode::IntrinsicsFunctionError:    return os << "IntrinsicsFunctionError";
         case ErrorCode::UnresolvedSymbol:           return os << "UnresolvedSymbol";
         case ErrorCode::ImportError:                return os << "ImportError";
+        case ErrorCode::MemoFunctionError:          return os << "MemoFunctionError";
+        case ErrorCode::BadBytecode:                return os << "BadBytecode";
         case ErrorCode::ModuleNotFound:             return os << "ModuleNotFound";
     }
     XCI_UNREACHABLE;
@@ -66,6 +66,8 @@ enum ErrorCode {
     IntrinsicsFunctionError,
     UnresolvedSymbol,
     ImportError,
+    MemoFunctionError,
+    BadBytecode,
 };
 
 
@@ -300,6 +302,20 @@ inline ScriptError import_error(NameId name) {
 }
 
 
+// Thrown by the compiler, or by the machine when the function wasn't known at compile time
+inline RuntimeError memo_function_error(string_view fn, string_view reason) {
+    return RuntimeError(ErrorCode::MemoFunctionError,
+                        fmt::format("function cannot be memoized: {} ({})", fn, reason));
+}
+
+
+// Thrown by the bytecode verifier (see code/verify_bytecode.h)
+inline ScriptError bad_bytecode(string_view fn, size_t offset, string_view reason) {
+    return ScriptError(ErrorCode::BadBytecode,
+                       fmt::format("bad bytecode in function {} at offset {}: {}", fn, offset, reason));
+}
+
+
 } // namespace xci::script
 
 template <> struct fmt::formatter<xci::script::ErrorCode> : ostream_formatter {};
@@ -36,12 +36,22 @@ Function::Function(Module& mod, SymbolTable& symtab)
 Function::Function(Function&& rhs) noexcept
         : m_module(rhs.m_module), m_symtab(rhs.m_symtab),
           m_signature(std::move(rhs.m_signature)),
-          m_body(std::move(rhs.m_body))
+          m_body(std::move(rhs.m_body)),
+          m_memo_id(rhs.m_memo_id)
 {
     m_symtab->set_function(this);
 }
 
 
+Function::~Function()
+{
+    if (const auto* slot = m_static_closure.heapslot(); *slot) {
+        slot->make_mortal();
+        m_static_closure.decref();
+    }
+}
+
+
 const TypeInfo& Function::parameter(Index idx) const
 {
     if (idx == no_index)
@@ -68,6 +78,17 @@ size_t Function::parameter_offset(Index idx) const
 }
 
 
+const value::Closure& Function::static_closure() const
+{
+    assert(!has_nonlocals());
+    if (!*m_static_closure.heapslot()) {
+        m_static_closure = value::Closure(*this);
+        m_static_closure.heapslot()->make_immortal();
+    }
+    return m_static_closure;
+}
+
+
 size_t Function::raw_size_of_nonlocals() const
 {
     return std::accumulate(nonlocals().begin(), nonlocals().end(), size_t(0),
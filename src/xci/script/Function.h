@@ -14,6 +14,7 @@
 #include "TypeInfo.h"
 #include "NativeDelegate.h"
 #include <map>
+#include <memory>
 #include <string>
 #include <variant>
 
@@ -21,6 +22,7 @@ namespace xci::script {
 
 class Module;
 class Stack;
+namespace jit { class CompiledFunction; }
 
 // Scope of names and values
 //
@@ -45,6 +47,7 @@ public:
     explicit Function(Module& mod);  // only for deserialization!
     explicit Function(Module& mod, SymbolTable& symtab);
     Function(Function&& rhs) noexcept;
+    ~Function();
     Function& operator =(Function&&) = delete;
 
     bool operator==(const Function& rhs) const;
@@ -109,6 +112,13 @@ public:
 
     // Kind of function body
 
+    // state of tier-up JIT compilation (see Machine and jit/Jit.h)
+    struct JitState {
+        uint32_t calls = 0;     // counted until the function is compiled
+        bool rejected = false;  // the function can't be compiled
+        std::shared_ptr<const jit::CompiledFunction> code;
+    };
+
     // function has compiled bytecode
     struct BytecodeBody {
         bool operator==(const BytecodeBody& rhs) const { return code == rhs.code; }
@@ -119,6 +129,8 @@ public:
         }
 
         Code code;
+        mutable JitState jit;
+        mutable bool verified = false;  // passed verify_bytecode (see code/verify_bytecode.h)
     };
 
     // function has intermediate relocatable compiled bytecode
@@ -187,6 +199,7 @@ public:
         }
 
         NativeDelegate native;
+        bool io = false;  // does I/O (is not pure)
     };
 
     void set_undefined() { m_body = std::monostate{}; }
@@ -196,12 +209,36 @@ public:
     void set_native(NativeDelegate native) { m_body = NativeBody{native}; }
     void call_native(Stack& stack) const { std::get<NativeBody>(m_body).native(stack); }
 
+    // native function does I/O - it's not pure and cannot be memoized
+    void set_io(bool io = true) { std::get<NativeBody>(m_body).io = io; }
+    bool has_io() const { return is_native() && std::get<NativeBody>(m_body).io; }
+
     bool is_undefined() const { return std::holds_alternative<std::monostate>(m_body); }
     bool is_bytecode() const { return std::holds_alternative<BytecodeBody>(m_body); }
     bool is_assembly() const { return std::holds_alternative<AssemblyBody>(m_body); }
     bool is_generic() const { return std::holds_alternative<GenericBody>(m_body); }
     bool is_native() const { return std::holds_alternative<NativeBody>(m_body); }
 
+    // Memoization (see MemoCache): the id is assigned when the function
+    // is memoized for the first time, after it passed check_memoizable.
+    // Zero means the function wasn't checked yet.
+    void set_memo_id(uint64_t id) const { m_memo_id = id; }
+    uint64_t memo_id() const { return m_memo_id; }
+
+    // Preallocated closure of a function without nonlocals (see LoadFunction).
+    // It's created on first use, immortal and freed with the function.
+    const value::Closure& static_closure() const;
+
+    // tier-up JIT state of bytecode function
+    JitState& jit_state() const { return std::get<BytecodeBody>(m_body).jit; }
+
+    // bytecode was verified, the Machine can run it without runtime checks
+    void set_verified() const { std::get<BytecodeBody>(m_body).verified = true; }
+    bool is_verified() const {
+        const auto* body = std::get_if<BytecodeBody>(&m_body);
+        return body != nullptr && body->verified;
+    }
+
     void copy_body(const Function& src);
 
     void set_expression(bool is_expr = true) { m_expression = is_expr; }
@@ -251,6 +288,8 @@ private:
     SignaturePtr m_signature;
     // function body (depending on kind of function)
     std::variant<std::monostate, BytecodeBody, AssemblyBody, GenericBody, NativeBody> m_body;
+    mutable uint64_t m_memo_id = 0;
+    mutable value::Closure m_static_closure;
     // flags
     bool m_expression : 1 = false;  // doesn't have its own parameters, but can alias something with parameters
     bool m_specialized : 1 = false;
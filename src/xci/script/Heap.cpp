@@ -5,6 +5,7 @@
 // Licensed under the Apache License, Version 2.0 (see LICENSE file)
 
 #include "Heap.h"
+#include <algorithm>
 
 namespace xci::script {
 
@@ -17,12 +18,14 @@ HeapSlot::HeapSlot(size_t user_size, Deleter deleter)
     RefCount refs = 1;
     memcpy(m_slot, &refs, sizeof(refs));
     memcpy(m_slot + sizeof(RefCount), &deleter, sizeof(Deleter));
+    if (deleter != nullptr)
+        CycleCollector::on_alloc(m_slot, user_size, deleter);
 }
 
 
 auto HeapSlot::refcount() const -> RefCount
 {
-    if (m_slot == nullptr)
+    if (m_slot == nullptr || is_inline())
         return 0;
     return bit_copy<RefCount>(m_slot);
 }
@@ -30,23 +33,31 @@ auto HeapSlot::refcount() const -> RefCount
 
 void HeapSlot::incref() const
 {
-    if (m_slot == nullptr)
+    if (m_slot == nullptr || is_inline())
         return;
-    const auto refs = bit_copy<RefCount>(m_slot) + 1;
+    auto refs = bit_copy<RefCount>(m_slot);
+    if (refs == immortal_refcount)
+        return;
+    ++refs;
     memcpy(m_slot, &refs, sizeof(refs));
 }
 
 
 bool HeapSlot::decref()
 {
-    if (m_slot == nullptr)
-        return false;  // caller's pointer is already null
-    const auto refs = bit_copy<RefCount>(m_slot) - 1;
+    if (m_slot == nullptr || is_inline())
+        return false;  // caller's pointer is already null, or it's not a pointer
+    auto refs = bit_copy<RefCount>(m_slot);
+    if (refs == immortal_refcount)
+        return false;
+    --refs;
     if (refs == 0) {
         Deleter deleter;
         memcpy(&deleter, m_slot + sizeof(RefCount), sizeof(Deleter));
-        if (deleter != nullptr)
+        if (deleter != nullptr) {
             deleter(data_());
+            CycleCollector::on_free(m_slot);
+        }
         delete[] m_slot;
         return true;  // freed, the caller may want to clear the pointer
     }
@@ -55,4 +66,156 @@ bool HeapSlot::decref()
 }
 
 
+void HeapSlot::make_immortal() const
+{
+    if (m_slot == nullptr || is_inline())
+        return;
+    const RefCount refs = immortal_refcount;
+    memcpy(m_slot, &refs, sizeof(refs));
+    // the cycle collector would never free it, stop tracking
+    CycleCollector::on_free(m_slot);
+}
+
+
+void HeapSlot::make_mortal() const
+{
+    if (m_slot == nullptr || is_inline())
+        return;
+    const RefCount refs = 1;
+    memcpy(m_slot, &refs, sizeof(refs));
+}
+
+
+void HeapSlot::release()
+{
+    CycleCollector::on_free(m_slot);
+    delete[] m_slot;
+    m_slot = nullptr;
+}
+
+
+// Registered container types, shared by all threads (read-only after static initialization)
+static auto containers() -> std::vector<std::pair<HeapSlot::Deleter, CycleCollector::Traverse>>&
+{
+    static std::vector<std::pair<HeapSlot::Deleter, CycleCollector::Traverse>> containers;
+    return containers;
+}
+
+
+static thread_local bool t_collector_destroyed = false;
+
+
+CycleCollector::~CycleCollector()
+{
+    t_collector_destroyed = true;
+}
+
+
+CycleCollector* CycleCollector::current()
+{
+    if (t_collector_destroyed)
+        return nullptr;
+    return &thread_instance();
+}
+
+
+CycleCollector& CycleCollector::thread_instance()
+{
+    static thread_local CycleCollector instance;
+    return instance;
+}
+
+
+void CycleCollector::register_container(HeapSlot::Deleter deleter, Traverse traverse)
+{
+    containers().emplace_back(deleter, traverse);
+}
+
+
+void CycleCollector::track(std::byte* slot, size_t user_size, HeapSlot::Deleter deleter)
+{
+    const auto& reg = containers();
+    const auto it = std::find_if(reg.begin(), reg.end(),
+            [deleter](const auto& c) { return c.first == deleter; });
+    if (it == reg.end())
+        return;
+    m_tracked.emplace(slot, Tracked{user_size, it->second, 0, false});
+    ++m_new_slots;
+}
+
+
+auto CycleCollector::collect() -> Result
+{
+    m_new_slots = 0;
+    ++m_stats.collections;
+    const auto data = [](std::byte* slot) { return slot + HeapSlot::header_size; };
+
+    // Subtract references from inside the tracked slots
+    for (auto& [slot, t] : m_tracked) {
+        t.gc_refs = HeapSlot(slot).refcount();
+        t.alive = false;
+    }
+    for (auto& [slot, t] : m_tracked) {
+        t.traverse(data(slot), [this](std::byte* child) {
+            auto it = m_tracked.find(child);
+            if (it != m_tracked.end())
+                --it->second.gc_refs;
+        });
+    }
+
+    // Mark slots referenced from outside and everything reachable from them
+    std::vector<std::pair<std::byte*, Tracked*>> work;
+    for (auto& [slot, t] : m_tracked) {
+        if (t.gc_refs > 0 && !t.alive) {
+            t.alive = true;
+            work.emplace_back(slot, &t);
+        }
+    }
+    while (!work.empty()) {
+        auto [slot, t] = work.back();
+        work.pop_back();
+        t->traverse(data(slot), [this, &work](std::byte* child) {
+            auto it = m_tracked.find(child);
+            if (it != m_tracked.end() && !it->second.alive) {
+                it->second.alive = true;
+                work.emplace_back(child, &it->second);
+            }
+        });
+    }
+
+    // The rest is garbage
+    std::vector<std::pair<std::byte*, Tracked>> garbage;
+    for (const auto& [slot, t] : m_tracked) {
+        if (!t.alive)
+            garbage.emplace_back(slot, t);
+    }
+    if (garbage.empty())
+        return {};
+    std::sort(garbage.begin(), garbage.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    Result res;
+    for (const auto& [slot, t] : garbage) {
+        m_tracked.erase(slot);
+        res.slots += 1;
+        res.bytes += HeapSlot::header_size + t.size;
+    }
+    // Release references to live slots (untracked or alive). Freeing them
+    // may erase other entries from m_tracked, but never a garbage slot.
+    for (const auto& [slot, t] : garbage) {
+        t.traverse(data(slot), [&garbage](std::byte* child) {
+            const auto it = std::lower_bound(garbage.begin(), garbage.end(), child,
+                    [](const auto& g, std::byte* p) { return g.first < p; });
+            if (it == garbage.end() || it->first != child)
+                HeapSlot(child).decref();
+        });
+    }
+    for (const auto& [slot, t] : garbage)
+        delete[] slot;
+
+    m_stats.slots += res.slots;
+    m_stats.bytes += res.bytes;
+    return res;
+}
+
+
 } // namespace xci::script
@@ -8,6 +8,9 @@
 #define XCI_SCRIPT_HEAP_H
 
 #include <xci/core/bit.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 #include <cstddef>  // byte
 #include <cstdint>
 
@@ -23,6 +26,9 @@ namespace xci::script {
 // Header is:
 // * 4B refcount
 // * zB pointer to deleter - a function to be called before destroying the slot
+//
+// A pointer with the lowest bit set is not a heap slot, it's a part
+// of inline value (see StringV). The slot operations are no-op for it.
 class HeapSlot {
 public:
     using RefCount = uint32_t;
@@ -44,17 +50,28 @@ public:
     void write(std::byte* buffer) const { std::memcpy(buffer, &m_slot, sizeof(m_slot)); }
     void read(const std::byte* buffer) { std::memcpy(&m_slot, buffer, sizeof(m_slot)); }
 
+    bool is_inline() const { return (reinterpret_cast<uintptr_t>(m_slot) & 1) != 0; }
+
     RefCount refcount() const;
     void incref() const;  // constness is disputable here, but logically the object is not affected, only its refcount
     bool decref();  // free the object and return true when refcount = 0
 
+    /// Immortal slot is never freed by refcounting, incref/decref are no-op.
+    /// Used for constants shared by many modules (see ConstantPool).
+    /// The owner frees the slot by making it mortal again (refcount = 1)
+    /// and calling decref.
+    static constexpr RefCount immortal_refcount = ~RefCount(0);
+    void make_immortal() const;
+    void make_mortal() const;
+    bool is_immortal() const { return refcount() == immortal_refcount; }
+
     std::byte* data() { return data_(); }
     const std::byte* data() const { return data_(); }
     const std::byte* slot() const { return m_slot; }
 
     /// Release the object, ignoring refcount, not calling deleter.
     /// Use only after bit-copying the data to another HeapSlot.
-    void release() { delete[] m_slot; m_slot = nullptr; }
+    void release();
 
     bool operator==(const HeapSlot&) const = default;
     explicit operator bool() const { return m_slot != nullptr; }
@@ -66,6 +83,108 @@ private:
 };
 
 
+// Cycle collector for container heap slots (List, Map, Closure)
+//
+// Reference counting alone can't free a group of slots which reference each other.
+// When enabled, each new container slot is tracked. The collection uses trial deletion:
+// For each tracked slot, it computes the number of references from outside
+// of the tracked slots (refcount minus references from other tracked slots).
+// The slots with an outside reference are alive, together with all slots
+// reachable from them. The rest is garbage, referenced only from cycles.
+// The garbage is freed without calling deleters, only the references
+// to alive slots (e.g. strings) are released.
+//
+// Roots (stack, static values) don't need to be scanned, they are counted
+// in refcount. But all references must be counted - the collection
+// must not run in the middle of an operation which holds a borrowed
+// reference to an otherwise unreferenced slot. The Machine runs it
+// on function calls (see `collect_if_needed`).
+//
+// Only the slots created while the collector is enabled are tracked.
+// Each thread has its own collector, which tracks the slots created
+// in the thread. Like the refcounting, the slots must not be shared
+// between threads.
+class CycleCollector {
+public:
+    // Call `cb` with each slot referenced from container data (may be null or inline)
+    using Traverse = void(*)(const std::byte* data, const std::function<void(std::byte* slot)>& cb);
+
+    // Instance for the current thread, used by HeapSlot
+    static CycleCollector& thread_instance();
+
+    // Register container type by its deleter. Slots with other deleters are not tracked.
+    // The registration is shared by all threads, do it during static initialization.
+    static void register_container(HeapSlot::Deleter deleter, Traverse traverse);
+
+    void set_enabled(bool enabled) { m_enabled = enabled; }
+    bool enabled() const { return m_enabled; }
+
+    // Number of new container slots which trigger the collection.
+    // Zero means no automatic collection, only explicit `collect`.
+    static constexpr size_t default_threshold = 10000;
+    void set_threshold(size_t threshold) { m_threshold = threshold; }
+    size_t threshold() const { return m_threshold; }
+
+    struct Result {
+        size_t slots = 0;   // number of freed slots
+        size_t bytes = 0;   // freed bytes (including slot headers)
+    };
+
+    // Free all tracked slots which are referenced only from cycles
+    Result collect();
+
+    // Collect when the threshold was reached
+    Result collect_if_needed() {
+        if (m_threshold == 0 || m_new_slots < m_threshold)
+            return {};
+        return collect();
+    }
+
+    struct Stats {
+        size_t collections = 0;
+        size_t slots = 0;       // total freed slots
+        size_t bytes = 0;       // total freed bytes
+    };
+    const Stats& stats() const { return m_stats; }
+    size_t num_tracked() const { return m_tracked.size(); }
+
+    // Called by HeapSlot
+    static void on_alloc(std::byte* slot, size_t user_size, HeapSlot::Deleter deleter) {
+        auto* cc = current();
+        if (cc != nullptr && cc->m_enabled)
+            cc->track(slot, user_size, deleter);
+    }
+    static void on_free(std::byte* slot) {
+        auto* cc = current();
+        if (cc != nullptr && !cc->m_tracked.empty())
+            cc->m_tracked.erase(slot);
+    }
+
+    ~CycleCollector();
+
+private:
+    CycleCollector() = default;
+
+    // The thread instance, null when it was already destroyed (at thread exit,
+    // slots still may be freed by destructors of static objects)
+    static CycleCollector* current();
+
+    void track(std::byte* slot, size_t user_size, HeapSlot::Deleter deleter);
+
+    struct Tracked {
+        size_t size;        // user size
+        Traverse traverse;
+        int64_t gc_refs;    // refcount minus internal references (during collection)
+        bool alive;         // reachable from outside (during collection)
+    };
+    std::unordered_map<std::byte*, Tracked> m_tracked;
+    size_t m_threshold = default_threshold;
+    size_t m_new_slots = 0;     // tracked since last collection
+    Stats m_stats;
+    bool m_enabled = false;
+};
+
+
 } // namespace xci::script
 
 #endif // include guard
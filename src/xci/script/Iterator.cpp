@@ -0,0 +1,235 @@
+// Iterator.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "Iterator.h"
+#include "Stack.h"
+#include "Stream.h"
+
+namespace xci::script {
+
+
+class RangeGenerator final: public Generator {
+public:
+    RangeGenerator(int64_t begin, int64_t end) : m_next(begin), m_end(end) {}
+
+    bool next(Stack& stack, const CallFn&) override {
+        if (m_next >= m_end)
+            return false;
+        stack.push(value::Int(m_next++));
+        return true;
+    }
+
+private:
+    int64_t m_next;
+    int64_t m_end;
+};
+
+
+class ListGenerator final: public Generator {
+public:
+    ListGenerator(value::List&& list, const TypeInfo& elem_type)
+        : m_list(std::move(list)), m_elem_type(elem_type) {}
+    ~ListGenerator() override { m_list.decref(); }
+
+    bool next(Stack& stack, const CallFn&) override {
+        if (m_pos >= m_list.length())
+            return false;
+        const Value item = m_list.value_at(m_pos++, m_elem_type);
+        item.incref();
+        stack.push(item);
+        return true;
+    }
+
+private:
+    value::List m_list;
+    TypeInfo m_elem_type;
+    size_t m_pos = 0;
+};
+
+
+class LinesGenerator final: public Generator {
+public:
+    explicit LinesGenerator(value::Stream&& stream) : m_stream(std::move(stream)) {}
+    ~LinesGenerator() override { m_stream.decref(); }
+
+    bool next(Stack& stack, const CallFn&) override {
+        for (;;) {
+            const auto nl = m_buffer.find('\n', m_pos);
+            if (nl != std::string::npos) {
+                stack.push(value::String(std::string_view(m_buffer).substr(m_pos, nl - m_pos)));
+                m_pos = nl + 1;
+                return true;
+            }
+            if (m_eof) {
+                if (m_pos >= m_buffer.size())
+                    return false;
+                // last line without newline
+                stack.push(value::String(std::string_view(m_buffer).substr(m_pos)));
+                m_pos = m_buffer.size();
+                return true;
+            }
+            // drop the consumed lines, read next chunk
+            m_buffer.erase(0, m_pos);
+            m_pos = 0;
+            const auto chunk = stack.output_buffers().read(m_stream.value(), chunk_size);
+            if (chunk.empty())
+                m_eof = true;
+            m_buffer += chunk;
+        }
+    }
+
+private:
+    static constexpr size_t chunk_size = 4096;
+    value::Stream m_stream;
+    std::string m_buffer;
+    size_t m_pos = 0;
+    bool m_eof = false;
+};
+
+
+class MapGenerator final: public Generator {
+public:
+    MapGenerator(value::Iter&& source, value::Closure&& fn)
+        : m_source(std::move(source)), m_fn(std::move(fn)) {}
+    ~MapGenerator() override { m_fn.decref(); m_source.decref(); }
+
+    bool next(Stack& stack, const CallFn& call) override {
+        if (!m_source.generator().next(stack, call))
+            return false;
+        // the element is the argument
+        m_fn.incref();
+        call(value::Closure(m_fn));
+        return true;
+    }
+
+private:
+    value::Iter m_source;
+    value::Closure m_fn;
+};
+
+
+class FilterGenerator final: public Generator {
+public:
+    FilterGenerator(value::Iter&& source, value::Closure&& pred, const TypeInfo& elem_type)
+        : m_source(std::move(source)), m_pred(std::move(pred)), m_elem_type(elem_type) {}
+    ~FilterGenerator() override { m_pred.decref(); m_source.decref(); }
+
+    bool next(Stack& stack, const CallFn& call) override {
+        while (m_source.generator().next(stack, call)) {
+            Value item = stack.pull(m_elem_type);
+            DecRefGuard item_guard {item};  // released if the predicate throws
+            item.incref();
+            stack.push(item);
+            m_pred.incref();
+            call(value::Closure(m_pred));
+            if (stack.pull<value::Bool>().value()) {
+                stack.push(item);
+                item_guard.release();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    value::Iter m_source;
+    value::Closure m_pred;
+    TypeInfo m_elem_type;
+};
+
+
+class TakeGenerator final: public Generator {
+public:
+    TakeGenerator(value::Iter&& source, uint64_t n) : m_source(std::move(source)), m_remaining(n) {}
+    ~TakeGenerator() override { m_source.decref(); }
+
+    bool next(Stack& stack, const CallFn& call) override {
+        if (m_remaining == 0)
+            return false;
+        --m_remaining;
+        return m_source.generator().next(stack, call);
+    }
+
+private:
+    value::Iter m_source;
+    uint64_t m_remaining;
+};
+
+
+class IterateGenerator final: public Generator {
+public:
+    IterateGenerator(Value&& init, value::Closure&& fn, const TypeInfo& elem_type)
+        : m_value(std::move(init)), m_fn(std::move(fn)), m_elem_type(elem_type) {}
+    ~IterateGenerator() override { m_fn.decref(); m_value.decref(); }
+
+    bool next(Stack& stack, const CallFn& call) override {
+        if (m_started) {
+            // the function consumes the previous value
+            stack.push(m_value);
+            m_value = Value();  // owned by the stack, released there if the function throws
+            m_fn.incref();
+            call(value::Closure(m_fn));
+            m_value = stack.pull(m_elem_type);
+        }
+        m_started = true;
+        m_value.incref();
+        stack.push(m_value);
+        return true;
+    }
+
+private:
+    Value m_value;
+    value::Closure m_fn;
+    TypeInfo m_elem_type;
+    bool m_started = false;
+};
+
+
+std::unique_ptr<Generator> make_range_generator(int64_t begin, int64_t end)
+{
+    return std::make_unique<RangeGenerator>(begin, end);
+}
+
+
+std::unique_ptr<Generator> make_list_generator(value::List&& list, const TypeInfo& elem_type)
+{
+    return std::make_unique<ListGenerator>(std::move(list), elem_type);
+}
+
+
+std::unique_ptr<Generator> make_lines_generator(value::Stream&& stream)
+{
+    return std::make_unique<LinesGenerator>(std::move(stream));
+}
+
+
+std::unique_ptr<Generator> make_map_generator(value::Iter&& source, value::Closure&& fn)
+{
+    return std::make_unique<MapGenerator>(std::move(source), std::move(fn));
+}
+
+
+std::unique_ptr<Generator> make_filter_generator(value::Iter&& source, value::Closure&& pred,
+                                                 const TypeInfo& elem_type)
+{
+    return std::make_unique<FilterGenerator>(std::move(source), std::move(pred), elem_type);
+}
+
+
+std::unique_ptr<Generator> make_take_generator(value::Iter&& source, uint64_t n)
+{
+    return std::make_unique<TakeGenerator>(std::move(source), n);
+}
+
+
+std::unique_ptr<Generator> make_iterate_generator(Value&& init, value::Closure&& fn,
+                                                  const TypeInfo& elem_type)
+{
+    return std::make_unique<IterateGenerator>(std::move(init), std::move(fn), elem_type);
+}
+
+
+} // namespace xci::script
@@ -0,0 +1,76 @@
+// Iterator.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_ITERATOR_H
+#define XCI_SCRIPT_ITERATOR_H
+
+#include "Value.h"
+#include "TypeInfo.h"
+#include <functional>
+#include <memory>
+
+namespace xci::script {
+
+class Stack;
+
+
+/// Generator of a lazy sequence (see IterV, type `[T..]`)
+///
+/// The elements are generated one by one, on demand, so the whole sequence
+/// never needs to be in memory. The iterator is single-pass: the elements
+/// are consumed by stepping it, and the state is shared by all copies
+/// of the IterV value (like a Stream).
+///
+/// The generator owns one reference to each value it holds
+/// (source iterator, list, function object). These are released
+/// in its destructor, when the IterV heap slot is freed.
+
+class Generator {
+public:
+    virtual ~Generator() = default;
+
+    // Call a function object from the generator (see Machine::execute).
+    // The argument must be already on stack, the result is left on stack.
+    using CallFn = std::function<void(value::Closure&&)>;
+
+    // Generate next element and push it on stack.
+    // Returns false at the end of sequence, nothing is pushed in that case.
+    virtual bool next(Stack& stack, const CallFn& call) = 0;
+};
+
+
+// Native sources
+
+// Integers from `begin` up to `end` (exclusive)
+std::unique_ptr<Generator> make_range_generator(int64_t begin, int64_t end);
+
+// Elements of a list (takes over the reference)
+std::unique_ptr<Generator> make_list_generator(value::List&& list, const TypeInfo& elem_type);
+
+// Lines read from a stream, without the newline characters.
+// The stream is read in chunks, only the current line is kept in memory.
+std::unique_ptr<Generator> make_lines_generator(value::Stream&& stream);
+
+// Adapters (take over the references)
+
+// Apply the function to each element of the source
+std::unique_ptr<Generator> make_map_generator(value::Iter&& source, value::Closure&& fn);
+
+// Skip the elements of the source for which the predicate returns false
+std::unique_ptr<Generator> make_filter_generator(value::Iter&& source, value::Closure&& pred,
+                                                 const TypeInfo& elem_type);
+
+// Stop after `n` elements of the source
+std::unique_ptr<Generator> make_take_generator(value::Iter&& source, uint64_t n);
+
+// Infinite sequence: init, f(init), f(f(init)), ...
+std::unique_ptr<Generator> make_iterate_generator(Value&& init, value::Closure&& fn,
+                                                  const TypeInfo& elem_type);
+
+
+} // namespace xci::script
+
+#endif // include guard
@@ -6,15 +6,22 @@
 
 #include "Machine.h"
 #include "Builtin.h"
+#include "ConstantPool.h"
 #include "Value.h"
 #include "Error.h"
+#include "Iterator.h"
 #include "dump.h"
 #include "typing/type_index.h"
+#include "jit/Jit.h"
+#include "code/check_memo.h"
 #include <xci/data/coding/leb128.h>
 
 #include <fmt/format.h>
+#include <charconv>
 #include <cassert>
 #include <cstddef>  // std::ptrdiff_t
+#include <cstdlib>  // getenv
+#include <cstring>
 
 namespace xci::script {
 
@@ -22,33 +29,216 @@ using xci::data::leb128_decode;
 using fmt::format;
 
 
+Machine::Machine()
+{
+    if (const char* env = std::getenv("XCI_SCRIPT_JIT")) {
+        const std::string_view v = env;
+        uint32_t threshold = 0;
+        if (v == "force")
+            threshold = 1;
+        else if (v == "on")
+            threshold = jit_default_threshold;
+        else
+            std::from_chars(v.data(), v.data() + v.size(), threshold);
+        set_jit_threshold(threshold);
+    }
+}
+
+
+void Machine::set_jit_threshold(uint32_t threshold)
+{
+    m_jit_threshold = jit::is_available() ? threshold : 0;
+}
+
+
 void Machine::call(const Function& function, const Machine::InvokeCallback& cb)
 {
+    CycleCollector::thread_instance().collect_if_needed();
     m_stack.push_frame(function);
     try {
         run(cb);
         assert(m_stack.size() == function.effective_return_type().size());
+        detach_constants(function.effective_return_type());
     } catch (RuntimeError& e) {
         // unwind the whole stack, fill StackTrace in the ScriptError
         e.set_stack_trace(m_stack.make_trace());
+        m_stack.output_buffers().flush_all();
+        throw;
+    }
+    // end of invocation - write out buffered output
+    m_stack.output_buffers().flush_all();
+}
+
+
+void Machine::call_prepared(const Function& function, bool flush_output)
+{
+    // constructed once, not per call
+    static const InvokeCallback ignore_invocations = no_invoke_cb;
+    CycleCollector::thread_instance().collect_if_needed();
+    try {
+        invoke(function, ignore_invocations);
+    } catch (RuntimeError& e) {
+        e.set_stack_trace(m_stack.make_trace());
+        m_stack.output_buffers().flush_all();
+        throw;
+    }
+    if (flush_output)
+        m_stack.output_buffers().flush_all();
+}
+
+
+void Machine::detach_constants(const TypeInfo& ti)
+{
+    ConstantPool::make_mortal(m_stack.data(), ti);
+}
+
+
+// Flatten the type to type records as pushed on stack (bottom to top).
+// Returns false if it contains a heap value.
+static bool flatten_stack_types(const TypeInfo& type_info, std::vector<Type>& out)
+{
+    const auto& ti = type_info.underlying();
+    if (ti.is_struct_or_tuple()) {
+        bool plain = true;
+        const auto& subtypes = ti.subtypes();
+        for (size_t i = subtypes.size(); i != 0; --i)
+            plain = flatten_stack_types(subtypes[i - 1], out) && plain;
+        return plain;
+    }
+    if (ti.size() == 0)
+        return true;  // Void is not pushed
+    out.push_back(ti.type());
+    bool plain = true;
+    ti.foreach_heap_slot([&plain](size_t) { plain = false; });
+    return plain;
+}
+
+
+PreparedCall::PreparedCall(Machine& machine, const Function& function)
+    : m_machine(machine), m_function(function),
+      m_param_size(function.parameter().size()),
+      m_return_size(function.effective_return_type().size())
+{
+    assert(!function.is_generic());
+    assert(!function.has_nonlocals());
+    m_plain = flatten_stack_types(function.parameter(), m_param_types);
+    std::vector<Type> return_types;
+    m_plain = flatten_stack_types(function.effective_return_type(), return_types) && m_plain;
+    m_n_return_types = return_types.size();
+}
+
+
+void Machine::execute(value::Closure&& closure, const InvokeCallback& cb)
+{
+    const Function& fn = *closure.function();
+    {
+        const DecRefGuard guard {closure};  // also on stack overflow
+        closure.copy_nonlocals(m_stack.push_raw(fn.raw_size_of_nonlocals(), fn.nonlocals()));
+    }
+    invoke(fn, cb);
+}
+
+
+void Machine::invoke(const Function& fn, const InvokeCallback& cb)
+{
+    if (fn.is_native()) {
+        fn.call_native(m_stack);
+        return;
+    }
+    if (const auto* code = jit_code(fn)) {
+        run_jit(fn, *code, cb);
+        return;
+    }
+    m_stack.push_frame(fn);
+    run(cb);
+}
+
+
+const jit::CompiledFunction* Machine::jit_code(const Function& fn)
+{
+    if (m_jit_threshold == 0 || m_jit_depth >= jit_max_depth || m_bytecode_trace_cb
+    || !fn.is_bytecode())
+        return nullptr;
+    auto& state = fn.jit_state();
+    if (!state.code) {
+        if (state.rejected || ++state.calls < m_jit_threshold)
+            return nullptr;
+        state.code = jit::compile(fn);
+        state.rejected = !state.code;
+        ++(state.rejected ? m_jit_stats.rejected : m_jit_stats.compiled);
+    }
+    return state.code.get();
+}
+
+
+void Machine::run_jit(const Function& fn, const jit::CompiledFunction& code, const InvokeCallback& cb)
+{
+    struct Runtime final : jit::Runtime {
+        Machine& machine;
+        const InvokeCallback& cb;
+        Runtime(Machine& machine, const InvokeCallback& cb) : machine(machine), cb(cb) {}
+        Stack& stack() override { return machine.m_stack; }
+        void call(const Function& callee) override { machine.invoke(callee, cb); }
+    } runtime {*this, cb};
+
+    m_stack.push_frame(fn);
+    if (m_call_enter_cb)
+        m_call_enter_cb(fn);
+    ++m_jit_depth;
+    ++m_jit_stats.calls;
+    try {
+        jit::run(code, runtime);
+    } catch (...) {
+        --m_jit_depth;
         throw;
     }
+    --m_jit_depth;
+    if (m_call_exit_cb)
+        m_call_exit_cb(fn);
+    m_stack.pop_frame();
 }
 
 
 void Machine::run(const InvokeCallback& cb)
+{
+    // Bytecode tracing is done only by the checked loop
+    if (m_stack.frame().function.is_verified() && !m_bytecode_trace_cb)
+        run_code<false>(cb);
+    else
+        run_code<true>(cb);
+}
+
+
+template <bool Checked>
+void Machine::run_code(const InvokeCallback& cb)
 {
     // Avoid recursion - update these pointers instead (we already have a stack)
+    // Nested run (see execute) returns when its initial frame is popped.
+    const auto n_frames = m_stack.n_frames();
     const Function* function = &m_stack.frame().function;
     assert(function->is_bytecode());
     auto it = function->bytecode().begin() + (std::ptrdiff_t) m_stack.frame().instruction;
     auto base = m_stack.frame().base;
 
-    auto call_fun = [this, &function, &it, &base](const Function& fn) {
+    auto call_fun = [this, &function, &it, &base, &cb](const Function& fn) {
+        // safe point - all heap slots in use are referenced
+        CycleCollector::thread_instance().collect_if_needed();
         if (fn.is_native()) {
             fn.call_native(m_stack);
             return;
         }
+        if (const auto* code = jit_code(fn)) {
+            run_jit(fn, *code, cb);
+            return;
+        }
+        if constexpr (!Checked) {
+            if (!fn.is_verified()) {
+                // leave the fast path, the callee returns back here
+                m_stack.push_frame(fn);
+                run_code<true>(cb);
+                return;
+            }
+        }
         // return address
         m_stack.frame().instruction = it - function->bytecode().begin();
         assert(fn.is_bytecode());
@@ -77,18 +267,34 @@ void Machine::run(const InvokeCallback& cb)
     auto read_type_arg = [&it, &function]() -> const TypeInfo& {
         // LEB128 encoding of a type_index
         auto index = leb128_decode<Index>(it);
-        return get_type_info_unchecked(function->module().module_manager(), index);
+        if constexpr (Checked) {
+            const auto& ti = get_type_info(function->module().module_manager(), index);
+            if (ti.is_unknown())
+                throw bad_instruction(format("bad type index: {}", index));
+            return ti;
+        } else
+            return get_type_info_unchecked(function->module().module_manager(), index);
+    };
+
+    // validate an index read from bytecode (verified bytecode was checked ahead of time)
+    auto check_index = [](size_t idx, size_t size) {
+        if constexpr (Checked) {
+            if (idx >= size)
+                throw bad_instruction(format("index out of range: {} (size {})", idx, size));
+        }
     };
 
     // Run function code
     if (m_call_enter_cb)
         m_call_enter_cb(*function);
     for (;;) {
-        if (it == function->bytecode().end())
-            throw bad_instruction("reached end of code (missing RET)");
+        if constexpr (Checked) {
+            if (it == function->bytecode().end())
+                throw bad_instruction("reached end of code (missing RET)");
 
-        if (m_bytecode_trace_cb)
-            m_bytecode_trace_cb(*function, it);
+            if (m_bytecode_trace_cb)
+                m_bytecode_trace_cb(*function, it);
+        }
 
         auto opcode = static_cast<Opcode>(*it++);
         switch (opcode) {
@@ -100,8 +306,8 @@ void Machine::run(const InvokeCallback& cb)
                 if (m_call_exit_cb)
                     m_call_exit_cb(*function);
 
-                // no more stack frames?
-                if (m_stack.n_frames() == 1) {
+                // no more stack frames (in this run)?
+                if (m_stack.n_frames() == n_frames) {
                     assert(function == &m_stack.frame().function);
                     m_stack.pop_frame();
                     return;
@@ -303,7 +509,7 @@ void Machine::run(const InvokeCallback& cb)
                 const auto arg = *it++;
                 const auto lhs_type = decode_arg_type(arg >> 4);
                 const auto rhs_type = decode_arg_type(arg & 0xf);
-                if (lhs_type == Type::Unknown || rhs_type == Type::Unknown || lhs_type != rhs_type)
+                if (Checked && (lhs_type == Type::Unknown || rhs_type == Type::Unknown || lhs_type != rhs_type))
                     throw not_implemented(format("opcode: {} lhs type: {:x} rhs type: {:x}",
                             opcode, arg >> 4, arg & 0xf));
                 auto lhs = m_stack.pull(TypeInfo{lhs_type});
@@ -356,7 +562,7 @@ void Machine::run(const InvokeCallback& cb)
             case Opcode::Neg: {
                 const auto arg = *it++;
                 const auto type = decode_arg_type(arg & 0xf);
-                if (type == Type::Unknown)
+                if (Checked && type == Type::Unknown)
                     throw not_implemented(format("opcode: {} type: {:x}",
                             opcode, arg & 0xf));
                 auto v = m_stack.pull(TypeInfo{type});
@@ -414,6 +620,328 @@ void Machine::run(const InvokeCallback& cb)
                 break;
             }
 
+            case Opcode::ListMap: {
+                const auto& types = read_type_arg().underlying();
+                const auto& elem_ti = types.subtypes()[0];
+                const auto& res_ti = types.subtypes()[1];
+                auto fn = m_stack.pull<value::Closure>();
+                auto list = m_stack.pull_typed(ti_list(TypeInfo(elem_ti)));
+                const DecRefGuard args_guard {fn, list};
+                const auto& list_v = list.get<ListV>();
+                const auto len = list_v.length();
+                value::List res(len, res_ti);
+                DecRefGuard res_guard {res};  // partial result (unset elements are null)
+                for (size_t i = 0; i != len; ++i) {
+                    const Value item = list_v.value_at(i, elem_ti);
+                    item.incref();
+                    m_stack.push(item);
+                    fn.incref();
+                    execute(value::Closure(fn), cb);
+                    res.set_value(i, m_stack.pull(res_ti));
+                }
+                m_stack.push(res);
+                res_guard.release();
+                break;
+            }
+
+            case Opcode::ListFilter: {
+                const auto& elem_ti = read_type_arg();
+                auto fn = m_stack.pull<value::Closure>();
+                auto list = m_stack.pull_typed(ti_list(TypeInfo(elem_ti)));
+                const DecRefGuard args_guard {fn, list};
+                const auto& list_v = list.get<ListV>();
+                const auto len = list_v.length();
+                std::vector<Value> selected;  // not owned, referenced by `list`
+                selected.reserve(len);
+                for (size_t i = 0; i != len; ++i) {
+                    const Value item = list_v.value_at(i, elem_ti);
+                    item.incref();
+                    m_stack.push(item);
+                    fn.incref();
+                    execute(value::Closure(fn), cb);
+                    if (m_stack.pull<value::Bool>().value())
+                        selected.push_back(item);
+                }
+                value::List res(selected.size(), elem_ti);
+                for (size_t i = 0; i != selected.size(); ++i) {
+                    selected[i].incref();
+                    res.set_value(i, selected[i]);
+                }
+                m_stack.push(res);
+                break;
+            }
+
+            case Opcode::ListFold: {
+                const auto& types = read_type_arg().underlying();
+                const auto& elem_ti = types.subtypes()[0];
+                const auto& acc_ti = types.subtypes()[1];
+                auto fn = m_stack.pull<value::Closure>();
+                auto acc = m_stack.pull(acc_ti);
+                auto list = m_stack.pull_typed(ti_list(TypeInfo(elem_ti)));
+                const DecRefGuard args_guard {fn, list};
+                DecRefGuard acc_guard {acc};
+                const auto& list_v = list.get<ListV>();
+                const auto len = list_v.length();
+                for (size_t i = 0; i != len; ++i) {
+                    const Value item = list_v.value_at(i, elem_ti);
+                    item.incref();
+                    m_stack.push(value::Tuple{acc, item});
+                    acc = Value();  // passed to the function
+                    fn.incref();
+                    execute(value::Closure(fn), cb);
+                    acc = m_stack.pull(acc_ti);
+                }
+                m_stack.push(acc);
+                acc_guard.release();
+                break;
+            }
+
+            case Opcode::ListZip: {
+                const auto& item_ti = read_type_arg().underlying();
+                const auto& a_ti = item_ti.subtypes()[0];
+                const auto& b_ti = item_ti.subtypes()[1];
+                auto list_a = m_stack.pull_typed(ti_list(TypeInfo(a_ti)));
+                auto list_b = m_stack.pull_typed(ti_list(TypeInfo(b_ti)));
+                const auto& a_v = list_a.get<ListV>();
+                const auto& b_v = list_b.get<ListV>();
+                const auto len = std::min(a_v.length(), b_v.length());
+                value::List res(len, item_ti);
+                for (size_t i = 0; i != len; ++i) {
+                    const value::Tuple item {a_v.value_at(i, a_ti), b_v.value_at(i, b_ti)};
+                    item.incref();
+                    res.set_value(i, item);
+                }
+                list_a.decref();
+                list_b.decref();
+                m_stack.push(res);
+                break;
+            }
+
+            case Opcode::Memo: {
+                const auto& types = read_type_arg().underlying();
+                const auto& arg_ti = types.subtypes()[0];
+                const auto& res_ti = types.subtypes()[1];
+                auto fn = m_stack.pull<value::Closure>();
+                const Function& callee = *fn.function();
+                if (callee.memo_id() == 0) {
+                    // not known at compile time, or not yet checked
+                    try {
+                        check_memoizable(callee);
+                    } catch (...) {
+                        fn.decref();
+                        throw;
+                    }
+                    callee.set_memo_id(MemoCache::new_function_id());
+                }
+                // key = function id, nonlocals, arg (all plain data)
+                const auto memo_id = callee.memo_id();
+                const auto* nonlocals = fn.get<ClosureV>().nonlocals_data();
+                const auto nonlocals_size = callee.raw_size_of_nonlocals();
+                const auto arg_size = arg_ti.size();
+                std::string key(sizeof(memo_id) + nonlocals_size + arg_size, '\0');
+                auto* key_data = reinterpret_cast<std::byte*>(key.data());
+                std::memcpy(key_data, &memo_id, sizeof(memo_id));
+                std::memcpy(key_data + sizeof(memo_id), nonlocals, nonlocals_size);
+                std::memcpy(key_data + sizeof(memo_id) + nonlocals_size, m_stack.data(), arg_size);
+                if (const Value* cached = m_memo.find(key)) {
+                    m_stack.pull(arg_ti);  // plain data, no decref
+                    fn.decref();
+                    cached->incref();
+                    m_stack.push(*cached);
+                    break;
+                }
+                execute(std::move(fn), cb);
+                auto res = m_stack.pull(res_ti);
+                res.incref();
+                m_stack.push(res);
+                m_memo.insert(std::move(key), std::move(res));
+                break;
+            }
+
+            case Opcode::MapFromList: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                const auto item_ti = ti_tuple(TypeInfo(key_ti), TypeInfo(value_ti));
+                auto list = m_stack.pull_typed(ti_list(TypeInfo(item_ti)));
+                const auto& list_v = list.get<ListV>();
+                const auto len = list_v.length();
+                MapV map(key_ti, value_ti, len * 2);
+                for (size_t i = 0; i != len; ++i) {
+                    const Value item = list_v.value_at(i, item_ti);
+                    item.incref();
+                    const auto& tuple = item.get<TupleV>();
+                    map.insert(tuple.value_at(0), tuple.value_at(1), key_ti, value_ti);
+                }
+                list.decref();
+                m_stack.push(Value(std::move(map)));
+                break;
+            }
+
+            case Opcode::MapLength: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                auto map = m_stack.pull_typed(map_ti);
+                auto len = map.get<MapV>().length();
+                map.decref();
+                m_stack.push(value::UInt(len));
+                break;
+            }
+
+            case Opcode::MapGet: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                auto map = m_stack.pull_typed(map_ti);
+                auto key = m_stack.pull_typed(key_ti);
+                auto def = m_stack.pull_typed(value_ti);
+                const Value found = map.get<MapV>().get(key.value(), key_ti, value_ti);
+                if (found.is_unknown()) {
+                    m_stack.push(def);
+                } else {
+                    found.incref();
+                    def.decref();
+                    m_stack.push(found);
+                }
+                key.decref();
+                map.decref();
+                break;
+            }
+
+            case Opcode::MapContains: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                auto map = m_stack.pull_typed(map_ti);
+                auto key = m_stack.pull_typed(key_ti);
+                const bool res = map.get<MapV>().contains(key.value(), key_ti, value_ti);
+                key.decref();
+                map.decref();
+                m_stack.push(value::Bool(res));
+                break;
+            }
+
+            case Opcode::MapInsert: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                auto map = m_stack.pull_typed(map_ti);
+                auto key = m_stack.pull_typed(key_ti);
+                auto value = m_stack.pull_typed(value_ti);
+                map.get<MapV>().insert(key.value(), value.value(), key_ti, value_ti);
+                m_stack.push(map);
+                break;
+            }
+
+            case Opcode::MapRemove: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                auto map = m_stack.pull_typed(map_ti);
+                auto key = m_stack.pull_typed(key_ti);
+                map.get<MapV>().remove(key.value(), key_ti, value_ti);
+                key.decref();
+                m_stack.push(map);
+                break;
+            }
+
+            case Opcode::MapItems: {
+                const TypeInfo& map_ti = read_type_arg().underlying();
+                const auto& key_ti = map_ti.map_key_type();
+                const auto& value_ti = map_ti.map_value_type();
+                const auto item_ti = ti_tuple(TypeInfo(key_ti), TypeInfo(value_ti));
+                auto map = m_stack.pull_typed(map_ti);
+                const auto& map_v = map.get<MapV>();
+                value::List items(map_v.length(), item_ti);
+                size_t idx = 0;
+                map_v.foreach(key_ti, value_ti, [&](const Value& k, const Value& v) {
+                    const value::Tuple item {k, v};
+                    item.incref();
+                    items.set_value(idx++, item);
+                });
+                map.decref();
+                m_stack.push(items);
+                break;
+            }
+
+            case Opcode::IterFromList: {
+                const auto& elem_ti = read_type_arg();
+                auto list = m_stack.pull<value::List>();
+                m_stack.push(value::Iter(make_list_generator(std::move(list), elem_ti)));
+                break;
+            }
+
+            case Opcode::IterMap: {
+                read_type_arg();
+                auto fn = m_stack.pull<value::Closure>();
+                auto iter = m_stack.pull<value::Iter>();
+                m_stack.push(value::Iter(make_map_generator(std::move(iter), std::move(fn))));
+                break;
+            }
+
+            case Opcode::IterFilter: {
+                const auto& elem_ti = read_type_arg();
+                auto fn = m_stack.pull<value::Closure>();
+                auto iter = m_stack.pull<value::Iter>();
+                m_stack.push(value::Iter(make_filter_generator(std::move(iter), std::move(fn), elem_ti)));
+                break;
+            }
+
+            case Opcode::IterTake: {
+                read_type_arg();
+                const auto n = m_stack.pull<value::Int>().value();
+                auto iter = m_stack.pull<value::Iter>();
+                m_stack.push(value::Iter(make_take_generator(std::move(iter), n > 0 ? uint64_t(n) : 0)));
+                break;
+            }
+
+            case Opcode::IterIterate: {
+                const auto& elem_ti = read_type_arg();
+                auto fn = m_stack.pull<value::Closure>();
+                auto init = m_stack.pull(elem_ti);
+                m_stack.push(value::Iter(make_iterate_generator(std::move(init), std::move(fn), elem_ti)));
+                break;
+            }
+
+            case Opcode::IterFold: {
+                const auto& types = read_type_arg().underlying();
+                const auto& elem_ti = types.subtypes()[0];
+                const auto& acc_ti = types.subtypes()[1];
+                auto fn = m_stack.pull<value::Closure>();
+                auto acc = m_stack.pull(acc_ti);
+                auto iter = m_stack.pull<value::Iter>();
+                const DecRefGuard args_guard {fn, iter};
+                DecRefGuard acc_guard {acc};
+                const auto call = [this, &cb](value::Closure&& c) { execute(std::move(c), cb); };
+                // only one element is alive at a time
+                while (iter.generator().next(m_stack, call)) {
+                    const Value item = m_stack.pull(elem_ti);
+                    m_stack.push(value::Tuple{acc, item});
+                    acc = Value();  // passed to the function
+                    fn.incref();
+                    execute(value::Closure(fn), cb);
+                    acc = m_stack.pull(acc_ti);
+                }
+                m_stack.push(acc);
+                acc_guard.release();
+                break;
+            }
+
+            case Opcode::IterCollect: {
+                const auto& elem_ti = read_type_arg();
+                auto iter = m_stack.pull<value::Iter>();
+                std::vector<Value> items;
+                const DecRefGuard guard {iter, items};
+                const auto call = [this, &cb](value::Closure&& c) { execute(std::move(c), cb); };
+                while (iter.generator().next(m_stack, call))
+                    items.push_back(m_stack.pull(elem_ti));
+                value::List res(items.size(), elem_ti);
+                for (size_t i = 0; i != items.size(); ++i)
+                    res.set_value(i, items[i]);
+                items.clear();  // moved to `res`
+                m_stack.push(res);
+                break;
+            }
+
             case Opcode::Cast: {
                 // TODO: possible optimization when truncating integers
                 //       or extending unsigned integers: do not pull the value,
@@ -421,9 +949,9 @@ void Machine::run(const InvokeCallback& cb)
                 const auto arg = *it++;
                 const auto from_type = decode_arg_type(arg >> 4);
                 const auto to_type = decode_arg_type(arg & 0xf);
-                if (from_type == Type::Unknown)
+                if (Checked && from_type == Type::Unknown)
                     throw not_implemented(format("cast from: {:x}", arg >> 4));
-                if (to_type == Type::Unknown)
+                if (Checked && to_type == Type::Unknown)
                     throw not_implemented(format("cast to: {:x}", arg & 0xf));
                 auto from = m_stack.pull(TypeInfo{from_type});
                 auto to = create_value(TypeInfo{to_type});
@@ -436,23 +964,24 @@ void Machine::run(const InvokeCallback& cb)
 
             case Opcode::Invoke: {
                 const auto& type_info = read_type_arg();
+                detach_constants(type_info);
                 cb(m_stack.pull_typed(type_info));
                 break;
             }
 
             case Opcode::Execute: {
                 auto o = m_stack.pull<value::Closure>();
-                auto closure = o.closure();
-                for (size_t i = closure.length(); i != 0;) {
-                    m_stack.push(closure.value_at(--i));
-                }
-                call_fun(*o.function());
+                const Function& fn = *o.function();
+                // copy nonlocals directly from the closure to the stack
+                o.copy_nonlocals(m_stack.push_raw(fn.raw_size_of_nonlocals(), fn.nonlocals()));
+                call_fun(fn);
                 o.decref();
                 break;
             }
 
             case Opcode::LoadStatic: {
                 auto arg = leb128_decode<Index>(it);
+                check_index(arg, function->module().num_values());
                 const auto& o = function->module().get_value(arg);
                 m_stack.push(o);
                 o.incref();
@@ -461,13 +990,16 @@ void Machine::run(const InvokeCallback& cb)
 
             case Opcode::LoadFunction: {
                 auto arg = leb128_decode<Index>(it);
-                auto& fn = function->module().get_function(arg);
-                m_stack.push(value::Closure(fn));
+                check_index(arg, function->module().num_functions());
+                const auto& fn = function->module().get_function(arg);
+                m_stack.push(fn.static_closure());
                 break;
             }
 
             case Opcode::LoadModule: {
                 auto arg = leb128_decode<Index>(it);
+                if (arg != no_index)
+                    check_index(arg, function->module().num_imported_modules());
                 auto& mod = (arg == no_index)? function->module() : function->module().get_imported_module(arg);
                 m_stack.push(value::Module(mod));
                 break;
@@ -519,18 +1051,55 @@ void Machine::run(const InvokeCallback& cb)
                         // read arg1
                         idx = leb128_decode<Index>(it);
                     }
+                    check_index(idx, function->module().num_imported_modules());
                     module = &function->module().get_imported_module(idx);
                 }
                 // call function from the module
                 auto arg = leb128_decode<Index>(it);
+                check_index(arg, module->num_functions());
                 auto& fn = module->get_function(arg);
-                if (opcode == Opcode::TailCall0 || opcode == Opcode::TailCall1 || opcode == Opcode::TailCall)
+                if (opcode == Opcode::TailCall0 || opcode == Opcode::TailCall1 || opcode == Opcode::TailCall) {
+                    const auto* code = jit_code(fn);
+                    if (code != nullptr || (!Checked && !fn.is_verified())) {
+                        // run compiled or unverified function in place of this one,
+                        // then return from this one
+                        if (m_call_exit_cb)
+                            m_call_exit_cb(*function);
+                        m_stack.pop_frame();
+                        if (code != nullptr) {
+                            run_jit(fn, *code, cb);
+                        } else {
+                            m_stack.push_frame(fn);
+                            run_code<true>(cb);
+                        }
+                        if (m_stack.n_frames() < n_frames)
+                            return;
+                        function = &m_stack.frame().function;
+                        it = function->bytecode().begin() + (std::ptrdiff_t) m_stack.frame().instruction;
+                        base = m_stack.frame().base;
+                        break;
+                    }
                     tail_call_fun(fn);
-                else
+                } else
                     call_fun(fn);
                 break;
             }
 
+            case Opcode::CallNative: {
+                const auto mod_ref = leb128_decode<Index>(it);
+                const auto fn_idx = leb128_decode<Index>(it);
+                if (mod_ref != 0)
+                    check_index(mod_ref - 1, function->module().num_imported_modules());
+                const Module& module = mod_ref == 0 ? function->module()
+                        : function->module().get_imported_module(mod_ref - 1);
+                check_index(fn_idx, module.num_functions());
+                const Function& fn = module.get_function(fn_idx);
+                if (Checked && !fn.is_native())
+                    throw bad_instruction("CALL_NATIVE to non-native function");
+                fn.call_native(m_stack);
+                break;
+            }
+
             case Opcode::MakeList: {
                 const auto num_elems = leb128_decode<uint32_t>(it);
                 const auto& elem_ti = read_type_arg();
@@ -545,15 +1114,16 @@ void Machine::run(const InvokeCallback& cb)
             case Opcode::MakeClosure: {
                 auto arg = leb128_decode<Index>(it);
                 // get function
+                check_index(arg, function->module().num_functions());
                 auto& fn = function->module().get_function(arg);
-                // pull nonlocals
-                Values closure;
-                closure.reserve(fn.nonlocals().size());
-                for (const auto & ti : fn.nonlocals()) {
-                    closure.add(m_stack.pull(ti));
-                }
+                // verified bytecode was checked ahead of time
+                if constexpr (Checked)
+                    m_stack.check_top(fn.nonlocals());
+                // move nonlocals from the stack to the closure
+                value::Closure closure {fn, m_stack.data()};
+                m_stack.drop(0, fn.raw_size_of_nonlocals());
                 // push closure
-                m_stack.push(value::Closure{fn, std::move(closure)});
+                m_stack.push(closure);
                 break;
             }
 
@@ -587,8 +1157,22 @@ void Machine::run(const InvokeCallback& cb)
                 break;
             }
 
+            case Opcode::JumpBack: {
+                // loop - a self tail call, the frame stays in place
+                const auto arg = leb128_decode<size_t>(it);
+                if constexpr (Checked) {
+                    if (arg > size_t(it - function->bytecode().begin()))
+                        throw bad_instruction("jump before start of code");
+                }
+                it -= std::ptrdiff_t(arg);
+                break;
+            }
+
             default:
-                throw not_implemented(format("opcode {}", opcode));
+                if constexpr (Checked)
+                    throw not_implemented(format("opcode {}", opcode));
+                else
+                    XCI_UNREACHABLE;
         }
     }
 }
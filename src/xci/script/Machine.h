@@ -9,7 +9,13 @@
 
 #include "Function.h"
 #include "Stack.h"
+#include "MemoCache.h"
 #include <functional>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include <cassert>
+#include <cstring>
 
 namespace xci::script {
 
@@ -18,6 +24,8 @@ namespace xci::script {
 
 class Machine {
 public:
+    Machine();
+
     // Run all Invocations in a function or module:
     // - evaluate each invoked value (possibly concurrently)
     // - pass results to cb
@@ -38,12 +46,72 @@ public:
     using BytecodeTraceCb = std::function<void(const Function& function, Code::const_iterator ipos)>;
     void set_bytecode_trace_cb(BytecodeTraceCb cb) { m_bytecode_trace_cb = std::move(cb); }
 
+    // Tier-up JIT (see jit/Jit.h)
+    // A bytecode function is compiled to machine code when it was called `threshold` times.
+    // Zero disables the JIT, one compiles each function on its first call.
+    // Ignored when the JIT is not available. Disabled while tracing bytecode.
+    // The initial value comes from environment variable XCI_SCRIPT_JIT:
+    // "force" (= 1), "on" (= jit_default_threshold) or a number.
+    static constexpr uint32_t jit_default_threshold = 1000;
+    void set_jit_threshold(uint32_t threshold);
+    uint32_t jit_threshold() const { return m_jit_threshold; }
+
+    struct JitStats {
+        size_t compiled = 0;    // functions compiled to machine code
+        size_t rejected = 0;    // functions which can't be compiled
+        size_t calls = 0;       // calls into compiled code
+    };
+    const JitStats& jit_stats() const { return m_jit_stats; }
+
+    // Cache of memoized function results, with hit/miss stats (see `memo` in std.fire)
+    MemoCache& memo_cache() { return m_memo; }
+
 private:
+    friend class PreparedCall;
+
+    // Call the function with args already on stack, leave the result on stack.
+    // Unlike `call`, there are no invocations. The output is flushed
+    // only when `flush_output` is true.
+    void call_prepared(const Function& function, bool flush_output);
+
+    // Replace pooled constants in the value on top of stack by mortal copies,
+    // before it's passed to the host, which might keep it after the module
+    // is unloaded (see ConstantPool)
+    void detach_constants(const TypeInfo& ti);
+
     // The function must be already prepared in top stack frame
     void run(const InvokeCallback& cb);
 
+    // The interpreter loop. Verified functions (see code/verify_bytecode.h)
+    // run with Checked = false, skipping the checks already done by the verifier.
+    // An unverified function called from the unchecked loop runs nested.
+    template <bool Checked>
+    void run_code(const InvokeCallback& cb);
+
+    // Call a function object from an instruction implementation (nested run).
+    // The argument must be already on stack, the result is left on stack.
+    // Consumes one reference to the closure, same as EXECUTE instruction.
+    void execute(value::Closure&& closure, const InvokeCallback& cb);
+
+    // Call a function of any kind (native, compiled, bytecode), similar to `execute`.
+    void invoke(const Function& fn, const InvokeCallback& cb);
+
+    // Count the call, get compiled code (compile it when the function becomes hot)
+    const jit::CompiledFunction* jit_code(const Function& fn);
+    // Push a frame for the function and run its compiled code
+    void run_jit(const Function& fn, const jit::CompiledFunction& code, const InvokeCallback& cb);
+
     Stack m_stack;
 
+    // JIT
+    // Each call from compiled code nests on native stack, limit the depth.
+    static constexpr unsigned jit_max_depth = 256;
+    uint32_t m_jit_threshold = 0;
+    unsigned m_jit_depth = 0;
+    JitStats m_jit_stats;
+
+    MemoCache m_memo;
+
     // Tracing
     CallTraceCb m_call_enter_cb;
     CallTraceCb m_call_exit_cb;
@@ -51,6 +119,102 @@ private:
 };
 
 
+/// Function bound to a Machine, for repeated calls from the host program
+///
+/// Machine::call is general: the host pushes the args as Values, the invocations
+/// are passed to a type-erased callback and the result is pulled as TypedValue.
+/// PreparedCall does the per-function work once (parameter and return sizes,
+/// stack type records), then each call writes the args directly to stack memory
+/// and reads the result directly from stack memory, using templated callbacks.
+///
+/// The function must not be generic and must not have nonlocals (closure).
+/// Invocations in the function (if any) are ignored. Buffered output is written
+/// out at the end of each call, same as in Machine::call. This can be disabled
+/// by `set_flush_output(false)` for a tight loop of calls - then flush it
+/// explicitly: `machine.stack().output_buffers().flush_all()` (see OutputBuffers).
+///
+/// Example:
+///     PreparedCall sub {machine, fn};   // fn = fun (a:Int, b:Int) -> Int { a - b }
+///     int64_t r = sub.call<int64_t>(int64_t{10}, int64_t{3});   // 7
+
+class PreparedCall {
+public:
+    PreparedCall(Machine& machine, const Function& function);
+
+    const Function& function() const { return m_function; }
+    size_t param_size() const { return m_param_size; }
+    size_t return_size() const { return m_return_size; }
+
+    // Parameter and return value are plain data (no heap slots)
+    bool is_plain() const { return m_plain; }
+
+    // Write out buffered output after each call (default: true)
+    void set_flush_output(bool flush) { m_flush_output = flush; }
+    bool flush_output() const { return m_flush_output; }
+
+    // Call with plain data args (C++ types with the same layout as the parameter
+    // items, e.g. int64_t for Int, double for Float, bool for Bool).
+    // The result is also read as plain data (R = void drops it).
+    template <class R = void, class... Args>
+    R call(const Args&... args) {
+        static_assert((std::is_trivially_copyable_v<Args> && ...));
+        assert(m_plain);
+        assert((sizeof(Args) + ... + 0) == m_param_size);
+        const auto write_args = [&args...](std::byte* p) {
+            // first arg is on top (the lowest address)
+            ((std::memcpy(p, &args, sizeof(Args)), p += sizeof(Args)), ...);
+        };
+        if constexpr (std::is_void_v<R>) {
+            call_raw(write_args, [](const std::byte*) {});
+        } else {
+            static_assert(std::is_trivially_copyable_v<R>);
+            assert(sizeof(R) == m_return_size);
+            R result;
+            call_raw(write_args, [&result](const std::byte* p) {
+                std::memcpy(&result, p, sizeof(R));
+            });
+            return result;
+        }
+    }
+
+    // Low-level call:
+    // - `write_args(std::byte*)` writes `param_size()` bytes of the parameter,
+    //   laid out as on stack (see Value::write). The callee consumes
+    //   the references in the args.
+    // - `read_result(const std::byte*)` reads `return_size()` bytes of the result.
+    //   The result is then removed from stack, `read_result` takes over
+    //   the references in it.
+    template <class WriteArgs, class ReadResult>
+    void call_raw(WriteArgs&& write_args, ReadResult&& read_result) {
+        Stack& stack = m_machine.stack();
+        const size_t n_types = stack.n_values();
+        stack.reserve(m_param_size);
+        std::byte* args = stack.data() - m_param_size;
+        write_args(args);
+        stack.set_data(args);
+        stack.set_types(n_types, m_param_types);
+        m_machine.call_prepared(m_function, m_flush_output);
+        assert(stack.n_values() == n_types + m_n_return_types);
+        if (!m_plain)
+            m_machine.detach_constants(m_function.effective_return_type());
+        std::byte* result = stack.data();
+        read_result(static_cast<const std::byte*>(result));
+        stack.set_data(result + m_return_size);
+        stack.set_types(n_types, {});
+    }
+
+private:
+    Machine& m_machine;
+    const Function& m_function;
+    std::vector<Type> m_param_types;  // stack type records of the parameter, bottom to top
+    size_t m_n_return_types = 0;
+    size_t m_param_size;
+    size_t m_return_size;
+    bool m_plain = true;
+    bool m_flush_output = true;
+};
+
+
 } // namespace xci::script
 
 #endif // include guard
@@ -0,0 +1,82 @@
+// MemoCache.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "MemoCache.h"
+#include <atomic>
+
+namespace xci::script {
+
+
+uint64_t MemoCache::new_function_id()
+{
+    static std::atomic<uint64_t> last_id {0};
+    return ++last_id;
+}
+
+
+void MemoCache::set_capacity(size_t capacity)
+{
+    m_capacity = capacity;
+    while (m_entries.size() > m_capacity)
+        evict_last();
+}
+
+
+const Value* MemoCache::find(std::string_view key)
+{
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    // move to front (the iterators and the key view stay valid)
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &it->second->value;
+}
+
+
+void MemoCache::insert(std::string&& key, Value&& value)
+{
+    if (m_capacity == 0) {
+        value.decref();
+        return;
+    }
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        // inserted meanwhile (by a nested call), replace the value
+        it->second->value.decref();
+        it->second->value = std::move(value);
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+    if (m_entries.size() >= m_capacity)
+        evict_last();
+    m_entries.push_front({std::move(key), std::move(value)});
+    m_index.emplace(m_entries.front().key, m_entries.begin());
+}
+
+
+void MemoCache::clear()
+{
+    for (auto& entry : m_entries)
+        entry.value.decref();
+    m_index.clear();
+    m_entries.clear();
+}
+
+
+void MemoCache::evict_last()
+{
+    auto& entry = m_entries.back();
+    m_index.erase(entry.key);
+    entry.value.decref();
+    m_entries.pop_back();
+    ++m_stats.evictions;
+}
+
+
+} // namespace xci::script
@@ -0,0 +1,83 @@
+// MemoCache.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_MEMO_CACHE_H
+#define XCI_SCRIPT_MEMO_CACHE_H
+
+#include "Value.h"
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+namespace xci::script {
+
+
+/// Cache of memoized function results (see MEMO instruction and `memo` in std.fire)
+///
+/// The key is made of raw bytes of the function id, its nonlocals
+/// and the argument. These must be plain data (see check_memoizable).
+/// The cache owns one reference to each result value.
+/// When the cache is full, the least recently used entry is evicted.
+///
+/// Unlike core/memoization.h, the size is not fixed at compile time
+/// and the keys are compared by value (hashed), not by linear search.
+
+class MemoCache {
+public:
+    static constexpr size_t default_capacity = 4096;
+
+    MemoCache() = default;
+    MemoCache(const MemoCache&) = delete;
+    MemoCache& operator=(const MemoCache&) = delete;
+    ~MemoCache() { clear(); }
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+    const Stats& stats() const { return m_stats; }
+    void reset_stats() { m_stats = {}; }
+
+    // Max number of entries. Zero disables the cache (each call is a miss).
+    void set_capacity(size_t capacity);
+    size_t capacity() const { return m_capacity; }
+    size_t size() const { return m_entries.size(); }
+
+    // Look up the key, count a hit or a miss.
+    // The returned value is owned by the cache, it's valid until next `insert`.
+    const Value* find(std::string_view key);
+
+    // Insert new entry, taking over one reference to the value.
+    // Evicts the least recently used entry when the cache is full.
+    void insert(std::string&& key, Value&& value);
+
+    // Remove all entries, release the values. Stats are not reset.
+    void clear();
+
+    // Unique id for Function::set_memo_id (never reused, unlike the Function address)
+    static uint64_t new_function_id();
+
+private:
+    void evict_last();
+
+    struct Entry {
+        std::string key;
+        Value value;
+    };
+    using Entries = std::list<Entry>;  // most recently used first
+    Entries m_entries;
+    std::unordered_map<std::string_view, Entries::iterator> m_index;  // views of keys in m_entries
+    size_t m_capacity = default_capacity;
+    Stats m_stats;
+};
+
+
+} // namespace xci::script
+
+#endif // include guard
@@ -7,7 +7,9 @@
 #include "Module.h"
 #include "Function.h"
 #include "Error.h"
+#include "ConstantPool.h"
 #include "ast/AST_serialization.h"
+#include "code/verify_bytecode.h"
 
 #include <xci/data/BinaryWriter.h>
 #include <xci/data/BinaryReader.h>
@@ -26,7 +28,7 @@ Module::~Module()
     std::cout << "* in ~Module " << name() << std::endl;
     #endif
     for (auto& val : m_values) {
-        val.decref();
+        release_value(std::move(val));
     }
 }
 
@@ -119,9 +121,11 @@ auto Module::add_scope(Scope&& scope) -> ScopeIdx
 
 Index Module::add_value(TypedValue&& value)
 {
+    if (m_constant_pool)
+        value = m_constant_pool->intern(std::move(value));
     auto idx = find_value(value);
     if (idx != no_index) {
-        value.decref();  // we don't save the new value -> release it
+        release_value(std::move(value));  // we don't save the new value -> release it
         return idx;
     }
 
@@ -130,6 +134,15 @@ Index Module::add_value(TypedValue&& value)
 }
 
 
+void Module::release_value(TypedValue&& value)
+{
+    if (m_constant_pool)
+        m_constant_pool->release(std::move(value));
+    else
+        value.decref();
+}
+
+
 Index Module::find_value(const TypedValue& value) const
 {
     const auto it = std::ranges::find(m_values, value);
@@ -248,6 +261,84 @@ std::vector<Index> Module::get_spec_instances(SymbolPointer gen_inst)
 }
 
 
+// Remap indexes of symbols of `type` in the whole symbol table tree
+static void remap_symbols(SymbolTable& root, Symbol::Type type, const std::vector<Index>& remap)
+{
+    root.foreach_table([type, &remap](SymbolTable& symtab) {
+        for (Symbol& sym : symtab) {
+            if (sym.type() == type && sym.index() != no_index && sym.index() < remap.size())
+                sym.set_index(remap[sym.index()]);
+        }
+    });
+}
+
+
+std::vector<Index> Module::retain_functions(const std::vector<bool>& keep)
+{
+    assert(keep.size() == m_functions.size());
+    assert(keep[0]);  // main function
+    std::vector<Index> remap(keep.size(), no_index);
+    IndexedMap<Function> kept;
+    for (Index i = 0; i != Index(keep.size()); ++i) {
+        Function& fn = m_functions[i];
+        if (keep[i])
+            remap[i] = kept.add(std::move(fn)).index;  // move ctor updates the symtab
+        else
+            fn.symtab().set_function(nullptr);
+    }
+    m_functions.clear();
+    m_functions = std::move(kept);
+
+    for (Scope& scope : m_scopes) {
+        if (scope.has_function())
+            scope.set_function_index(remap[scope.function_index()]);
+    }
+    return remap;
+}
+
+
+std::vector<Index> Module::retain_values(const std::vector<bool>& keep)
+{
+    assert(keep.size() == m_values.size());
+    std::vector<Index> remap(keep.size(), no_index);
+    TypedValues kept;
+    for (Index i = 0; i != Index(keep.size()); ++i) {
+        if (keep[i]) {
+            remap[i] = Index(kept.size());
+            kept.add(std::move(m_values[i]));
+        } else
+            release_value(std::move(m_values[i]));
+    }
+    m_values = std::move(kept);
+    remap_symbols(m_symtab, Symbol::Value, remap);
+    return remap;
+}
+
+
+std::vector<Index> Module::retain_instances(const std::vector<bool>& keep)
+{
+    assert(keep.size() == m_instances.size());
+    std::vector<Index> remap(keep.size(), no_index);
+    IndexedMap<Instance> kept;
+    for (Index i = 0; i != Index(keep.size()); ++i) {
+        if (keep[i])
+            remap[i] = kept.add(std::move(m_instances[i])).index;
+    }
+    m_instances.clear();
+    m_instances = std::move(kept);
+    remap_symbols(m_symtab, Symbol::Instance, remap);
+
+    for (auto it = m_spec_instances.begin(); it != m_spec_instances.end(); ) {
+        it->second = remap[it->second];
+        if (it->second == no_index)
+            it = m_spec_instances.erase(it);
+        else
+            ++it;
+    }
+    return remap;
+}
+
+
 bool Module::operator==(const Module& rhs) const
 {
     return m_modules == rhs.m_modules &&
@@ -267,7 +358,7 @@ bool Module::save_to_file(const std::string& filename)
 {
     std::ofstream f(filename, std::ios::binary);
     xci::data::BinaryWriter writer(f, true);
-    writer(m_modules)(m_values)(m_symtab)(m_functions);  // NOLINT(clang-analyzer-core.uninitialized.UndefReturn) - https://github.com/boostorg/pfr/issues/91
+    writer(format_version)(m_modules)(m_values)(m_symtab)(m_functions);  // NOLINT(clang-analyzer-core.uninitialized.UndefReturn) - https://github.com/boostorg/pfr/issues/91
     return !f.fail();
 }
 
@@ -275,7 +366,8 @@ bool Module::save_to_file(const std::string& filename)
 bool Module::write_schema_to_file(const std::string& filename)
 {
     xci::data::Schema schema;
-    schema  ("modules", m_modules)
+    schema  ("format_version", format_version)
+            ("modules", m_modules)
             ("values", m_values)
             ("symtab", m_symtab)
             ("functions", m_functions);
@@ -321,15 +413,34 @@ bool Module::load_from_file(const std::string& filename)
     };
     using ModuleReader = xci::data::BinaryReaderBase<ReaderContext>;
     ModuleReader reader(f, ReaderContext{*this});
+    uint32_t version = 0;
+    try {
+        reader(version);
+    } catch (const xci::data::ArchiveError&) {
+        return false;  // unversioned format (the first chunk is not the version)
+    }
+    if (version != format_version)
+        return false;
     reader.repeated(m_modules, [this](std::vector<std::shared_ptr<Module>>& modules) {
         return ModuleLoader(*m_module_manager, modules);
     });
     reader(m_values)(m_symtab);
+    if (m_constant_pool) {
+        for (auto& val : m_values)
+            val = m_constant_pool->intern(std::move(val));
+    }
     reader.repeated(m_functions, [this](IndexedMap<Function>& functions) -> Function& {
         auto idx = m_functions.emplace(*this);
         return *m_functions.get(idx);
     });
-    return !f.fail();
+    if (f.fail())
+        return false;
+    // don't trust the loaded bytecode, throws on failure
+    for (const Function& fn : m_functions) {
+        if (fn.is_bytecode())
+            verify_bytecode(fn);
+    }
+    return true;
 }
 
 
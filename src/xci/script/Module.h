@@ -35,7 +35,8 @@ public:
     using InstanceIdx = IndexedMap<Instance>::Index;
 
     explicit Module(ModuleManager& module_manager, NameId name = intern("<module>"))
-        : m_module_manager(&module_manager), m_symtab(name)
+        : m_module_manager(&module_manager),
+          m_constant_pool(module_manager.constant_pool()), m_symtab(name)
         { init(); }
     Module() : m_symtab(intern("<module>")) { m_symtab.set_module(this); }  // only for serialization
     ~Module();
@@ -96,6 +97,7 @@ public:
     Size num_scopes() const { return Size(m_scopes.size()); }
 
     // Static values
+    // Heap values (strings, lists) are shared with other modules via ConstantPool
     Index add_value(TypedValue&& value);
     const TypedValue& get_value(Index idx) const { return m_values[idx]; }
     Index find_value(const TypedValue& value) const;
@@ -135,7 +137,23 @@ public:
     void add_spec_instance(SymbolPointer gen_inst, Index spec_inst_idx);
     std::vector<Index> get_spec_instances(SymbolPointer gen_inst);
 
+    // Compaction (see code/tree_shake.h)
+    // Remove the functions / static values / instances not flagged in `keep`
+    // (indexed by the current index). The remaining items are renumbered,
+    // keeping their order. References from scopes and symbol tables are updated.
+    // Returns map of old index -> new index (no_index for removed item).
+    // The bytecode referencing the items has to be updated by the caller.
+    std::vector<Index> retain_functions(const std::vector<bool>& keep);
+    std::vector<Index> retain_values(const std::vector<bool>& keep);
+    std::vector<Index> retain_instances(const std::vector<bool>& keep);
+
     // Serialization
+    // The file begins with `format_version`. It must be incremented on any
+    // change to the saved data, including the values of Opcode and Type enums.
+    // load_from_file returns false for a file with different version.
+    // The loaded bytecode is verified, load_from_file throws ScriptError (BadBytecode)
+    // when any function doesn't pass (see code/verify_bytecode.h).
+    static constexpr uint32_t format_version = 1;
     bool save_to_file(const std::string& filename);
     bool load_from_file(const std::string& filename);
     bool write_schema_to_file(const std::string& filename);
@@ -152,7 +170,11 @@ public:
 private:
     void init();
 
+    // Release a static value, or its use in ConstantPool
+    void release_value(TypedValue&& value);
+
     ModuleManager* m_module_manager = nullptr;
+    std::shared_ptr<ConstantPool> m_constant_pool;  // keep the pool alive while the values are referenced
     std::vector<std::shared_ptr<Module>> m_modules;
     IndexedMap<Function> m_functions;
     IndexedMap<Scope> m_scopes;
@@ -8,6 +8,7 @@
 #include "Module.h"
 #include "Interpreter.h"
 #include "Builtin.h"
+#include "ConstantPool.h"
 #include "Error.h"
 
 #include <fmt/format.h>
@@ -18,7 +19,8 @@ namespace xci::script {
 
 
 ModuleManager::ModuleManager(const Vfs& vfs, Interpreter& interpreter)
-        : m_vfs(vfs), m_interpreter(interpreter)
+        : m_vfs(vfs), m_interpreter(interpreter),
+          m_constant_pool(std::make_shared<ConstantPool>())
 {
     m_modules.emplace_back(std::make_shared<BuiltinModule>(*this));
     m_module_names.try_emplace(intern("builtin"), 0);
@@ -16,6 +16,7 @@ namespace xci::script {
 using xci::vfs::Vfs;
 class Interpreter;
 class Module;
+class ConstantPool;
 
 using ModulePtr = std::shared_ptr<Module>;
 
@@ -49,9 +50,13 @@ public:
     // drop all modules except builtin and std
     void clear(bool keep_std = true);
 
+    /// Static values shared by the modules (see ConstantPool)
+    const std::shared_ptr<ConstantPool>& constant_pool() const { return m_constant_pool; }
+
 private:
     const Vfs& m_vfs;
     Interpreter& m_interpreter;
+    std::shared_ptr<ConstantPool> m_constant_pool;
     std::vector<ModulePtr> m_modules;
     std::map<NameId, Index> m_module_names;  // map name to index
 };
@@ -11,7 +11,9 @@
 #include "Stack.h"
 #include <xci/core/template/ToFunctionPtr.h>
 #include <tuple>
+#include <array>
 #include <string>
+#include <cstring>
 
 namespace xci::script {
 
@@ -116,6 +118,13 @@ concept ToString = std::is_constructible_v<value::String, T>;
 template<typename T>
 concept ToModule = std::is_same_v<T, Module&>;
 
+// Types which are passed to native functions directly from stack bytes
+template<typename T>
+concept ToScalar = ToBool<T> || ToChar<T> ||
+                   ToUInt8<T> || ToUInt16<T> || ToUInt32<T> || ToUInt64<T> ||
+                   ToInt8<T> || ToInt16<T> || ToInt32<T> || ToInt64<T> ||
+                   ToFloat32<T> || ToFloat64<T>;
+
 
 /// Convert native type to `script::TypeInfo`:
 ///
@@ -281,6 +290,81 @@ template<class T>
 using ValueType = typename ValueType_s<T>::type;
 
 
+/// Type of scalar as stored on stack, e.g. `char` is stored as `char32_t`
+template<class T>
+using StackType = decltype(std::declval<ValueType<T>>().value());
+
+template<ToScalar T>
+constexpr Type scalar_type() {
+    if constexpr (ToBool<T>) return Type::Bool;
+    else if constexpr (ToChar<T>) return Type::Char;
+    else if constexpr (ToUInt8<T>) return Type::UInt8;
+    else if constexpr (ToUInt16<T>) return Type::UInt16;
+    else if constexpr (ToUInt32<T>) return Type::UInt32;
+    else if constexpr (ToUInt64<T>) return Type::UInt64;
+    else if constexpr (ToInt8<T>) return Type::Int8;
+    else if constexpr (ToInt16<T>) return Type::Int16;
+    else if constexpr (ToInt32<T>) return Type::Int32;
+    else if constexpr (ToInt64<T>) return Type::Int64;
+    else if constexpr (ToFloat32<T>) return Type::Float32;
+    else return Type::Float64;
+}
+
+template<ToScalar T>
+T read_scalar(const std::byte* p) {
+    if constexpr (ToBool<T>)
+        return *p != std::byte(0);
+    else {
+        StackType<T> v;
+        std::memcpy(&v, p, sizeof(v));
+        return static_cast<T>(v);
+    }
+}
+
+template<ToScalar T>
+void write_scalar(std::byte* p, T v) {
+    if constexpr (ToBool<T>)
+        *p = std::byte(v);
+    else {
+        const auto s = static_cast<StackType<T>>(v);
+        std::memcpy(p, &s, sizeof(s));
+    }
+}
+
+
+/// Native call thunk for functions with only scalar args and result:
+/// reads the args directly from stack bytes at offsets computed in compile time,
+/// writes the result in place of the args. No intermediate Values are created.
+template<class Ret, class... Args>
+struct ScalarThunk {
+    static constexpr bool enabled = (ToVoid<Ret> || ToScalar<Ret>) && (ToScalar<Args> && ...);
+
+    static constexpr size_t args_size = (size_t(0) + ... + sizeof(StackType<Args>));
+
+    // offsets of args from top of the stack (first arg is on top)
+    static constexpr std::array<size_t, sizeof...(Args)> offsets = [] {
+        std::array<size_t, sizeof...(Args)> res {};
+        size_t i = 0, ofs = 0;
+        ((res[i++] = ofs, ofs += sizeof(StackType<Args>)), ...);
+        return res;
+    }();
+
+    // Call `f(pre..., args...)`, where args are read from stack
+    template<class F, std::size_t... Is, class... Pre>
+    static void call(Stack& stack, F f, std::index_sequence<Is...>, Pre... pre)
+    {
+        const std::byte* p = stack.data();
+        if constexpr (std::is_void_v<Ret>) {
+            f(pre..., read_scalar<Args>(p + offsets[Is])...);
+            stack.replace_top(sizeof...(Args), args_size, Type::Tuple);
+        } else {
+            const Ret r = f(pre..., read_scalar<Args>(p + offsets[Is])...);
+            write_scalar<Ret>(stack.replace_top(sizeof...(Args), args_size, scalar_type<Ret>()), r);
+        }
+    }
+};
+
+
 /// Call .decref() method on all values in a tuple.
 template<class Tuple, std::size_t... Is>
 void decref_each(Tuple&& t, std::index_sequence<Is...>)
@@ -321,8 +405,19 @@ struct AutoWrap<FPtr, Ret(*)(Args...), void> {
 
     /// Build wrapper function which reads args from stack,
     /// converts them to C types and calls original function.
+    /// Functions with only scalar args and result use ScalarThunk.
     NativeDelegate native_wrapper()
     {
+        using Thunk = ScalarThunk<Ret, Args...>;
+        if constexpr (Thunk::enabled) {
+            return {
+                [](Stack& stack, void* fun_ptr, void*) -> void {
+                    Thunk::call(stack, reinterpret_cast<FunctionPointer>(fun_ptr),
+                                std::index_sequence_for<Args...>{});
+                },
+                _fun_ptr
+            };
+        }
         return {
             [](Stack& stack, void* fun_ptr, void*) -> void {
                 // *** sample of generated code in comments ***
@@ -371,8 +466,20 @@ struct AutoWrap<FPtr, Ret(*)(Arg0, Args...), Arg0> {
 
     /// Build wrapper function which reads args from stack,
     /// converts them to C types and calls original function.
+    /// Functions with only scalar args and result use ScalarThunk.
     NativeDelegate native_wrapper()
     {
+        using Thunk = ScalarThunk<Ret, Args...>;
+        if constexpr (Thunk::enabled) {
+            return {
+                [](Stack& stack, void* fun_ptr, void* arg0) -> void {
+                    Thunk::call(stack, reinterpret_cast<FunctionPointer>(fun_ptr),
+                                std::index_sequence_for<Args...>{}, static_cast<Arg0>(arg0));
+                },
+                _fun_ptr,
+                _arg0
+            };
+        }
         return {
             [](Stack& stack, void* fun_ptr, void* arg0) -> void {
                 // *** sample of generated code in comments ***
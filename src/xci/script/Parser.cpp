@@ -133,13 +133,15 @@ struct TypeContext: seq< one<'('>, SC, must<TypeConstraint>, SC, star<one<','>,
 struct FunctionType: seq< opt<TypeParams>, SC, DeclParam, SC, DeclResult > {};
 struct FunctionDecl: seq< opt<TypeParams>, SC, DeclParam, SC, opt<DeclResult>, SC, opt<KeywordWith, SC, must<TypeContext>> > {};
 struct PlainTypeName: seq< TypeName, not_at<SC, one<','>> > {};  // not followed by comma (would be TupleType)
-struct ListType: seq< one<'['>, SC, must<UnsafeType>, SC, must<one<']'>> > {};
+struct MapType: seq< one<'['>, SC, Type, SC, one<':'>, SC, must<UnsafeType>, SC, must<one<']'>> > {};
+struct LazyListMark: string<'.','.'> {};  // [T..] - lazy sequence
+struct ListType: seq< one<'['>, SC, must<UnsafeType>, SC, opt<LazyListMark, SC>, must<one<']'>> > {};
 struct TupleType: seq< Type, plus<SC, one<','>, SC, Type> > {};
 struct StructItem: seq< Identifier, opt<SC, one<':'>, SC, must<Type>> > {};
 struct StructType: seq< StructItem, star<SC, opt<one<','>>, NSC, StructItem>, opt<SC, one<','>> > {};
 struct ParenthesizedType: seq< one<'('>, NSC, opt<UnsafeType, NSC>, must<one<')'>> > {};
-struct UnsafeType: sor<FunctionType, PlainTypeName, TupleType, StructType, ParenthesizedType, ListType> {};   // usable in context where Type is already expected
-struct Type: sor< ParenthesizedType, ListType, TypeName > {};
+struct UnsafeType: sor<FunctionType, PlainTypeName, TupleType, StructType, ParenthesizedType, MapType, ListType> {};   // usable in context where Type is already expected
+struct Type: sor< ParenthesizedType, MapType, ListType, TypeName > {};
 
 // Expressions
 // * some rules are parametrized with S (space type), choose either SC or NSC (allow newline)
@@ -878,6 +880,29 @@ struct Action<ListType> : change_states< ast::ListType > {
 };
 
 
+template<>
+struct Action<LazyListMark> {
+    template<typename Input>
+    static void apply(const Input &in, ast::ListType& ltype) {
+        ltype.lazy = true;
+    }
+};
+
+
+template<>
+struct Action<MapType> : change_states< ast::MapType > {
+    template<typename Input>
+    static void apply(const Input &in, ast::MapType& mtype) {
+        mtype.source_loc.load(in.input(), in.position());
+    }
+
+    template<typename Input>
+    static void success(const Input &in, ast::MapType& mtype, std::unique_ptr<ast::Type>& type) {
+        type = std::make_unique<ast::MapType>(std::move(mtype));
+    }
+};
+
+
 template<>
 struct Action<TupleType> : change_states< ast::TupleType > {
     template<typename Input>
@@ -987,6 +1012,11 @@ struct Action<Type> : change_states< std::unique_ptr<ast::Type> >  {
     static void success(const Input &in, std::unique_ptr<ast::Type>& type, ast::Reference& ref) {
         ref.type_args.push_back(std::move(type));
     }
+
+    template<typename Input>
+    static void success(const Input &in, std::unique_ptr<ast::Type>& type, ast::MapType& mtype) {
+        mtype.key_type = std::move(type);
+    }
 };
 
 
@@ -1009,6 +1039,11 @@ struct Action<UnsafeType> : change_states< std::unique_ptr<ast::Type> >  {
         ltype.elem_type = std::move(type);
     }
 
+    template<typename Input>
+    static void success(const Input &in, std::unique_ptr<ast::Type>& type, ast::MapType& mtype) {
+        mtype.value_type = std::move(type);
+    }
+
     template<typename Input>
     static void success(const Input &in, std::unique_ptr<ast::Type>& type, ast::Variable& var) {
         var.type = std::move(type);
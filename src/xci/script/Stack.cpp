@@ -35,6 +35,20 @@ void Stack::push(const Value& v)
 }
 
 
+std::byte* Stack::push_raw(size_t size, std::span<const TypeInfo> types)
+{
+    if (m_stack_pointer < size) {
+        if (grow() < size)
+            throw stack_overflow();
+    }
+    m_stack_pointer -= size;
+    // same type records as when pushing the values one by one, last value first
+    for (auto it = types.rbegin(); it != types.rend(); ++it)
+        push_type(*it);
+    return data();
+}
+
+
 Value Stack::pull(const TypeInfo& ti)
 {
     // create Value with TypeInfo, read contents from stack
@@ -45,6 +59,57 @@ Value Stack::pull(const TypeInfo& ti)
 }
 
 
+std::byte* Stack::replace_top(size_t n_values, size_t size, Type result)
+{
+    if (Stack::size() < size || m_stack_types.size() < n_values)
+        throw stack_underflow();
+    m_stack_types.resize(m_stack_types.size() - n_values);
+    m_stack_pointer += size;
+    const auto result_size = type_size_on_stack(result);
+    if (result_size == 0)
+        return data();
+    if (m_stack_pointer < result_size) {
+        if (grow() < result_size)
+            throw stack_overflow();
+    }
+    m_stack_pointer -= result_size;
+    m_stack_types.push_back(result);
+    return data();
+}
+
+
+void Stack::check_top(std::span<const TypeInfo> types) const
+{
+    size_t size = 0;
+    for (const auto& ti : types)
+        size += ti.size();
+    if (Stack::size() < size)
+        throw stack_underflow();
+
+    // walk the type records from top, in reverse order of push_type
+    auto it_type = m_stack_types.rbegin();
+    auto check_type = [this, &it_type](const TypeInfo& ti, auto& self) -> void {
+        const auto& uti = ti.underlying();
+        if (uti.is_struct_or_tuple()) {
+            for (const auto& item : reverse(uti.subtypes()))
+                self(item, self);
+            return;
+        }
+        if (uti.size() == 0)
+            return;
+        if (it_type == m_stack_types.rend())
+            throw stack_underflow();
+        // allow casts - only size have to match (see pop_type)
+        if (type_size_on_stack(*it_type) != uti.size())
+            throw bad_instruction(fmt::format("unexpected value on stack: size {} (expected {})",
+                                              type_size_on_stack(*it_type), uti.size()));
+        ++it_type;
+    };
+    for (const auto& ti : types)
+        check_type(ti, check_type);
+}
+
+
 Value Stack::get(StackRel pos, const TypeInfo& ti) const
 {
     assert(pos + ti.size() <= size());
@@ -244,6 +309,24 @@ size_t Stack::grow()
 }
 
 
+void Stack::reserve(size_t free_size)
+{
+    while (m_stack_pointer < free_size) {
+        const auto prev = m_stack_pointer;
+        if (grow() == prev)
+            throw stack_overflow();
+    }
+}
+
+
+void Stack::set_types(size_t keep, std::span<const Type> types)
+{
+    assert(keep <= m_stack_types.size());
+    m_stack_types.resize(keep);
+    m_stack_types.insert(m_stack_types.end(), types.begin(), types.end());
+}
+
+
 void Stack::push_type(const Value& v)
 {
     if (v.type() == Type::Tuple) {
@@ -255,6 +338,17 @@ void Stack::push_type(const Value& v)
 }
 
 
+void Stack::push_type(const TypeInfo& ti)
+{
+    const auto& uti = ti.underlying();
+    if (uti.is_struct_or_tuple()) {
+        for (const auto& item : uti.subtypes())
+            push_type(item);
+    } else if (uti.size() != 0)
+        m_stack_types.emplace_back(uti.type());
+}
+
+
 void Stack::pop_type(const Value& v)
 {
     if (Stack::size() < v.size_on_stack())
@@ -11,6 +11,7 @@
 #include "Error.h"
 #include <xci/core/container/ChunkedStack.h>
 #include <cstddef>  // byte
+#include <span>
 #include <vector>
 #include <ostream>
 
@@ -50,6 +51,11 @@ public:
     void push(const TypedValue& v) { push(v.value()); }
 
     Value pull(const TypeInfo& ti);
+
+    // Allocate `size` bytes on top of the stack, for values of `types`
+    // (the first value on top), return pointer to the allocated space.
+    // The caller writes the raw data, including the references (no incref here).
+    std::byte* push_raw(size_t size, std::span<const TypeInfo> types);
     TypedValue pull_typed(const TypeInfo& ti) { return {pull(ti), ti}; }
 
     template <ValueT T>
@@ -62,6 +68,17 @@ public:
         return v;
     }
 
+    // Replace top `n_values` values (`size` bytes) with a value of `result` type.
+    // Returns address of the result, which the caller has to write.
+    // Used by native functions which read their args directly (see NativeDelegate.h).
+    // The types of removed values are not checked.
+    std::byte* replace_top(size_t n_values, size_t size, Type result);
+
+    // Check that top of the stack holds values of `types` (the first value on top),
+    // like `pull` would do for each of them. Throws on stack underflow
+    // or when a type record doesn't match. Used for unverified bytecode.
+    void check_top(std::span<const TypeInfo> types) const;
+
     Value get(StackRel pos, const TypeInfo& ti) const;
     Value get(StackRel pos, Type type) const;  // cannot be used for Tuple
     void* get_ptr(StackRel pos) const;
@@ -154,6 +171,27 @@ public:
     const value::Stream& get_stream_out() { m_streams.out.incref(); return m_streams.out; }
     const value::Stream& get_stream_err() { m_streams.err.incref(); return m_streams.err; }
 
+    // Output buffers of this stack's machine - write to the streams through these
+    OutputBuffers& output_buffers() { return m_output_buffers; }
+
+    // ------------------------------------------------------------------------
+    // Raw access for JIT compiled code
+    // The compiled code reads and writes the stack memory directly.
+    // The stack pointer and type records are updated only when
+    // the compiled code calls back into the Machine or returns.
+
+    // Address of StackAbs zero (one past the bottom of the stack)
+    std::byte* bottom() const { return m_stack.get() + m_stack_capacity; }
+
+    // Set top of the stack to `top` (previously obtained by data())
+    void set_data(std::byte* top) { m_stack_pointer = size_t(top - m_stack.get()); }
+
+    // Grow the stack to have at least `free_size` bytes above the top
+    void reserve(size_t free_size);
+
+    // Replace type records above first `keep` records
+    void set_types(size_t keep, std::span<const Type> types);
+
     // ------------------------------------------------------------------------
 
     friend std::ostream& operator<<(std::ostream& os, const Stack& v);
@@ -163,6 +201,7 @@ public:
 
 private:
     void push_type(const Value& v);
+    void push_type(const TypeInfo& ti);
 
     // throw if the stack would underflow
     // or when the top isn't compatible with the type
@@ -174,6 +213,7 @@ private:
     std::unique_ptr<std::byte[]> m_stack = std::make_unique<std::byte[]>(m_stack_capacity);
     std::vector<Type> m_stack_types;
     core::ChunkedStack<Frame> m_frame;
+    OutputBuffers m_output_buffers;  // destroyed after the streams
     Streams m_streams;
 };
 
@@ -6,11 +6,17 @@
 
 #include "Stream.h"
 #include <xci/core/log.h>
+#include <xci/core/file.h>
 #include <xci/core/template/helpers.h>
 #include <xci/compat/unistd.h>
 #include <xci/compat/macros.h>
 #include <fmt/ostream.h>
 #include <cassert>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/uio.h>  // writev
+#endif
 
 namespace xci::script {
 
@@ -48,30 +54,63 @@ static constexpr auto term_stdin_name = "term:stdin";
 static constexpr auto term_stderr_name = "term:stderr";
 
 
+// Write `a` followed by `b` to FD, in a loop handling EINTR and partial writes.
+// Usually, this is a single syscall.
+static bool write_fd(int fd, std::string_view a, std::string_view b = {})
+{
+#ifdef _WIN32
+    return core::write(fd, a) && core::write(fd, b);
+#else
+    struct iovec iov[2] = {
+            {const_cast<char*>(a.data()), a.size()},
+            {const_cast<char*>(b.data()), b.size()},
+    };
+    struct iovec* p = iov;
+    int iovcnt = 2;
+    size_t total = a.size() + b.size();
+    while (total != 0) {
+        const ssize_t r = ::writev(fd, p, iovcnt);
+        if (r == -1) {
+            if (errno == EINTR)
+                continue;
+            log::error("writev({}, {} bytes): {m}", fd, total);
+            return false;
+        }
+        // skip what was written
+        total -= size_t(r);
+        auto n = size_t(r);
+        while (iovcnt != 0 && n >= p->iov_len) {
+            n -= p->iov_len;
+            ++p;
+            --iovcnt;
+        }
+        if (iovcnt != 0) {
+            p->iov_base = static_cast<char*>(p->iov_base) + n;
+            p->iov_len -= n;
+        }
+    }
+    return true;
+#endif
+}
+
+
 size_t Stream::write(void* data, size_t size)
 {
-    return std::visit([data, size](auto&& v) {
+    const std::string_view s {static_cast<const char*>(data), size};
+    return std::visit([s](auto&& v) {
         using T = std::decay_t<decltype(v)>;
         if constexpr (std::is_same_v<T, Undef>) {
             assert(!"can't write to undefined stream");
             return size_t(0);
         } else if constexpr (std::is_same_v<T, Null>)
-            return size;
+            return s.size();
         else if constexpr (std::is_same_v<T, CFile> || std::is_same_v<T, CFileRef>) {
-            return fwrite(data, 1, size, v.file);
+            return fwrite(s.data(), 1, s.size(), v.file);
         } else if constexpr (std::is_same_v<T, Fd> || std::is_same_v<T, FdRef>) {
-            ssize_t r;
-            do {
-                r = ::write(v.fd, data, size);
-            } while (r == -1 && errno == EINTR);
-            if (r == -1) {
-                log::error("write({}): {m}", v.fd);
-                return (size_t) 0;
-            }
-            return (size_t) r;
+            return write_fd(v.fd, s) ? s.size() : size_t(0);
         } else if constexpr (std::is_same_v<T, TermCtlRef>) {
-            v.term->write({(const char*) data, size});
-            return size;
+            v.term->write(s);
+            return s.size();
         }
     }, m_handle);
 }
@@ -243,10 +282,230 @@ void Stream::close()
 {
     std::visit(overloaded {
             [](CFile v) { fclose(v.file); },
-            [](Fd v) { ::close(v.fd); },
+            [](Fd v) { OutputBuffers::on_close(v.fd); ::close(v.fd); },
             [](auto) {},
     }, m_handle);
 }
 
 
+// -----------------------------------------------------------------------------
+
+
+static OutputBuffers::Buffering default_buffering(bool is_stderr, bool is_tty)
+{
+    if (is_stderr)
+        return OutputBuffers::Buffering::None;
+    return is_tty ? OutputBuffers::Buffering::Line : OutputBuffers::Buffering::Full;
+}
+
+
+static bool fd_is_tty(int fd)
+{
+#ifdef _WIN32
+    return _isatty(fd) != 0;
+#else
+    return isatty(fd) == 1;
+#endif
+}
+
+
+static int target(Stream::FdRef v) { return v.fd; }
+static int target(Stream::Fd v) { return v.fd; }
+static TermCtl* target(Stream::TermCtlRef v) { return v.term; }
+
+static bool write_out(int fd, std::string_view a, std::string_view b = {})
+{
+    return write_fd(fd, a, b);
+}
+
+static bool write_out(TermCtl* term, std::string_view a, std::string_view b = {})
+{
+    if (!a.empty())
+        term->write(a);
+    if (!b.empty())
+        term->write(b);
+    return true;
+}
+
+template <class T>
+static constexpr bool is_buffered = std::is_same_v<T, Stream::FdRef> || std::is_same_v<T, Stream::Fd>
+                                    || std::is_same_v<T, Stream::TermCtlRef>;
+
+
+// The list is made of raw pointers, it has no destructor,
+// so it's safe to use from static destructors (e.g. a static Interpreter).
+static thread_local OutputBuffers* t_first_buffers = nullptr;
+
+
+OutputBuffers::OutputBuffers()
+{
+    m_next = t_first_buffers;
+    if (m_next)
+        m_next->m_prev = this;
+    t_first_buffers = this;
+}
+
+
+OutputBuffers::~OutputBuffers()
+{
+    flush_all();
+    if (m_prev)
+        m_prev->m_next = m_next;
+    else if (t_first_buffers == this)
+        t_first_buffers = m_next;
+    if (m_next)
+        m_next->m_prev = m_prev;
+}
+
+
+auto OutputBuffers::get(int fd) -> Buffer&
+{
+    auto it = m_fd.find(fd);
+    if (it == m_fd.end())
+        it = m_fd.emplace(fd, Buffer{default_buffering(fd == STDERR_FILENO, fd_is_tty(fd))}).first;
+    return it->second;
+}
+
+
+auto OutputBuffers::get(TermCtl* term) -> Buffer&
+{
+    auto it = m_term.find(term);
+    if (it == m_term.end())
+        it = m_term.emplace(term, Buffer{default_buffering(term == &TermCtl::stderr_instance(), term->is_tty())}).first;
+    return it->second;
+}
+
+
+void OutputBuffers::set_buffering(Stream stream, Buffering mode, size_t size)
+{
+    std::visit([this, mode, size](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (is_buffered<T>) {
+            flush(Stream(v));
+            auto& buf = get(target(v));
+            buf.mode = mode;
+            buf.capacity = size;
+            buf.configured = true;
+        }
+    }, stream.m_handle);
+}
+
+
+auto OutputBuffers::buffering(Stream stream) -> Buffering
+{
+    return std::visit([this](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (is_buffered<T>)
+            return get(target(v)).mode;
+        else
+            return Buffering::None;
+    }, stream.m_handle);
+}
+
+
+size_t OutputBuffers::write(Stream stream, std::string_view data)
+{
+    return std::visit([this, stream, data](auto&& v) mutable {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (is_buffered<T>) {
+            auto& buf = get(target(v));
+            if (buf.mode == Buffering::None || buf.data.size() + data.size() > buf.capacity) {
+                // coalesce the buffered data with the new data
+                if (!write_out(target(v), buf.data, data))
+                    return size_t(0);
+                buf.data.clear();
+                return data.size();
+            }
+            buf.data.append(data);
+            if (buf.mode == Buffering::Line && data.find('\n') != std::string_view::npos) {
+                write_out(target(v), buf.data);
+                buf.data.clear();
+            }
+            return data.size();
+        } else
+            return stream.write((void*) data.data(), data.size());
+    }, stream.m_handle);
+}
+
+
+void OutputBuffers::flush(Stream stream)
+{
+    std::visit([this](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (is_buffered<T>) {
+            auto& buf = get(target(v));
+            if (!buf.data.empty()) {
+                write_out(target(v), buf.data);
+                buf.data.clear();
+            }
+        }
+    }, stream.m_handle);
+    stream.flush();
+}
+
+
+std::string OutputBuffers::read(Stream stream, size_t n)
+{
+    // make sure a prompt is visible before waiting for input
+    flush_all();
+    return stream.read(n);
+}
+
+
+// Write out the buffers, drop those with default settings
+template <class M>
+static void flush_map(M& map)
+{
+    for (auto it = map.begin(); it != map.end(); ) {
+        write_out(it->first, it->second.data);
+        it->second.data.clear();
+        if (it->second.configured)
+            ++it;
+        else
+            it = map.erase(it);
+    }
+}
+
+
+void OutputBuffers::flush_all()
+{
+    flush_map(m_fd);
+    flush_map(m_term);
+}
+
+
+void OutputBuffers::forget(Stream stream)
+{
+    std::visit([this](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, Stream::FdRef> || std::is_same_v<T, Stream::Fd>)
+            forget_fd(v.fd);
+        else if constexpr (std::is_same_v<T, Stream::TermCtlRef>) {
+            auto it = m_term.find(v.term);
+            if (it != m_term.end()) {
+                write_out(v.term, it->second.data);
+                m_term.erase(it);
+            }
+        }
+    }, stream.m_handle);
+}
+
+
+void OutputBuffers::forget_fd(int fd)
+{
+    auto it = m_fd.find(fd);
+    if (it != m_fd.end()) {
+        write_out(fd, it->second.data);
+        m_fd.erase(it);
+    }
+}
+
+
+void OutputBuffers::on_close(int fd)
+{
+    for (auto* buffers = t_first_buffers; buffers != nullptr; buffers = buffers->m_next)
+        buffers->forget_fd(fd);
+}
+
+
 } // namespace xci::script
@@ -8,7 +8,10 @@
 #define XCI_SCRIPT_STREAM_H
 
 #include <xci/core/TermCtl.h>
+#include <xci/core/mixin.h>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <span>
 #include <cstdio>
@@ -116,6 +119,7 @@ public:
     void close();
 
 private:
+    friend class OutputBuffers;
     HandleVariant m_handle;
 };
 
@@ -124,6 +128,81 @@ private:
 static_assert(sizeof(Stream) == 2 * sizeof(void*));
 
 
+/// Output buffers for FD and TermCtl streams, by target (fd, TermCtl)
+///
+/// Stream itself is unbuffered. Each Machine has its own buffers (see Stack),
+/// shared by all streams writing to the same target. The buffers are flushed
+/// when full, on explicit `flush`, before reading from any stream,
+/// at the end of each Machine::call, and before an owned fd is closed
+/// (Stream::close, i.e. when the last reference to the stream is released).
+/// When a write doesn't fit in the buffer, the buffer and the new data
+/// are written by single `writev`.
+///
+/// stdio streams are not buffered here, they have their own buffering.
+///
+/// The buffering mode can be set per target (`set_buffering`, or the builtin
+/// function of the same name). The setting is kept until the target is closed
+/// or forgotten. The default mode is not kept, it's determined again when
+/// the target is written after the end of a call.
+///
+/// Not thread-safe, same as the Machine. An owned fd must be closed
+/// on the thread where the Machine was created, otherwise its buffer
+/// is not flushed before closing.
+
+class OutputBuffers: private core::NonCopyable {
+public:
+    OutputBuffers();
+    ~OutputBuffers();
+
+    // Default is Line for a terminal, Full for other targets and None for stderr.
+    enum class Buffering : uint8_t {
+        None,   // write through
+        Line,   // flush after writing a newline
+        Full,   // flush when the buffer is full
+    };
+    static constexpr size_t default_buffer_size = 8192;
+
+    void set_buffering(Stream stream, Buffering mode, size_t size = default_buffer_size);
+    Buffering buffering(Stream stream);
+
+    template <ByteSpanT T> size_t write(Stream stream, T data) { return write(stream, {(const char*) data.data(), data.size()}); }
+    size_t write(Stream stream, std::string_view data);
+    void flush(Stream stream);
+
+    // Flush all buffers before reading
+    std::string read(Stream stream, size_t n);
+
+    // Flush all buffers. Drop those with default settings.
+    void flush_all();
+
+    // Flush the buffer and forget its settings - call before closing
+    // a referenced fd (FdRef) which has explicit settings.
+    void forget(Stream stream);
+
+    // Called by Stream::close before closing an owned fd
+    static void on_close(int fd);
+
+private:
+    struct Buffer {
+        Buffering mode;
+        size_t capacity = default_buffer_size;
+        std::string data;
+        bool configured = false;  // set by set_buffering, kept by flush_all
+    };
+
+    Buffer& get(int fd);
+    Buffer& get(core::TermCtl* term);
+    void forget_fd(int fd);
+
+    std::unordered_map<int, Buffer> m_fd;
+    std::unordered_map<core::TermCtl*, Buffer> m_term;
+
+    // instances living in this thread, see on_close
+    OutputBuffers* m_prev = nullptr;
+    OutputBuffers* m_next = nullptr;
+};
+
+
 } // namespace xci::script
 
 #endif // include guard
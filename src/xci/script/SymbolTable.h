@@ -258,6 +258,14 @@ public:
     Children children() const { return Children{*this}; }
     SymbolTable* find_child_by_name(NameId name);
 
+    // Call `f` with this table and then with each of its descendants
+    template<class F>
+    void foreach_table(F&& f) {
+        f(*this);
+        for (SymbolTable& child : m_children)
+            child.foreach_table(f);
+    }
+
     template<class Archive>
     void save(Archive& ar) const {
         ar ("name", m_name) ("symbols", m_symbols) ("children", m_children);
@@ -65,7 +65,10 @@ size_t type_size_on_stack(Type type)
         case Type::Float128:
             return 16;
         case Type::String:
+            return 16;  // inline or heap string, see StringV
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Function:
         case Type::Stream:
         case Type::Module:
@@ -85,6 +88,20 @@ TypeInfo::TypeInfo(ListTag, TypeInfo elem)
 }
 
 
+TypeInfo::TypeInfo(MapTag, TypeInfo key, TypeInfo value)
+        : m_type(Type::Map)
+{
+    std::construct_at(&m_subtypes, Subtypes({std::move(key), std::move(value)}));
+}
+
+
+TypeInfo::TypeInfo(IterTag, TypeInfo elem)
+        : m_type(Type::Iterator)
+{
+    std::construct_at(&m_subtypes, Subtypes({std::move(elem)}));
+}
+
+
 TypeInfo::TypeInfo(NameId name, TypeInfo&& type_info)
         : m_type(Type::Named)
 {
@@ -126,6 +143,8 @@ void TypeInfo::construct_variant() {
     switch (m_type) {
         case Type::Unknown: std::construct_at(&m_var); break;
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Tuple:
         case Type::Struct: std::construct_at(&m_subtypes); break;
         case Type::Function: std::construct_at(&m_signature_ptr); break;
@@ -140,6 +159,8 @@ void TypeInfo::destroy_variant() {
     switch (m_type) {
         case Type::Unknown: m_var.~Var(); break;
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Tuple:
         case Type::Struct: m_subtypes.~Subtypes(); break;
         case Type::Function: m_signature_ptr.~SignaturePtr(); break;
@@ -155,6 +176,8 @@ void TypeInfo::copy_variant(const xci::script::TypeInfo& r)
     switch (m_type) {
         case Type::Unknown: m_var = r.m_var; break;
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Tuple:
         case Type::Struct: m_subtypes = r.m_subtypes; break;
         case Type::Function: m_signature_ptr = r.m_signature_ptr; break;
@@ -170,6 +193,8 @@ void TypeInfo::move_variant(xci::script::TypeInfo&& r)
     switch (m_type) {
         case Type::Unknown: m_var = r.m_var; break;
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Tuple:
         case Type::Struct: m_subtypes = std::move(r.m_subtypes); break;
         case Type::Function: m_signature_ptr = std::move(r.m_signature_ptr); break;
@@ -196,7 +221,7 @@ auto TypeInfo::generic_var() -> Var&
 
 auto TypeInfo::subtypes() const -> const Subtypes&
 {
-    assert(m_type == Type::Tuple || m_type == Type::Struct || type() == Type::List);
+    assert(has_subtypes(m_type));
     return m_subtypes;
 }
 
@@ -238,6 +263,8 @@ void TypeInfo::foreach_heap_slot(std::function<void(size_t offset)> cb) const
     switch (uti.type()) {
         case Type::String:
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Function:
         case Type::Stream:
             cb(0);
@@ -278,6 +305,8 @@ void TypeInfo::replace_var(SymbolPointer var, const TypeInfo& ti)
         case Type::Tuple:
         case Type::Struct:
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
             for (auto& sub : subtypes())
                 sub.replace_var(var, ti);
             break;
@@ -324,8 +353,13 @@ bool is_same_underlying(const TypeInfo& lhs, const TypeInfo& rhs)
         case Type::TypeIndex:
             return l.type() == r.type();
         case Type::List:
-            return r.type() == Type::List &&
+        case Type::Iterator:
+            return r.type() == l.type() &&
                    is_same_underlying(l.elem_type(), r.elem_type());
+        case Type::Map:
+            return r.type() == Type::Map &&
+                   is_same_underlying(l.map_key_type(), r.map_key_type()) &&
+                   is_same_underlying(l.map_value_type(), r.map_value_type());
         case Type::Tuple:
         case Type::Struct:
             if (r.type() == Type::Tuple || r.type() == Type::Struct) {
@@ -357,6 +391,8 @@ bool TypeInfo::operator==(const TypeInfo& rhs) const
         return false;  // keys don't match (missing key = match anything)
     switch (type()) {
         case Type::List:
+        case Type::Map:
+        case Type::Iterator:
         case Type::Tuple:
         case Type::Struct: return subtypes() == rhs.subtypes();
         case Type::Function: return signature() == rhs.signature();  // compare content, not pointer
@@ -375,7 +411,10 @@ bool TypeInfo::has_unknown() const
         case Type::Function:
             return signature_ptr()->has_any_unknown();
         case Type::List:
+        case Type::Iterator:
             return elem_type().has_unknown();
+        case Type::Map:
+            return map_key_type().has_unknown() || map_value_type().has_unknown();
         case Type::Tuple:
         case Type::Struct:
             return std::ranges::any_of(subtypes(), [](const TypeInfo& type_info) {
@@ -395,7 +434,10 @@ bool TypeInfo::has_generic() const
         case Type::Function:
             return signature_ptr()->has_any_generic();
         case Type::List:
+        case Type::Iterator:
             return elem_type().has_generic();
+        case Type::Map:
+            return map_key_type().has_generic() || map_value_type().has_generic();
         case Type::Tuple:
         case Type::Struct:
             return std::ranges::any_of(subtypes(), [](const TypeInfo& type_info) {
@@ -409,12 +451,28 @@ bool TypeInfo::has_generic() const
 
 auto TypeInfo::elem_type() const -> const TypeInfo&
 {
-    assert(type() == Type::List);
+    assert(type() == Type::List || type() == Type::Iterator);
     assert(subtypes().size() == 1);
     return subtypes().front();
 }
 
 
+auto TypeInfo::map_key_type() const -> const TypeInfo&
+{
+    assert(type() == Type::Map);
+    assert(subtypes().size() == 2);
+    return subtypes()[0];
+}
+
+
+auto TypeInfo::map_value_type() const -> const TypeInfo&
+{
+    assert(type() == Type::Map);
+    assert(subtypes().size() == 2);
+    return subtypes()[1];
+}
+
+
 const TypeInfo* TypeInfo::struct_item_by_key(NameId key) const
 {
     const auto& items = subtypes();
@@ -55,6 +55,11 @@ enum class Type : uint8_t {
     Named,      // type NewType = ... (all other types are anonymous)
     Struct,     // a tuple with named members, similar to C struct
 
+    // The values are saved in compiled modules, new types must be appended
+    // here (and Module::format_version incremented on any change)
+    Map,        // hash map from key type to value type (both are part of type)
+    Iterator,   // lazy sequence, elements are generated on demand (elem type is part of type)
+
     // Aliases:
     Byte = UInt8,
     Int = Int64,
@@ -79,10 +84,14 @@ struct NamedType;
 class TypeInfo {
 public:
     struct ListTag {};
+    struct MapTag {};
+    struct IterTag {};
     struct TupleTag {};
     struct StructTag {};
 
     static constexpr ListTag list_of {};
+    static constexpr MapTag map_of {};
+    static constexpr IterTag iter_of {};
     static constexpr TupleTag tuple_of {};
     static constexpr StructTag struct_of {};
 
@@ -102,6 +111,10 @@ public:
     explicit TypeInfo(SignaturePtr signature) : m_type(Type::Function) { std::construct_at(&m_signature_ptr, std::move(signature)); }
     // List
     explicit TypeInfo(ListTag tag, TypeInfo elem);
+    // Map
+    explicit TypeInfo(MapTag tag, TypeInfo key, TypeInfo value);
+    // Iterator
+    explicit TypeInfo(IterTag tag, TypeInfo elem);
     // Tuple
     explicit TypeInfo(TupleTag, Subtypes subtypes)
             : m_type(Type::Tuple) { std::construct_at(&m_subtypes, std::move(subtypes)); }
@@ -145,8 +158,7 @@ public:
     void set_type(Type type) {
         if (m_type == type)
             return;
-        if ((m_type == Type::List || m_type == Type::Tuple || m_type == Type::Struct) &&
-            (type == Type::List || type == Type::Tuple || type == Type::Struct))
+        if (has_subtypes(m_type) && has_subtypes(type))
         {
             m_type = type;
             return;
@@ -166,6 +178,8 @@ public:
     bool is_bool() const { return type() == Type::Bool; }
     bool is_string() const { return type() == Type::String; }
     bool is_list() const { return type() == Type::List; }
+    bool is_map() const { return type() == Type::Map; }
+    bool is_iter() const { return type() == Type::Iterator; }
     bool is_tuple() const { return type() == Type::Tuple; }
     bool is_struct() const { return type() == Type::Struct; }
     bool is_struct_or_tuple() const { return is_struct() || is_tuple(); }
@@ -197,8 +211,12 @@ public:
 
     Var generic_var() const;  // type = Unknown
     Var& generic_var();  // type = Unknown
-    const TypeInfo& elem_type() const;  // type = List (Subtypes[0])
+    const TypeInfo& elem_type() const;  // type = List, Iterator (Subtypes[0])
     TypeInfo& elem_type() { return const_cast<TypeInfo&>( const_cast<const TypeInfo*>(this)->elem_type() ); }
+    const TypeInfo& map_key_type() const;  // type = Map (Subtypes[0])
+    TypeInfo& map_key_type() { return const_cast<TypeInfo&>( const_cast<const TypeInfo*>(this)->map_key_type() ); }
+    const TypeInfo& map_value_type() const;  // type = Map (Subtypes[1])
+    TypeInfo& map_value_type() { return const_cast<TypeInfo&>( const_cast<const TypeInfo*>(this)->map_value_type() ); }
     const Subtypes& subtypes() const;  // type = Tuple
     Subtypes& subtypes() { return const_cast<Subtypes&>( const_cast<const TypeInfo*>(this)->subtypes() ); }
     const SignaturePtr& signature_ptr() const;  // type = Function
@@ -222,6 +240,12 @@ public:
     template <class Archive> void load(Archive& ar);
 
 private:
+    // Types which store Subtypes in the variant
+    static constexpr bool has_subtypes(Type t) {
+        return t == Type::List || t == Type::Map || t == Type::Iterator
+            || t == Type::Tuple || t == Type::Struct;
+    }
+
     void construct_variant();
     void destroy_variant();
     void copy_variant(const TypeInfo& r);
@@ -249,6 +273,8 @@ void TypeInfo::save_schema(Archive& ar) const {
     if (ar.enter_union("info", "type", typeid(TypeInfo))) {
         ar(uint8_t(Type::Unknown), "var", SymbolPointer{});
         ar(uint8_t(Type::List), "elem_type", TypeInfo{});
+        ar(uint8_t(Type::Map), "subtypes", Subtypes{});
+        ar(uint8_t(Type::Iterator), "elem_type", TypeInfo{});
         ar(uint8_t(Type::Tuple), "subtypes", Subtypes{});
         ar(uint8_t(Type::Function), "signature", SignaturePtr{});
         ar(uint8_t(Type::Named), "named_type", NamedTypePtr{});
@@ -271,8 +297,10 @@ void TypeInfo::save(Archive& ar) const {
             ar("signature", signature());
             break;
         case Type::List:
+        case Type::Iterator:
             ar("elem_type", elem_type());
             break;
+        case Type::Map:
         case Type::Tuple:
         case Type::Struct:
             ar("subtypes", subtypes());
@@ -302,11 +330,13 @@ void TypeInfo::load(Archive& ar)
             ar(*signature_ptr());
             break;
         }
-        case Type::List: {
+        case Type::List:
+        case Type::Iterator: {
             subtypes().reset(1);
             ar(subtypes().front());
             break;
         }
+        case Type::Map:
         case Type::Tuple:
         case Type::Struct: {
             std::vector<TypeInfo> v;
@@ -405,6 +435,11 @@ inline TypeInfo ti_list(TypeInfo&& elem) { return TypeInfo(TypeInfo::list_of, st
 inline TypeInfo ti_chars() { return TypeInfo{TypeInfo::list_of, ti_char()}; }
 inline TypeInfo ti_bytes() { return TypeInfo{TypeInfo::list_of, ti_byte()}; }
 
+inline TypeInfo ti_map(TypeInfo&& key, TypeInfo&& value)
+{ return TypeInfo(TypeInfo::map_of, std::forward<TypeInfo>(key), std::forward<TypeInfo>(value)); }
+
+inline TypeInfo ti_iter(TypeInfo&& elem) { return TypeInfo(TypeInfo::iter_of, std::forward<TypeInfo>(elem)); }
+
 // Each item must be TypeInfo
 template <typename... Args>
 inline TypeInfo ti_tuple(Args&&... args) { return TypeInfo(TypeInfo::tuple_of, {std::forward<TypeInfo>(args)...}); }
@@ -8,6 +8,7 @@
 #include "Function.h"
 #include "Module.h"
 #include "Error.h"
+#include "Iterator.h"
 #include "dump.h"  // NOLINT - not unused
 #include <xci/data/coding/leb128.h>
 #include <xci/core/string.h>
@@ -16,6 +17,7 @@
 #include <range/v3/view/take.hpp>
 #include <range/v3/numeric/accumulate.hpp>
 #include <numeric>
+#include <bit>
 #include <sstream>
 #include <limits>
 #include <cassert>
@@ -48,6 +50,10 @@ Value create_value(const TypeInfo& type_info)
             if (type_info.elem_type() == TypeInfo{Type::UInt8})
                 return value::Bytes();  // List subclass, with special output formatting
             return value::List();
+        case Type::Map:
+            return value::Map();
+        case Type::Iterator:
+            return value::Iter();
         case Type::Tuple:
         case Type::Struct:
             return value::Tuple{type_info.subtypes()};
@@ -80,6 +86,8 @@ Value create_value(Type type)
         case Type::Float128: return value::Float128{};
         case Type::String: return value::String{};
         case Type::List: return value::List{};
+        case Type::Map: return value::Map{};
+        case Type::Iterator: return value::Iter{};
         case Type::Tuple: return value::Tuple{};
         case Type::Struct: return value::Tuple{};  // struct differs only in type, otherwise it's just a tuple
         case Type::Function: return value::Closure{};
@@ -112,6 +120,9 @@ size_t Value::write(byte* buffer) const
         else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, byte>) {
             *buffer = byte(v);
             return 1;
+        } else if constexpr (std::is_same_v<T, StringV>) {
+            v.write(buffer);
+            return StringV::size_on_stack;
         } else if constexpr (HasHeapSlot<T>) {
             const byte* slot_ptr = v.slot.slot();
             std::memcpy(buffer, &slot_ptr, sizeof(slot_ptr));
@@ -146,6 +157,9 @@ size_t Value::read(const byte* buffer)
         } else if constexpr (std::is_same_v<T, byte>) {
             v = *buffer;
             return 1;
+        } else if constexpr (std::is_same_v<T, StringV>) {
+            v.read(buffer);
+            return StringV::size_on_stack;
         } else if constexpr (HasHeapSlot<T>) {
             byte* slot_ptr;
             std::memcpy(&slot_ptr, buffer, sizeof(byte*));
@@ -190,7 +204,9 @@ size_t Value::size_on_stack() const noexcept
 const HeapSlot* Value::heapslot() const
 {
     return std::visit([]<typename T>(T& v) -> const HeapSlot* {
-        if constexpr (HasHeapSlot<T>)
+        if constexpr (std::is_same_v<std::remove_const_t<T>, StringV>)
+            return v.is_inline() || !v.slot ? nullptr : &v.slot;  // inline or empty
+        else if constexpr (HasHeapSlot<T>)
             return &v.slot;
         else
             return nullptr;
@@ -266,6 +282,8 @@ Type Value::type() const
             [](float128) { return Type::Float128; },
             [](const StringV&) { return Type::String; },
             [](const ListV&) { return Type::List; },
+            [](const MapV&) { return Type::Map; },
+            [](const IterV&) { return Type::Iterator; },
             [](const TupleV&) { return Type::Tuple; },
             [](const ClosureV&) { return Type::Function; },
             [](const StreamV&) { return Type::Stream; },
@@ -336,19 +354,34 @@ int64_t Value::to_int64() const
 }
 
 
+static_assert(sizeof(StringV) == StringV::size_on_stack);
+static_assert(StringV::max_inline_size < 128);  // size must fit in the tag byte
+
+
 StringV::StringV(std::string_view v)
-        : slot(v.size() + sizeof(uint32_t))
 {
+    if (v.empty())
+        return;  // null slot
+    if (v.size() <= max_inline_size) {
+        auto* repr = reinterpret_cast<byte*>(this);
+        repr[0] = byte((v.size() << 1) | 1);
+        std::memcpy(repr + 1, v.data(), v.size());
+        return;
+    }
     assert(v.size() < std::numeric_limits<uint32_t>::max());
+    slot = HeapSlot(v.size() + sizeof(uint32_t));
     auto size = (uint32_t) v.size();
     std::memcpy(slot.data(), &size, sizeof(uint32_t));
-    if (!v.empty())
-        std::memcpy(slot.data() + sizeof(uint32_t), v.data(), v.size());
+    std::memcpy(slot.data() + sizeof(uint32_t), v.data(), v.size());
 }
 
 
 std::string_view StringV::value() const
 {
+    if (is_inline()) {
+        const auto* repr = reinterpret_cast<const char*>(this);
+        return {repr + 1, size_t(uint8_t(repr[0]) >> 1)};
+    }
     if (!slot)
         return {nullptr, 0};
     size_t size = bit_copy<uint32_t>(slot.data());
@@ -357,6 +390,12 @@ std::string_view StringV::value() const
 }
 
 
+bool StringV::is_same(const StringV& rhs) const
+{
+    return std::memcmp(this, &rhs, size_on_stack) == 0;
+}
+
+
 template <typename InIter = byte*>
 static auto list_deleter_read_offsets(InIter& data, size_t size) -> std::vector<size_t>
 {
@@ -387,6 +426,7 @@ static void list_deleter_foreach_heap_slot(InIter& data, uint32_t length,
 static void list_deleter(byte* data)
 {
     auto length = bit_read<uint32_t>(data);
+    data += sizeof(uint32_t);  // capacity
     auto deleter_data_size = bit_read<uint16_t>(data);
     if (length == 0 || deleter_data_size == 0)
         return;  // no slots to decref
@@ -397,31 +437,53 @@ static void list_deleter(byte* data)
             [](HeapSlot&& slot){ slot.decref(); });
 }
 
+static void list_traverse(const byte* data, const std::function<void(byte* slot)>& cb)
+{
+    auto length = bit_read<uint32_t>(data);
+    data += sizeof(uint32_t);  // capacity
+    auto deleter_data_size = bit_read<uint16_t>(data);
+    if (length == 0 || deleter_data_size == 0)
+        return;
+    const std::vector<size_t> offsets = list_deleter_read_offsets(data, deleter_data_size);
+    list_deleter_foreach_heap_slot(data, length, offsets,
+            [&cb](HeapSlot&& slot){ cb(const_cast<byte*>(slot.slot())); });
+}
+
 
-ListV::ListV(size_t length, const TypeInfo& elem_type, const void* elem_data)
+// Relative offsets of heap slots in an element, followed by final skip to next element.
+// Empty when the element doesn't contain any heap slots.
+// Returns the size of LEB128-encoded offsets.
+static unsigned make_deleter_offsets(const TypeInfo& elem_type, std::vector<size_t>& offsets)
 {
-    // prepare deleter data
-    std::vector<size_t> offsets;
     offsets.reserve(8);
-    elem_type.foreach_heap_slot([&offsets](size_t offset) {
-        size_t last_offset = offsets.empty() ? 0 : offsets.back();
+    size_t last_offset = 0;
+    elem_type.foreach_heap_slot([&offsets, &last_offset](size_t offset) {
         offsets.push_back(offset - last_offset);
+        last_offset = offset;
     });
-    unsigned deleter_data_size = 0;
-    if (!offsets.empty()) {
-        // add final skip
-        offsets.push_back(elem_type.size() - offsets.back());
-        // sum of LEB128-encoded lengths of the offsets
-        deleter_data_size = accumulate(offsets | views::transform([](size_t i){ return leb128_length(i); }), 0);
-    }
+    if (offsets.empty())
+        return 0;
+    // add final skip
+    offsets.push_back(elem_type.size() - last_offset);
+    // sum of LEB128-encoded lengths of the offsets
+    return accumulate(offsets | views::transform([](size_t i){ return leb128_length(i); }), 0);
+}
+
+
+ListV::ListV(size_t length, const TypeInfo& elem_type, const void* elem_data)
+{
+    // prepare deleter data
+    std::vector<size_t> offsets;
+    const unsigned deleter_data_size = make_deleter_offsets(elem_type, offsets);
 
     const size_t elem_data_size = length * elem_type.size();
-    slot = HeapSlot(6 + deleter_data_size + elem_data_size, list_deleter);
+    slot = HeapSlot(header_size + deleter_data_size + elem_data_size, list_deleter);
     auto* data = slot.data();
 
-    // length (number of elements)
+    // length (number of elements) and capacity (same as length)
     assert(length < std::numeric_limits<uint32_t>::max());
     bit_write(data, (uint32_t) length);
+    bit_write(data, (uint32_t) length);
 
     // size of deleter data
     assert(deleter_data_size < std::numeric_limits<uint16_t>::max());
@@ -449,9 +511,15 @@ size_t ListV::length() const
 }
 
 
+size_t ListV::capacity() const
+{
+    return bit_copy<uint32_t>(slot.data() + sizeof(uint32_t));
+}
+
+
 const std::byte* ListV::raw_data() const
 {
-    const auto* data = slot.data() + sizeof(uint32_t);
+    const auto* data = slot.data() + 2 * sizeof(uint32_t);
     auto dd_size = bit_read<uint16_t>(data);
     data += dd_size;
     return data;
@@ -480,6 +548,7 @@ void ListV::slice(int64_t begin, int64_t end, int64_t step, const TypeInfo& elem
 {
     const auto* data = slot.data();
     auto length = (int32_t) bit_read<uint32_t>(data);
+    data += sizeof(uint32_t);  // capacity
 
     // deleter data
     const auto offsets_size = bit_read<uint16_t>(data);
@@ -539,17 +608,33 @@ void ListV::slice(int64_t begin, int64_t end, int64_t step, const TypeInfo& elem
 
     const auto elem_size = elem_type.size();
 
-/*
-    if (slot.refcount() == 1) {
-        // TODO: in-place
+    if (slot.refcount() == 1 && step > 0) {
+        // in-place: selected elements are moved towards the beginning
+        // (never overlapping with unprocessed ones), the rest is released
+        auto* elems = slot.data() + (data - slot.data());
+        size_t n_moved = 0;
+        for (int64_t i = 0; i != length; ++i) {
+            auto* elem = elems + i * elem_size;
+            if (i >= begin && i < end && (i - begin) % step == 0) {
+                std::memmove(elems + n_moved * elem_size, elem, elem_size);
+                ++ n_moved;
+            } else if (!offsets.empty()) {
+                list_deleter_foreach_heap_slot(elem, 1, offsets,
+                        [](HeapSlot&& heap_slot){ heap_slot.decref(); });
+            }
+        }
+        assert(n_moved == n_sliced);
+        auto* header = slot.data();
+        bit_write(header, (uint32_t) n_sliced);
+        return;
     }
-*/
 
-    HeapSlot new_slot(6 + offsets_size + n_sliced * elem_size, list_deleter);
+    HeapSlot new_slot(header_size + offsets_size + n_sliced * elem_size, list_deleter);
     auto* new_data = new_slot.data();
     bit_write(new_data, (uint32_t) n_sliced);
+    bit_write(new_data, (uint32_t) n_sliced);
     bit_write(new_data, (uint16_t) offsets_size);
-    std::memcpy(new_data, slot.data() + sizeof(uint32_t) + sizeof(uint16_t), offsets_size);
+    std::memcpy(new_data, slot.data() + header_size, offsets_size);
     new_data += offsets_size;
 
     if (step > 0) {
@@ -594,42 +679,496 @@ void ListV::slice(int64_t begin, int64_t end, int64_t step, const TypeInfo& elem
 void ListV::extend(const ListV& rhs, const TypeInfo& elem_type)
 {
     const auto* data1 = slot.data();
-    auto length1 = (int32_t) bit_read<uint32_t>(data1);
+    const auto length1 = bit_read<uint32_t>(data1);
+    const auto capacity1 = bit_read<uint32_t>(data1);
     const auto offsets_size = bit_read<uint16_t>(data1);
     const auto offsets = list_deleter_read_offsets(data1, offsets_size);
     const auto* data2 = rhs.slot.data();
-    auto length2 = (int32_t) bit_read<uint32_t>(data2);
-    data2 += 2 + offsets_size;
+    const auto length2 = bit_read<uint32_t>(data2);
+    data2 += sizeof(uint32_t) + sizeof(uint16_t) + offsets_size;
 
-    // prepare new list
     const auto elem_size = elem_type.size();
+    assert(size_t(length1) + length2 < std::numeric_limits<uint32_t>::max());
     const auto new_length = length1 + length2;
-    HeapSlot new_slot(6 + offsets_size + new_length * elem_size, list_deleter);
+
+    // incref elements of other list, they are now referenced also by this list
+    if (!offsets.empty()) {
+        auto* elems2 = data2;
+        list_deleter_foreach_heap_slot(elems2, length2, offsets,
+                           [](HeapSlot&& heap_slot){ heap_slot.incref(); });
+    }
+
+    if (slot.refcount() == 1 && new_length <= capacity1) {
+        // in-place: there is enough spare capacity
+        auto* elems1 = slot.data() + (data1 - slot.data());
+        std::memcpy(elems1 + length1 * elem_size, data2, length2 * elem_size);
+        auto* header = slot.data();
+        bit_write(header, new_length);
+        return;
+    }
+
+    // Prepare new list. When it's unique, reserve spare capacity for following
+    // appends (geometric growth makes repeated appending amortized O(1)).
+    // A copy of shared list is not expected to grow, it gets exact size.
+    const bool unique = slot.refcount() == 1;
+    uint32_t new_capacity = new_length;
+    if (unique && length1 != 0)
+        new_capacity = uint32_t(std::min<uint64_t>(
+                std::max<uint64_t>(new_length, uint64_t(capacity1) * 2),
+                std::numeric_limits<uint32_t>::max() - 1));
+    HeapSlot new_slot(header_size + offsets_size + new_capacity * elem_size, list_deleter);
     auto* new_data = new_slot.data();
 
-    bit_write(new_data, (uint32_t) new_length);
+    bit_write(new_data, new_length);
+    bit_write(new_data, new_capacity);
     bit_write(new_data, (uint16_t) offsets_size);
-    std::memcpy(new_data, slot.data() + 6, offsets_size);
+    std::memcpy(new_data, slot.data() + header_size, offsets_size);
     new_data += offsets_size;
 
     std::memcpy(new_data, data1, length1 * elem_size);
     new_data += length1 * elem_size;
     std::memcpy(new_data, data2, length2 * elem_size);
 
-    if (slot.refcount() == 1) {
-        // in-place: incref only other, do not touch refs of this
-        if (!offsets.empty()) {
-            list_deleter_foreach_heap_slot(data2, length2, offsets,
-                               [](HeapSlot&& heap_slot){ heap_slot.incref(); });
-        }
+    if (unique) {
+        // moved: do not touch refs of elements of this
         slot.release();
     } else {
         // incref all copied elements
         if (!offsets.empty()) {
             list_deleter_foreach_heap_slot(data1, length1, offsets,
                                [](HeapSlot&& heap_slot){ heap_slot.incref(); });
-            list_deleter_foreach_heap_slot(data2, length2, offsets,
-                               [](HeapSlot&& heap_slot){ heap_slot.incref(); });
+        }
+        slot.decref();
+    }
+    slot = new_slot;
+}
+
+
+// Control bytes of map buckets
+static constexpr uint8_t map_ctrl_empty = 0;
+static constexpr uint8_t map_ctrl_deleted = 1;
+static constexpr uint8_t map_ctrl_full = 0x80;  // lower 7 bits are taken from the key hash
+
+static byte map_ctrl_for_hash(uint64_t hash) { return byte(map_ctrl_full | (hash >> 57)); }
+static bool map_ctrl_is_full(byte c) { return (uint8_t(c) & map_ctrl_full) != 0; }
+
+
+// Decoded header of map slot
+struct MapLayout {
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t tombstones;
+    uint16_t deleter_data_size;
+    byte* deleter_data;
+    byte* ctrl;
+    byte* entries;
+};
+
+static MapLayout map_layout(const HeapSlot& slot)
+{
+    auto* data = const_cast<byte*>(slot.data());
+    MapLayout m {};
+    m.length = bit_read<uint32_t>(data);
+    m.capacity = bit_read<uint32_t>(data);
+    m.tombstones = bit_read<uint32_t>(data);
+    m.deleter_data_size = bit_read<uint16_t>(data);
+    m.deleter_data = data;
+    m.ctrl = data + m.deleter_data_size;
+    m.entries = m.ctrl + m.capacity;
+    return m;
+}
+
+static void map_write_counts(HeapSlot& slot, uint32_t length, uint32_t tombstones)
+{
+    auto* data = slot.data();
+    bit_write(data, length);
+    data += sizeof(uint32_t);  // capacity
+    bit_write(data, tombstones);
+}
+
+
+template <typename F>
+static void map_foreach_heap_slot(const MapLayout& m, size_t entry_size, F&& cb)
+{
+    const byte* dd = m.deleter_data;
+    const std::vector<size_t> offsets = list_deleter_read_offsets(dd, m.deleter_data_size);
+    for (size_t i = 0; i != m.capacity; ++i) {
+        if (!map_ctrl_is_full(m.ctrl[i]))
+            continue;
+        byte* entry = m.entries + i * entry_size;
+        list_deleter_foreach_heap_slot(entry, 1, offsets, cb);
+    }
+}
+
+static void map_deleter(byte* data)
+{
+    const auto length = bit_read<uint32_t>(data);
+    const auto capacity = bit_read<uint32_t>(data);
+    data += sizeof(uint32_t);  // tombstones
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    if (length == 0 || deleter_data_size == 0)
+        return;  // no slots to decref
+
+    const std::vector<size_t> offsets = list_deleter_read_offsets(data, deleter_data_size);
+    const size_t entry_size = std::accumulate(offsets.begin(), offsets.end(), size_t(0));
+    const byte* ctrl = data;
+    byte* entries = data + capacity;
+    for (size_t i = 0; i != capacity; ++i) {
+        if (!map_ctrl_is_full(ctrl[i]))
+            continue;
+        byte* entry = entries + i * entry_size;
+        list_deleter_foreach_heap_slot(entry, 1, offsets,
+                [](HeapSlot&& slot){ slot.decref(); });
+    }
+}
+
+static void map_traverse(const byte* data, const std::function<void(byte* slot)>& cb)
+{
+    const auto length = bit_read<uint32_t>(data);
+    const auto capacity = bit_read<uint32_t>(data);
+    data += sizeof(uint32_t);  // tombstones
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    if (length == 0 || deleter_data_size == 0)
+        return;
+    const std::vector<size_t> offsets = list_deleter_read_offsets(data, deleter_data_size);
+    const size_t entry_size = std::accumulate(offsets.begin(), offsets.end(), size_t(0));
+    const byte* ctrl = data;
+    const byte* entries = data + capacity;
+    for (size_t i = 0; i != capacity; ++i) {
+        if (!map_ctrl_is_full(ctrl[i]))
+            continue;
+        const byte* entry = entries + i * entry_size;
+        list_deleter_foreach_heap_slot(entry, 1, offsets,
+                [&cb](HeapSlot&& slot){ cb(const_cast<byte*>(slot.slot())); });
+    }
+}
+
+
+// Hash of a map key. Keys which compare equal must have the same hash.
+class MapKeyHasher: public value::Visitor {
+public:
+    uint64_t hash = 0;
+
+    void visit(bool v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(char32_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(uint8_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(uint16_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(uint32_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(uint64_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(uint128 v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(int8_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(int16_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(int32_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(int64_t v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(int128 v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(float v) override { hash_float(v); }
+    void visit(double v) override { hash_float(v); }
+    void visit(float128 v) override { hash_float(double(v)); }  // lossy, but consistent with equality
+    void visit(std::string_view&& v) override { hash_bytes(v.data(), v.size()); }
+    void visit(const ListV&) override { throw not_implemented("map key of List type"); }
+    void visit(const MapV&) override { throw not_implemented("map key of Map type"); }
+    void visit(const IterV&) override { throw not_implemented("map key of Iterator type"); }
+    void visit(const TupleV& v) override {
+        uint64_t combined = 0;
+        v.foreach([&combined](const Value& item) {
+            MapKeyHasher item_hasher;
+            item.apply(item_hasher);
+            combined = (combined ^ item_hasher.hash) * 0x9e3779b97f4a7c15;
+        });
+        hash = combined;
+    }
+    void visit(const ClosureV&) override { throw not_implemented("map key of Function type"); }
+    void visit(const script::Module* v) override { hash_bytes(&v, sizeof(v)); }
+    void visit(const script::Stream&) override { throw not_implemented("map key of Stream type"); }
+    void visit(const TypeIndexV& v) override { const Index idx = v.value(); hash_bytes(&idx, sizeof(idx)); }
+
+private:
+    void hash_bytes(const void* data, size_t size) {
+        hash = std::hash<std::string_view>{}({static_cast<const char*>(data), size});
+    }
+    template <class T> void hash_float(T v) {
+        if (v == T(0))
+            v = T(0);  // -0.0 == +0.0
+        hash_bytes(&v, sizeof(v));
+    }
+};
+
+static uint64_t map_key_hash(const Value& key)
+{
+    MapKeyHasher hasher;
+    key.apply(hasher);
+    return hasher.hash;
+}
+
+static bool map_key_equal(const Value& a, const Value& b)
+{
+    if (a.type() == Type::Tuple && b.type() == Type::Tuple) {
+        // TupleV::operator== compares identity, compare the items instead
+        const auto& ta = a.get<TupleV>();
+        const auto& tb = b.get<TupleV>();
+        for (size_t i = 0; ; ++i) {
+            const Value& ia = ta.value_at(i);
+            const Value& ib = tb.value_at(i);
+            if (ia.is_unknown() || ib.is_unknown())
+                return ia.is_unknown() && ib.is_unknown();
+            if (!map_key_equal(ia, ib))
+                return false;
+        }
+    }
+    return a == b;
+}
+
+// Returns index of the bucket with the key, or capacity if not found
+static size_t map_find_bucket(const MapLayout& m, const Value& key, uint64_t hash,
+                              const TypeInfo& key_type, size_t entry_size)
+{
+    if (m.length == 0)
+        return m.capacity;
+    const size_t mask = m.capacity - 1;
+    const byte ctrl = map_ctrl_for_hash(hash);
+    auto bucket_key = create_value(key_type);
+    for (size_t i = hash & mask, n = 0; n != m.capacity; i = (i + 1) & mask, ++n) {
+        if (m.ctrl[i] == byte(map_ctrl_empty))
+            break;
+        if (m.ctrl[i] == ctrl) {
+            bucket_key.read(m.entries + i * entry_size);
+            if (map_key_equal(bucket_key, key))
+                return i;
+        }
+    }
+    return m.capacity;
+}
+
+
+MapV::MapV(const TypeInfo& key_type, const TypeInfo& value_type, size_t capacity)
+{
+    if (capacity != 0)
+        capacity = std::bit_ceil(std::max(capacity, size_t(8)));
+    assert(capacity < std::numeric_limits<uint32_t>::max());
+
+    std::vector<size_t> offsets;
+    const unsigned deleter_data_size = make_deleter_offsets(
+            ti_tuple(TypeInfo(key_type), TypeInfo(value_type)), offsets);
+    assert(deleter_data_size < std::numeric_limits<uint16_t>::max());
+
+    const size_t entry_size = key_type.size() + value_type.size();
+    slot = HeapSlot(header_size + deleter_data_size + capacity * (1 + entry_size), map_deleter);
+    auto* data = slot.data();
+    bit_write(data, uint32_t(0));  // length
+    bit_write(data, (uint32_t) capacity);
+    bit_write(data, uint32_t(0));  // tombstones
+    bit_write(data, (uint16_t) deleter_data_size);
+    for (auto ofs : offsets)
+        leb128_encode(data, ofs);
+    std::memset(data, map_ctrl_empty, capacity);
+}
+
+
+size_t MapV::length() const
+{
+    return bit_copy<uint32_t>(slot.data());
+}
+
+
+size_t MapV::capacity() const
+{
+    return bit_copy<uint32_t>(slot.data() + sizeof(uint32_t));
+}
+
+
+Value MapV::get(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type) const
+{
+    const auto m = map_layout(slot);
+    const size_t key_size = key_type.size();
+    const size_t entry_size = key_size + value_type.size();
+    const size_t i = map_find_bucket(m, key, map_key_hash(key), key_type, entry_size);
+    if (i == m.capacity)
+        return {};
+    auto value = create_value(value_type);
+    value.read(m.entries + i * entry_size + key_size);
+    return value;
+}
+
+
+bool MapV::contains(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type) const
+{
+    const auto m = map_layout(slot);
+    const size_t entry_size = key_type.size() + value_type.size();
+    return map_find_bucket(m, key, map_key_hash(key), key_type, entry_size) != m.capacity;
+}
+
+
+void MapV::insert(const Value& key, const Value& value, const TypeInfo& key_type, const TypeInfo& value_type)
+{
+    {
+        const auto m = map_layout(slot);
+        // Keep the load (including tombstones) under 7/8. Grow to at most 1/2 load.
+        if ((size_t(m.length) + m.tombstones + 1) * 8 > size_t(m.capacity) * 7) {
+            size_t new_capacity = std::max(size_t(m.capacity), size_t(8));
+            while ((size_t(m.length) + 1) * 2 > new_capacity)
+                new_capacity *= 2;
+            rehash(new_capacity, key_type, value_type);
+        } else if (slot.refcount() != 1) {
+            rehash(m.capacity, key_type, value_type);
+        }
+    }
+
+    const auto m = map_layout(slot);
+    const size_t key_size = key_type.size();
+    const size_t entry_size = key_size + value_type.size();
+    const size_t mask = m.capacity - 1;
+    const uint64_t hash = map_key_hash(key);
+    const byte ctrl = map_ctrl_for_hash(hash);
+    auto bucket_key = create_value(key_type);
+    size_t free_i = m.capacity;  // first deleted bucket on the probe path
+    size_t i = hash & mask;
+    for (;; i = (i + 1) & mask) {
+        if (m.ctrl[i] == byte(map_ctrl_empty))
+            break;
+        if (m.ctrl[i] == byte(map_ctrl_deleted)) {
+            if (free_i == m.capacity)
+                free_i = i;
+            continue;
+        }
+        if (m.ctrl[i] == ctrl) {
+            byte* entry = m.entries + i * entry_size;
+            bucket_key.read(entry);
+            if (map_key_equal(bucket_key, key)) {
+                // replace the value, keep the original key
+                auto orig_value = create_value(value_type);
+                orig_value.read(entry + key_size);
+                orig_value.decref();
+                value.write(entry + key_size);
+                Value{key}.decref();
+                return;
+            }
+        }
+    }
+
+    uint32_t tombstones = m.tombstones;
+    if (free_i != m.capacity) {
+        i = free_i;
+        --tombstones;
+    }
+    m.ctrl[i] = ctrl;
+    byte* entry = m.entries + i * entry_size;
+    key.write(entry);
+    value.write(entry + key_size);
+    map_write_counts(slot, m.length + 1, tombstones);
+}
+
+
+bool MapV::remove(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type)
+{
+    const size_t key_size = key_type.size();
+    const size_t entry_size = key_size + value_type.size();
+    const uint64_t hash = map_key_hash(key);
+    auto m = map_layout(slot);
+    size_t i = map_find_bucket(m, key, hash, key_type, entry_size);
+    if (i == m.capacity)
+        return false;
+    if (slot.refcount() != 1) {
+        rehash(m.capacity, key_type, value_type);
+        m = map_layout(slot);
+        i = map_find_bucket(m, key, hash, key_type, entry_size);
+        assert(i != m.capacity);
+    }
+
+    byte* entry = m.entries + i * entry_size;
+    auto orig_key = create_value(key_type);
+    orig_key.read(entry);
+    orig_key.decref();
+    auto orig_value = create_value(value_type);
+    orig_value.read(entry + key_size);
+    orig_value.decref();
+
+    // When the next bucket is empty, no probe sequence continues over this one
+    // and it can be marked empty as well. Otherwise, leave a tombstone.
+    if (m.ctrl[(i + 1) & (m.capacity - 1)] == byte(map_ctrl_empty)) {
+        m.ctrl[i] = byte(map_ctrl_empty);
+        map_write_counts(slot, m.length - 1, m.tombstones);
+    } else {
+        m.ctrl[i] = byte(map_ctrl_deleted);
+        map_write_counts(slot, m.length - 1, m.tombstones + 1);
+    }
+    return true;
+}
+
+
+void MapV::foreach(const TypeInfo& key_type, const TypeInfo& value_type,
+                   const std::function<void(const Value& key, const Value& value)>& cb) const
+{
+    const auto m = map_layout(slot);
+    const size_t key_size = key_type.size();
+    const size_t entry_size = key_size + value_type.size();
+    auto key = create_value(key_type);
+    auto value = create_value(value_type);
+    for (size_t i = 0; i != m.capacity; ++i) {
+        if (!map_ctrl_is_full(m.ctrl[i]))
+            continue;
+        const byte* entry = m.entries + i * entry_size;
+        key.read(entry);
+        value.read(entry + key_size);
+        cb(key, value);
+    }
+}
+
+
+void MapV::foreach_raw(const TypeInfo& key_type, const TypeInfo& value_type,
+                       const std::function<void(byte* key, byte* value)>& cb)
+{
+    const auto m = map_layout(slot);
+    const size_t key_size = key_type.size();
+    const size_t entry_size = key_size + value_type.size();
+    for (size_t i = 0; i != m.capacity; ++i) {
+        if (!map_ctrl_is_full(m.ctrl[i]))
+            continue;
+        byte* entry = m.entries + i * entry_size;
+        cb(entry, entry + key_size);
+    }
+}
+
+
+void MapV::rehash(size_t new_capacity, const TypeInfo& key_type, const TypeInfo& value_type)
+{
+    const auto m = map_layout(slot);
+    assert(std::has_single_bit(new_capacity) && new_capacity > m.length);
+    const size_t entry_size = key_type.size() + value_type.size();
+
+    HeapSlot new_slot(header_size + m.deleter_data_size + new_capacity * (1 + entry_size), map_deleter);
+    auto* data = new_slot.data();
+    bit_write(data, m.length);
+    bit_write(data, (uint32_t) new_capacity);
+    bit_write(data, uint32_t(0));  // tombstones
+    bit_write(data, m.deleter_data_size);
+    std::memcpy(data, m.deleter_data, m.deleter_data_size);
+    data += m.deleter_data_size;
+    byte* new_ctrl = data;
+    byte* new_entries = data + new_capacity;
+    std::memset(new_ctrl, map_ctrl_empty, new_capacity);
+
+    const size_t mask = new_capacity - 1;
+    auto key = create_value(key_type);
+    for (size_t i = 0; i != m.capacity; ++i) {
+        if (!map_ctrl_is_full(m.ctrl[i]))
+            continue;
+        const byte* entry = m.entries + i * entry_size;
+        key.read(entry);
+        size_t j = map_key_hash(key) & mask;
+        while (new_ctrl[j] != byte(map_ctrl_empty))
+            j = (j + 1) & mask;
+        new_ctrl[j] = m.ctrl[i];
+        std::memcpy(new_entries + j * entry_size, entry, entry_size);
+    }
+
+    if (slot.refcount() == 1) {
+        // moved: do not touch refs of the entries
+        slot.release();
+    } else {
+        // incref all copied entries
+        if (m.deleter_data_size != 0) {
+            map_foreach_heap_slot(map_layout(new_slot), entry_size,
+                    [](HeapSlot&& heap_slot){ heap_slot.incref(); });
         }
         slot.decref();
     }
@@ -711,23 +1250,108 @@ void TupleV::foreach(const std::function<void(const Value&)>& cb) const
 }
 
 
+// The closure owns the nonlocal values, they are decref'd when the closure
+// is destroyed. The deleter data are the same as for a list with single element.
+static void closure_deleter(byte* data)
+{
+    data += sizeof(Function*);
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    if (deleter_data_size == 0)
+        return;  // no slots to decref
+    const std::vector<size_t> offsets = list_deleter_read_offsets(data, deleter_data_size);
+    list_deleter_foreach_heap_slot(data, 1, offsets,
+            [](HeapSlot&& slot){ slot.decref(); });
+}
+
+static void closure_traverse(const byte* data, const std::function<void(byte* slot)>& cb)
+{
+    data += sizeof(Function*);
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    if (deleter_data_size == 0)
+        return;
+    const std::vector<size_t> offsets = list_deleter_read_offsets(data, deleter_data_size);
+    list_deleter_foreach_heap_slot(data, 1, offsets,
+            [&cb](HeapSlot&& slot){ cb(const_cast<byte*>(slot.slot())); });
+}
+
+
+// Same offsets as make_deleter_offsets(TypeInfo{Subtypes(fn.nonlocals())}),
+// but passed to the callback one by one, without allocating the vector.
+template <typename F>
+static void foreach_closure_deleter_offset(const Function& fn, F&& cb)
+{
+    struct {
+        F& cb;
+        size_t base = 0;
+        size_t last_offset = 0;
+        bool any = false;
+    } state {cb};
+    for (const auto& ti : fn.nonlocals()) {
+        ti.foreach_heap_slot([&state](size_t offset) {
+            state.cb(state.base + offset - state.last_offset);
+            state.last_offset = state.base + offset;
+            state.any = true;
+        });
+        state.base += ti.size();
+    }
+    // add final skip, unless there are no heap slots at all
+    if (state.any)
+        cb(state.base - state.last_offset);
+}
+
+
 ClosureV::ClosureV(const Function& fn)
-        : slot(sizeof(Function*))
+        : slot(header_size)
 {
     assert(fn.nonlocals().size() == 0);
-    const Function* fn_ptr = &fn;
-    std::memcpy(slot.data(), &fn_ptr, sizeof(Function*));
+    auto* data = slot.data();
+    bit_write(data, &fn);
+    bit_write(data, uint16_t(0));
 }
 
 
 ClosureV::ClosureV(const Function& fn, Values&& values)
-        : slot(fn.raw_size_of_nonlocals() + sizeof(Function*))
 {
     assert(fn.nonlocals().size() == values.size());
     value::Tuple closure(std::move(values));
-    const Function* fn_ptr = &fn;
-    std::memcpy(slot.data(), &fn_ptr, sizeof(Function*));
-    closure.write(slot.data() + sizeof(Function*));
+
+    // prepare deleter data
+    std::vector<size_t> offsets;
+    const TypeInfo closure_type {TypeInfo::Subtypes(fn.nonlocals())};
+    const unsigned deleter_data_size = make_deleter_offsets(closure_type, offsets);
+
+    // no deleter when there is nothing to decref
+    slot = HeapSlot(header_size + deleter_data_size + fn.raw_size_of_nonlocals(),
+                    deleter_data_size != 0 ? closure_deleter : nullptr);
+    auto* data = slot.data();
+    bit_write(data, &fn);
+    assert(deleter_data_size < std::numeric_limits<uint16_t>::max());
+    bit_write(data, (uint16_t) deleter_data_size);
+    for (auto ofs : offsets)
+        leb128_encode(data, ofs);
+    closure.write(data);
+}
+
+
+ClosureV::ClosureV(const Function& fn, const std::byte* nonlocals)
+{
+    const size_t nonlocals_size = fn.raw_size_of_nonlocals();
+    unsigned deleter_data_size = 0;
+    foreach_closure_deleter_offset(fn, [&deleter_data_size](size_t ofs) {
+        deleter_data_size += leb128_length(ofs);
+    });
+
+    // no deleter when there is nothing to decref
+    slot = HeapSlot(header_size + deleter_data_size + nonlocals_size,
+                    deleter_data_size != 0 ? closure_deleter : nullptr);
+    auto* data = slot.data();
+    bit_write(data, &fn);
+    assert(deleter_data_size < std::numeric_limits<uint16_t>::max());
+    bit_write(data, (uint16_t) deleter_data_size);
+    foreach_closure_deleter_offset(fn, [&data](size_t ofs) {
+        leb128_encode(data, ofs);
+    });
+    std::memcpy(data, nonlocals, nonlocals_size);
 }
 
 
@@ -737,14 +1361,73 @@ Function* ClosureV::function() const
 }
 
 
+const std::byte* ClosureV::nonlocals_data() const
+{
+    const auto* data = slot.data() + sizeof(Function*);
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    return data + deleter_data_size;
+}
+
+
+void ClosureV::copy_nonlocals(std::byte* target) const
+{
+    const auto* data = slot.data() + sizeof(Function*);
+    const auto deleter_data_size = bit_read<uint16_t>(data);
+    const auto* const offsets_end = data + deleter_data_size;
+    std::memcpy(target, offsets_end, function()->raw_size_of_nonlocals());
+    // the closure keeps its own references
+    while (data < offsets_end) {
+        const auto offset = leb128_decode<size_t>(data);
+        if (data == offsets_end)
+            break;  // final skip
+        target += offset;
+        HeapSlot{bit_copy<byte*>(target)}.incref();
+    }
+}
+
+
 value::Tuple ClosureV::closure() const
 {
     value::Tuple values{TypeInfo::Subtypes(function()->nonlocals())};
-    values.read(slot.data() + sizeof(Function*));
+    values.read(nonlocals_data());
     return values;
 }
 
 
+// Register the containers with the cycle collector
+[[maybe_unused]] static const bool containers_registered = [] {
+    CycleCollector::register_container(list_deleter, list_traverse);
+    CycleCollector::register_container(map_deleter, map_traverse);
+    CycleCollector::register_container(closure_deleter, closure_traverse);
+    return true;
+}();
+
+
+static void iter_deleter(byte* data)
+{
+    Generator* generator;
+    std::memcpy(&generator, data, sizeof(generator));
+    delete generator;
+}
+
+
+IterV::IterV(std::unique_ptr<Generator>&& generator)
+        : slot(sizeof(Generator*), iter_deleter)
+{
+    Generator* ptr = generator.release();
+    std::memcpy(slot.data(), &ptr, sizeof(ptr));
+}
+
+
+Generator& IterV::generator() const
+{
+    assert(slot);
+    Generator* generator;
+    std::memcpy(&generator, slot.data(), sizeof(generator));
+    return *generator;
+}
+
+
 static void stream_deleter(byte* data)
 {
     Stream v;
@@ -824,7 +1507,7 @@ public:
     void visit(const ListV& v) override {
         if (!type_info.is_unknown() && type_info.elem_type().type() == Type::Byte) {
             // special output for [Byte]
-            const char* data = (const char*)v.slot.data() + 6;
+            const char* data = (const char*)v.raw_data();
             const std::string_view sv{data, v.length()};
             os << "b\"" << core::escape(sv) << '"';
             return;
@@ -846,6 +1529,31 @@ public:
         }
         os << "]";
     }
+    void visit(const MapV& v) override {
+        os << "[";
+        if (v.length() == 0) {
+            os << ":]";
+            return;
+        }
+        if (type_info.is_unknown()) {
+            for (size_t idx = 0; idx < v.length(); idx++) {
+                if (idx != 0)
+                    os << ", ";
+                os << "?: ?";
+            }
+        } else {
+            const auto& key_ti = type_info.underlying().map_key_type();
+            const auto& value_ti = type_info.underlying().map_value_type();
+            bool first = true;
+            v.foreach(key_ti, value_ti, [&](const Value& key, const Value& value) {
+                if (!first)
+                    os << ", ";
+                first = false;
+                os << TypedValue(key, key_ti) << ": " << TypedValue(value, value_ti);
+            });
+        }
+        os << "]";
+    }
     void visit(const TupleV& v) override {
         if (type_info.is_named())
             os << type_info.name().view();
@@ -891,6 +1599,9 @@ public:
         else
             fmt::print(os, "<module:{}>", v->name());
     }
+    void visit(const IterV&) override {
+        os << "[..]";  // not evaluated, that would consume it
+    }
     void visit(const script::Stream& v) override {
         os << "<stream:" << v << ">";
     }
@@ -948,7 +1659,7 @@ Char::Char(std::string_view utf8)
 Bytes::Bytes(std::span<const std::byte> v)
         : List(v.size(), TypeInfo{Type::Byte})
 {
-    std::memcpy((void*)(heapslot()->data() + 6), v.data(), v.size());
+    std::memcpy((void*) get<ListV>().raw_data(), v.data(), v.size());
 }
 
 
@@ -21,7 +21,9 @@
 #include <map>
 #include <string_view>
 #include <span>
+#include <tuple>
 #include <variant>
+#include <bit>
 #include <cstring>
 #include <cstdint>
 
@@ -29,12 +31,15 @@ namespace xci::script {
 
 class Value;
 struct ListV;
+struct MapV;
+struct IterV;
 struct TupleV;
 struct ClosureV;
 struct TypeIndexV;
 class Values;
 class Function;
 class Module;
+class Generator;
 
 
 namespace value {
@@ -60,6 +65,8 @@ public:
     virtual void visit(float128) = 0;
     virtual void visit(std::string_view&&) = 0;
     virtual void visit(const ListV&) = 0;
+    virtual void visit(const MapV&) = 0;
+    virtual void visit(const IterV&) = 0;
     virtual void visit(const TupleV&) = 0;
     virtual void visit(const ClosureV&) = 0;
     virtual void visit(const script::Module*) = 0;
@@ -85,6 +92,8 @@ class PartialVisitor : public Visitor {
     void visit(float128) override {}
     void visit(std::string_view&&) override {}
     void visit(const ListV&) override {}
+    void visit(const MapV&) override {}
+    void visit(const IterV&) override {}
     void visit(const TupleV&) override {}
     void visit(const ClosureV&) override {}
     void visit(const script::Module*) override {}
@@ -95,22 +104,50 @@ class PartialVisitor : public Visitor {
 } // namespace value
 
 
+// String is stored inline when it's short enough (small-string optimization),
+// otherwise it's stored in a heap slot. Layout on stack (16 bytes):
+// * heap:   pointer to HeapSlot, padding (zeroed)
+// * inline: tag byte = (size << 1) | 1, up to 15 bytes of data
+// The tag byte overlaps with lowest byte of the pointer (on little-endian),
+// making the value an "inline" HeapSlot, which is ignored by incref/decref.
+// Null pointer means an empty string.
 struct StringV {
+    static constexpr size_t size_on_stack = 16;
+    static constexpr size_t max_inline_size =
+            std::endian::native == std::endian::little ? size_on_stack - 1 : 0;
+
     StringV() = default;
     explicit StringV(std::string_view v);
     bool operator ==(const StringV& rhs) const { return value() == rhs.value(); }
     std::string_view value() const;
 
+    bool is_inline() const { return slot.is_inline(); }
+    // Same heap slot or same inline data
+    bool is_same(const StringV& rhs) const;
+
+    void write(std::byte* buffer) const { std::memcpy(buffer, this, size_on_stack); }
+    void read(const std::byte* buffer) { std::memcpy((void*) this, buffer, size_on_stack); }
+
     HeapSlot slot;
+    std::byte inline_data[size_on_stack - sizeof(HeapSlot)] {};
 };
 
 
+// List on heap has a header:
+// * 4B length (number of elements)
+// * 4B capacity (number of elements that fit in the allocated slot)
+// * 2B size of deleter data
+// The header is followed by deleter data (LEB128-encoded offsets of heap slots
+// in each element) and element data.
 struct ListV {
+    static constexpr size_t header_size = 2 * sizeof(uint32_t) + sizeof(uint16_t);
+
     ListV() = default;
     explicit ListV(size_t length, const TypeInfo& elem_type, const void* elem_data = nullptr);
     explicit ListV(HeapSlot&& slot) : slot(std::move(slot)) {}
     bool operator ==(const ListV& rhs) const { return slot.slot() == rhs.slot.slot(); }  // same slot - cannot compare content without elem_type
     size_t length() const;
+    size_t capacity() const;
     const std::byte* raw_data() const;
     std::byte* raw_data() { return (std::byte*) const_cast<const ListV*>(this)->raw_data(); }
     Value value_at(size_t idx, const TypeInfo& elem_type) const;
@@ -123,13 +160,78 @@ struct ListV {
 
     /// Extend this list by concatenating another list (of same type).
     /// Automatically copies the list on heap when it has more than 1 reference.
-    /// Works in-place otherwise.
+    /// Works in-place otherwise, if the capacity allows. When the slot needs
+    /// to be reallocated, the capacity grows geometrically.
     void extend(const ListV& rhs, const TypeInfo& elem_type);
 
     HeapSlot slot;
 };
 
 
+// Map on heap is a hash table with open addressing (linear probing).
+// The header:
+// * 4B length (number of entries)
+// * 4B capacity (number of buckets, zero or power of two)
+// * 4B number of deleted buckets (tombstones)
+// * 2B size of deleter data
+// The header is followed by deleter data (LEB128-encoded offsets of heap slots
+// in each entry), one control byte per bucket and the buckets.
+// A bucket contains an entry: key followed by value.
+struct MapV {
+    static constexpr size_t header_size = 3 * sizeof(uint32_t) + sizeof(uint16_t);
+
+    MapV() = default;
+    explicit MapV(const TypeInfo& key_type, const TypeInfo& value_type, size_t capacity = 0);
+    explicit MapV(HeapSlot&& slot) : slot(std::move(slot)) {}
+    bool operator ==(const MapV& rhs) const { return slot.slot() == rhs.slot.slot(); }  // same slot
+    size_t length() const;
+    size_t capacity() const;
+
+    /// Find value for the key. Returns Unknown value when not found.
+    /// The returned value is not incref'd, it's still owned by the map.
+    Value get(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type) const;
+    bool contains(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type) const;
+
+    /// Insert an entry or replace the value of existing one.
+    /// Takes ownership of both `key` and `value` (they are not incref'd).
+    /// Automatically copies the map on heap when it has more than 1 reference.
+    void insert(const Value& key, const Value& value, const TypeInfo& key_type, const TypeInfo& value_type);
+
+    /// Remove an entry. Returns false if the key was not found.
+    /// Automatically copies the map on heap when it has more than 1 reference.
+    bool remove(const Value& key, const TypeInfo& key_type, const TypeInfo& value_type);
+
+    /// Call `cb` for each entry, in unspecified order.
+    /// The values passed to the callback are not incref'd.
+    void foreach(const TypeInfo& key_type, const TypeInfo& value_type,
+                 const std::function<void(const Value& key, const Value& value)>& cb) const;
+
+    /// Call `cb` with raw data of each entry's key and value, which can be
+    /// modified in place. The key must keep its hash (i.e. the same content).
+    void foreach_raw(const TypeInfo& key_type, const TypeInfo& value_type,
+                     const std::function<void(std::byte* key, std::byte* value)>& cb);
+
+    HeapSlot slot;
+
+private:
+    void rehash(size_t new_capacity, const TypeInfo& key_type, const TypeInfo& value_type);
+};
+
+
+// Iterator (lazy sequence) on heap is a pointer to Generator, owned by the slot.
+// The generator is shared by all copies of the value - it has a state,
+// stepping any copy advances all of them (see Iterator.h).
+struct IterV {
+    IterV() = default;
+    explicit IterV(std::unique_ptr<Generator>&& generator);
+    bool operator ==(const IterV& rhs) const { return slot.slot() == rhs.slot.slot(); }  // same slot
+
+    Generator& generator() const;
+
+    HeapSlot slot;
+};
+
+
 struct TupleV {
     TupleV(const TupleV& other);
     TupleV& operator =(const TupleV& other);
@@ -151,11 +253,22 @@ struct ClosureV {
     explicit ClosureV() = default;
     explicit ClosureV(const Function& fn);
     explicit ClosureV(const Function& fn, Values&& values);
+    // Take over raw nonlocals data (as laid out on stack), including the references
+    explicit ClosureV(const Function& fn, const std::byte* nonlocals);
     bool operator ==(const ClosureV& rhs) const { return slot.slot() == rhs.slot.slot(); }  // same slot - cannot compare content without elem_type
 
     Function* function() const;
     value::Tuple closure() const;
 
+    // Raw data of nonlocal values (see Function::raw_size_of_nonlocals)
+    const std::byte* nonlocals_data() const;
+
+    // Copy raw nonlocals data to `target` (e.g. stack), incref the contained heap slots
+    void copy_nonlocals(std::byte* target) const;
+
+    // Function pointer, size of deleter data
+    static constexpr size_t header_size = sizeof(Function*) + sizeof(uint16_t);
+
     HeapSlot slot;
 };
 
@@ -198,6 +311,8 @@ class Value {
 public:
     struct StringTag {};
     struct ListTag {};
+    struct MapTag {};
+    struct IterTag {};
     struct ClosureTag {};
     struct StreamTag {};
     struct ModuleTag {};
@@ -225,11 +340,16 @@ public:
     explicit Value(size_t length, const TypeInfo& elem_type) : m_value(ListV{length, elem_type}) {}  // List
     explicit Value(ListTag, HeapSlot&& slot) : m_value(ListV{std::move(slot)}) {}  // List
     explicit Value(ListV&& list_v) : m_value(std::move(list_v)) {}  // List
+    explicit Value(MapTag) : m_value(MapV{}) {}  // Map
+    explicit Value(MapV&& map_v) : m_value(std::move(map_v)) {}  // Map
+    explicit Value(IterTag) : m_value(IterV{}) {}  // Iterator
+    explicit Value(IterV&& iter_v) : m_value(std::move(iter_v)) {}  // Iterator
     explicit Value(const TypeInfo::Subtypes& subtypes) : m_value(TupleV{subtypes}) {}  // Tuple
     explicit Value(Values&& values) : m_value(TupleV{std::move(values)}) {}  // Tuple
     explicit Value(ClosureTag) : m_value(ClosureV{}) {}  // Closure
     explicit Value(const Function& fn) : m_value(ClosureV{fn}) {}  // Closure
     explicit Value(const Function& fn, Values&& values) : m_value(ClosureV{fn, std::move(values)}) {}  // Closure
+    explicit Value(const Function& fn, const std::byte* nonlocals) : m_value(ClosureV{fn, nonlocals}) {}  // Closure
     explicit Value(StreamTag) : m_value(StreamV{}) {}  // Stream
     explicit Value(const script::Stream& v) : m_value(StreamV{v}) {}  // Stream
     explicit Value(ModuleTag) : m_value(ModuleV{}) {}  // Module
@@ -306,6 +426,14 @@ public:
                 // Unknown
             } else if constexpr (std::is_trivial_v<T>) {
                 ar(v);
+            } else if constexpr (std::is_same_v<T, StringV>) {
+                if constexpr (requires { typename Archive::Reader; }) {
+                    std::string str;
+                    ar(str);
+                    v = StringV(str);
+                } else {
+                    ar(std::string(v.value()));
+                }
             } else {
                 // String etc.
                 // TODO
@@ -320,7 +448,7 @@ protected:
             uint8_t, uint16_t, uint32_t, uint64_t, uint128,
             int8_t, int16_t, int32_t, int64_t, int128,
             float, double, float128,
-            StringV, ListV, TupleV, ClosureV, StreamV, ModuleV, TypeIndexV
+            StringV, ListV, MapV, IterV, TupleV, ClosureV, StreamV, ModuleV, TypeIndexV
         >;
     ValueVariant m_value;
 };
@@ -448,6 +576,37 @@ private:
 };
 
 
+/// Decref the values on scope exit, also when an exception is thrown
+/// (e.g. from a function called by a native loop, like ListMap).
+/// A container of values (e.g. std::vector<Value>) decrefs all its items.
+/// Call `release()` when the values were passed on (pushed to stack).
+template <class... Ts>
+class DecRefGuard {
+public:
+    explicit DecRefGuard(Ts&... values) : m_values(values...) {}
+    ~DecRefGuard() {
+        if (m_active)
+            std::apply([](auto&... v) { (decref(v), ...); }, m_values);
+    }
+    DecRefGuard(const DecRefGuard&) = delete;
+    DecRefGuard& operator=(const DecRefGuard&) = delete;
+
+    void release() { m_active = false; }
+
+private:
+    template <class T> static void decref(T& v) {
+        if constexpr (requires { v.decref(); })
+            v.decref();
+        else
+            for (auto& item : v)
+                item.decref();
+    }
+
+    std::tuple<Ts&...> m_values;
+    bool m_active = true;
+};
+
+
 namespace value {
 
 // ----------- //
@@ -649,7 +808,7 @@ public:
 
     TypeInfo type_info() const { return ti_bytes(); }
 
-    std::span<const std::byte> value() const { return {heapslot()->data() + 6, length()}; }
+    std::span<const std::byte> value() const { return {get<ListV>().raw_data(), length()}; }
 };
 
 
@@ -659,6 +818,24 @@ public:
 };
 
 
+class Map: public Value {
+public:
+    Map() : Value(Value::MapTag{}) {}
+    Map(const TypeInfo& key_type, const TypeInfo& value_type) : Value(MapV{key_type, value_type}) {}
+
+    size_t length() const { return get<MapV>().length(); }
+};
+
+
+class Iter: public Value {
+public:
+    Iter() : Value(Value::IterTag{}) {}
+    explicit Iter(std::unique_ptr<Generator>&& generator) : Value(IterV{std::move(generator)}) {}
+
+    Generator& generator() const { return get<IterV>().generator(); }
+};
+
+
 // Frozen vector of values - cannot add/modify items
 class Tuple: public Value {
 public:
@@ -678,10 +855,12 @@ public:
     Closure() : Value(Value::ClosureTag{}) {}
     explicit Closure(const Function& fn) : Value(fn) {}
     explicit Closure(const Function& fn, Values&& values) : Value(fn, std::move(values)) {}
+    explicit Closure(const Function& fn, const std::byte* nonlocals) : Value(fn, nonlocals) {}
     TypeInfo type_info() const { return TypeInfo{Type::Function}; }
 
     Function* function() const { return get<ClosureV>().function(); }
     value::Tuple closure() const { return get<ClosureV>().closure(); }
+    void copy_nonlocals(std::byte* target) const { get<ClosureV>().copy_nonlocals(target); }
 };
 
 
@@ -258,6 +258,16 @@ std::unique_ptr<ast::Type> ListType::make_copy() const
 {
     auto r = std::make_unique<ListType>();
     r->elem_type = copy(elem_type);
+    r->lazy = lazy;
+    return r;
+}
+
+
+std::unique_ptr<ast::Type> MapType::make_copy() const
+{
+    auto r = std::make_unique<MapType>();
+    r->key_type = copy(key_type);
+    r->value_type = copy(value_type);
     return r;
 }
 
@@ -52,6 +52,7 @@ struct Function;
 struct TypeName;
 struct FunctionType;
 struct ListType;
+struct MapType;
 struct TupleType;
 struct StructType;
 
@@ -84,6 +85,7 @@ public:
     virtual void visit(const TypeName&) = 0;
     virtual void visit(const FunctionType&) = 0;
     virtual void visit(const ListType&) = 0;
+    virtual void visit(const MapType&) = 0;
     virtual void visit(const TupleType&) = 0;
     virtual void visit(const StructType&) = 0;
 };
@@ -116,6 +118,7 @@ public:
     virtual void visit(TypeName&) = 0;
     virtual void visit(FunctionType&) = 0;
     virtual void visit(ListType&) = 0;
+    virtual void visit(MapType&) = 0;
     virtual void visit(TupleType&) = 0;
     virtual void visit(StructType&) = 0;
 };
@@ -142,6 +145,7 @@ public:
     void visit(TypeName&) final {}
     void visit(FunctionType&) final {}
     void visit(ListType&) final {}
+    void visit(MapType&) final {}
     void visit(TupleType&) final {}
     void visit(StructType&) final {}
 };
@@ -185,6 +189,7 @@ public:
     void visit(TypeName&) final {}
     void visit(FunctionType&) final {}
     void visit(ListType&) final {}
+    void visit(MapType&) final {}
     void visit(TupleType&) final {}
     void visit(StructType&) final {}
 };
@@ -263,6 +268,17 @@ struct ListType: public Type {
     std::unique_ptr<ast::Type> make_copy() const override;
 
     std::unique_ptr<Type> elem_type;
+    bool lazy = false;  // [T..] - lazy sequence (iterator)
+};
+
+
+struct MapType: public Type {
+    void apply(ConstVisitor& visitor) const override { visitor.visit(*this); }
+    void apply(Visitor& visitor) override { visitor.visit(*this); }
+    std::unique_ptr<ast::Type> make_copy() const override;
+
+    std::unique_ptr<Type> key_type;
+    std::unique_ptr<Type> value_type;
 };
 
 
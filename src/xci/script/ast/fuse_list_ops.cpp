@@ -0,0 +1,289 @@
+// fuse_list_ops.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "fuse_list_ops.h"
+#include <xci/script/Function.h>
+#include <xci/script/Module.h>
+
+namespace xci::script {
+
+using std::unique_ptr;
+
+
+class FuseListOpsVisitor final: public ast::VisitorExclTypes {
+public:
+    using VisitorExclTypes::visit;
+
+    void visit(ast::Definition& dfn) override {
+        if (dfn.expression)
+            dfn.expression->apply(*this);
+    }
+
+    void visit(ast::Invocation& inv) override {
+        inv.expression->apply(*this);
+    }
+
+    void visit(ast::Return& ret) override {
+        ret.expression->apply(*this);
+    }
+
+    void visit(ast::Call& v) override {
+        // fuse the inner calls first, so the whole chain collapses into the outer one
+        if (v.arg)
+            v.arg->apply(*this);
+        v.callable->apply(*this);
+        fuse_map(v) || fuse_fold(v);
+    }
+
+    void visit(ast::OpCall& v) override {
+        if (v.arg)
+            v.arg->apply(*this);
+        if (v.right_arg)
+            v.right_arg->apply(*this);
+    }
+
+    void visit(ast::Condition& v) override {
+        for (auto& item : v.if_then_expr) {
+            item.first->apply(*this);
+            item.second->apply(*this);
+        }
+        v.else_expr->apply(*this);
+    }
+
+    void visit(ast::WithContext& v) override {
+        v.context->apply(*this);
+        v.expression->apply(*this);
+    }
+
+    void visit(ast::Function& v) override {
+        v.body.apply(*this);
+    }
+
+    void visit(ast::Parenthesized& v) override {
+        v.expression->apply(*this);
+    }
+
+    void visit(ast::Tuple& v) override {
+        for (auto& expr : v.items)
+            expr->apply(*this);
+    }
+
+    void visit(ast::List& v) override {
+        for (auto& expr : v.items)
+            expr->apply(*this);
+    }
+
+    void visit(ast::StructInit& v) override {
+        for (auto& item : v.items)
+            item.second->apply(*this);
+    }
+
+    void visit(ast::Literal&) override {}
+    void visit(ast::Reference&) override {}
+
+    void visit(ast::Cast& v) override {
+        if (v.expression)
+            v.expression->apply(*this);
+    }
+
+    void visit(ast::Class&) override {}
+
+    void visit(ast::Instance& v) override {
+        for (auto& dfn : v.defs)
+            dfn.apply(*this);
+    }
+
+private:
+    // Check that the expression is a Reference to function `name` from std module.
+    // Returns its symbol table, or nullptr.
+    SymbolTable* std_function_ref(const ast::Expression& expr, NameId name) const {
+        const auto* ref = dynamic_cast<const ast::Reference*>(&expr);
+        if (ref == nullptr || ref->identifier.name != name || !ref->type_args.empty())
+            return nullptr;
+        const auto& symptr = ref->identifier.symbol;
+        if (!symptr || symptr->type() != Symbol::Function)
+            return nullptr;
+        SymbolTable* symtab = symptr.symtab();
+        if (symtab->module() == nullptr || symtab->module()->name() != m_std)
+            return nullptr;
+        return symtab;
+    }
+
+    // Check that the expression is a Call of std function `name` with a tuple
+    // of `n_args` arguments. Returns the args, or nullptr.
+    ast::Tuple* std_function_call(const ast::Expression& expr, NameId name, size_t n_args) const {
+        const auto* call = dynamic_cast<const ast::Call*>(&expr);
+        if (call == nullptr || dynamic_cast<const ast::OpCall*>(call) != nullptr)
+            return nullptr;
+        if (!call->callable || !call->arg || !std_function_ref(*call->callable, name))
+            return nullptr;
+        auto* args = dynamic_cast<ast::Tuple*>(call->arg.get());
+        if (args == nullptr || args->items.size() != n_args)
+            return nullptr;
+        return args;
+    }
+
+    // Point the callable (a resolved Reference) to another std function
+    static bool retarget(ast::Call& call, NameId name) {
+        auto& ref = static_cast<ast::Reference&>(*call.callable);
+        SymbolTable& symtab = *ref.identifier.symbol.symtab();
+        auto sym_list = symtab.filter(name, Symbol::Function);
+        if (sym_list.empty())
+            return false;
+        ref.identifier.name = name;
+        ref.identifier.symbol = sym_list.front();
+        ref.sym_list = std::move(sym_list);
+        return true;
+    }
+
+    // Make a call `compose (f, g)`, with the function resolved from the std symtab
+    // (the symtab of the callable in `call`). Returns nullptr if there is no `compose`.
+    unique_ptr<ast::Expression> make_compose(const ast::Call& call,
+            unique_ptr<ast::Expression> f, unique_ptr<ast::Expression> g) const
+    {
+        const auto& callee = static_cast<const ast::Reference&>(*call.callable);
+        SymbolTable& symtab = *callee.identifier.symbol.symtab();
+        auto sym_list = symtab.filter(m_compose, Symbol::Function);
+        if (sym_list.empty())
+            return nullptr;
+        auto ref = std::make_unique<ast::Reference>();
+        ref->identifier.name = m_compose;
+        ref->identifier.source_loc = call.source_loc;
+        ref->identifier.symbol = sym_list.front();
+        ref->sym_list = std::move(sym_list);
+        ref->source_loc = call.source_loc;
+        auto args = std::make_unique<ast::Tuple>();
+        args->items.push_back(std::move(f));
+        args->items.push_back(std::move(g));
+        args->source_loc = call.source_loc;
+        auto res = std::make_unique<ast::Call>();
+        res->callable = std::move(ref);
+        res->arg = std::move(args);
+        res->source_loc = call.source_loc;
+        return res;
+    }
+
+    // Check that the expression is `map (f, l)` or `map_compose (f, g, l)`.
+    // Returns the args, or nullptr.
+    ast::Tuple* map_like_call(const ast::Expression& expr) const {
+        if (auto* args = std_function_call(expr, m_map, 2))
+            return args;
+        return std_function_call(expr, m_map_compose, 3);
+    }
+
+    // Take the mapped function out of the args of `map_like_call`,
+    // composing the two functions of `map_compose`. Leaves only the list in `args`.
+    unique_ptr<ast::Expression> take_map_function(const ast::Call& call, ast::Tuple& args) const {
+        auto l = std::move(args.items.back());
+        args.items.pop_back();
+        unique_ptr<ast::Expression> fn;
+        if (args.items.size() == 1)
+            fn = std::move(args.items[0]);
+        else
+            fn = make_compose(call, std::move(args.items[0]), std::move(args.items[1]));
+        args.items.clear();
+        args.items.push_back(std::move(l));
+        return fn;
+    }
+
+    // map (f, map (g, l)) -> map_compose (f, g, l)
+    // map (f, map_compose (g, h, l)) -> map_compose (f, compose (g, h), l)
+    // map_compose (f, g, map (h, l)) -> map_compose (f, compose (g, h), l)
+    // map_compose (f, g, map_compose (h, k, l)) -> map_compose (f, compose (g, compose (h, k)), l)
+    // map (f, filter (p, l)) -> map_filter (f, p, l)
+    // map_compose (f, g, filter (p, l)) -> map_filter (compose (f, g), p, l)
+    bool fuse_map(ast::Call& v) {
+        auto* outer_args = map_like_call(v);
+        if (outer_args == nullptr)
+            return false;
+        const bool outer_compose = outer_args->items.size() == 3;
+        auto& inner_expr = outer_args->items.back();
+
+        if (auto* inner_args = map_like_call(*inner_expr)) {
+            if ((outer_compose || inner_args->items.size() == 3) && !has_compose(v))
+                return false;
+            auto& inner_call = static_cast<ast::Call&>(*inner_expr);
+            auto inner_fn = take_map_function(inner_call, *inner_args);
+            auto l = std::move(inner_args->items[0]);
+            if (outer_compose) {
+                auto g = std::move(outer_args->items[1]);
+                outer_args->items[1] = make_compose(v, std::move(g), std::move(inner_fn));
+                outer_args->items[2] = std::move(l);
+            } else {
+                retarget(v, m_map_compose);
+                outer_args->items[1] = std::move(inner_fn);
+                outer_args->items.push_back(std::move(l));
+            }
+            return true;
+        }
+
+        if (auto* inner_args = std_function_call(*inner_expr, m_filter, 2)) {
+            if (!has_function(v, m_map_filter) || (outer_compose && !has_compose(v)))
+                return false;
+            auto p = std::move(inner_args->items[0]);
+            auto l = std::move(inner_args->items[1]);
+            auto f = take_map_function(v, *outer_args);
+            retarget(v, m_map_filter);
+            outer_args->items.clear();
+            outer_args->items.push_back(std::move(f));
+            outer_args->items.push_back(std::move(p));
+            outer_args->items.push_back(std::move(l));
+            return true;
+        }
+        return false;
+    }
+
+    // fold (f, init, map (g, l)) -> fold_map (f, init, g, l)
+    // fold (f, init, map_compose (g, h, l)) -> fold_map (f, init, compose (g, h), l)
+    bool fuse_fold(ast::Call& v) {
+        auto* outer_args = std_function_call(v, m_fold, 3);
+        if (outer_args == nullptr)
+            return false;
+        auto* inner_args = map_like_call(*outer_args->items[2]);
+        if (inner_args == nullptr || !has_function(v, m_fold_map)
+                || (inner_args->items.size() == 3 && !has_compose(v)))
+            return false;
+        auto& inner_call = static_cast<ast::Call&>(*outer_args->items[2]);
+        auto g = take_map_function(inner_call, *inner_args);
+        auto l = std::move(inner_args->items[0]);
+        retarget(v, m_fold_map);
+        outer_args->items[2] = std::move(g);
+        outer_args->items.push_back(std::move(l));
+        return true;
+    }
+
+    // Check that the std module (where the callable of `call` is from) has function `name`
+    static bool has_function(const ast::Call& call, NameId name) {
+        const auto& ref = static_cast<const ast::Reference&>(*call.callable);
+        return !ref.identifier.symbol.symtab()->filter(name, Symbol::Function).empty();
+    }
+
+    bool has_compose(const ast::Call& call) const { return has_function(call, m_compose); }
+
+    const NameId m_std = intern("std");
+    const NameId m_map = intern("map");
+    const NameId m_map_compose = intern("map_compose");
+    const NameId m_filter = intern("filter");
+    const NameId m_map_filter = intern("map_filter");
+    const NameId m_fold = intern("fold");
+    const NameId m_fold_map = intern("fold_map");
+    const NameId m_compose = intern("compose");
+};
+
+
+void fuse_list_ops(const Scope& scope, const ast::Block& block)
+{
+    // std implements the fused functions with the plain ones, don't fuse them back
+    if (scope.module().name() == intern("std"))
+        return;
+    FuseListOpsVisitor visitor;
+    for (const auto& stmt : block.statements) {
+        stmt->apply(visitor);
+    }
+}
+
+
+} // namespace xci::script
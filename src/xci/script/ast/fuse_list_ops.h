@@ -0,0 +1,37 @@
+// fuse_list_ops.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_AST_FUSE_LIST_OPS_H
+#define XCI_SCRIPT_AST_FUSE_LIST_OPS_H
+
+#include "AST.h"
+
+namespace xci::script {
+
+
+/// Fuse chained calls of std list functions, so the intermediate lists
+/// are not created. Only the calls which resolve to functions from `std`
+/// module are fused (user-defined functions of same name are left alone).
+///
+/// Rules:
+/// * `map (f, map (g, l))` -> `map_compose (f, g, l)`
+/// * `map (f, filter (p, l))` -> `map_filter (f, p, l)`
+/// * `fold (f, init, map (g, l))` -> `fold_map (f, init, g, l)`
+///
+/// The inner calls are fused first, so a chain of maps collapses into single
+/// `map_compose`, the additional functions are joined by `compose`:
+/// `map (f, map (g, map (h, l)))` -> `map_compose (f, compose (g, h), l)`
+///
+/// The std module itself is not fused (it implements the fused functions).
+///
+/// Optimization AST pass - runs after resolve_symbols.
+
+void fuse_list_ops(const Scope& scope, const ast::Block& block);
+
+
+} // namespace xci::script
+
+#endif // include guard
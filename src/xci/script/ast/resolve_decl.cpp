@@ -393,7 +393,17 @@ public:
 
     void visit(ast::ListType& t) final {
         t.elem_type->apply(*this);
-        m_type_info = ti_list(std::move(m_type_info));
+        if (t.lazy)
+            m_type_info = ti_iter(std::move(m_type_info));
+        else
+            m_type_info = ti_list(std::move(m_type_info));
+    }
+
+    void visit(ast::MapType& t) final {
+        t.key_type->apply(*this);
+        TypeInfo key_type = std::move(m_type_info);
+        t.value_type->apply(*this);
+        m_type_info = ti_map(std::move(key_type), std::move(m_type_info));
     }
 
     void visit(ast::TupleType& t) final {
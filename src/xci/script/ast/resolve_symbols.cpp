@@ -389,6 +389,11 @@ public:
         t.elem_type->apply(*this);
     }
 
+    void visit(ast::MapType& t) final {
+        t.key_type->apply(*this);
+        t.value_type->apply(*this);
+    }
+
     void visit(ast::TupleType& t) final {
         for (auto& st : t.subtypes)
             st->apply(*this);
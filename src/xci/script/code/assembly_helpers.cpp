@@ -16,15 +16,18 @@ const Function& get_call_function(const CodeAssembly::Instruction& instr, const
 {
     const Module* module;
     Module::FunctionIdx fn_idx;
-    if (instr.opcode == Opcode::Call0) {
+    if (instr.opcode == Opcode::Call0 || instr.opcode == Opcode::TailCall0) {
         module = &mod;
         fn_idx = Module::FunctionIdx(instr.args.first);
-    } else if (instr.opcode == Opcode::Call1) {
+    } else if (instr.opcode == Opcode::Call1 || instr.opcode == Opcode::TailCall1) {
         module = &mod.get_imported_module(0);
         fn_idx = Module::FunctionIdx(instr.args.first);
-    } else if (instr.opcode == Opcode::Call) {
+    } else if (instr.opcode == Opcode::Call || instr.opcode == Opcode::TailCall) {
         module = &mod.get_imported_module(Index(instr.args.first));
         fn_idx = Module::FunctionIdx(instr.args.second);
+    } else if (instr.opcode == Opcode::CallNative) {
+        module = instr.args.first == 0 ? &mod : &mod.get_imported_module(Index(instr.args.first - 1));
+        fn_idx = Module::FunctionIdx(instr.args.second);
     } else {
         assert(!"not a call instruction");
         XCI_UNREACHABLE;
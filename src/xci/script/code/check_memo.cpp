@@ -0,0 +1,168 @@
+// check_memo.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "check_memo.h"
+#include <xci/script/Module.h>
+#include <xci/script/Error.h>
+#include <xci/script/code/assembly_helpers.h>
+
+#include <unordered_set>
+#include <vector>
+
+namespace xci::script {
+
+
+static bool has_heap_slot(const TypeInfo& ti)
+{
+    bool res = false;
+    ti.foreach_heap_slot([&res](size_t) { res = true; });
+    return res;
+}
+
+
+static bool has_stream(const TypeInfo& ti)
+{
+    const TypeInfo& ul = ti.underlying();
+    switch (ul.type()) {
+        case Type::Stream:
+        case Type::Iterator:  // stepping the iterator consumes it, like reading a stream
+            return true;
+        case Type::List:
+            return has_stream(ul.elem_type());
+        case Type::Map:
+            return has_stream(ul.map_key_type()) || has_stream(ul.map_value_type());
+        case Type::Tuple:
+        case Type::Struct:
+            for (const auto& sub : ul.subtypes())
+                if (has_stream(sub))
+                    return true;
+            return false;
+        default:
+            return false;
+    }
+}
+
+
+static bool has_stream(const Function& fn)
+{
+    if (has_stream(fn.parameter()) || has_stream(fn.signature().return_type))
+        return true;
+    for (const auto& ti : fn.nonlocals())
+        if (has_stream(ti))
+            return true;
+    return false;
+}
+
+
+// Returns the first function reachable from `fn` which does I/O, or null
+static const Function* find_io_function(const Function& fn)
+{
+    std::vector<const Function*> todo {&fn};
+    std::unordered_set<const Function*> seen {&fn};
+    const auto add = [&todo, &seen](const Function& f) {
+        if (seen.insert(&f).second)
+            todo.push_back(&f);
+    };
+    while (!todo.empty()) {
+        const Function& f = *todo.back();
+        todo.pop_back();
+        if (has_stream(f) || f.has_io())
+            return &f;
+
+        CodeAssembly disassembled;
+        const CodeAssembly* code;
+        if (f.is_assembly())
+            code = &f.asm_code();
+        else if (f.is_bytecode()) {
+            disassembled.disassemble(f.bytecode());
+            code = &disassembled;
+        } else
+            continue;  // native (checked above), generic (can't be called)
+
+        const Module& mod = f.module();
+        for (const auto& instr : *code) {
+            switch (instr.opcode) {
+                case Opcode::Call0:
+                case Opcode::TailCall0:
+                case Opcode::Call1:
+                case Opcode::TailCall1:
+                case Opcode::Call:
+                case Opcode::TailCall:
+                case Opcode::CallNative:
+                    add(get_call_function(instr, mod));
+                    break;
+                case Opcode::LoadFunction:
+                case Opcode::MakeClosure:
+                    add(mod.get_function(Module::FunctionIdx(instr.args.first)));
+                    break;
+                case Opcode::LoadStatic:
+                    if (has_stream(mod.get_value(Index(instr.args.first)).type_info()))
+                        return &f;
+                    break;
+                case Opcode::Invoke:
+                    return &f;
+                default:
+                    break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+
+void check_memoizable(const Function& fn)
+{
+    if (has_heap_slot(fn.parameter()))
+        throw memo_function_error(fn.qualified_name(), "parameter is not plain data");
+    for (const auto& ti : fn.nonlocals())
+        if (has_heap_slot(ti))
+            throw memo_function_error(fn.qualified_name(), "captured value is not plain data");
+    if (const Function* io_fn = find_io_function(fn)) {
+        if (io_fn == &fn)
+            throw memo_function_error(fn.qualified_name(), "it does I/O");
+        throw memo_function_error(fn.qualified_name(),
+                fmt::format("it does I/O in {}", io_fn->qualified_name()));
+    }
+}
+
+
+// The function is `memo` from std.fire (its specialization)
+static bool is_memo(const Function& fn)
+{
+    if (fn.is_assembly())
+        return !fn.asm_code().empty() && fn.asm_code()[0].opcode == Opcode::Memo;
+    if (fn.is_bytecode())
+        return !fn.bytecode().empty() && Opcode(*fn.bytecode().begin()) == Opcode::Memo;
+    return false;
+}
+
+
+void check_memo_functions(Function& fn)
+{
+    const CodeAssembly& ca = fn.asm_code();
+    for (size_t i = 1; i < ca.size(); ++i) {
+        const auto& instr = ca[i];
+        switch (instr.opcode) {
+            case Opcode::Call0:
+            case Opcode::Call1:
+            case Opcode::Call:
+                if (!is_memo(get_call_function(instr, fn.module())))
+                    continue;
+                break;
+            case Opcode::Memo:  // inlined
+                break;
+            default:
+                continue;
+        }
+        // The function arg is on top of the stack - pushed by previous instruction
+        const auto& prev = ca[i - 1];
+        if (prev.opcode == Opcode::LoadFunction || prev.opcode == Opcode::MakeClosure)
+            check_memoizable(fn.module().get_function(Module::FunctionIdx(prev.args.first)));
+    }
+}
+
+
+} // namespace xci::script
@@ -0,0 +1,37 @@
+// check_memo.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_CODE_CHECK_MEMO_H
+#define XCI_SCRIPT_CODE_CHECK_MEMO_H
+
+#include <xci/script/Function.h>
+
+namespace xci::script {
+
+
+/// Check that the function can be memoized (see `memo` in std.fire)
+/// Throws MemoFunctionError if it can't:
+/// - the parameter and the nonlocals must be plain data (no heap slots),
+///   because they are used as the cache key in raw form
+/// - the function must be pure: it must not call a native function doing I/O
+///   (Function::has_io) or work with a Stream, neither directly nor through
+///   any function it calls or references
+
+void check_memoizable(const Function& fn);
+
+
+/// Check functions passed to `memo` in the code of `fn`
+/// The function must be in assembly form. Only the functions which are
+/// known at compile time are checked, i.e. the argument of `memo` is
+/// a reference to a named or anonymous function. The other ones are checked
+/// by the Machine on the first call.
+
+void check_memo_functions(Function& fn);
+
+
+} // namespace xci::script
+
+#endif // include guard
@@ -0,0 +1,45 @@
+// optimize_native_call.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "optimize_native_call.h"
+#include <xci/script/Module.h>
+#include <xci/script/code/assembly_helpers.h>
+
+namespace xci::script {
+
+
+void optimize_native_call(Function& fn)
+{
+    CodeAssembly& ca = fn.asm_code();
+    for (size_t i = 0; i != ca.size(); ++i) {
+        auto& instr = ca[i];
+        size_t mod_ref;  // 0 = current module, 1 + idx of imported module
+        size_t fn_idx;
+        switch (instr.opcode) {
+            case Opcode::Call0:
+                mod_ref = 0;
+                fn_idx = instr.args.first;
+                break;
+            case Opcode::Call1:
+                mod_ref = 1;
+                fn_idx = instr.args.first;
+                break;
+            case Opcode::Call:
+                mod_ref = instr.args.first + 1;
+                fn_idx = instr.args.second;
+                break;
+            default:
+                continue;
+        }
+        if (!get_call_function(instr, fn.module()).is_native())
+            continue;
+        instr.opcode = Opcode::CallNative;
+        instr.args = {mod_ref, fn_idx};
+    }
+}
+
+
+} // namespace xci::script
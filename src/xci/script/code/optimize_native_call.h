@@ -0,0 +1,25 @@
+// optimize_native_call.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_CODE_OPTIMIZE_NATIVE_CALL_H
+#define XCI_SCRIPT_CODE_OPTIMIZE_NATIVE_CALL_H
+
+#include <xci/script/Function.h>
+
+namespace xci::script {
+
+
+/// Replace CALL of a native function by CALL_NATIVE
+/// CALL_NATIVE calls the native delegate directly, the machine doesn't need
+/// to check the function kind or touch the stack frames.
+/// This should run after other optimizations which look for CALL instructions.
+
+void optimize_native_call(Function& fn);
+
+
+} // namespace xci::script
+
+#endif // include guard
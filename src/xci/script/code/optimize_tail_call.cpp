@@ -9,6 +9,9 @@
 #include <xci/script/code/assembly_helpers.h>
 #include <xci/compat/macros.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace xci::script {
 
 
@@ -23,8 +26,110 @@ static Opcode call_to_tail_call(Opcode opcode)
 }
 
 
+static size_t find_label(const CodeAssembly& ca, size_t label_idx)
+{
+    for (size_t i = 0; i != ca.size(); ++i) {
+        const auto& instr = ca[i];
+        if (instr.opcode == Opcode::Annotation
+        && CodeAssembly::Annotation(instr.args.first) == CodeAssembly::Annotation::Label
+        && instr.args.second == label_idx)
+            return i;
+    }
+    return ca.size();
+}
+
+
+struct Epilogue {
+    std::vector<size_t> dec_refs;  // DEC_REF offsets
+    size_t skip = 0;    // DROP
+    size_t drop = 0;
+};
+
+
+// Check that only the epilogue follows the instruction at `idx`: DEC_REF*, [DROP], RET.
+// Labels are skipped, JUMPs are followed.
+static bool find_epilogue(const CodeAssembly& ca, size_t idx, Epilogue& epi)
+{
+    bool dropped = false;
+    for (size_t i = idx + 1; i < ca.size(); ) {
+        const auto& instr = ca[i];
+        switch (instr.opcode) {
+            case Opcode::Annotation:
+                switch (CodeAssembly::Annotation(instr.args.first)) {
+                    case CodeAssembly::Annotation::Label:
+                        ++i;
+                        continue;
+                    case CodeAssembly::Annotation::Jump:
+                        i = find_label(ca, instr.args.second);
+                        continue;
+                    default:
+                        return false;
+                }
+            case Opcode::DecRef:
+                if (dropped)
+                    return false;
+                epi.dec_refs.push_back(instr.args.first);
+                ++i;
+                continue;
+            case Opcode::Drop:
+                if (dropped)
+                    return false;
+                epi.skip = instr.args.first;
+                epi.drop = instr.args.second;
+                dropped = true;
+                ++i;
+                continue;
+            case Opcode::Ret:
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+
+// Replace self-recursive tail calls by a jump to the start
+static void optimize_self_tail_call(Function& fn)
+{
+    CodeAssembly& ca = fn.asm_code();
+    const size_t args = fn.raw_size_of_parameter() + fn.raw_size_of_nonlocals();
+    const size_t ret = fn.effective_return_type().size();
+    size_t start_label = no_index;
+    for (size_t i = 0; i < ca.size(); ++i) {
+        if (ca[i].opcode != Opcode::Call0 || &get_call_function(ca[i], fn.module()) != &fn)
+            continue;
+        Epilogue epi;
+        if (!find_epilogue(ca, i, epi))
+            continue;
+        if (epi.drop != 0 && epi.skip != ret)
+            continue;
+        // DEC_REF offsets are from top, the args are there instead of the return value
+        if (std::ranges::any_of(epi.dec_refs, [ret](size_t ofs) { return ofs < ret; }))
+            continue;
+
+        if (start_label == no_index)
+            start_label = ca.add_label();
+        ca.remove(i);
+        for (size_t ofs : epi.dec_refs)
+            ca.insert(i++, {Opcode::DecRef, ofs - ret + args});
+        if (epi.drop != 0)
+            ca.insert(i++, {Opcode::Drop, args, epi.drop});
+        ca.insert(i, {Opcode::Annotation, size_t(CodeAssembly::Annotation::JumpBack), start_label});
+        // remove dead code up to next label
+        while (i + 1 < ca.size() && !(ca[i + 1].opcode == Opcode::Annotation
+                && CodeAssembly::Annotation(ca[i + 1].args.first) == CodeAssembly::Annotation::Label))
+            ca.remove(i + 1);
+    }
+    if (start_label != no_index)
+        ca.insert(0, {Opcode::Annotation, size_t(CodeAssembly::Annotation::Label), start_label});
+}
+
+
 void optimize_tail_call(Function& fn)
 {
+    optimize_self_tail_call(fn);
+
     CodeAssembly& ca = fn.asm_code();
     if (ca.size() < 2 || ca.back().opcode != Opcode::Ret)
         return;
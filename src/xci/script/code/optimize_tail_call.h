@@ -15,6 +15,16 @@ namespace xci::script {
 /// Replace tail CALL by TAIL_CALL
 /// This requires that the CALL is last instruction in the function.
 /// TAIL_CALL doesn't add a new stack frame, but replaces the last one.
+///
+/// Self-recursive tail calls are turned into loops. A CALL0 of the function
+/// itself, which is followed only by the function epilogue (DEC_REF of params,
+/// DROP, RET - possibly through a JUMP to it from if-branch), is replaced by:
+///
+///     DEC_REF             <old params>
+///     DROP                <args> <params>
+///     JUMP_BACK           .start
+///
+/// The new args take place of the params, there is no frame operation.
 
 void optimize_tail_call(Function& fn);
 
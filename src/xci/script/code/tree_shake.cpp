@@ -0,0 +1,218 @@
+// tree_shake.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "tree_shake.h"
+#include "verify_bytecode.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace xci::script {
+
+
+// The value may hold a function object (its Function pointer)
+static bool has_function(const TypeInfo& ti)
+{
+    const TypeInfo& ul = ti.underlying();
+    switch (ul.type()) {
+        case Type::Function:
+        case Type::Iterator:  // the generator may hold function objects
+            return true;
+        case Type::List:
+            return has_function(ul.elem_type());
+        case Type::Map:
+            return has_function(ul.map_key_type()) || has_function(ul.map_value_type());
+        case Type::Tuple:
+        case Type::Struct:
+            for (const auto& sub : ul.subtypes())
+                if (has_function(sub))
+                    return true;
+            return false;
+        default:
+            return false;
+    }
+}
+
+
+static size_t code_bytes(const Module& module)
+{
+    size_t res = 0;
+    for (Index i = 0; i != module.num_functions(); ++i) {
+        const Function& fn = module.get_function(Module::FunctionIdx(i));
+        if (fn.is_bytecode())
+            res += fn.bytecode().size();
+    }
+    return res;
+}
+
+
+// Mark everything reachable from the already marked functions
+static void mark_reachable(const Module& module,
+                           std::vector<bool>& functions, std::vector<bool>& values)
+{
+    std::vector<Index> todo;
+    for (Index i = 0; i != Index(functions.size()); ++i)
+        if (functions[i])
+            todo.push_back(i);
+    const auto add = [&todo, &functions](size_t idx) {
+        if (!functions[idx]) {
+            functions[idx] = true;
+            todo.push_back(Index(idx));
+        }
+    };
+    while (!todo.empty()) {
+        const Function& fn = module.get_function(Module::FunctionIdx(todo.back()));
+        todo.pop_back();
+
+        CodeAssembly disassembled;
+        const CodeAssembly* code;
+        if (fn.is_assembly())
+            code = &fn.asm_code();
+        else if (fn.is_bytecode()) {
+            disassembled.disassemble(fn.bytecode());
+            code = &disassembled;
+        } else
+            continue;  // native, generic (can't be called)
+
+        for (const auto& instr : *code) {
+            switch (instr.opcode) {
+                case Opcode::Call0:
+                case Opcode::TailCall0:
+                case Opcode::LoadFunction:
+                case Opcode::MakeClosure:
+                    add(instr.args.first);
+                    break;
+                case Opcode::CallNative:
+                    if (instr.args.first == 0)  // this module
+                        add(instr.args.second);
+                    break;
+                case Opcode::LoadStatic:
+                    values[instr.args.first] = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+
+// Rewrite the operands referencing renumbered functions and values.
+// Empty remap means the items were not renumbered.
+// Returns true if the code was modified.
+static bool remap_code(CodeAssembly& code,
+                       const std::vector<Index>& fn_remap, const std::vector<Index>& value_remap)
+{
+    bool changed = false;
+    const auto remap = [&changed](size_t& arg, const std::vector<Index>& map) {
+        if (map.empty())
+            return;
+        const Index new_idx = map[arg];
+        assert(new_idx != no_index);
+        if (new_idx != arg) {
+            arg = new_idx;
+            changed = true;
+        }
+    };
+    for (size_t i = 0; i != code.size(); ++i) {
+        auto& instr = code[i];
+        switch (instr.opcode) {
+            case Opcode::Call0:
+            case Opcode::TailCall0:
+            case Opcode::LoadFunction:
+            case Opcode::MakeClosure:
+                remap(instr.args.first, fn_remap);
+                break;
+            case Opcode::CallNative:
+                if (instr.args.first == 0)
+                    remap(instr.args.second, fn_remap);
+                break;
+            case Opcode::LoadStatic:
+                remap(instr.args.first, value_remap);
+                break;
+            default:
+                break;
+        }
+    }
+    return changed;
+}
+
+
+static bool is_reachable(const Module& module, const Instance& inst,
+                         const std::vector<bool>& functions)
+{
+    for (Index i = 0; i != inst.num_functions(); ++i) {
+        const auto& fi = inst.get_function(i);
+        if (fi.module == nullptr)
+            continue;
+        if (fi.module != &module)
+            return true;  // we can't tell, keep it
+        const Scope& scope = module.get_scope(Module::ScopeIdx(fi.scope_index));
+        if (scope.has_function() && functions[scope.function_index()])
+            return true;
+    }
+    return false;
+}
+
+
+TreeShakeStats tree_shake(Module& module)
+{
+    TreeShakeStats stats;
+    stats.functions.before = module.num_functions();
+    stats.instances.before = module.num_instances();
+    stats.values.before = module.num_values();
+    stats.code_bytes.before = code_bytes(module);
+
+    std::vector<bool> functions(module.num_functions(), false);
+    std::vector<bool> values(module.num_values(), false);
+    functions[0] = true;  // main
+    mark_reachable(module, functions, values);
+
+    // A function object in static value refers to the Function by address,
+    // which would change by renumbering. Keep all functions in that case.
+    bool pinned = false;
+    for (Index i = 0; i != module.num_values(); ++i)
+        if (values[i] && has_function(module.get_value(i).type_info()))
+            pinned = true;
+    if (pinned) {
+        functions.assign(functions.size(), true);
+        mark_reachable(module, functions, values);
+    }
+
+    std::vector<bool> instances(module.num_instances(), false);
+    for (Index i = 0; i != module.num_instances(); ++i)
+        instances[i] = is_reachable(module, module.get_instance(Module::InstanceIdx(i)), functions);
+
+    const auto fn_remap = pinned ? std::vector<Index>{} : module.retain_functions(functions);
+    const auto value_remap = module.retain_values(values);
+    module.retain_instances(instances);
+
+    for (Index i = 0; i != module.num_functions(); ++i) {
+        Function& fn = module.get_function(Module::FunctionIdx(i));
+        if (fn.is_assembly()) {
+            remap_code(fn.asm_code(), fn_remap, value_remap);
+        } else if (fn.is_bytecode()) {
+            CodeAssembly code;
+            code.disassemble(fn.bytecode());
+            if (!remap_code(code, fn_remap, value_remap))
+                continue;
+            const bool verified = fn.is_verified();
+            fn.set_bytecode();
+            code.assemble_to(fn.bytecode());
+            if (verified)
+                verify_bytecode(fn);
+        }
+    }
+
+    stats.functions.after = module.num_functions();
+    stats.instances.after = module.num_instances();
+    stats.values.after = module.num_values();
+    stats.code_bytes.after = code_bytes(module);
+    return stats;
+}
+
+
+} // namespace xci::script
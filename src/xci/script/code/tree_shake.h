@@ -0,0 +1,50 @@
+// tree_shake.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_CODE_TREE_SHAKE_H
+#define XCI_SCRIPT_CODE_TREE_SHAKE_H
+
+#include <xci/script/Module.h>
+
+namespace xci::script {
+
+
+struct TreeShakeStats {
+    struct Count {
+        size_t before = 0;
+        size_t after = 0;
+    };
+    Count functions;
+    Count instances;
+    Count values;
+    Count code_bytes;  // sum of bytecode sizes
+};
+
+
+/// Remove the functions, instances and static values which are unreachable
+/// from the main function of the module.
+///
+/// The reachable set is computed by walking the compiled code from main:
+/// calls and function objects (LOAD_FUNCTION, MAKE_CLOSURE) referencing
+/// this module, and static values loaded by LOAD_STATIC. The imported modules
+/// are referenced by name and left untouched, their functions are leaves.
+/// Unused generic functions and their specializations, which were kept
+/// for further compilation, are dropped. Instances are dropped when none
+/// of their functions is reachable.
+///
+/// The surviving items are renumbered and the bytecode is rewritten
+/// (and verified again), the module is then ready for save_to_file.
+/// This is a link-time pass: the module must not be compiled into afterwards.
+///
+/// A static value containing a function object of this module pins
+/// the function's address, the functions are not removed in that case.
+
+TreeShakeStats tree_shake(Module& module);
+
+
+} // namespace xci::script
+
+#endif // include guard
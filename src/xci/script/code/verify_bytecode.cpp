@@ -0,0 +1,578 @@
+// verify_bytecode.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "verify_bytecode.h"
+#include <xci/script/Module.h>
+#include <xci/script/Error.h>
+#include <xci/script/typing/type_index.h>
+
+#include <map>
+#include <vector>
+
+namespace xci::script {
+
+
+namespace {
+
+// Sizes of values on stack, as pulled/pushed by the Machine
+const size_t bool_size = type_size_on_stack(Type::Bool);
+const size_t int_size = type_size_on_stack(Type::Int64);     // value::Int
+const size_t uint_size = type_size_on_stack(Type::UInt64);   // value::UInt
+constexpr size_t ptr_size = sizeof(void*);  // List, Map, Closure, Module (heap slot)
+
+// Stack depth is not known after EXECUTE
+constexpr size_t unknown_depth = size_t(-1);
+
+// Recorded depth at positions which are not a start of a reachable instruction
+constexpr size_t not_instruction = size_t(-2);
+constexpr size_t unreachable_instruction = size_t(-3);
+
+
+class BytecodeVerifier {
+public:
+    explicit BytecodeVerifier(const Function& fn)
+        : m_fn(fn), m_module(fn.module()), m_code(fn.bytecode()),
+          m_entry_depth(fn.raw_size_of_parameter() + fn.raw_size_of_nonlocals()),
+          m_ret_size(fn.effective_return_type().size()),
+          m_depth(m_entry_depth),
+          m_entry_depths(m_code.size(), not_instruction)
+    {}
+
+    void run() {
+        while (m_next != m_code.size()) {
+            m_pos = m_next;
+            enter_instruction();
+            m_entry_depths[m_pos] = m_reachable ? m_depth : unreachable_instruction;
+            instruction(static_cast<Opcode>(read_byte()));
+        }
+        m_pos = m_code.size();
+        if (!m_targets.empty())
+            fail("jump target is out of code");
+        if (m_reachable)
+            fail("reached end of code (missing RET)");
+    }
+
+private:
+    [[noreturn]] void fail(std::string_view reason) const {
+        throw bad_bytecode(m_fn.qualified_name(), m_pos, reason);
+    }
+
+    // Merge the stack depth from jumps which target this instruction
+    void enter_instruction() {
+        while (!m_targets.empty() && m_targets.begin()->first <= m_pos) {
+            const auto [target, depth] = *m_targets.begin();
+            m_targets.erase(m_targets.begin());
+            if (target != m_pos)
+                fail("jump target is not at instruction boundary");
+            merge(depth);
+        }
+    }
+
+    void merge(size_t depth) {
+        if (!m_reachable) {
+            m_depth = depth;
+            m_reachable = true;
+            return;
+        }
+        if (m_depth == unknown_depth || depth == unknown_depth) {
+            m_depth = unknown_depth;
+            return;
+        }
+        if (m_depth != depth)
+            fail("stack depth differs between branches");
+    }
+
+    void jump(size_t target) {
+        if (!m_reachable)
+            return;
+        auto [it, inserted] = m_targets.try_emplace(target, m_depth);
+        if (inserted)
+            return;
+        if (it->second == unknown_depth || m_depth == unknown_depth)
+            it->second = unknown_depth;
+        else if (it->second != m_depth)
+            fail("stack depth differs between branches");
+    }
+
+    // Backward jump - the target was already verified, with the depth recorded
+    void jump_back(size_t target) {
+        if (!m_reachable)
+            return;
+        const auto depth = m_entry_depths[target];
+        if (depth == not_instruction)
+            fail("jump target is not at instruction boundary");
+        if (depth == unreachable_instruction)
+            fail("jump target is unreachable");
+        if (depth != unknown_depth && m_depth != unknown_depth && depth != m_depth)
+            fail("stack depth differs between branches");
+    }
+
+    // ------------------------------------------------------------------------
+    // Operands
+
+    uint8_t read_byte() {
+        if (m_next >= m_code.size())
+            fail("operand is out of code");
+        return *(m_code.begin() + std::ptrdiff_t(m_next++));
+    }
+
+    // LEB128, same as leb128_decode in Machine, but checked
+    size_t read_leb() {
+        size_t result = 0;
+        unsigned shift = 0;
+        for (;;) {
+            const uint8_t b = read_byte();
+            if (shift >= sizeof(size_t) * 8 || (shift != 0 && (b & 0x7f) >> (sizeof(size_t) * 8 - shift) != 0))
+                fail("operand overflow");
+            result |= size_t(b & 0x7f) << shift;
+            if (b < 0x80)
+                return result;
+            shift += 7;
+        }
+    }
+
+    Index read_index() {
+        const auto idx = read_leb();
+        if (idx > no_index)
+            fail("index out of range");
+        return Index(idx);
+    }
+
+    const TypeInfo& read_type() {
+        const auto& ti = get_type_info(m_module.module_manager(), read_index());
+        if (ti.is_unknown())
+            fail("unknown type index");
+        return ti;
+    }
+
+    // Type operand of a tuple type with two items: (elem, result) etc.
+    const TypeInfo& read_pair_type() {
+        const auto& ti = read_type().underlying();
+        if (!ti.is_tuple() || ti.subtypes().size() < 2)
+            fail("type operand is not a pair");
+        return ti;
+    }
+
+    const TypeInfo& read_map_type() {
+        const auto& ti = read_type().underlying();
+        if (!ti.is_map())
+            fail("type operand is not a map");
+        return ti;
+    }
+
+    // 4-bit type number of Cast and arithmetic instructions
+    size_t arg_type_size(uint8_t arg) {
+        const auto type = decode_arg_type(arg);
+        if (type == Type::Unknown)
+            fail("unknown operand type");
+        return type_size_on_stack(type);
+    }
+
+    const Module& imported_module(size_t idx) {
+        if (idx >= m_module.num_imported_modules())
+            fail("imported module index out of range");
+        return m_module.get_imported_module(Index(idx));
+    }
+
+    const Function& function_in(const Module& module, size_t idx) {
+        if (idx >= module.num_functions())
+            fail("function index out of range");
+        return module.get_function(Index(idx));
+    }
+
+    // ------------------------------------------------------------------------
+    // Stack depth
+
+    void pull(size_t size) {
+        if (!m_reachable || m_depth == unknown_depth)
+            return;
+        if (size > m_depth)
+            fail("stack underflow");
+        m_depth -= size;
+    }
+
+    void push(size_t size) {
+        if (!m_reachable || m_depth == unknown_depth)
+            return;
+        m_depth += size;
+    }
+
+    // Offset + size relative to stack top must be inside the frame
+    void require(size_t offset, size_t size) {
+        if (!m_reachable || m_depth == unknown_depth)
+            return;
+        if (offset + size > m_depth)
+            fail("stack offset out of range");
+    }
+
+    void stop() { m_reachable = false; }
+
+    void call(const Function& callee, bool tail) {
+        if (!callee.is_bytecode() && !callee.is_assembly() && !callee.is_native())
+            fail("called function has no body");
+        if (tail && callee.is_native())
+            fail("tail call to native function");
+        const auto in = callee.raw_size_of_parameter() + callee.raw_size_of_nonlocals();
+        const auto out = callee.effective_return_type().size();
+        if (!tail) {
+            pull(in);
+            push(out);
+            return;
+        }
+        // the frame is replaced, only the callee's args may be left on stack
+        if (m_reachable && m_depth != unknown_depth && m_depth != in)
+            fail("stack depth mismatch at TAIL_CALL");
+        if (out != m_ret_size)
+            fail("tail call returns different size");
+        stop();
+    }
+
+    // ------------------------------------------------------------------------
+
+    void instruction(Opcode opcode) {
+        switch (opcode) {
+            case Opcode::Noop:
+                break;
+
+            case Opcode::LogicalNot:
+                pull(bool_size); push(bool_size);
+                break;
+            case Opcode::LogicalOr:
+            case Opcode::LogicalAnd:
+                pull(2 * bool_size); push(bool_size);
+                break;
+
+            case Opcode::BitwiseNot_8: case Opcode::BitwiseNot_16: case Opcode::BitwiseNot_32:
+            case Opcode::BitwiseNot_64: case Opcode::BitwiseNot_128: {
+                const size_t size = size_t(1) << (int(opcode) - int(Opcode::BitwiseNot_8));
+                pull(size); push(size);
+                break;
+            }
+            case Opcode::BitwiseOr_8: case Opcode::BitwiseOr_16: case Opcode::BitwiseOr_32:
+            case Opcode::BitwiseOr_64: case Opcode::BitwiseOr_128:
+            case Opcode::BitwiseAnd_8: case Opcode::BitwiseAnd_16: case Opcode::BitwiseAnd_32:
+            case Opcode::BitwiseAnd_64: case Opcode::BitwiseAnd_128:
+            case Opcode::BitwiseXor_8: case Opcode::BitwiseXor_16: case Opcode::BitwiseXor_32:
+            case Opcode::BitwiseXor_64: case Opcode::BitwiseXor_128: {
+                const size_t size = size_t(1) << ((int(opcode) - int(Opcode::BitwiseOr_8)) % 5);
+                pull(2 * size); push(size);
+                break;
+            }
+            case Opcode::ShiftLeft_8: case Opcode::ShiftLeft_16: case Opcode::ShiftLeft_32:
+            case Opcode::ShiftLeft_64: case Opcode::ShiftLeft_128:
+            case Opcode::ShiftRight_8: case Opcode::ShiftRight_16: case Opcode::ShiftRight_32:
+            case Opcode::ShiftRight_64: case Opcode::ShiftRight_128:
+            case Opcode::ShiftRightSE_8: case Opcode::ShiftRightSE_16: case Opcode::ShiftRightSE_32:
+            case Opcode::ShiftRightSE_64: case Opcode::ShiftRightSE_128: {
+                const size_t size = size_t(1) << ((int(opcode) - int(Opcode::ShiftLeft_8)) % 5);
+                pull(size + 1); push(size);  // shift amount is UInt8
+                break;
+            }
+
+            case Opcode::Execute:
+                pull(ptr_size);
+                if (m_reachable)
+                    m_depth = unknown_depth;
+                break;
+
+            case Opcode::Ret:
+                if (m_reachable && m_depth != unknown_depth && m_depth != m_ret_size)
+                    fail("stack depth at RET doesn't match return type");
+                stop();
+                break;
+
+            case Opcode::Cast: {
+                const auto arg = read_byte();
+                const auto from = arg_type_size(arg >> 4);
+                const auto to = arg_type_size(arg & 0xf);
+                pull(from); push(to);
+                break;
+            }
+
+            case Opcode::Equal: case Opcode::NotEqual:
+            case Opcode::LessEqual: case Opcode::GreaterEqual:
+            case Opcode::LessThan: case Opcode::GreaterThan: {
+                const auto arg = read_byte();
+                if (arg >> 4 != (arg & 0xf))
+                    fail("operand types differ");
+                pull(2 * arg_type_size(arg & 0xf)); push(bool_size);
+                break;
+            }
+
+            case Opcode::Neg: {
+                const auto size = arg_type_size(read_byte() & 0xf);
+                pull(size); push(size);
+                break;
+            }
+
+            case Opcode::Add: case Opcode::Sub: case Opcode::Mul:
+            case Opcode::Div: case Opcode::Mod: case Opcode::Exp:
+            case Opcode::UnsafeAdd: case Opcode::UnsafeSub: case Opcode::UnsafeMul:
+            case Opcode::UnsafeDiv: case Opcode::UnsafeMod: {
+                const auto arg = read_byte();
+                if (arg >> 4 != (arg & 0xf))
+                    fail("operand types differ");
+                const auto size = arg_type_size(arg & 0xf);
+                pull(2 * size); push(size);
+                break;
+            }
+
+            case Opcode::Jump: {
+                const auto skip = read_byte();
+                jump(m_next + skip);
+                stop();
+                break;
+            }
+            case Opcode::JumpIfNot: {
+                const auto skip = read_byte();
+                pull(bool_size);
+                jump(m_next + skip);
+                break;
+            }
+            case Opcode::JumpBack: {
+                const auto back = read_leb();
+                if (back > m_next)
+                    fail("jump target is out of code");
+                jump_back(m_next - back);
+                stop();
+                break;
+            }
+
+            case Opcode::LoadStatic: {
+                const auto idx = read_leb();
+                if (idx >= m_module.num_values())
+                    fail("static value index out of range");
+                push(m_module.get_value(Index(idx)).type_info().size());
+                break;
+            }
+            case Opcode::LoadModule: {
+                const auto idx = read_index();
+                if (idx != no_index)
+                    imported_module(idx);
+                push(ptr_size);
+                break;
+            }
+            case Opcode::LoadFunction:
+                function_in(m_module, read_leb());
+                push(ptr_size);
+                break;
+
+            case Opcode::Call0:
+            case Opcode::TailCall0:
+                call(function_in(m_module, read_leb()), opcode == Opcode::TailCall0);
+                break;
+            case Opcode::Call1:
+            case Opcode::TailCall1:
+                call(function_in(imported_module(0), read_leb()), opcode == Opcode::TailCall1);
+                break;
+            case Opcode::Call:
+            case Opcode::TailCall: {
+                const auto& module = imported_module(read_leb());
+                call(function_in(module, read_leb()), opcode == Opcode::TailCall);
+                break;
+            }
+            case Opcode::CallNative: {
+                const auto mod_ref = read_leb();
+                const auto& module = mod_ref == 0 ? m_module : imported_module(mod_ref - 1);
+                const auto& callee = function_in(module, read_leb());
+                if (!callee.is_native())
+                    fail("CALL_NATIVE to non-native function");
+                call(callee, false);
+                break;
+            }
+
+            case Opcode::MakeClosure: {
+                const auto& callee = function_in(m_module, read_leb());
+                pull(callee.raw_size_of_nonlocals());
+                push(ptr_size);
+                break;
+            }
+            case Opcode::MakeList: {
+                const auto num_elems = read_leb();
+                const auto elem_size = read_type().size();
+                if (elem_size != 0 && num_elems > unknown_depth / elem_size)
+                    fail("operand overflow");
+                pull(num_elems * elem_size);
+                push(ptr_size);
+                break;
+            }
+
+            case Opcode::SetBase:
+                // the base of a parent frame is not known, don't check COPY
+                if (read_leb() != 0)
+                    m_unknown_base = true;
+                break;
+
+            case Opcode::Copy: {
+                const auto offset = read_leb();
+                const auto size = read_leb();
+                if (size > unknown_depth - offset
+                || (!m_unknown_base && offset + size > m_entry_depth))
+                    fail("COPY out of frame");
+                push(size);
+                break;
+            }
+            case Opcode::Drop: {
+                const auto skip = read_leb();
+                const auto size = read_leb();
+                if (size > unknown_depth - skip)
+                    fail("operand overflow");
+                require(skip, size);
+                pull(size);
+                break;
+            }
+            case Opcode::Swap: {
+                const auto first = read_leb();
+                const auto second = read_leb();
+                if (second > unknown_depth - first)
+                    fail("operand overflow");
+                require(first, second);
+                break;
+            }
+
+            case Opcode::IncRef:
+            case Opcode::DecRef: {
+                const auto offset = read_leb();
+                if (offset > unknown_depth - ptr_size)
+                    fail("operand overflow");
+                require(offset, ptr_size);
+                break;
+            }
+
+            case Opcode::ListSubscript: {
+                const auto& elem_ti = read_type();
+                pull(ptr_size + int_size); push(elem_ti.size());
+                break;
+            }
+            case Opcode::ListLength:
+                read_type();
+                pull(ptr_size); push(uint_size);
+                break;
+            case Opcode::ListSlice:
+                read_type();
+                pull(ptr_size + 3 * int_size); push(ptr_size);
+                break;
+            case Opcode::ListConcat:
+            case Opcode::ListFilter:
+                read_type();
+                pull(2 * ptr_size); push(ptr_size);
+                break;
+            case Opcode::ListMap:
+                read_pair_type();
+                pull(2 * ptr_size); push(ptr_size);
+                break;
+            case Opcode::ListFold: {
+                const auto& acc_ti = read_pair_type().subtypes()[1];
+                pull(2 * ptr_size + acc_ti.size()); push(acc_ti.size());
+                break;
+            }
+            case Opcode::ListZip:
+                read_pair_type();
+                pull(2 * ptr_size); push(ptr_size);
+                break;
+
+            case Opcode::MapFromList:
+            case Opcode::MapItems:
+                read_map_type();
+                pull(ptr_size); push(ptr_size);
+                break;
+            case Opcode::MapLength:
+                read_map_type();
+                pull(ptr_size); push(uint_size);
+                break;
+            case Opcode::MapGet: {
+                const auto& map_ti = read_map_type();
+                const auto value_size = map_ti.map_value_type().size();
+                pull(ptr_size + map_ti.map_key_type().size() + value_size); push(value_size);
+                break;
+            }
+            case Opcode::MapContains: {
+                const auto& map_ti = read_map_type();
+                pull(ptr_size + map_ti.map_key_type().size()); push(bool_size);
+                break;
+            }
+            case Opcode::MapInsert: {
+                const auto& map_ti = read_map_type();
+                pull(ptr_size + map_ti.map_key_type().size() + map_ti.map_value_type().size());
+                push(ptr_size);
+                break;
+            }
+            case Opcode::MapRemove: {
+                const auto& map_ti = read_map_type();
+                pull(ptr_size + map_ti.map_key_type().size()); push(ptr_size);
+                break;
+            }
+
+            case Opcode::IterFromList:
+            case Opcode::IterCollect:
+                read_type();
+                pull(ptr_size); push(ptr_size);
+                break;
+            case Opcode::IterMap:
+                read_pair_type();
+                pull(2 * ptr_size); push(ptr_size);
+                break;
+            case Opcode::IterFilter:
+                read_type();
+                pull(2 * ptr_size); push(ptr_size);
+                break;
+            case Opcode::IterTake:
+                read_type();
+                pull(int_size + ptr_size); push(ptr_size);
+                break;
+            case Opcode::IterIterate: {
+                const auto& elem_ti = read_type();
+                pull(ptr_size + elem_ti.size()); push(ptr_size);
+                break;
+            }
+            case Opcode::IterFold: {
+                const auto& acc_ti = read_pair_type().subtypes()[1];
+                pull(2 * ptr_size + acc_ti.size()); push(acc_ti.size());
+                break;
+            }
+
+            case Opcode::Memo: {
+                const auto& types = read_pair_type();
+                pull(ptr_size + types.subtypes()[0].size()); push(types.subtypes()[1].size());
+                break;
+            }
+
+            case Opcode::Invoke:
+                pull(read_type().size());
+                break;
+
+            default:
+                // includes Annotation, which must not appear in bytecode
+                fail(fmt::format("bad opcode {}", int(opcode)));
+        }
+    }
+
+    const Function& m_fn;
+    const Module& m_module;
+    const Code& m_code;
+    const size_t m_entry_depth;  // parameter + nonlocals
+    const size_t m_ret_size;
+
+    size_t m_pos = 0;   // start of current instruction
+    size_t m_next = 0;  // read position
+    size_t m_depth;     // bytes on stack in this frame, including the args
+    bool m_reachable = true;
+    bool m_unknown_base = false;
+    std::map<size_t, size_t> m_targets;  // jump target -> stack depth
+    std::vector<size_t> m_entry_depths;  // code position -> stack depth at start of instruction
+};
+
+} // namespace
+
+
+void verify_bytecode(const Function& fn)
+{
+    BytecodeVerifier(fn).run();
+    fn.set_verified();
+}
+
+
+} // namespace xci::script
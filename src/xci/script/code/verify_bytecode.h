@@ -0,0 +1,39 @@
+// verify_bytecode.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_CODE_VERIFY_BYTECODE_H
+#define XCI_SCRIPT_CODE_VERIFY_BYTECODE_H
+
+#include <xci/script/Function.h>
+
+namespace xci::script {
+
+
+/// Verify the bytecode of a function before it's run by the Machine
+/// The function must be in bytecode form. Throws ScriptError (BadBytecode)
+/// if any of these checks fail:
+/// - each instruction has a valid opcode and its operands fit in the code
+/// - jump targets point to an instruction inside the function,
+///   backward jump (JUMP_BACK) only to a reachable one with the same stack depth
+/// - the code can't run past its end (last instruction is RET or TAIL_CALL)
+/// - indices of functions, modules, static values and types are valid,
+///   type operands of arithmetic instructions are known and match
+/// - stack depth is balanced: instructions don't pull more than was pushed,
+///   all paths merge with the same depth and RET leaves exactly
+///   the return value on stack
+///
+/// The stack depth can't be tracked after EXECUTE (the called closure
+/// is not known), the rest of such path is checked only for the other rules.
+///
+/// On success, the function is marked as verified (Function::is_verified)
+/// and the Machine runs it without the runtime checks.
+
+void verify_bytecode(const Function& fn);
+
+
+} // namespace xci::script
+
+#endif // include guard
@@ -133,6 +133,7 @@ public:
     void visit(const TypeName& v) override { m_os << v; }
     void visit(const FunctionType& v) override { m_os << v; }
     void visit(const ListType& v) override { m_os << v; }
+    void visit(const MapType& v) override { m_os << v; }
     void visit(const TupleType& v) override { m_os << v; }
     void visit(const StructType& v) override { m_os << v; }
 
@@ -366,7 +367,7 @@ std::ostream& operator<<(std::ostream& os, const FunctionType& v)
 std::ostream& operator<<(std::ostream& os, const ListType& v)
 {
     if (stream_options(os).enable_tree) {
-        os << "ListType(Type)" << endl;
+        os << (v.lazy ? "ListType(Type, lazy)" : "ListType(Type)") << endl;
         if (v.elem_type)
             os << more_indent << put_indent << *v.elem_type << less_indent;
         return os;
@@ -374,6 +375,28 @@ std::ostream& operator<<(std::ostream& os, const ListType& v)
         os << "[";
         if (v.elem_type)
             os << *v.elem_type;
+        if (v.lazy)
+            os << "..";
+        return os << "]";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const MapType& v)
+{
+    if (stream_options(os).enable_tree) {
+        os << "MapType(Type)" << endl << more_indent;
+        if (v.key_type)
+            os << put_indent << *v.key_type;
+        if (v.value_type)
+            os << put_indent << *v.value_type;
+        return os << less_indent;
+    } else {
+        os << "[";
+        if (v.key_type)
+            os << *v.key_type;
+        os << ": ";
+        if (v.value_type)
+            os << *v.value_type;
         return os << "]";
     }
 }
@@ -861,6 +884,9 @@ static void dump_l1_instruction(std::ostream& os, Opcode opcode, size_t arg, con
 {
     os << arg;
     switch (opcode) {
+        case Opcode::JumpBack:
+            os << fmt::format(" (-{})", arg);
+            break;
         case Opcode::LoadStatic: {
             const auto& value = mod.get_value(Index(arg));
             os << " (" << value << ':' << value.type_info() << ")";
@@ -884,6 +910,25 @@ static void dump_l1_instruction(std::ostream& os, Opcode opcode, size_t arg, con
         case Opcode::ListLength:
         case Opcode::ListSlice:
         case Opcode::ListConcat:
+        case Opcode::ListMap:
+        case Opcode::ListFilter:
+        case Opcode::ListFold:
+        case Opcode::ListZip:
+        case Opcode::MapFromList:
+        case Opcode::MapLength:
+        case Opcode::MapGet:
+        case Opcode::MapContains:
+        case Opcode::MapInsert:
+        case Opcode::MapRemove:
+        case Opcode::MapItems:
+        case Opcode::IterFromList:
+        case Opcode::IterMap:
+        case Opcode::IterFilter:
+        case Opcode::IterTake:
+        case Opcode::IterIterate:
+        case Opcode::IterFold:
+        case Opcode::IterCollect:
+        case Opcode::Memo:
         case Opcode::Invoke: {
             const TypeInfo& ti = get_type_info(mod.module_manager(), Index(arg));
             fmt::print(os, " ({})", ti);
@@ -904,6 +949,12 @@ static void dump_l2_instruction(std::ostream& os, Opcode opcode, size_t arg1, si
             fmt::print(os, " ({} {})", fn.symtab().name(), fn.signature());
             break;
         }
+        case Opcode::CallNative: {
+            const Module& fn_mod = arg1 == 0 ? mod : mod.get_imported_module(Index(arg1 - 1));
+            const auto& fn = fn_mod.get_function(Module::FunctionIdx(arg2));
+            fmt::print(os, " ({} {})", fn.symtab().name(), fn.signature());
+            break;
+        }
         case Opcode::MakeList: {
             const TypeInfo& ti = get_type_info(mod.module_manager(), Index(arg2));
             fmt::print(os, " ({})", ti);
@@ -925,6 +976,7 @@ std::ostream& operator<<(std::ostream& os, DumpInstruction&& v)
                 return os;
             case CodeAssembly::Annotation::Jump:
             case CodeAssembly::Annotation::JumpIfNot:
+            case CodeAssembly::Annotation::JumpBack:
                 fmt::print(os, "     {:<20}.j{}", Opcode(v.instr.args.first), v.instr.args.second);
                 return os;
         }
@@ -1127,6 +1179,10 @@ std::ostream& operator<<(std::ostream& os, const TypeInfo& v)
         case Type::String:      return os << "String";
         case Type::List:
             return os << "[" << v.elem_type() << "]";
+        case Type::Map:
+            return os << "[" << v.map_key_type() << ": " << v.map_value_type() << "]";
+        case Type::Iterator:
+            return os << "[" << v.elem_type() << "..]";
         case Type::Tuple:
         case Type::Struct: {
             os << "(";
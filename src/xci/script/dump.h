@@ -39,6 +39,7 @@ std::ostream& operator<<(std::ostream& os, const Type& v);
 std::ostream& operator<<(std::ostream& os, const TypeName& v);
 std::ostream& operator<<(std::ostream& os, const FunctionType& v);
 std::ostream& operator<<(std::ostream& os, const ListType& v);
+std::ostream& operator<<(std::ostream& os, const MapType& v);
 std::ostream& operator<<(std::ostream& os, const TupleType& v);
 std::ostream& operator<<(std::ostream& os, const StructType& v);
 std::ostream& operator<<(std::ostream& os, const TypeConstraint& v);
@@ -0,0 +1,993 @@
+// Jit.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "Jit.h"
+#include <xci/script/Function.h>
+#include <xci/script/Module.h>
+#include <xci/script/Stack.h>
+#include <xci/script/Error.h>
+#include <xci/data/coding/leb128.h>
+#include <xci/compat/macros.h>
+#include <xci/config.h>
+
+#include <algorithm>
+#include <exception>
+#include <map>
+#include <cassert>
+#include <cstddef>
+
+#if defined(XCI_SCRIPT_JIT) && defined(__x86_64__) && !defined(_WIN32)
+#   define XCI_SCRIPT_JIT_X86_64 1
+#   include "x86_64.h"
+#   include <sys/mman.h>
+#endif
+
+namespace xci::script::jit {
+
+using xci::data::leb128_decode;
+
+
+#ifndef XCI_SCRIPT_JIT_X86_64
+
+bool is_available() { return false; }
+
+class CompiledFunction {};
+
+std::shared_ptr<const CompiledFunction> compile(const Function&) { return {}; }
+
+void run(const CompiledFunction&, Runtime&)
+{
+    throw not_implemented("JIT");
+}
+
+#else
+
+using namespace x86_64;
+
+
+// -----------------------------------------------------------------------------
+// Interface between compiled code and the runtime
+
+// Exit status of compiled code. Errors are combined with site index: (site << 8) | status
+enum Status : uint32_t {
+    Ok = 0,
+    Exception = 1,          // the callee has thrown, the exception is stored in Context
+    IntegerOverflow = 2,
+    DivisionByZero = 3,
+};
+
+// Registers saved in memory - accessed by compiled code by fixed offsets
+struct Registers {
+    std::byte* sp;      // top of the stack (RBX)
+    std::byte* base;    // frame base (R12)
+    uint32_t (*call)(Registers* regs, uint32_t site);
+    void* ctx;          // Context
+    std::byte scratch[64];  // temporary space for SWAP
+};
+
+constexpr int32_t c_regs_sp = offsetof(Registers, sp);
+constexpr int32_t c_regs_base = offsetof(Registers, base);
+constexpr int32_t c_regs_call = offsetof(Registers, call);
+constexpr int32_t c_regs_scratch = offsetof(Registers, scratch);
+constexpr size_t c_scratch_size = sizeof(Registers::scratch);
+
+// Register allocation in compiled code (all callee-saved)
+constexpr Reg c_sp = Reg::RBX;
+constexpr Reg c_base = Reg::R12;
+constexpr Reg c_regs = Reg::R14;
+
+
+// A place in compiled code which leaves into the runtime (call or error)
+struct Site {
+    const Function* callee = nullptr;   // null for error exit
+    std::vector<Type> types;            // values on stack at the site, bottom to top, starting with parameters
+};
+
+
+class CompiledFunction {
+public:
+    using Entry = uint32_t (*)(Registers* regs);
+
+    explicit CompiledFunction(const std::vector<uint8_t>& code) : m_size(code.size()) {
+        m_mem = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m_mem == MAP_FAILED) {
+            m_mem = nullptr;
+            return;
+        }
+        std::memcpy(m_mem, code.data(), m_size);
+        if (mprotect(m_mem, m_size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(m_mem, m_size);
+            m_mem = nullptr;
+        }
+    }
+    ~CompiledFunction() {
+        if (m_mem)
+            munmap(m_mem, m_size);
+    }
+    CompiledFunction(const CompiledFunction&) = delete;
+    CompiledFunction& operator=(const CompiledFunction&) = delete;
+
+    explicit operator bool() const { return m_mem != nullptr; }
+    Entry entry() const { return reinterpret_cast<Entry>(m_mem); }
+
+    std::vector<Type> param_types;      // flattened parameter, bottom to top
+    std::vector<Type> return_types;     // flattened return value
+    std::vector<Site> sites;
+    size_t max_stack = 0;               // stack space needed above parameters
+
+private:
+    void* m_mem = nullptr;
+    size_t m_size;
+};
+
+
+// -----------------------------------------------------------------------------
+// Compiler
+
+namespace {
+
+bool is_int(Type t)
+{
+    switch (t) {
+        case Type::UInt8: case Type::UInt16: case Type::UInt32: case Type::UInt64:
+        case Type::Int8: case Type::Int16: case Type::Int32: case Type::Int64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_signed(Type t)
+{
+    return t == Type::Int8 || t == Type::Int16 || t == Type::Int32 || t == Type::Int64;
+}
+
+bool is_float(Type t) { return t == Type::Float32 || t == Type::Float64; }
+
+bool is_simple(Type t) { return t == Type::Bool || t == Type::Char || is_int(t) || is_float(t); }
+
+
+// Flatten a type to simple types as they lay on stack (bottom to top)
+bool flatten(const TypeInfo& type_info, std::vector<Type>& out)
+{
+    const auto& ti = type_info.underlying();
+    if (ti.is_struct_or_tuple()) {
+        const auto& subtypes = ti.subtypes();
+        for (size_t i = subtypes.size(); i != 0; --i)
+            if (!flatten(subtypes[i - 1], out))
+                return false;
+        return true;
+    }
+    if (!is_simple(ti.type()))
+        return false;
+    out.push_back(ti.type());
+    return true;
+}
+
+
+size_t size_of(const std::vector<Type>& types)
+{
+    size_t size = 0;
+    for (Type t : types)
+        size += type_size_on_stack(t);
+    return size;
+}
+
+
+// Same layout on stack - allow casts, like the interpreter
+bool same_layout(const std::vector<Type>& a, const std::vector<Type>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](Type x, Type y) {
+        return type_size_on_stack(x) == type_size_on_stack(y);
+    });
+}
+
+
+struct Instruction {
+    Opcode opcode;
+    size_t arg1 = 0;
+    size_t arg2 = 0;
+};
+
+Instruction decode(Code::const_iterator& it)
+{
+    Instruction instr {static_cast<Opcode>(*it++)};
+    if (instr.opcode >= Opcode::B1First && instr.opcode <= Opcode::B1Last) {
+        instr.arg1 = *it++;
+    } else if (instr.opcode >= Opcode::L1First && instr.opcode <= Opcode::L1Last) {
+        instr.arg1 = leb128_decode<size_t>(it);
+    } else if (instr.opcode >= Opcode::L2First && instr.opcode <= Opcode::L2Last) {
+        instr.arg1 = leb128_decode<size_t>(it);
+        instr.arg2 = leb128_decode<size_t>(it);
+    }
+    return instr;
+}
+
+
+const Function* call_target(const Function& fn, const Instruction& instr)
+{
+    switch (instr.opcode) {
+        case Opcode::Call0:
+        case Opcode::TailCall0:
+            return &fn.module().get_function(Index(instr.arg1));
+        case Opcode::Call1:
+        case Opcode::TailCall1:
+            return &fn.module().get_imported_module(0).get_function(Index(instr.arg1));
+        case Opcode::Call:
+        case Opcode::TailCall:
+            return &fn.module().get_imported_module(Index(instr.arg1)).get_function(Index(instr.arg2));
+        case Opcode::CallNative: {
+            const Module& mod = instr.arg1 == 0 ? fn.module() : fn.module().get_imported_module(Index(instr.arg1 - 1));
+            return &mod.get_function(Index(instr.arg2));
+        }
+        default:
+            return nullptr;
+    }
+}
+
+
+class Compiler {
+public:
+    explicit Compiler(const Function& fn) : m_fn(fn) {}
+
+    std::shared_ptr<const CompiledFunction> compile();
+
+private:
+    bool compile_body();
+    bool compile_instruction(const Instruction& instr, Code::const_iterator next);
+    bool compile_op(const Instruction& instr);
+    bool compile_arith(Opcode opcode, Type type);
+    bool compile_call(const Function& callee);
+    bool inline_call(const Function& callee);
+    bool emit_call(const Function& callee);
+    bool compile_load_static(const TypedValue& tv);
+
+    // Stack model
+    void push(Type t) {
+        m_types.push_back(t);
+        m_bytes += type_size_on_stack(t);
+        m_max_bytes = std::max(m_max_bytes, m_bytes);
+    }
+    void push(const std::vector<Type>& types) { for (Type t : types) push(t); }
+    // Remove exactly `size` bytes from top, the range must be aligned to values
+    bool take(size_t size, std::vector<Type>* out = nullptr);
+    // Check that top of stack contains `n` values of same size as `t`
+    bool check_top(Type t, size_t n) const;
+
+    // Machine code helpers
+    void move(Mem dst, Mem src, size_t size, bool backwards = false);
+    void error_exit(Cond cc, Status status);
+    void exit_ok() { m_asm.zero(Reg::RAX); m_epilogue_jumps.push_back(m_asm.jmp()); }
+
+    const Function& m_fn;
+    Assembler m_asm;
+    std::vector<Type> m_types;  // values on stack, bottom to top
+    size_t m_bytes = 0;         // size of m_types
+    size_t m_max_bytes = 0;
+    size_t m_param_bytes = 0;
+    std::vector<Type> m_param_types;
+    std::vector<Type> m_return_types;
+    std::vector<Site> m_sites;
+    Assembler::Label m_body = 0;
+    std::vector<size_t> m_epilogue_jumps;   // operands of jumps to the epilogue
+    struct ErrorExit { size_t operand; uint32_t status; };
+    std::vector<ErrorExit> m_error_exits;
+    bool m_reachable = true;
+    // forward jumps: target bytecode offset -> operands to patch, stack model at the target
+    struct PendingJump { std::vector<size_t> operands; std::vector<Type> types; };
+    std::map<size_t, PendingJump> m_jumps;
+};
+
+
+std::shared_ptr<const CompiledFunction> Compiler::compile()
+{
+    if (!m_fn.is_bytecode() || m_fn.has_nonlocals() || m_fn.has_any_generic())
+        return {};
+    if (!flatten(m_fn.parameter(), m_param_types)
+    ||  !flatten(m_fn.effective_return_type(), m_return_types))
+        return {};
+
+    // Prologue: RBX = sp, R12 = base, R14 = regs
+    m_asm.push(Reg::RBP);
+    m_asm.mov(Reg::RBP, Reg::RSP);
+    m_asm.push(c_sp);
+    m_asm.push(c_base);
+    m_asm.push(c_regs);
+    m_asm.push(Reg::R15);  // keep the stack aligned for calls
+    m_asm.mov(c_regs, Reg::RDI);
+    m_asm.load(c_sp, {c_regs, c_regs_sp}, 8);
+    m_asm.load(c_base, {c_regs, c_regs_base}, 8);
+
+    push(m_param_types);
+    m_param_bytes = m_bytes;
+    m_body = m_asm.here();
+    if (!compile_body())
+        return {};
+
+    // Error exits: EAX = (site << 8) | status
+    for (const auto& e : m_error_exits) {
+        m_asm.patch(e.operand, m_asm.here());
+        m_asm.mov32(Reg::RAX, e.status);
+        m_epilogue_jumps.push_back(m_asm.jmp());
+    }
+
+    // Epilogue: save the stack pointer, return EAX
+    for (auto operand : m_epilogue_jumps)
+        m_asm.patch(operand, m_asm.here());
+    m_asm.store({c_regs, c_regs_sp}, c_sp, 8);
+    m_asm.pop(Reg::R15);
+    m_asm.pop(c_regs);
+    m_asm.pop(c_base);
+    m_asm.pop(c_sp);
+    m_asm.pop(Reg::RBP);
+    m_asm.ret();
+
+    auto res = std::make_shared<CompiledFunction>(m_asm.code());
+    if (!*res)
+        return {};
+    res->param_types = std::move(m_param_types);
+    res->return_types = std::move(m_return_types);
+    res->sites = std::move(m_sites);
+    res->max_stack = m_max_bytes - m_param_bytes;
+    return res;
+}
+
+
+bool Compiler::compile_body()
+{
+    const auto& code = m_fn.bytecode();
+    for (auto it = code.begin(); it != code.end();) {
+        const auto offset = size_t(it - code.begin());
+        const auto instr = decode(it);
+
+        // resolve forward jumps to this instruction
+        if (auto jit = m_jumps.find(offset); jit != m_jumps.end()) {
+            if (m_reachable) {
+                if (!same_layout(m_types, jit->second.types))
+                    return false;
+            } else {
+                m_types.clear();
+                m_bytes = 0;
+                push(jit->second.types);
+                m_reachable = true;
+            }
+            for (auto operand : jit->second.operands)
+                m_asm.patch(operand, m_asm.here());
+            m_jumps.erase(jit);
+        }
+        if (!m_reachable)
+            continue;  // dead code
+
+        if (!compile_instruction(instr, it))
+            return false;
+    }
+    return m_jumps.empty() && !m_reachable;
+}
+
+
+bool Compiler::compile_instruction(const Instruction& instr, Code::const_iterator next)
+{
+    const auto& code = m_fn.bytecode();
+    switch (instr.opcode) {
+        case Opcode::Ret:
+            if (!same_layout(m_types, m_return_types))
+                return false;
+            exit_ok();
+            m_reachable = false;
+            return true;
+
+        case Opcode::Jump:
+        case Opcode::JumpIfNot: {
+            if (instr.opcode == Opcode::JumpIfNot) {
+                if (!check_top(Type::Bool, 1))
+                    return false;
+                take(1);
+                m_asm.load(Reg::RAX, {c_sp}, 1);
+                m_asm.add(c_sp, 1);
+                m_asm.test(Reg::RAX, 1);
+            }
+            const auto target = size_t(next - code.begin()) + instr.arg1;
+            auto& pending = m_jumps[target];
+            if (pending.operands.empty())
+                pending.types = m_types;
+            else if (!same_layout(m_types, pending.types))
+                return false;
+            if (instr.opcode == Opcode::Jump) {
+                pending.operands.push_back(m_asm.jmp());
+                m_reachable = false;
+            } else {
+                pending.operands.push_back(m_asm.jcc(Cond::E));
+            }
+            return true;
+        }
+
+        case Opcode::JumpBack: {
+            // only the loop from self tail call - the arguments replace the parameters
+            if (size_t(next - code.begin()) != instr.arg1 || !same_layout(m_types, m_param_types))
+                return false;
+            m_asm.mov(c_base, c_sp);
+            m_asm.jmp(m_body);
+            m_reachable = false;
+            return true;
+        }
+
+        case Opcode::LoadStatic:
+            return compile_load_static(m_fn.module().get_value(Index(instr.arg1)));
+
+        case Opcode::Copy: {
+            // copy from parameters: arg1 = offset from base, arg2 = size
+            const auto size = instr.arg2;
+            if (instr.arg1 + size > m_param_bytes || size == 0)
+                return false;
+            // find the values in stack model
+            const auto first = m_param_bytes - instr.arg1 - size;
+            std::vector<Type> copies;
+            size_t pos = 0;
+            for (Type t : m_types) {
+                if (pos >= first + size)
+                    break;
+                if (pos >= first)
+                    copies.push_back(t);
+                else if (pos + type_size_on_stack(t) > first)
+                    return false;  // not aligned
+                pos += type_size_on_stack(t);
+            }
+            if (size_of(copies) != size)
+                return false;
+            m_asm.sub(c_sp, int32_t(size));
+            move({c_sp, 0}, {c_base, int32_t(instr.arg1)}, size);
+            push(copies);
+            return true;
+        }
+
+        case Opcode::Drop: {
+            // skip top arg1 bytes, remove arg2 bytes
+            std::vector<Type> kept;
+            if (!take(instr.arg1, &kept) || !take(instr.arg2))
+                return false;
+            push(kept);
+            move({c_sp, int32_t(instr.arg2)}, {c_sp, 0}, instr.arg1, true);
+            m_asm.add(c_sp, int32_t(instr.arg2));
+            return true;
+        }
+
+        case Opcode::Swap: {
+            // swap top arg1 bytes with following arg2 bytes
+            const auto first = instr.arg1;
+            const auto second = instr.arg2;
+            if (second > c_scratch_size)
+                return false;
+            std::vector<Type> a, b;
+            if (!take(first, &a) || !take(second, &b))
+                return false;
+            push(a);
+            push(b);
+            move({c_regs, c_regs_scratch}, {c_sp, int32_t(first)}, second);
+            move({c_sp, int32_t(second)}, {c_sp, 0}, first, true);
+            move({c_sp, 0}, {c_regs, c_regs_scratch}, second);
+            return true;
+        }
+
+        case Opcode::Call0:
+        case Opcode::Call1:
+        case Opcode::Call:
+        case Opcode::CallNative:
+            return compile_call(*call_target(m_fn, instr));
+
+        case Opcode::TailCall0:
+        case Opcode::TailCall1:
+        case Opcode::TailCall: {
+            const Function& callee = *call_target(m_fn, instr);
+            if (&callee == &m_fn) {
+                // self tail call - the arguments replace the parameters, jump to the start
+                if (!same_layout(m_types, m_param_types))
+                    return false;
+                m_asm.mov(c_base, c_sp);
+                m_asm.jmp(m_body);
+                m_reachable = false;
+                return true;
+            }
+            // other functions: CALL + RET
+            if (!compile_call(callee) || !same_layout(m_types, m_return_types))
+                return false;
+            exit_ok();
+            m_reachable = false;
+            return true;
+        }
+
+        default:
+            return compile_op(instr);
+    }
+}
+
+
+// Simple operations on top of the stack (these can be inlined from intrinsic functions)
+bool Compiler::compile_op(const Instruction& instr)
+{
+    switch (instr.opcode) {
+        case Opcode::Noop:
+            return true;
+
+        case Opcode::LogicalNot:
+            if (!check_top(Type::Bool, 1))
+                return false;
+            m_asm.xor8({c_sp}, 1);
+            return true;
+
+        case Opcode::BitwiseNot_8:
+        case Opcode::BitwiseNot_32:
+        case Opcode::BitwiseNot_64: {
+            const Type t = instr.opcode == Opcode::BitwiseNot_8 ? Type::UInt8 :
+                           instr.opcode == Opcode::BitwiseNot_32 ? Type::UInt32 : Type::UInt64;
+            if (!check_top(t, 1))
+                return false;
+            if (t == Type::UInt8)
+                m_asm.xor8({c_sp}, 0xFF);
+            else
+                m_asm.not_({c_sp}, unsigned(type_size_on_stack(t)));
+            return true;
+        }
+
+        case Opcode::BitwiseOr_8:
+        case Opcode::BitwiseOr_32:
+        case Opcode::BitwiseOr_64:
+        case Opcode::BitwiseAnd_8:
+        case Opcode::BitwiseAnd_32:
+        case Opcode::BitwiseAnd_64:
+        case Opcode::BitwiseXor_8:
+        case Opcode::BitwiseXor_32:
+        case Opcode::BitwiseXor_64: {
+            // the opcodes are ordered by size: _8, _16, _32, _64, _128
+            static_assert(int(Opcode::BitwiseOr_32) - int(Opcode::BitwiseOr_8) == 2);
+            const Opcode base = instr.opcode < Opcode::BitwiseAnd_8 ? Opcode::BitwiseOr_8 :
+                                instr.opcode < Opcode::BitwiseXor_8 ? Opcode::BitwiseAnd_8 :
+                                Opcode::BitwiseXor_8;
+            const Alu op = base == Opcode::BitwiseOr_8 ? Alu::Or :
+                           base == Opcode::BitwiseAnd_8 ? Alu::And : Alu::Xor;
+            const auto n = int(instr.opcode) - int(base);
+            const Type t = n == 0 ? Type::UInt8 : n == 2 ? Type::UInt32 : Type::UInt64;
+            const auto size = unsigned(type_size_on_stack(t));
+            if (!check_top(t, 2))
+                return false;
+            take(size);
+            m_asm.load(Reg::RAX, {c_sp}, size);
+            m_asm.alu(op, Reg::RAX, {c_sp, int32_t(size)}, size);
+            m_asm.add(c_sp, int32_t(size));
+            m_asm.store({c_sp}, Reg::RAX, size);
+            return true;
+        }
+
+        case Opcode::Neg: {
+            const Type t = decode_arg_type(instr.arg1 & 0xf);
+            const auto size = unsigned(type_size_on_stack(t));
+            if (!check_top(t, 1))
+                return false;
+            if (is_float(t)) {
+                m_asm.xor8({c_sp, int32_t(size - 1)}, 0x80);  // flip sign bit
+                return true;
+            }
+            if (!is_signed(t) || size < 4)
+                return false;
+            m_asm.neg({c_sp}, size);
+            return true;
+        }
+
+        case Opcode::Equal:
+        case Opcode::NotEqual:
+        case Opcode::LessEqual:
+        case Opcode::GreaterEqual:
+        case Opcode::LessThan:
+        case Opcode::GreaterThan:
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod:
+        case Opcode::UnsafeAdd:
+        case Opcode::UnsafeSub:
+        case Opcode::UnsafeMul:
+        case Opcode::UnsafeDiv:
+        case Opcode::UnsafeMod: {
+            const Type lhs = decode_arg_type(instr.arg1 >> 4);
+            const Type rhs = decode_arg_type(instr.arg1 & 0xf);
+            if (lhs != rhs || !check_top(lhs, 2))
+                return false;
+            return compile_arith(instr.opcode, lhs);
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+// Binary operation: lhs on top, rhs below it, both of `type`
+bool Compiler::compile_arith(Opcode opcode, Type type)
+{
+    const auto size = unsigned(type_size_on_stack(type));
+    const Mem lhs {c_sp, 0};
+    const Mem rhs {c_sp, int32_t(size)};
+    const bool is_cmp = opcode <= Opcode::GreaterThan;
+    const bool is_signed_type = is_signed(type);
+
+    if (is_float(type)) {
+        if (is_cmp) {
+            // `a < b` is computed as `b > a` - unordered (NaN) gives false for all of these
+            Cond cc;
+            bool swap;
+            switch (opcode) {
+                case Opcode::LessThan:      cc = Cond::A; swap = true; break;
+                case Opcode::LessEqual:     cc = Cond::AE; swap = true; break;
+                case Opcode::GreaterThan:   cc = Cond::A; swap = false; break;
+                case Opcode::GreaterEqual:  cc = Cond::AE; swap = false; break;
+                default: return false;  // Equal / NotEqual would need to check parity for NaN
+            }
+            m_asm.sse_load(0, swap ? rhs : lhs, size);
+            m_asm.ucomis(0, swap ? lhs : rhs, size);
+            m_asm.setcc(cc, Reg::RAX);
+            take(2 * size);
+            push(Type::Bool);
+            m_asm.add(c_sp, int32_t(2 * size - 1));
+            m_asm.store({c_sp}, Reg::RAX, 1);
+            return true;
+        }
+        Sse op;
+        switch (opcode) {
+            case Opcode::Add: case Opcode::UnsafeAdd: op = Sse::Add; break;
+            case Opcode::Sub: case Opcode::UnsafeSub: op = Sse::Sub; break;
+            case Opcode::Mul: case Opcode::UnsafeMul: op = Sse::Mul; break;
+            case Opcode::Div: case Opcode::UnsafeDiv: op = Sse::Div; break;
+            default: return false;
+        }
+        m_asm.sse_load(0, lhs, size);
+        m_asm.sse(op, 0, rhs, size);
+        take(size);
+        m_asm.add(c_sp, int32_t(size));
+        m_asm.sse_store({c_sp}, 0, size);
+        return true;
+    }
+
+    if (!is_int(type))
+        return false;
+
+    if (is_cmp) {
+        Cond cc;
+        switch (opcode) {
+            case Opcode::Equal:         cc = Cond::E; break;
+            case Opcode::NotEqual:      cc = Cond::NE; break;
+            case Opcode::LessThan:      cc = is_signed_type ? Cond::L : Cond::B; break;
+            case Opcode::LessEqual:     cc = is_signed_type ? Cond::LE : Cond::BE; break;
+            case Opcode::GreaterThan:   cc = is_signed_type ? Cond::G : Cond::A; break;
+            case Opcode::GreaterEqual:  cc = is_signed_type ? Cond::GE : Cond::AE; break;
+            default: XCI_UNREACHABLE;
+        }
+        m_asm.load(Reg::RAX, lhs, size);
+        m_asm.alu(Alu::Cmp, Reg::RAX, rhs, size);
+        m_asm.setcc(cc, Reg::RAX);
+        take(2 * size);
+        push(Type::Bool);
+        m_asm.add(c_sp, int32_t(2 * size - 1));
+        m_asm.store({c_sp}, Reg::RAX, 1);
+        return true;
+    }
+
+    const bool checked = opcode < Opcode::UnsafeAdd;
+    const Cond overflow = is_signed_type ? Cond::O : Cond::B;
+    Reg result = Reg::RAX;
+    switch (opcode) {
+        case Opcode::Add:
+        case Opcode::UnsafeAdd:
+        case Opcode::Sub:
+        case Opcode::UnsafeSub: {
+            const bool add = opcode == Opcode::Add || opcode == Opcode::UnsafeAdd;
+            m_asm.load(Reg::RAX, lhs, size);
+            m_asm.alu(add ? Alu::Add : Alu::Sub, Reg::RAX, rhs, size);
+            if (checked)
+                error_exit(overflow, IntegerOverflow);
+            break;
+        }
+        case Opcode::Mul:
+        case Opcode::UnsafeMul:
+            if (size < 4)
+                return false;
+            m_asm.load(Reg::RAX, lhs, size);
+            if (is_signed_type) {
+                m_asm.imul(Reg::RAX, rhs, size);
+            } else {
+                m_asm.load(Reg::RCX, rhs, size);
+                m_asm.mul(Reg::RCX, size);
+            }
+            if (checked)
+                error_exit(Cond::O, IntegerOverflow);
+            break;
+        case Opcode::Div:
+        case Opcode::UnsafeDiv:
+        case Opcode::Mod:
+        case Opcode::UnsafeMod:
+            if (size < 4)
+                return false;
+            m_asm.load(Reg::RCX, rhs, size);
+            if (checked) {
+                m_asm.test(Reg::RCX, size);
+                error_exit(Cond::E, DivisionByZero);
+            }
+            m_asm.load(Reg::RAX, lhs, size);
+            if (is_signed_type) {
+                const bool mod = opcode == Opcode::Mod;
+                size_t skip_div = 0;
+                if (checked) {
+                    // MIN / -1 overflows (IDIV would trap), MIN % -1 is zero (see builtin::div, mod)
+                    m_asm.mov(Reg::RDX, ~uint64_t(0));
+                    m_asm.alu(Alu::Cmp, Reg::RDX, rhs, size);
+                    const auto not_minus_one = m_asm.jcc(Cond::NE);
+                    if (mod) {
+                        m_asm.zero(Reg::RDX);
+                        skip_div = m_asm.jmp();
+                    } else {
+                        m_asm.mov(Reg::RDX, uint64_t(1) << (size * 8 - 1));
+                        m_asm.alu(Alu::Cmp, Reg::RDX, lhs, size);
+                        error_exit(Cond::E, IntegerOverflow);
+                    }
+                    m_asm.patch(not_minus_one, m_asm.here());
+                }
+                m_asm.sign_extend_rdx(size);
+                m_asm.idiv(Reg::RCX, size);
+                if (skip_div != 0)
+                    m_asm.patch(skip_div, m_asm.here());
+            } else {
+                m_asm.zero(Reg::RDX);
+                m_asm.div(Reg::RCX, size);
+            }
+            if (opcode == Opcode::Mod || opcode == Opcode::UnsafeMod)
+                result = Reg::RDX;
+            break;
+        default:
+            return false;  // Exp
+    }
+    take(size);
+    m_asm.add(c_sp, int32_t(size));
+    m_asm.store({c_sp}, result, size);
+    return true;
+}
+
+
+bool Compiler::compile_load_static(const TypedValue& tv)
+{
+    const Type t = tv.value().type();
+    if (!is_simple(t))
+        return false;
+    const auto size = unsigned(type_size_on_stack(t));
+    uint64_t imm = 0;
+    tv.value().write(reinterpret_cast<std::byte*>(&imm));
+    m_asm.sub(c_sp, int32_t(size));
+    if (size == 8)
+        m_asm.mov(Reg::RAX, imm);
+    else
+        m_asm.mov32(Reg::RAX, uint32_t(imm));
+    m_asm.store({c_sp}, Reg::RAX, size);
+    push(t);
+    return true;
+}
+
+
+bool Compiler::compile_call(const Function& callee)
+{
+    if (callee.has_nonlocals() || (!callee.is_native() && !callee.is_bytecode()))
+        return false;
+    return inline_call(callee) || emit_call(callee);
+}
+
+
+// Inline intrinsic function - simple operations followed by RET
+bool Compiler::inline_call(const Function& callee)
+{
+    if (!callee.is_bytecode() || callee.has_nonlocals() || &callee == &m_fn)
+        return false;
+    std::vector<Type> params, ret;
+    if (!flatten(callee.parameter(), params) || !flatten(callee.effective_return_type(), ret))
+        return false;
+    if (m_bytes < size_of(params))
+        return false;
+
+    // try to compile the ops, roll back on failure
+    const auto code_size = m_asm.size();
+    const auto saved_types = m_types;
+    const auto saved_bytes = m_bytes;
+    const auto saved_exits = m_error_exits.size();
+    const auto saved_sites = m_sites.size();
+    auto rollback = [&] {
+        m_asm.truncate(code_size);
+        m_types = saved_types;
+        m_bytes = saved_bytes;
+        m_error_exits.resize(saved_exits);
+        m_sites.resize(saved_sites);
+        return false;
+    };
+
+    const auto& code = callee.bytecode();
+    for (auto it = code.begin(); it != code.end();) {
+        const auto instr = decode(it);
+        if (instr.opcode == Opcode::Ret) {
+            if (it != code.end())
+                return rollback();
+            break;
+        }
+        if (it == code.end() || !compile_op(instr))
+            return rollback();
+    }
+
+    // check the result against the callee signature
+    const std::vector<Type> top(m_types.end() - std::min(ret.size(), m_types.size()), m_types.end());
+    if (m_bytes + size_of(params) != saved_bytes + size_of(ret) || !same_layout(top, ret))
+        return rollback();
+    return true;
+}
+
+
+// Call into runtime - RBX and R12 are saved/restored via Registers
+bool Compiler::emit_call(const Function& callee)
+{
+    std::vector<Type> params, ret;
+    if (!flatten(callee.parameter(), params) || !flatten(callee.effective_return_type(), ret))
+        return false;
+    const auto site = uint32_t(m_sites.size());
+    m_sites.push_back({&callee, m_types});
+    if (!take(size_of(params)))
+        return false;
+    push(ret);
+
+    m_asm.store({c_regs, c_regs_sp}, c_sp, 8);
+    m_asm.store({c_regs, c_regs_base}, c_base, 8);
+    m_asm.mov(Reg::RDI, c_regs);
+    m_asm.mov32(Reg::RSI, site);
+    m_asm.call({c_regs, c_regs_call});
+    m_asm.test(Reg::RAX, 4);
+    m_epilogue_jumps.push_back(m_asm.jcc(Cond::NE));
+    m_asm.load(c_sp, {c_regs, c_regs_sp}, 8);
+    m_asm.load(c_base, {c_regs, c_regs_base}, 8);
+    return true;
+}
+
+
+bool Compiler::take(size_t size, std::vector<Type>* out)
+{
+    size_t taken = 0;
+    auto it = m_types.end();
+    while (taken < size) {
+        if (it == m_types.begin())
+            return false;
+        --it;
+        taken += type_size_on_stack(*it);
+    }
+    if (taken != size)
+        return false;
+    if (out)
+        out->assign(it, m_types.end());
+    m_types.erase(it, m_types.end());
+    m_bytes -= size;
+    return true;
+}
+
+
+bool Compiler::check_top(Type t, size_t n) const
+{
+    if (m_types.size() < n)
+        return false;
+    const auto size = type_size_on_stack(t);
+    return size != 0 && std::all_of(m_types.end() - n, m_types.end(),
+            [size](Type x) { return type_size_on_stack(x) == size; });
+}
+
+
+void Compiler::move(Mem dst, Mem src, size_t size, bool backwards)
+{
+    // split into chunks of 8, 4, 2, 1 bytes
+    std::vector<std::pair<int32_t, unsigned>> chunks;
+    int32_t ofs = 0;
+    for (unsigned chunk = 8; chunk != 0; chunk /= 2) {
+        while (size >= chunk) {
+            chunks.emplace_back(ofs, chunk);
+            ofs += int32_t(chunk);
+            size -= chunk;
+        }
+    }
+    // overlapping move to higher address must go from the end
+    if (backwards)
+        std::reverse(chunks.begin(), chunks.end());
+    for (auto [o, n] : chunks) {
+        m_asm.load(Reg::RAX, {src.base, src.disp + o}, n);
+        m_asm.store({dst.base, dst.disp + o}, Reg::RAX, n);
+    }
+}
+
+
+void Compiler::error_exit(Cond cc, Status status)
+{
+    // the site records stack state before the failed instruction
+    const auto site = uint32_t(m_sites.size());
+    m_sites.push_back({nullptr, m_types});
+    m_error_exits.push_back({m_asm.jcc(cc), (site << 8) | status});
+}
+
+
+// -----------------------------------------------------------------------------
+// Runtime
+
+struct Context {
+    Registers regs;
+    Runtime& runtime;
+    const CompiledFunction& code;
+    size_t types_base = 0;  // number of type records below the parameters
+    std::exception_ptr error;
+};
+
+
+uint32_t call_helper(Registers* regs, uint32_t site_idx)
+{
+    auto& ctx = *static_cast<Context*>(regs->ctx);
+    const Site& site = ctx.code.sites[site_idx];
+    Stack& stack = ctx.runtime.stack();
+    stack.set_data(regs->sp);
+    stack.set_types(ctx.types_base, site.types);
+    const auto base = Stack::StackAbs(stack.bottom() - regs->base);
+    stack.frame().base = base;
+    try {
+        ctx.runtime.call(*site.callee);
+        stack.reserve(ctx.code.max_stack);
+    } catch (...) {
+        ctx.error = std::current_exception();
+        return (site_idx << 8) | Exception;
+    }
+    regs->sp = stack.data();
+    regs->base = stack.bottom() - base;
+    return Ok;
+}
+
+} // namespace
+
+
+bool is_available() { return true; }
+
+
+std::shared_ptr<const CompiledFunction> compile(const Function& fn)
+{
+    return Compiler(fn).compile();
+}
+
+
+void run(const CompiledFunction& code, Runtime& rt)
+{
+    Stack& stack = rt.stack();
+    assert(stack.n_values() >= code.param_types.size());
+    Context ctx {{}, rt, code, stack.n_values() - code.param_types.size()};
+    stack.reserve(code.max_stack);
+    ctx.regs.sp = stack.data();
+    ctx.regs.base = stack.data();
+    ctx.regs.call = &call_helper;
+    ctx.regs.ctx = &ctx;
+
+    const uint32_t ret = code.entry()(&ctx.regs);
+    const auto status = ret & 0xff;
+    if (status == Exception)
+        std::rethrow_exception(ctx.error);  // the stack is in state left by the callee
+
+    stack.set_data(ctx.regs.sp);
+    if (status == Ok) {
+        stack.set_types(ctx.types_base, code.return_types);
+        return;
+    }
+    stack.set_types(ctx.types_base, code.sites[ret >> 8].types);
+    switch (status) {
+        case IntegerOverflow:   throw value_out_of_range("Integer overflow");
+        case DivisionByZero:    throw value_out_of_range("Division by zero");
+        default:                XCI_UNREACHABLE;
+    }
+}
+
+#endif  // XCI_SCRIPT_JIT_X86_64
+
+
+} // namespace xci::script::jit
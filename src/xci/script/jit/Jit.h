@@ -0,0 +1,64 @@
+// Jit.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_JIT_JIT_H
+#define XCI_SCRIPT_JIT_JIT_H
+
+#include <memory>
+
+namespace xci::script {
+class Function;
+class Stack;
+}
+
+namespace xci::script::jit {
+
+
+/// Baseline JIT compiler
+///
+/// Translates bytecode of a whole function to x86-64 machine code,
+/// instruction by instruction. The machine code works directly with the
+/// Machine's Stack (same layout as the interpreter), so compiled and
+/// interpreted functions can call each other freely.
+///
+/// Only functions working with simple values (Bool, integers, floats)
+/// are compiled. A function which uses any other type or instruction
+/// is rejected and stays interpreted. Calls to other functions go through
+/// the Runtime, except for intrinsic functions (e.g. `add` for Int),
+/// which are inlined. Self tail calls are compiled to a jump.
+///
+/// The type records on the stack are not maintained by the compiled code.
+/// They are synchronized only when leaving the compiled code (call, return, error).
+
+/// True if the JIT is supported in this build (x86-64, XCI_SCRIPT_JIT)
+bool is_available();
+
+class CompiledFunction;
+
+/// Compile the function. Returns null if the function can't be compiled.
+std::shared_ptr<const CompiledFunction> compile(const Function& fn);
+
+
+/// Interface for calling back into the Machine from compiled code
+
+class Runtime {
+public:
+    virtual ~Runtime() = default;
+    virtual Stack& stack() = 0;
+
+    // Call a function of any kind. Arguments are on stack, the result is left on stack.
+    virtual void call(const Function& fn) = 0;
+};
+
+
+/// Run compiled function. Its frame must be already pushed on stack.
+/// Throws the same errors as the interpreter.
+void run(const CompiledFunction& code, Runtime& rt);
+
+
+} // namespace xci::script::jit
+
+#endif // include guard
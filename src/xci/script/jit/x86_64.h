@@ -0,0 +1,330 @@
+// x86_64.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_JIT_X86_64_H
+#define XCI_SCRIPT_JIT_X86_64_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cassert>
+#include <initializer_list>
+
+namespace xci::script::jit::x86_64 {
+
+
+/// General purpose registers (encoding numbers)
+enum class Reg : uint8_t {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+/// Condition codes (low nibble of Jcc / SETcc opcodes)
+enum class Cond : uint8_t {
+    O = 0x0,    // overflow
+    B = 0x2,    // below (carry)
+    AE = 0x3,   // above or equal (no carry)
+    E = 0x4,    // equal (zero)
+    NE = 0x5,   // not equal (not zero)
+    BE = 0x6,   // below or equal
+    A = 0x7,    // above
+    L = 0xC,    // less
+    GE = 0xD,   // greater or equal
+    LE = 0xE,   // less or equal
+    G = 0xF,    // greater
+};
+
+/// Integer ALU operations in "reg, r/m" form: opcode for 8-bit variant,
+/// the 16/32/64-bit variant is opcode + 1
+enum class Alu : uint8_t {
+    Add = 0x02,
+    Or  = 0x0A,
+    And = 0x22,
+    Sub = 0x2A,
+    Xor = 0x32,
+    Cmp = 0x3A,
+};
+
+/// SSE scalar operations (second opcode byte after 0F)
+enum class Sse : uint8_t {
+    Add = 0x58,
+    Mul = 0x59,
+    Sub = 0x5C,
+    Div = 0x5E,
+};
+
+/// Memory operand [base + disp]
+struct Mem {
+    Reg base;
+    int32_t disp = 0;
+};
+
+
+/// Minimal x86-64 machine code emitter
+///
+/// Only the instruction forms needed by the baseline JIT are implemented.
+/// Memory operands always use 32-bit displacement, which keeps
+/// the encoding simple at the cost of a few bytes.
+/// Operand size is given in bytes (1, 2, 4 or 8).
+
+class Assembler {
+public:
+    using Label = size_t;  // offset in code
+
+    const std::vector<uint8_t>& code() const { return m_code; }
+    size_t size() const { return m_code.size(); }
+
+    // Discard code emitted after `size`
+    void truncate(size_t size) { m_code.resize(size); }
+
+    // ------------------------------------------------------------------------
+    // Moves
+
+    // reg <- [mem], 1 and 2 byte loads are zero-extended
+    void load(Reg dst, Mem src, unsigned size) {
+        switch (size) {
+            case 1: mem_op(0, false, {0x0F, 0xB6}, dst, src); break;  // MOVZX r32, r/m8
+            case 2: mem_op(0, false, {0x0F, 0xB7}, dst, src); break;  // MOVZX r32, r/m16
+            case 4: mem_op(0, false, {0x8B}, dst, src); break;
+            case 8: mem_op(0, true, {0x8B}, dst, src); break;
+            default: assert(!"bad operand size");
+        }
+    }
+
+    // [mem] <- reg
+    void store(Mem dst, Reg src, unsigned size) {
+        switch (size) {
+            case 1: mem_op(0, false, {0x88}, src, dst, true); break;
+            case 2: mem_op(0x66, false, {0x89}, src, dst); break;
+            case 4: mem_op(0, false, {0x89}, src, dst); break;
+            case 8: mem_op(0, true, {0x89}, src, dst); break;
+            default: assert(!"bad operand size");
+        }
+    }
+
+    // dst <- src (64-bit)
+    void mov(Reg dst, Reg src) { reg_op(true, 0x89, src, dst); }
+
+    // dst <- imm (64-bit)
+    void mov(Reg dst, uint64_t imm) {
+        const auto d = uint8_t(dst);
+        emit(0x48 | (d >> 3));
+        emit(0xB8 | (d & 7));
+        emit_imm(imm, 8);
+    }
+
+    // dst <- imm (32-bit, zero-extended)
+    void mov32(Reg dst, uint32_t imm) {
+        const auto d = uint8_t(dst);
+        if (d >= 8)
+            emit(0x41);
+        emit(0xB8 | (d & 7));
+        emit_imm(imm, 4);
+    }
+
+    // ------------------------------------------------------------------------
+    // Arithmetic
+
+    // reg <- reg (op) [mem]
+    void alu(Alu op, Reg dst, Mem src, unsigned size) {
+        switch (size) {
+            case 1: mem_op(0, false, {uint8_t(op)}, dst, src, true); break;
+            case 2: mem_op(0x66, false, {uint8_t(uint8_t(op) + 1)}, dst, src); break;
+            case 4: mem_op(0, false, {uint8_t(uint8_t(op) + 1)}, dst, src); break;
+            case 8: mem_op(0, true, {uint8_t(uint8_t(op) + 1)}, dst, src); break;
+            default: assert(!"bad operand size");
+        }
+    }
+
+    // reg <- reg * [mem] (signed, 32/64-bit)
+    void imul(Reg dst, Mem src, unsigned size) {
+        assert(size == 4 || size == 8);
+        mem_op(0, size == 8, {0x0F, 0xAF}, dst, src);
+    }
+
+    // Group 3 (F7 /n) with register operand: NOT=2, NEG=3, MUL=4, IMUL=5, DIV=6, IDIV=7
+    void group3(uint8_t ext, Reg r, unsigned size) {
+        assert(size == 4 || size == 8);
+        rex(size == 8, 0, uint8_t(r));
+        emit(0xF7);
+        emit(0xC0 | (ext << 3) | (uint8_t(r) & 7));
+    }
+    // Group 3 with memory operand
+    void group3(uint8_t ext, Mem m, unsigned size) {
+        assert(size == 4 || size == 8);
+        mem_op(0, size == 8, {0xF7}, Reg(ext), m);
+    }
+
+    void not_(Mem m, unsigned size) { group3(2, m, size); }
+    void neg(Mem m, unsigned size) { group3(3, m, size); }
+    void mul(Reg r, unsigned size) { group3(4, r, size); }
+    void div(Reg r, unsigned size) { group3(6, r, size); }
+    void idiv(Reg r, unsigned size) { group3(7, r, size); }
+
+    // Sign-extend RAX into RDX (CDQ / CQO)
+    void sign_extend_rdx(unsigned size) {
+        if (size == 8)
+            emit(0x48);
+        emit(0x99);
+    }
+
+    // reg <- 0
+    void zero(Reg r) { reg_op(false, 0x31, r, r); }
+
+    // TEST reg, reg
+    void test(Reg r, unsigned size) {
+        if (size == 1) {
+            assert(uint8_t(r) < 4);  // no REX -> AL, CL, DL, BL
+            emit(0x84);
+            emit(0xC0 | (uint8_t(r) << 3) | uint8_t(r));
+            return;
+        }
+        reg_op(size == 8, 0x85, r, r);
+    }
+
+    // XOR byte [mem], imm8
+    void xor8(Mem m, uint8_t imm) {
+        mem_op(0, false, {0x80}, Reg(6), m);
+        emit(imm);
+    }
+
+    // reg <- reg + imm (64-bit, imm is sign-extended)
+    void add(Reg r, int32_t imm) { group1_imm(0, r, imm); }
+    void sub(Reg r, int32_t imm) { group1_imm(5, r, imm); }
+
+    // SETcc AL..BL
+    void setcc(Cond cc, Reg r) {
+        assert(uint8_t(r) < 4);
+        emit(0x0F);
+        emit(0x90 | uint8_t(cc));
+        emit(0xC0 | uint8_t(r));
+    }
+
+    // ------------------------------------------------------------------------
+    // SSE scalar float (XMM0 and XMM1 only)
+
+    // xmm <- [mem] (MOVSS / MOVSD)
+    void sse_load(unsigned xmm, Mem src, unsigned size) {
+        mem_op(sse_prefix(size), false, {0x0F, 0x10}, Reg(xmm), src);
+    }
+    // [mem] <- xmm
+    void sse_store(Mem dst, unsigned xmm, unsigned size) {
+        mem_op(sse_prefix(size), false, {0x0F, 0x11}, Reg(xmm), dst);
+    }
+    // xmm <- xmm (op) [mem]
+    void sse(Sse op, unsigned xmm, Mem src, unsigned size) {
+        mem_op(sse_prefix(size), false, {0x0F, uint8_t(op)}, Reg(xmm), src);
+    }
+    // compare xmm with [mem], set ZF, PF, CF (UCOMISS / UCOMISD)
+    void ucomis(unsigned xmm, Mem src, unsigned size) {
+        assert(size == 4 || size == 8);
+        mem_op(size == 8 ? 0x66 : 0, false, {0x0F, 0x2E}, Reg(xmm), src);
+    }
+
+    // ------------------------------------------------------------------------
+    // Control flow
+
+    Label here() const { return m_code.size(); }
+
+    // Jumps with rel32 operand. Returns position of the operand for patching.
+    size_t jmp() {
+        emit(0xE9);
+        return emit_rel32();
+    }
+    size_t jcc(Cond cc) {
+        emit(0x0F);
+        emit(0x80 | uint8_t(cc));
+        return emit_rel32();
+    }
+    void jmp(Label target) { patch(jmp(), target); }
+    void jcc(Cond cc, Label target) { patch(jcc(cc), target); }
+
+    // Point rel32 operand at `operand_pos` to `target`
+    void patch(size_t operand_pos, Label target) {
+        const auto rel = int32_t(int64_t(target) - int64_t(operand_pos + 4));
+        std::memcpy(&m_code[operand_pos], &rel, 4);
+    }
+
+    // CALL [mem]
+    void call(Mem m) { mem_op(0, false, {0xFF}, Reg(2), m); }
+
+    void push(Reg r) {
+        if (uint8_t(r) >= 8)
+            emit(0x41);
+        emit(0x50 | (uint8_t(r) & 7));
+    }
+    void pop(Reg r) {
+        if (uint8_t(r) >= 8)
+            emit(0x41);
+        emit(0x58 | (uint8_t(r) & 7));
+    }
+    void ret() { emit(0xC3); }
+
+private:
+    void emit(uint8_t b) { m_code.push_back(b); }
+
+    void emit_imm(uint64_t imm, unsigned size) {
+        for (unsigned i = 0; i != size; ++i)
+            emit(uint8_t(imm >> (i * 8)));
+    }
+
+    size_t emit_rel32() {
+        const auto pos = m_code.size();
+        emit_imm(0, 4);
+        return pos;
+    }
+
+    static uint8_t sse_prefix(unsigned size) {
+        assert(size == 4 || size == 8);
+        return size == 8 ? 0xF2 : 0xF3;
+    }
+
+    // REX prefix, emitted only when needed (or forced for 8-bit regs SPL..DIL)
+    void rex(bool w, uint8_t reg, uint8_t rm, bool byte_reg = false) {
+        const uint8_t r = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+        if (r != 0x40 || (byte_reg && (reg & 7) >= 4 && reg < 8))
+            emit(r);
+    }
+
+    // [prefix] [REX] opcode ModRM(reg, [base + disp32]) [SIB] disp32
+    void mem_op(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode,
+                Reg reg, Mem m, bool byte_reg = false) {
+        const auto r = uint8_t(reg);
+        const auto b = uint8_t(m.base);
+        if (prefix)
+            emit(prefix);
+        rex(w, r, b, byte_reg);
+        for (auto op : opcode)
+            emit(op);
+        emit(0x80 | ((r & 7) << 3) | (b & 7));
+        if ((b & 7) == 4)
+            emit(0x24);  // SIB: base only (RSP, R12)
+        emit_imm(uint32_t(m.disp), 4);
+    }
+
+    // opcode ModRM(reg, rm) - register-direct form
+    void reg_op(bool w, uint8_t opcode, Reg reg, Reg rm) {
+        rex(w, uint8_t(reg), uint8_t(rm));
+        emit(opcode);
+        emit(0xC0 | ((uint8_t(reg) & 7) << 3) | (uint8_t(rm) & 7));
+    }
+
+    // 81 /ext r64, imm32
+    void group1_imm(uint8_t ext, Reg r, int32_t imm) {
+        rex(true, 0, uint8_t(r));
+        emit(0x81);
+        emit(0xC0 | (ext << 3) | (uint8_t(r) & 7));
+        emit_imm(uint32_t(imm), 4);
+    }
+
+    std::vector<uint8_t> m_code;
+};
+
+
+} // namespace xci::script::jit::x86_64
+
+#endif // include guard
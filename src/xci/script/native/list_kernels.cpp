@@ -0,0 +1,402 @@
+// list_kernels.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include "list_kernels.h"
+#include <xci/script/Builtin.h>
+
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define XCI_LIST_KERNELS_AVX2 1
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif
+#endif
+
+namespace xci::script::native {
+
+
+// -----------------------------------------------------------------------------
+// Scalar operations (used for tails and by generic implementation)
+
+template <class T>
+struct Elem {
+    // Integer ops are done in unsigned type to get wrap-around instead of UB
+    using U = typename std::conditional_t<std::is_integral_v<T>,
+            std::make_unsigned<T>, std::type_identity<T>>::type;
+    static T add(T a, T b) { return T(U(a) + U(b)); }
+    static T sub(T a, T b) { return T(U(a) - U(b)); }
+    static T mul(T a, T b) { return T(U(a) * U(b)); }
+    static T min(T a, T b) { return b < a ? b : a; }
+    static T max(T a, T b) { return a < b ? b : a; }
+
+    // Integer ops with overflow check - return true on overflow
+    static bool add_overflow(T a, T b, T& r) { return builtin::add_overflow(a, b, r); }
+    static bool sub_overflow(T a, T b, T& r) { return builtin::sub_overflow(a, b, r); }
+    static bool mul_overflow(T a, T b, T& r) {
+        if constexpr (sizeof(T) == 4) {
+            // in wider type, the compiler can vectorize this
+            const int64_t p = int64_t(a) * int64_t(b);
+            r = T(p);
+            return p != r;
+        } else
+            return builtin::mul_overflow(a, b, r);
+    }
+};
+
+
+// Integer sums are computed in wider type, only the result has to fit in T.
+// Sum of up to 2^32 elements can't overflow the wider type.
+template <class T>
+using WideSum = std::conditional_t<sizeof(T) == 4, int64_t, int128>;
+
+template <class T, class W>
+static T narrow_checked(W w)
+{
+    if (w < W(std::numeric_limits<T>::min()) || w > W(std::numeric_limits<T>::max())) [[unlikely]]
+        builtin::throw_integer_overflow();
+    return T(w);
+}
+
+
+// -----------------------------------------------------------------------------
+// Dispatch table - one set of kernels for each element type and instruction set
+
+template <class T>
+struct Kernels {
+    T (*sum)(const T*, size_t);
+    T (*min)(const T*, size_t);
+    T (*max)(const T*, size_t);
+    T (*dot)(const T*, const T*, size_t);
+    void (*add)(const T*, const T*, T*, size_t);
+    void (*sub)(const T*, const T*, T*, size_t);
+    void (*mul)(const T*, const T*, T*, size_t);
+    size_t (*find)(const T*, size_t, T);
+    bool (*equal)(const T*, const T*, size_t);
+};
+
+enum class BinOp { Add, Sub, Mul };
+
+
+// -----------------------------------------------------------------------------
+// Portable implementation - fixed-size arrays of lanes, the compiler
+// vectorizes the lane loops for baseline ISA of the target
+
+template <class ElemT>
+struct Generic {
+    using T = ElemT;
+    using E = Elem<T>;
+    static constexpr size_t width = 16 / sizeof(T) < 4 ? 4 : 16 / sizeof(T);
+    struct Reg { T v[width]; };
+
+    template <class F>
+    static Reg lanes(const Reg& a, const Reg& b, F&& f) {
+        Reg r;
+        for (size_t l = 0; l != width; ++l)
+            r.v[l] = f(a.v[l], b.v[l]);
+        return r;
+    }
+
+    template <class F>
+    static T fold(const Reg& a, F&& f) {
+        T r = a.v[0];
+        for (size_t l = 1; l != width; ++l)
+            r = f(r, a.v[l]);
+        return r;
+    }
+
+    static Reg load(const T* p) { Reg r; for (size_t l = 0; l != width; ++l) r.v[l] = p[l]; return r; }
+    static void store(T* p, const Reg& a) { for (size_t l = 0; l != width; ++l) p[l] = a.v[l]; }
+    static Reg set1(T v) { Reg r; for (auto& x : r.v) x = v; return r; }
+    static Reg zero() { return set1(T{}); }
+    static Reg add(const Reg& a, const Reg& b) { return lanes(a, b, E::add); }
+    static Reg sub(const Reg& a, const Reg& b) { return lanes(a, b, E::sub); }
+    static Reg mul(const Reg& a, const Reg& b) { return lanes(a, b, E::mul); }
+    static Reg min(const Reg& a, const Reg& b) { return lanes(a, b, E::min); }
+    static Reg max(const Reg& a, const Reg& b) { return lanes(a, b, E::max); }
+    static unsigned eq_mask(const Reg& a, const Reg& b) {
+        unsigned mask = 0;
+        for (size_t l = 0; l != width; ++l)
+            mask |= unsigned(a.v[l] == b.v[l]) << l;
+        return mask;
+    }
+    // integer types only
+    static Reg bit_and(const Reg& a, const Reg& b) { return lanes(a, b, [](T x, T y) { return T(x & y); }); }
+    static Reg bit_xor(const Reg& a, const Reg& b) { return lanes(a, b, [](T x, T y) { return T(x ^ y); }); }
+    static unsigned sign_mask(const Reg& a) {
+        unsigned mask = 0;
+        for (size_t l = 0; l != width; ++l)
+            mask |= unsigned(a.v[l] < 0) << l;
+        return mask;
+    }
+    static T reduce_add(const Reg& a) { return fold(a, E::add); }
+    static T reduce_min(const Reg& a) { return fold(a, E::min); }
+    static T reduce_max(const Reg& a) { return fold(a, E::max); }
+};
+
+
+namespace generic {
+#include "list_kernels_impl.h"
+} // namespace generic
+
+
+// -----------------------------------------------------------------------------
+// AVX2 implementation
+
+#ifdef XCI_LIST_KERNELS_AVX2
+
+// Everything in this section is compiled with AVX2 enabled (MSVC allows
+// the intrinsics in any function). The functions are called only after
+// checking the CPU support.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+template <class ElemT> struct Avx2;
+
+// Fold lanes of a register via temporary array
+template <class V, class F>
+inline auto avx2_fold(typename V::Reg reg, F&& f) -> typename V::T {
+    typename V::T tmp[V::width];
+    V::store(tmp, reg);
+    auto r = tmp[0];
+    for (size_t l = 1; l != V::width; ++l)
+        r = f(r, tmp[l]);
+    return r;
+}
+
+template <>
+struct Avx2<float> {
+    using T = float;
+    using E = Elem<T>;
+    using Reg = __m256;
+    static constexpr size_t width = 8;
+    static Reg load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, Reg a) { _mm256_storeu_ps(p, a); }
+    static Reg set1(T v) { return _mm256_set1_ps(v); }
+    static Reg zero() { return _mm256_setzero_ps(); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+    static unsigned eq_mask(Reg a, Reg b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))); }
+    static T reduce_add(Reg a) { return avx2_fold<Avx2>(a, E::add); }
+    static T reduce_min(Reg a) { return avx2_fold<Avx2>(a, E::min); }
+    static T reduce_max(Reg a) { return avx2_fold<Avx2>(a, E::max); }
+};
+
+template <>
+struct Avx2<double> {
+    using T = double;
+    using E = Elem<T>;
+    using Reg = __m256d;
+    static constexpr size_t width = 4;
+    static Reg load(const T* p) { return _mm256_loadu_pd(p); }
+    static void store(T* p, Reg a) { _mm256_storeu_pd(p, a); }
+    static Reg set1(T v) { return _mm256_set1_pd(v); }
+    static Reg zero() { return _mm256_setzero_pd(); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_pd(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+    static unsigned eq_mask(Reg a, Reg b) { return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ))); }
+    static T reduce_add(Reg a) { return avx2_fold<Avx2>(a, E::add); }
+    static T reduce_min(Reg a) { return avx2_fold<Avx2>(a, E::min); }
+    static T reduce_max(Reg a) { return avx2_fold<Avx2>(a, E::max); }
+};
+
+template <>
+struct Avx2<int32_t> {
+    using T = int32_t;
+    using E = Elem<T>;
+    using Reg = __m256i;
+    static constexpr size_t width = 8;
+    static Reg load(const T* p) { return _mm256_loadu_si256((const __m256i*) p); }
+    static void store(T* p, Reg a) { _mm256_storeu_si256((__m256i*) p, a); }
+    static Reg set1(T v) { return _mm256_set1_epi32(v); }
+    static Reg zero() { return _mm256_setzero_si256(); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_epi32(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_epi32(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_epi32(a, b); }
+    static unsigned eq_mask(Reg a, Reg b) { return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))); }
+    static Reg bit_and(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+    static Reg bit_xor(Reg a, Reg b) { return _mm256_xor_si256(a, b); }
+    static unsigned sign_mask(Reg a) { return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(a))); }
+    static T reduce_add(Reg a) { return avx2_fold<Avx2>(a, E::add); }
+    static T reduce_min(Reg a) { return avx2_fold<Avx2>(a, E::min); }
+    static T reduce_max(Reg a) { return avx2_fold<Avx2>(a, E::max); }
+};
+
+template <>
+struct Avx2<int64_t> {
+    using T = int64_t;
+    using E = Elem<T>;
+    using Reg = __m256i;
+    static constexpr size_t width = 4;
+    static Reg load(const T* p) { return _mm256_loadu_si256((const __m256i*) p); }
+    static void store(T* p, Reg a) { _mm256_storeu_si256((__m256i*) p, a); }
+    static Reg set1(T v) { return _mm256_set1_epi64x(v); }
+    static Reg zero() { return _mm256_setzero_si256(); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_epi64(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_epi64(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static Reg max(Reg a, Reg b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    static unsigned eq_mask(Reg a, Reg b) { return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)))); }
+    static Reg bit_and(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+    static Reg bit_xor(Reg a, Reg b) { return _mm256_xor_si256(a, b); }
+    static unsigned sign_mask(Reg a) { return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(a))); }
+    static T reduce_add(Reg a) { return avx2_fold<Avx2>(a, E::add); }
+    static T reduce_min(Reg a) { return avx2_fold<Avx2>(a, E::min); }
+    static T reduce_max(Reg a) { return avx2_fold<Avx2>(a, E::max); }
+};
+
+#include "list_kernels_impl.h"
+
+} // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;  // OS doesn't save YMM registers
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // XCI_LIST_KERNELS_AVX2
+
+
+// -----------------------------------------------------------------------------
+// Runtime dispatch
+
+#ifdef XCI_LIST_KERNELS_AVX2
+static const bool use_avx2 = cpu_has_avx2();
+#endif
+
+template <class T>
+static const Kernels<T>& kernels()
+{
+#ifdef XCI_LIST_KERNELS_AVX2
+    if (use_avx2)
+        return avx2::kernels_for<avx2::Avx2<T>>;
+#endif
+    return generic::kernels_for<Generic<T>>;
+}
+
+
+const char* list_kernels_isa()
+{
+#ifdef XCI_LIST_KERNELS_AVX2
+    if (use_avx2)
+        return "avx2";
+#endif
+    return "generic";
+}
+
+
+template <class T> T list_sum(std::span<const T> a)
+{
+    return kernels<T>().sum(a.data(), a.size());
+}
+
+template <class T> T list_min(std::span<const T> a)
+{
+    assert(!a.empty());
+    return kernels<T>().min(a.data(), a.size());
+}
+
+template <class T> T list_max(std::span<const T> a)
+{
+    assert(!a.empty());
+    return kernels<T>().max(a.data(), a.size());
+}
+
+template <class T> T list_dot(std::span<const T> a, std::span<const T> b)
+{
+    assert(a.size() == b.size());
+    return kernels<T>().dot(a.data(), b.data(), a.size());
+}
+
+template <class T> void list_add(std::span<const T> a, std::span<const T> b, std::span<T> out)
+{
+    assert(a.size() == b.size() && a.size() == out.size());
+    kernels<T>().add(a.data(), b.data(), out.data(), a.size());
+}
+
+template <class T> void list_sub(std::span<const T> a, std::span<const T> b, std::span<T> out)
+{
+    assert(a.size() == b.size() && a.size() == out.size());
+    kernels<T>().sub(a.data(), b.data(), out.data(), a.size());
+}
+
+template <class T> void list_mul(std::span<const T> a, std::span<const T> b, std::span<T> out)
+{
+    assert(a.size() == b.size() && a.size() == out.size());
+    kernels<T>().mul(a.data(), b.data(), out.data(), a.size());
+}
+
+template <class T> size_t list_find(std::span<const T> a, T v)
+{
+    return kernels<T>().find(a.data(), a.size(), v);
+}
+
+template <class T> bool list_equal(std::span<const T> a, std::span<const T> b)
+{
+    if (a.size() != b.size())
+        return false;
+    return kernels<T>().equal(a.data(), b.data(), a.size());
+}
+
+
+#define INSTANTIATE_LIST_KERNELS(T)                                                 \
+    template T list_sum(std::span<const T>);                                        \
+    template T list_min(std::span<const T>);                                        \
+    template T list_max(std::span<const T>);                                        \
+    template T list_dot(std::span<const T>, std::span<const T>);                    \
+    template void list_add(std::span<const T>, std::span<const T>, std::span<T>);   \
+    template void list_sub(std::span<const T>, std::span<const T>, std::span<T>);   \
+    template void list_mul(std::span<const T>, std::span<const T>, std::span<T>);   \
+    template size_t list_find(std::span<const T>, T);                               \
+    template bool list_equal(std::span<const T>, std::span<const T>);
+
+INSTANTIATE_LIST_KERNELS(int32_t)
+INSTANTIATE_LIST_KERNELS(int64_t)
+INSTANTIATE_LIST_KERNELS(float)
+INSTANTIATE_LIST_KERNELS(double)
+
+#undef INSTANTIATE_LIST_KERNELS
+
+
+} // namespace xci::script::native
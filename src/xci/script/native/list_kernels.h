@@ -0,0 +1,57 @@
+// list_kernels.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#ifndef XCI_SCRIPT_NATIVE_LIST_KERNELS_H
+#define XCI_SCRIPT_NATIVE_LIST_KERNELS_H
+
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace xci::script::native {
+
+
+/// Vectorized kernels for lists of numbers (contiguous element data of ListV).
+///
+/// Implemented for element types int32_t, int64_t, float and double.
+/// The implementation is selected at runtime, according to CPU features:
+/// * "avx2" - x86 AVX2 intrinsics
+/// * "generic" - portable code, vectorized by compiler for the baseline ISA (SSE2, NEON)
+///
+/// Integer arithmetic throws ValueOutOfRange ("Integer overflow") like the checked
+/// scalar operators, it never returns a wrapped result. Sum and dot product are
+/// computed in wider type, only the result has to fit in the element type.
+/// Floating-point reductions may sum in different order than a sequential loop.
+
+/// Name of the selected implementation
+const char* list_kernels_isa();
+
+/// Sum of all elements, zero for empty list
+template <class T> T list_sum(std::span<const T> a);
+
+/// Minimum / maximum element. The list must not be empty.
+template <class T> T list_min(std::span<const T> a);
+template <class T> T list_max(std::span<const T> a);
+
+/// Dot product, the lists must have the same length
+template <class T> T list_dot(std::span<const T> a, std::span<const T> b);
+
+/// Elementwise arithmetic: out[i] = a[i] (op) b[i]
+/// All three spans must have the same length. `out` may alias `a` or `b`.
+template <class T> void list_add(std::span<const T> a, std::span<const T> b, std::span<T> out);
+template <class T> void list_sub(std::span<const T> a, std::span<const T> b, std::span<T> out);
+template <class T> void list_mul(std::span<const T> a, std::span<const T> b, std::span<T> out);
+
+/// Index of first element equal to `v`, or `a.size()` if not found
+template <class T> size_t list_find(std::span<const T> a, T v);
+
+/// True if both lists have the same length and equal elements
+template <class T> bool list_equal(std::span<const T> a, std::span<const T> b);
+
+
+} // namespace xci::script::native
+
+#endif // include guard
@@ -0,0 +1,241 @@
+// list_kernels_impl.h created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+// Kernels for list_kernels.cpp, parametrized by "vector traits" V:
+// * V::T - element type, V::width - number of elements in V::Reg
+// * load, store, set1, zero, add, sub, min, max
+// * mul - floating-point types only
+// * eq_mask - bit mask of lanes where a == b (bit 0 = first lane)
+// * bit_and, bit_xor, sign_mask - integer types only, sign_mask is like eq_mask
+// * reduce_add, reduce_min, reduce_max - fold lanes of a register
+//
+// Integer kernels check for overflow and throw (see builtin::throw_integer_overflow).
+//
+// No include guard: the file is included once per instruction set,
+// each time into a different namespace, possibly with different target
+// options in effect (see list_kernels.cpp).
+
+// Overflow of integer `r = a + b` or `r = a - b` sets the sign bit of the lane
+template <class V>
+auto add_overflow_bits(typename V::Reg a, typename V::Reg b, typename V::Reg r) -> typename V::Reg
+{
+    return V::bit_and(V::bit_xor(a, r), V::bit_xor(b, r));  // both operands have different sign than result
+}
+
+template <class V>
+auto sub_overflow_bits(typename V::Reg a, typename V::Reg b, typename V::Reg r) -> typename V::Reg
+{
+    return V::bit_and(V::bit_xor(a, b), V::bit_xor(a, r));  // operands differ in sign and result has different sign than a
+}
+
+template <class T>
+T sum_wide(const T* a, size_t n)
+{
+    WideSum<T> res = 0;
+    for (size_t i = 0; i != n; ++i)
+        res += a[i];
+    return narrow_checked<T>(res);
+}
+
+template <class V>
+auto kernel_sum(const typename V::T* a, size_t n) -> typename V::T
+{
+    using T = typename V::T;
+    using E = Elem<T>;
+    constexpr size_t w = V::width;
+    size_t i = 0;
+    auto acc = V::zero();
+    if constexpr (std::is_integral_v<T>) {
+        for (; i + w <= n; i += w) {
+            const auto v = V::load(a + i);
+            const auto r = V::add(acc, v);
+            if (V::sign_mask(add_overflow_bits<V>(acc, v, r)) != 0) [[unlikely]] {
+                // a partial sum overflowed, the result may still fit
+                return sum_wide(a, n);
+            }
+            acc = r;
+        }
+        // the lanes and the tail are summed in wider type
+        T lanes[w];
+        V::store(lanes, acc);
+        WideSum<T> res = 0;
+        for (const T x : lanes)
+            res += x;
+        for (; i != n; ++i)
+            res += a[i];
+        return narrow_checked<T>(res);
+    } else {
+        for (; i + w <= n; i += w)
+            acc = V::add(acc, V::load(a + i));
+        auto res = V::reduce_add(acc);
+        for (; i != n; ++i)
+            res = E::add(res, a[i]);
+        return res;
+    }
+}
+
+template <class V, bool Min>
+auto kernel_minmax(const typename V::T* a, size_t n) -> typename V::T
+{
+    using E = Elem<typename V::T>;
+    constexpr size_t w = V::width;
+    assert(n != 0);
+    typename V::T res;
+    size_t i;
+    if (n >= w) {
+        auto acc = V::load(a);
+        for (i = w; i + w <= n; i += w) {
+            if constexpr (Min)
+                acc = V::min(acc, V::load(a + i));
+            else
+                acc = V::max(acc, V::load(a + i));
+        }
+        res = Min ? V::reduce_min(acc) : V::reduce_max(acc);
+    } else {
+        res = a[0];
+        i = 1;
+    }
+    for (; i != n; ++i)
+        res = Min ? E::min(res, a[i]) : E::max(res, a[i]);
+    return res;
+}
+
+template <class V>
+auto kernel_dot(const typename V::T* a, const typename V::T* b, size_t n) -> typename V::T
+{
+    using T = typename V::T;
+    using E = Elem<T>;
+    if constexpr (std::is_integral_v<T>) {
+        // Scalar: the products are exact in 128 bits, only the result has to fit in T.
+        // The 128-bit sum overflows only with 64-bit products close to the limit.
+        int128 res = 0;
+        for (size_t i = 0; i != n; ++i) {
+            if (builtin::add_overflow(res, int128(a[i]) * int128(b[i]), res)) [[unlikely]]
+                builtin::throw_integer_overflow();
+        }
+        return narrow_checked<T>(res);
+    } else {
+        constexpr size_t w = V::width;
+        size_t i = 0;
+        auto acc = V::zero();
+        for (; i + w <= n; i += w)
+            acc = V::add(acc, V::mul(V::load(a + i), V::load(b + i)));
+        auto res = V::reduce_add(acc);
+        for (; i != n; ++i)
+            res = E::add(res, E::mul(a[i], b[i]));
+        return res;
+    }
+}
+
+template <class V, BinOp Op>
+void kernel_binop_checked(const typename V::T* a, const typename V::T* b, typename V::T* out, size_t n)
+{
+    using E = Elem<typename V::T>;
+    constexpr size_t w = V::width;
+    size_t i = 0;
+    if constexpr (Op == BinOp::Mul) {
+        // Scalar: SIMD has no integer multiplication with overflow check.
+        // The 32-bit case is vectorized by the compiler (multiply in 64 bits).
+        bool overflow = false;
+        for (; i != n; ++i)
+            overflow |= E::mul_overflow(a[i], b[i], out[i]);
+        if (overflow) [[unlikely]]
+            builtin::throw_integer_overflow();
+    } else {
+        for (; i + w <= n; i += w) {
+            const auto va = V::load(a + i);
+            const auto vb = V::load(b + i);
+            const auto r = Op == BinOp::Add ? V::add(va, vb) : V::sub(va, vb);
+            const auto overflow_bits = Op == BinOp::Add ? add_overflow_bits<V>(va, vb, r)
+                                                        : sub_overflow_bits<V>(va, vb, r);
+            if (V::sign_mask(overflow_bits) != 0) [[unlikely]]
+                builtin::throw_integer_overflow();
+            V::store(out + i, r);
+        }
+        for (; i != n; ++i) {
+            const bool overflow = Op == BinOp::Add ? E::add_overflow(a[i], b[i], out[i])
+                                                   : E::sub_overflow(a[i], b[i], out[i]);
+            if (overflow) [[unlikely]]
+                builtin::throw_integer_overflow();
+        }
+    }
+}
+
+template <class V, BinOp Op>
+void kernel_binop(const typename V::T* a, const typename V::T* b, typename V::T* out, size_t n)
+{
+    using E = Elem<typename V::T>;
+    if constexpr (std::is_integral_v<typename V::T>) {
+        kernel_binop_checked<V, Op>(a, b, out, n);
+    } else {
+        constexpr size_t w = V::width;
+        size_t i = 0;
+        for (; i + w <= n; i += w) {
+            const auto va = V::load(a + i);
+            const auto vb = V::load(b + i);
+            if constexpr (Op == BinOp::Add)
+                V::store(out + i, V::add(va, vb));
+            else if constexpr (Op == BinOp::Sub)
+                V::store(out + i, V::sub(va, vb));
+            else
+                V::store(out + i, V::mul(va, vb));
+        }
+        for (; i != n; ++i) {
+            if constexpr (Op == BinOp::Add)
+                out[i] = E::add(a[i], b[i]);
+            else if constexpr (Op == BinOp::Sub)
+                out[i] = E::sub(a[i], b[i]);
+            else
+                out[i] = E::mul(a[i], b[i]);
+        }
+    }
+}
+
+template <class V>
+size_t kernel_find(const typename V::T* a, size_t n, typename V::T v)
+{
+    constexpr size_t w = V::width;
+    size_t i = 0;
+    const auto vv = V::set1(v);
+    for (; i + w <= n; i += w) {
+        const unsigned mask = V::eq_mask(V::load(a + i), vv);
+        if (mask != 0)
+            return i + std::countr_zero(mask);
+    }
+    for (; i != n; ++i)
+        if (a[i] == v)
+            return i;
+    return n;
+}
+
+template <class V>
+bool kernel_equal(const typename V::T* a, const typename V::T* b, size_t n)
+{
+    constexpr size_t w = V::width;
+    constexpr unsigned all = (1u << w) - 1;
+    size_t i = 0;
+    for (; i + w <= n; i += w) {
+        if (V::eq_mask(V::load(a + i), V::load(b + i)) != all)
+            return false;
+    }
+    for (; i != n; ++i)
+        if (!(a[i] == b[i]))
+            return false;
+    return true;
+}
+
+template <class V>
+constexpr Kernels<typename V::T> kernels_for {
+    kernel_sum<V>,
+    kernel_minmax<V, true>,
+    kernel_minmax<V, false>,
+    kernel_dot<V>,
+    kernel_binop<V, BinOp::Add>,
+    kernel_binop<V, BinOp::Sub>,
+    kernel_binop<V, BinOp::Mul>,
+    kernel_find<V>,
+    kernel_equal<V>,
+};
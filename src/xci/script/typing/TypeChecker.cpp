@@ -76,7 +76,9 @@ MatchScore match_type(const TypeInfo& candidate, const TypeInfo& expected)
         return MatchScore::generic();
     if (candidate.type() == expected.type()) {
         switch (candidate.type()) {
-            case Type::List: return match_type(candidate.elem_type(), expected.elem_type());
+            case Type::List:
+            case Type::Iterator: return match_type(candidate.elem_type(), expected.elem_type());
+            case Type::Map: return match_map(candidate, expected);
             case Type::Tuple: return match_tuple(candidate, expected);
             case Type::Struct: return match_struct(candidate, expected);
             case Type::Function: return match_function(candidate, expected);
@@ -91,6 +93,18 @@ MatchScore match_type(const TypeInfo& candidate, const TypeInfo& expected)
 }
 
 
+MatchScore match_map(const TypeInfo& candidate, const TypeInfo& expected)
+{
+    const auto key_match = match_type(candidate.map_key_type(), expected.map_key_type());
+    if (!key_match)
+        return MatchScore::mismatch();
+    const auto value_match = match_type(candidate.map_value_type(), expected.map_value_type());
+    if (!value_match)
+        return MatchScore::mismatch();
+    return key_match + value_match;
+}
+
+
 MatchScore match_tuple(const TypeInfo& candidate, const TypeInfo& expected)
 {
     assert(candidate.is_struct_or_tuple());
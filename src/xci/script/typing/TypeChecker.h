@@ -78,6 +78,12 @@ MatchScore match_inst_types(std::span<const TypeInfo> candidate, std::span<const
 /// Candidate may coerce to expected, when candidate is literal.
 MatchScore match_type(const TypeInfo& candidate, const TypeInfo& expected);
 
+/// Match map to map
+/// \param candidate    Candidate map type
+/// \param expected     Expected map type
+/// \returns Combined match score of key and value types, or mismatch
+MatchScore match_map(const TypeInfo& candidate, const TypeInfo& expected);
+
 /// Match tuple to tuple
 /// \param candidate    Candidate tuple type
 /// \param expected     Expected tuple type
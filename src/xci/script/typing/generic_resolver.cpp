@@ -68,8 +68,10 @@ void resolve_generic_type(TypeInfo& sig, const TypeArgs& type_args)
             break;
         }
         case Type::List:
+        case Type::Iterator:
             resolve_generic_type(sig.elem_type(), type_args);
             break;
+        case Type::Map:
         case Type::Tuple:
         case Type::Struct:
             for (auto& sub : sig.subtypes())
@@ -114,8 +116,10 @@ void resolve_generic_type(TypeInfo& sig, const Scope& scope)
             break;
         }
         case Type::List:
+        case Type::Iterator:
             resolve_generic_type(sig.elem_type(), scope);
             break;
+        case Type::Map:
         case Type::Tuple:
         case Type::Struct:
             for (auto& sub : sig.subtypes())
@@ -184,12 +188,21 @@ void specialize_arg(const TypeInfo& sig, const TypeInfo& deduced,
             break;
         }
         case Type::List:
-            if (deduced.type() != Type::List) {
+        case Type::Iterator:
+            if (deduced.type() != sig.type()) {
                 exc_cb(sig, deduced);
                 break;
             }
             specialize_arg(sig.elem_type(), deduced.elem_type(), type_args, exc_cb);
             break;
+        case Type::Map:
+            if (deduced.type() != Type::Map) {
+                exc_cb(sig, deduced);
+                break;
+            }
+            specialize_arg(sig.map_key_type(), deduced.map_key_type(), type_args, exc_cb);
+            specialize_arg(sig.map_value_type(), deduced.map_value_type(), type_args, exc_cb);
+            break;
         case Type::Tuple:
         case Type::Struct:
             if (deduced.type() != Type::Tuple && deduced.type() != Type::Struct) {
@@ -25,9 +25,9 @@ Index make_type_index(Module& mod, const TypeInfo& type_info)
     // first add underlying types
     if (type_info.is_named())
         make_type_index(mod, type_info.underlying());
-    if (type_info.is_list())
+    if (type_info.is_list() || type_info.is_iter())
         make_type_index(mod, type_info.elem_type());
-    if (type_info.is_struct_or_tuple())
+    if (type_info.is_map() || type_info.is_struct_or_tuple())
         for (const TypeInfo& ti : type_info.subtypes())
             make_type_index(mod, ti);
     return (mod.add_type(type_info) << 7) + mod_idx;
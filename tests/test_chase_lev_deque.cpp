@@ -0,0 +1,90 @@
+// test_chase_lev_deque.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <xci/core/container/ChaseLevDeque.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+using namespace xci::core;
+
+TEST_CASE( "Owner push/pop", "[ChaseLevDeque]" )
+{
+    ChaseLevDeque<int*, 4> deque;
+    int items[5] = {};
+    CHECK(deque.empty());
+    CHECK(deque.pop() == nullptr);
+    CHECK(deque.steal() == nullptr);
+
+    // fixed capacity
+    for (int i = 0; i != 4; ++i)
+        CHECK(deque.push(&items[i]));
+    CHECK(!deque.push(&items[4]));
+    CHECK(deque.size() == 4);
+
+    // owner pops LIFO, thief steals FIFO
+    CHECK(deque.pop() == &items[3]);
+    CHECK(deque.steal() == &items[0]);
+    CHECK(deque.push(&items[4]));
+    CHECK(deque.pop() == &items[4]);
+    CHECK(deque.pop() == &items[2]);
+    CHECK(deque.steal() == &items[1]);
+    CHECK(deque.pop() == nullptr);
+    CHECK(deque.empty());
+
+    // wrap around the ring buffer
+    for (int round = 0; round != 10; ++round) {
+        CHECK(deque.push(&items[round % 5]));
+        CHECK(deque.steal() == &items[round % 5]);
+    }
+    CHECK(deque.empty());
+}
+
+
+TEST_CASE( "Concurrent stealing", "[ChaseLevDeque]" )
+{
+    constexpr int num_items = 100000;
+    constexpr int num_thieves = 3;
+    std::vector<int> items(num_items);
+    std::vector<std::atomic_int> taken(num_items);
+    ChaseLevDeque<int*, 64> deque;
+    std::atomic_bool done {false};
+
+    const auto take = [&](int* item) {
+        taken[item - items.data()].fetch_add(1, std::memory_order_relaxed);
+    };
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i != num_thieves; ++i) {
+        thieves.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire) || !deque.empty()) {
+                if (int* item = deque.steal())
+                    take(item);
+            }
+        });
+    }
+
+    // owner: push all items, pop some of them (when the deque is full)
+    for (int i = 0; i != num_items; ++i) {
+        while (!deque.push(&items[i])) {
+            if (int* item = deque.pop())
+                take(item);
+        }
+    }
+    while (int* item = deque.pop())
+        take(item);
+    done.store(true, std::memory_order_release);
+    for (auto& t : thieves)
+        t.join();
+
+    // each item was taken exactly once
+    int wrong = 0;
+    for (const auto& n : taken)
+        wrong += n.load() != 1;
+    CHECK(wrong == 0);
+}
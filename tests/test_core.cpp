@@ -12,11 +12,20 @@
 #include <xci/core/sys.h>
 #include <xci/core/TermCtl.h>
 
+#include <xci/config.h>
+
 #ifndef _WIN32
 #include <xci/core/FileTree.h>
 #endif
+#ifdef HAVE_IO_URING
+#include <xci/core/IoRing.h>
+#include <linux/io_uring.h>
+#endif
 
 #include <string>
+#include <fstream>
+#include <functional>
+#include <atomic>
 
 using namespace xci::core;
 using namespace std::string_literals;
@@ -279,10 +288,162 @@ TEST_CASE( "PathNode", "[FileTree]" )
         CHECK(PathNode::make("foo/bar")->parent_dir_path() == "foo/");
         CHECK(PathNode::make("/foo/bar")->parent_dir_path() == "/foo/");
     };
+    SECTION("stat fields") {
+        const fs::path file = fs::temp_directory_path() / "xci_test_path_node.txt";
+        std::ofstream(file) << "hello";
+        const auto node = PathNode::make(file.string());
+        struct stat full {};
+        REQUIRE(node->stat(full));
+        struct stat st {};
+        // the requested fields are always set, same as from full stat
+        REQUIRE(node->stat(st, PathNode::StatType));
+        CHECK(S_ISREG(st.st_mode));
+        REQUIRE(node->stat(st, PathNode::StatSize));
+        CHECK(st.st_size == 5);
+        CHECK(st.st_blocks == full.st_blocks);
+        REQUIRE(node->stat(st, PathNode::StatMode | PathNode::StatSize));
+        CHECK(st.st_mode == full.st_mode);
+        CHECK(st.st_size == 5);
+        REQUIRE(node->stat(st, PathNode::StatAll));
+        CHECK(st.st_mode == full.st_mode);
+        CHECK(st.st_ino == full.st_ino);
+        CHECK(st.st_nlink == full.st_nlink);
+        CHECK(st.st_uid == full.st_uid);
+        CHECK(st.st_mtim.tv_sec == full.st_mtim.tv_sec);
+        fs::remove(file);
+    };
+}
+
+
+TEST_CASE( "FileTree walk", "[FileTree]" )
+{
+    // synthetic tree: 3 levels of 4 subdirs, each dir contains 2 files
+    const fs::path root = fs::temp_directory_path() / "xci_test_file_tree";
+    fs::remove_all(root);
+    std::function<void(const fs::path&, int)> make_tree = [&](const fs::path& dir, int depth) {
+        fs::create_directory(dir);
+        for (const char* name : {"a.txt", "b.txt"})
+            std::ofstream(dir / name);
+        if (depth == 0)
+            return;
+        for (const char* name : {"d1", "d2", "d3", "d4"})
+            make_tree(dir / name, depth - 1);
+    };
+    make_tree(root, 3);
+
+    for (const int num_threads : {0, 1, 3, 8}) {
+        INFO("num_threads = " << num_threads);
+        std::atomic_int files {0};
+        std::atomic_int dirs {0};
+        std::atomic_int errors {0};
+        std::atomic_int idle {0};
+        // the callback is called from worker threads - don't CHECK there
+        FileTree ft(num_threads, [&](int tn, const FileTree::PathNode& path, FileTree::Type t) {
+            if (tn < 0 || tn > num_threads)
+                ++errors;
+            // names and paths are NUL-terminated in place
+            if (path.name().data()[path.name().size()] != '\0' ||
+                path.file_path().data()[path.file_path().size()] != '\0')
+                ++errors;
+            if (t == FileTree::File) {
+                // type is known from dir entry (if the filesystem provides it), size from partial stat
+                struct stat st;
+                if ((path.type_hint() != 0 && path.type_hint() != S_IFREG) ||
+                    !path.stat(st, FileTree::PathNode::StatType | FileTree::PathNode::StatSize) ||
+                    !S_ISREG(st.st_mode) || st.st_size != 0)
+                    ++errors;
+            }
+            switch (t) {
+                case FileTree::File: ++files; break;
+                case FileTree::Directory: ++dirs; break;
+                default: ++errors; break;
+            }
+            return path.name() != "d4";  // skip d4 subtrees
+        }, [&](int tn) {
+            if (tn < 0 || tn > num_threads)
+                ++errors;
+            ++idle;
+        });
+        ft.walk(root);
+        ft.main_worker();
+        // each worker called the idle callback at least before finishing
+        CHECK(idle >= num_threads + 1);
+        // each d4 is reported, but not descended:
+        // descended 1 + 3 + 9 + 27 = 40 dirs, the 13 non-leaf have 4 subdirs each
+        CHECK(dirs == 1 + 13 * 4);
+        CHECK(files == 40 * 2);
+        CHECK(errors == 0);
+    }
+    fs::remove_all(root);
 }
 #endif // _WIN32
 
 
+#ifdef HAVE_IO_URING
+TEST_CASE( "IoRing read", "[IoRing]" )
+{
+    IoRing ring(4);
+    if (!ring || !ring.supports(IORING_OP_OPENAT) || !ring.supports(IORING_OP_READ)
+        || !ring.supports(IORING_OP_CLOSE)) {
+        WARN("io_uring not available, skipped");
+        return;
+    }
+
+    const fs::path filename = fs::temp_directory_path() / "xci_test_io_ring";
+    std::ofstream(filename) << "hello io_uring";
+
+    const std::string path = filename.string();
+    REQUIRE(ring.prep_openat(AT_FDCWD, path.c_str(), O_RDONLY | O_CLOEXEC, 1));
+    REQUIRE(ring.submit(1));
+    IoRing::Completion c;
+    REQUIRE(ring.pop(c));
+    CHECK(c.user_data == 1);
+    REQUIRE(c.res >= 0);
+    const int fd = c.res;
+
+    // read in two parts, both submitted at once
+    char buf[32] = {};
+    CHECK(ring.prep_read(fd, buf, 5, 0, 2));
+    CHECK(ring.prep_read(fd, buf + 5, sizeof(buf) - 5, 5, 3));
+    CHECK(ring.num_prepared() == 2);
+    REQUIRE(ring.submit(2));
+    CHECK(ring.num_prepared() == 0);
+    int total = 0;
+    while (ring.pop(c)) {
+        CHECK((c.user_data == 2 || c.user_data == 3));
+        total += c.res;
+    }
+    CHECK(total == 14);
+    CHECK(std::string(buf) == "hello io_uring");
+
+    REQUIRE(ring.prep_close(fd, 4));
+    REQUIRE(ring.submit(1));
+    REQUIRE(ring.pop(c));
+    CHECK(c.user_data == 4);
+    CHECK(c.res == 0);
+    CHECK(!ring.pop(c));
+
+    // prepared operations can be taken back before submitting
+    CHECK(ring.prep_close(-1, 6));
+    CHECK(ring.prep_close(-1, 7));
+    std::vector<uint64_t> discarded;
+    ring.discard_prepared(discarded);
+    CHECK(discarded == std::vector<uint64_t>{6, 7});
+    CHECK(ring.num_prepared() == 0);
+    REQUIRE(ring.submit(0));
+    CHECK(!ring.pop(c));
+
+    // errors are returned as -errno
+    REQUIRE(ring.prep_openat(AT_FDCWD, "/nonexistent/xci", O_RDONLY, 5));
+    REQUIRE(ring.submit(1));
+    REQUIRE(ring.pop(c));
+    CHECK(c.res == -ENOENT);
+
+    fs::remove(filename);
+}
+#endif
+
+
 TEST_CASE( "c32_width", "[TermCtl]" )
 {
     CHECK(c32_width(utf8_codepoint(" ")) == 1);
@@ -0,0 +1,137 @@
+// test_fire_script.cpp created on 2026-10-18 as part of xcikit project
+// https://github.com/rbrich/xcikit
+//
+// Copyright 2026 Radek Brich
+// Licensed under the Apache License, Version 2.0 (see LICENSE file)
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "fire_script/Highlighter.h"
+#include "fire_script/Repl.h"
+
+#include <xci/core/TermCtl.h>
+#include <xci/compat/unistd.h>
+#include <xci/config.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+using namespace xci::script;
+using namespace xci::script::tool;
+using xci::core::TermCtl;
+
+
+// Highlight the input incrementally (as the user types and moves the cursor)
+// and compare each step with highlighting of the whole input from scratch.
+static void check_incremental(Highlighter& hl, std::string_view input, unsigned cursor)
+{
+    TermCtl term(STDOUT_FILENO, TermCtl::IsTty::Always);
+    Highlighter ref(term);
+    const auto r = hl.highlight(input, cursor);
+    const auto expected = ref.highlight_all(input, cursor);
+    INFO("input: " << input << "\ncursor: " << cursor);
+    CHECK(r.highlighted_input == expected.highlighted_input);
+    CHECK(r.is_open == expected.is_open);
+}
+
+
+TEST_CASE( "Incremental highlighting", "[Highlighter]" )
+{
+    TermCtl term(STDOUT_FILENO, TermCtl::IsTty::Always);
+
+    const std::string_view inputs[] = {
+        "a = 1\nb = 2\na + b",
+        "f = fun a {\n  a + 1\n}\nf 2",
+        "s = \"\"\"\n  raw\n  string\n  \"\"\"\ns",
+        "x = 1  /* block\ncomment\n*/\nx",
+        "(1,\n 2)\n[3,\n 4]",
+        "c = 'a'  // line comment\n\"str\" + \"ing\"",
+    };
+
+    for (const auto input : inputs) {
+        Highlighter hl(term);
+
+        // type the input char by char
+        for (unsigned n = 0; n <= input.size(); ++n)
+            check_incremental(hl, input.substr(0, n), n);
+
+        // move the cursor through the whole input
+        for (unsigned c = 0; c <= input.size(); ++c)
+            check_incremental(hl, input, c);
+        check_incremental(hl, input, unsigned(input.size()));
+
+        // edit the first line, then revert the edit
+        std::string edited(input);
+        edited.insert(0, "(");
+        check_incremental(hl, edited, 1);
+        check_incremental(hl, input, 0);
+
+        // edit the last line
+        edited = input;
+        edited.append(" + 1");
+        check_incremental(hl, edited, unsigned(edited.size()));
+    }
+}
+
+
+TEST_CASE( "REPL definitions cache", "[Repl]" )
+{
+    Context ctx;
+    ctx.vfs.mount(XCI_SHARE);
+    ctx.input_number = 0;
+    ReplOptions opts;
+    Repl repl(ctx, opts);
+
+    const auto imports = [](const Module& mod, const std::shared_ptr<Module>& imported) {
+        return mod.get_imported_module_index(imported.get()) != no_index;
+    };
+
+    REQUIRE(repl.evaluate("_0", "a = 1\nf = fun x:Int -> Int { x + a }\nf 1", EvalMode::Repl));
+    const auto defs0 = repl.definitions_module();
+    REQUIRE(defs0);
+    REQUIRE(ctx.input_modules.size() == 2);
+    CHECK(ctx.input_modules[0] == defs0);
+    const auto main0 = ctx.input_modules[1];
+    CHECK(imports(*main0, defs0));
+
+    // an unrelated input doesn't import the previous ones
+    REQUIRE(repl.evaluate("_1", "b = 2\nb", EvalMode::Repl));
+    const auto defs1 = repl.definitions_module();
+    REQUIRE(defs1);
+    CHECK(defs1 != defs0);
+    REQUIRE(ctx.input_modules.size() == 4);
+    const auto main1 = ctx.input_modules[3];
+    CHECK(!imports(*main1, defs0));
+    CHECK(!imports(*main1, main0));
+    CHECK(!imports(*defs1, defs0));
+
+    // resubmitted definitions with edited last line - the definitions
+    // are compiled again (the last definitions were different)
+    REQUIRE(repl.evaluate("_2", "a = 1\nf = fun x:Int -> Int { x + a }\nf 2", EvalMode::Repl));
+    const auto defs2 = repl.definitions_module();
+    CHECK(defs2 != defs0);
+    REQUIRE(ctx.input_modules.size() == 6);
+
+    // the same definitions again - the cached module is reused
+    REQUIRE(repl.evaluate("_3", "a = 1\nf = fun x:Int -> Int { x + a }\nf 3", EvalMode::Repl));
+    CHECK(repl.definitions_module() == defs2);
+    REQUIRE(ctx.input_modules.size() == 7);  // defs2 is not added again
+    CHECK(std::ranges::count(ctx.input_modules, defs2) == 1);
+    const auto main3 = ctx.input_modules[6];
+    CHECK(imports(*main3, defs2));
+    CHECK(!imports(*main3, defs0));
+
+    // an input referring to a previous definition imports its module
+    REQUIRE(repl.evaluate("_4", "f 4", EvalMode::Repl));
+    REQUIRE(ctx.input_modules.size() == 8);
+    const auto main4 = ctx.input_modules[7];
+    CHECK(imports(*main4, defs2));
+    CHECK(!imports(*main4, defs1));
+
+    // the result of previous input is referred as `_N`
+    REQUIRE(repl.evaluate("_5", "_4 + 1", EvalMode::Repl));
+    const auto main5 = ctx.input_modules.back();
+    CHECK(imports(*main5, main4));
+    CHECK(!imports(*main5, main3));
+}
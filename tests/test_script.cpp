@@ -13,23 +13,32 @@
 #include <xci/script/Stack.h>
 #include <xci/script/SymbolTable.h>
 #include <xci/script/NativeDelegate.h>
+#include <xci/script/ConstantPool.h>
 #include <xci/script/ast/fold_tuple.h>
 #include <xci/script/ast/fold_dot_call.h>
 #include <xci/script/ast/fold_paren.h>
+#include <xci/script/code/verify_bytecode.h>
+#include <xci/script/code/tree_shake.h>
+#include <xci/script/jit/Jit.h>
 #include <xci/script/dump.h>
 #include <xci/vfs/Vfs.h>
+#include <xci/data/BinaryWriter.h>
 #include <xci/core/log.h>
 #include <xci/core/string.h>
+#include <xci/compat/unistd.h>
 #include <xci/config.h>
 
 #include <string>
 #include <sstream>
+#include <fstream>
 #include <filesystem>
+#include <thread>
 
 namespace fs = std::filesystem;
 using namespace xci::script;
 using namespace xci::core;
 using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
 
 
 struct Context {
@@ -151,6 +160,21 @@ static std::string optimize_code(Compiler::Flags opt, const std::string& input,
 }
 
 
+// Freshly compiled code must pass the bytecode verifier.
+// The Compiler only logs a warning when it doesn't.
+static void check_verified(const ModuleManager& module_manager)
+{
+    for (Index m = 0; m != module_manager.num_modules(); ++m) {
+        const Module& module = module_manager.get_module(m);
+        for (Index f = 0; f != module.num_functions(); ++f) {
+            const Function& fn = module.get_function(f);
+            if (fn.is_bytecode() && !fn.is_verified())
+                FAIL_CHECK("not verified: " << module.name().view() << ": " << fn.qualified_name());
+        }
+    }
+}
+
+
 static std::string interpret(const std::string& input, bool import_std=false)
 {
     Context& ctx = context();
@@ -165,6 +189,7 @@ static std::string interpret(const std::string& input, bool import_std=false)
         result.decref();
         assert(ctx.interpreter.machine().stack().empty());
         assert(ctx.interpreter.machine().stack().n_frames() == 0);
+        check_verified(ctx.interpreter.module_manager());
     } catch (const ScriptError& e) {
         UNSCOPED_INFO("Exception: " << e.what() << "\n" << e.detail());
         assert(ctx.interpreter.machine().stack().empty());
@@ -301,6 +326,8 @@ TEST_CASE( "Parsing types", "[script][parser]")
     CHECK(parse("type MyListOfTuples2 = [(String, Int), Int]") == "type MyListOfTuples2 = [((String, Int), Int)]; ()");
     CHECK(parse("MyAlias = Int") == "MyAlias = Int; ()");
     CHECK(parse("MyAlias2 = [Int]") == "MyAlias2 = [Int]; ()");
+    CHECK(parse("type MyMap = [String: Int]") == "type MyMap = [String: Int]; ()");
+    CHECK(parse("type MyMapOfLists = [(Int, Int): [String]]") == "type MyMapOfLists = [(Int, Int): [String]]; ()");
     CHECK(parse("type MyFunction = (String, Int) -> String -> Int") == "type MyFunction = (String, Int) -> String -> Int; ()");
     CHECK(parse("type MyFunction = Int -> String -> Float -> Bool") == "type MyFunction = Int -> String -> Float -> Bool; ()");
 }
@@ -442,12 +469,12 @@ TEST_CASE( "Stack push/pull", "[script][machine]" )
     CHECK(stack.size() == 1);
     stack.push(value::Int32{73});
     CHECK(stack.size() == 1+4);
-    value::String str{"hello"};
+    value::String str{"hello, this string is stored on heap"};
     stack.push(str);
-    CHECK(stack.size() == 1+4 + sizeof(void*));
+    CHECK(stack.size() == 1+4 + type_size_on_stack(Type::String));
     CHECK(stack.n_values() == 3);
 
-    CHECK(stack.pull<value::String>().value() == "hello");
+    CHECK(stack.pull<value::String>().value() == "hello, this string is stored on heap");
     CHECK(stack.pull<value::Int32>().value() == 73);
     CHECK(stack.pull<value::Bool>().value() == true);  // NOLINT
 
@@ -456,6 +483,286 @@ TEST_CASE( "Stack push/pull", "[script][machine]" )
 }
 
 
+TEST_CASE( "Small string optimization", "[script][machine]" )
+{
+    // Short strings are stored inline, without heap slot
+    value::String empty;
+    CHECK(empty.value().empty());
+    CHECK(empty.heapslot() == nullptr);
+
+    value::String short_str{"hello"};
+    CHECK(short_str.get<StringV>().is_inline());
+    CHECK(short_str.heapslot() == nullptr);
+    CHECK(short_str.value() == "hello");
+
+    const std::string max_inline(StringV::max_inline_size, 'x');
+    value::String max_str{max_inline};
+    CHECK(max_str.heapslot() == nullptr);
+    CHECK(max_str.value() == max_inline);
+
+    value::String long_str{max_inline + "y"};
+    CHECK(!long_str.get<StringV>().is_inline());
+    CHECK(long_str.heapslot()->refcount() == 1);
+    CHECK(long_str.value() == max_inline + "y");
+
+    // incref / decref is no-op for inline strings
+    short_str.incref();
+    short_str.decref();
+    CHECK(short_str.value() == "hello");
+
+    // round trip via stack
+    Stack stack;
+    stack.push(short_str);
+    stack.push(long_str);
+    CHECK(stack.size() == 2 * type_size_on_stack(Type::String));
+    auto long_pulled = stack.pull<value::String>();
+    auto short_pulled = stack.pull<value::String>();
+    CHECK(short_pulled.value() == "hello");
+    CHECK(long_pulled.value() == max_inline + "y");
+    CHECK(short_pulled.get<StringV>().is_same(short_str.get<StringV>()));
+    CHECK(!short_pulled.get<StringV>().is_same(long_pulled.get<StringV>()));
+    long_str.decref();
+
+    // strings of both kinds in a list and a tuple
+    CHECK(interpret_std("[\"a\", \"bcdefghijklmnopqrstuvwxyz\", \"\"]") == R"(["a", "bcdefghijklmnopqrstuvwxyz", ""])");
+    CHECK(interpret_std("(\"short\", 1, \"this one is long enough for heap\")") == R"(("short", 1, "this one is long enough for heap"))");
+    CHECK(interpret_std("\"abc\" + \"def\" + \"ghijklmnopqrstuvwxyz\"") == R"("abcdefghijklmnopqrstuvwxyz")");
+}
+
+
+TEST_CASE( "List capacity", "[script][machine]" )
+{
+    const auto ti = ti_int();
+    value::List list(1, ti);
+    list.set_value(0, value::Int(1));
+    CHECK(list.get<ListV>().capacity() == 1);
+
+    // unique list grows geometrically, then appends in place
+    value::List one(1, ti);
+    for (int i = 2; i <= 5; ++i) {
+        one.set_value(0, value::Int(i));
+        list.get<ListV>().extend(one.get<ListV>(), ti);
+    }
+    CHECK(list.length() == 5);
+    CHECK(list.get<ListV>().capacity() == 8);
+    const auto* slot_before = list.heapslot()->slot();
+    list.get<ListV>().extend(one.get<ListV>(), ti);
+    CHECK(list.heapslot()->slot() == slot_before);
+    CHECK(list.length() == 6);
+    CHECK(list.value_at(5, ti) == value::Int(5));
+
+    // shared list is copied, with exact size
+    list.incref();
+    value::List copy = list;
+    copy.get<ListV>().extend(one.get<ListV>(), ti);
+    CHECK(copy.heapslot()->slot() != list.heapslot()->slot());
+    CHECK(copy.get<ListV>().capacity() == 7);
+    CHECK(list.heapslot()->refcount() == 1);
+    CHECK(list.length() == 6);
+    copy.decref();
+
+    // unique list is sliced in place, keeping the capacity
+    list.get<ListV>().slice(1, 6, 2, ti);
+    CHECK(list.heapslot()->slot() == slot_before);
+    CHECK(list.length() == 3);
+    CHECK(list.get<ListV>().capacity() == 8);
+    CHECK(list.value_at(0, ti) == value::Int(2));
+    CHECK(list.value_at(1, ti) == value::Int(4));
+    CHECK(list.value_at(2, ti) == value::Int(5));
+    list.decref();
+    one.decref();
+
+    // heap-allocated elements: refcounts are kept in sync
+    const auto ti_s = ti_string();
+    value::String str {"long enough string to be on heap"};
+    value::List strings(1, ti_s);
+    str.incref();
+    strings.set_value(0, str);
+    value::List other(1, ti_s);
+    str.incref();
+    other.set_value(0, str);
+    strings.get<ListV>().extend(other.get<ListV>(), ti_s);
+    CHECK(str.heapslot()->refcount() == 4);
+    other.decref();
+    CHECK(str.heapslot()->refcount() == 3);
+    strings.get<ListV>().slice(1, 2, 1, ti_s);
+    CHECK(str.heapslot()->refcount() == 2);
+    strings.decref();
+    CHECK(str.heapslot()->refcount() == 1);
+    str.decref();
+
+    CHECK(interpret_std("l = [1,2] + [3] + [4] + [5]; (l, l .slice (1, 3, 1) + [6])") == "([1, 2, 3, 4, 5], [2, 3, 6])");
+}
+
+
+TEST_CASE( "Map value", "[script][machine]" )
+{
+    const auto kt = ti_string();
+    const auto vt = ti_int();
+    value::Map map(kt, vt);
+    CHECK(map.length() == 0);
+    CHECK(map.get<MapV>().capacity() == 0);
+    CHECK(map.get<MapV>().get(value::String("x"), kt, vt).is_unknown());
+
+    // grows to keep load under 7/8, tombstones are reused
+    for (int i = 0; i != 100; ++i)
+        map.get<MapV>().insert(value::String("key" + std::to_string(i)), value::Int(i), kt, vt);
+    CHECK(map.length() == 100);
+    CHECK(map.get<MapV>().capacity() == 128);
+    CHECK(map.get<MapV>().get(value::String("key42"), kt, vt) == value::Int(42));
+    CHECK(!map.get<MapV>().contains(value::String("key100"), kt, vt));
+    for (int i = 0; i != 100; i += 2)
+        CHECK(map.get<MapV>().remove(value::String("key" + std::to_string(i)), kt, vt));
+    CHECK(!map.get<MapV>().remove(value::String("key0"), kt, vt));
+    CHECK(map.length() == 50);
+    CHECK(!map.get<MapV>().contains(value::String("key42"), kt, vt));
+    CHECK(map.get<MapV>().get(value::String("key43"), kt, vt) == value::Int(43));
+
+    // replace value of existing key
+    map.get<MapV>().insert(value::String("key43"), value::Int(-1), kt, vt);
+    CHECK(map.length() == 50);
+    CHECK(map.get<MapV>().get(value::String("key43"), kt, vt) == value::Int(-1));
+
+    // shared map is copied on write, refcounts of entries are kept in sync
+    value::String str {"long enough string to be on heap"};
+    str.incref();
+    map.get<MapV>().insert(str, value::Int(7), kt, vt);
+    CHECK(str.heapslot()->refcount() == 2);
+    map.incref();
+    value::Map copy = map;
+    copy.get<MapV>().remove(str, kt, vt);
+    CHECK(copy.heapslot()->slot() != map.heapslot()->slot());
+    CHECK(map.heapslot()->refcount() == 1);
+    CHECK(str.heapslot()->refcount() == 2);
+    CHECK(copy.length() == 50);
+    CHECK(map.length() == 51);
+    copy.decref();
+    map.decref();
+    CHECK(str.heapslot()->refcount() == 1);
+    str.decref();
+}
+
+
+TEST_CASE( "Cycle collector", "[script][machine]" )
+{
+    auto& cc = CycleCollector::thread_instance();
+    cc.set_enabled(true);
+    cc.set_threshold(0);
+    cc.collect();
+    const auto stats_before = cc.stats();
+    // element type doesn't matter for the collector, only the heap slots
+    const auto elem_ti = ti_list(ti_int());
+    const auto list_bytes = [](size_t n, const TypeInfo& ti) {
+        return HeapSlot::header_size + ListV::header_size + 2 + n * ti.size();
+    };
+
+    // a -> b -> a, a -> s -> str
+    value::List a(2, elem_ti);
+    value::List b(1, elem_ti);
+    value::List s(1, ti_string());
+    value::String str {"long enough string to be on heap"};
+    str.incref();
+    s.set_value(0, str);
+    a.set_value(0, b);
+    a.set_value(1, s);
+    a.incref();
+    b.set_value(0, a);
+    CHECK(cc.num_tracked() >= 3);
+    CHECK(str.heapslot()->refcount() == 2);
+
+    // the cycle is referenced from outside - nothing is freed
+    auto res = cc.collect();
+    CHECK(res.slots == 0);
+    CHECK(res.bytes == 0);
+    CHECK(a.heapslot()->refcount() == 2);
+    CHECK(b.heapslot()->refcount() == 1);
+
+    // drop the outside reference - the whole cycle is garbage, including `s`
+    a.decref();
+    res = cc.collect();
+    CHECK(res.slots == 3);
+    CHECK(res.bytes == list_bytes(2, elem_ti) + list_bytes(1, elem_ti) + list_bytes(1, ti_string()));
+    CHECK(str.heapslot()->refcount() == 1);
+    CHECK(cc.stats().collections == stats_before.collections + 2);
+    CHECK(cc.stats().bytes == stats_before.bytes + res.bytes);
+    str.decref();
+
+    // stress: many small cycles, collected automatically on function call
+    Module module {context().interpreter.module_manager(), intern("<cc>")};
+    Function id_fn {module, module.symtab().add_child(intern("id"))};
+    id_fn.signature().set_parameter(ti_int());
+    id_fn.signature().set_return_type(ti_int());
+    id_fn.set_bytecode();
+    id_fn.bytecode().add_opcode(Opcode::Ret);
+    Machine machine;
+    cc.set_threshold(1000);
+    for (int i = 0; i != 10000; ++i) {
+        machine.stack().push(value::Int(i));
+        machine.call(id_fn);
+        CHECK(machine.stack().pull<value::Int>().value() == i);
+        value::List x(1, elem_ti);
+        value::List y(1, elem_ti);
+        x.set_value(0, y);
+        y.set_value(0, x);
+    }
+    CHECK(cc.stats().slots >= stats_before.slots + 3 + 19000);
+    CHECK(cc.num_tracked() <= 1000);
+
+    // each thread has its own collector
+    const auto tracked = cc.num_tracked();
+    bool thread_enabled = true;
+    size_t thread_tracked = 0;
+    size_t thread_freed = 0;
+    std::thread([&] {
+        auto& thread_cc = CycleCollector::thread_instance();
+        thread_enabled = thread_cc.enabled();
+        thread_cc.set_enabled(true);
+        value::List x(1, elem_ti);
+        value::List y(1, elem_ti);
+        x.set_value(0, y);
+        y.set_value(0, x);
+        thread_tracked = thread_cc.num_tracked();
+        thread_freed = thread_cc.collect().slots;
+    }).join();
+    CHECK(!thread_enabled);
+    CHECK(thread_tracked == 2);
+    CHECK(thread_freed == 2);
+    CHECK(cc.num_tracked() == tracked);
+
+    // programs run normally with frequent collections
+    cc.set_threshold(1);
+    CHECK(interpret_std("a = \"long enough string to be on heap\"; map (fun x:Int -> String { a }, [1,2]) ! 1") == "\"long enough string to be on heap\"");
+    CHECK(interpret_std("fold (fun (acc:[Int], x:Int) -> [Int] { [x] + acc }, []:[Int], [1,2,3])") == "[3, 2, 1]");
+    cc.collect();
+    cc.set_threshold(CycleCollector::default_threshold);
+    cc.set_enabled(false);
+}
+
+
+TEST_CASE( "Flat closures", "[script][machine]" )
+{
+    // function without nonlocals has single preallocated closure
+    Context& ctx = context();
+    Module module {ctx.interpreter.module_manager(), intern("<closures>")};
+    const Function& fn = module.get_main_function();
+    REQUIRE(!fn.has_nonlocals());
+    const auto* slot = fn.static_closure().heapslot();
+    CHECK(slot->is_immortal());
+    CHECK(fn.static_closure().heapslot()->slot() == slot->slot());
+    CHECK(fn.static_closure().function() == &fn);
+
+    // nonlocals are moved to the closure and copied back on each call,
+    // the closure keeps its own references
+    CHECK(interpret_std("f = fun (a:String, l:[Int]) { fun i:Int -> String { a + to_string (l ! i) } }; "
+                        "g = f (\"long enough string to be on heap \", [1,2,3]); "
+                        "g 0 + g 2") == "\"long enough string to be on heap 1long enough string to be on heap 3\"");
+    CHECK(interpret_std("f = fun k:Int { map (fun x:Int -> Int { x + k }, [1,2,3]) }; f 10") == "[11, 12, 13]");
+    CHECK(interpret_std("f = fun (a:Int, b:Int) { fun c:Int { fun d:Int { a * b + c * d } } }; f (2, 3) 4 5") == "26");
+    // non-capturing lambda, loaded many times
+    CHECK(interpret_std("map (fun x:Int -> Int { x * 2 }, [1,2,3])") == "[2, 4, 6]");
+}
+
+
 TEST_CASE( "SymbolTable", "[script][compiler]" )
 {
     SymbolTable symtab;
@@ -625,6 +932,28 @@ TEST_CASE( "Expressions", "[script][interpreter]" )
     CHECK(interpret_std("-1d << 32b") == "0d");
     CHECK(interpret_std("-2147483648d << 1b") == "0d");
 
+    // checked integer arithmetic
+    CHECK_THROWS_EC(interpret_std("9223372036854775807 + 1"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("-9223372036854775807 - 2"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("(-9223372036854775807 - 1) / -1"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("1 / 0"), ValueOutOfRange, "Division by zero");
+    CHECK(interpret_std("(-9223372036854775807 - 1) % -1") == "0");
+    CHECK(interpret_std("-7 / -1") == "7");
+    CHECK_THROWS_EC(interpret_std("0u - 1u"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("4294967296 * 2147483648"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("42535295865117307932921825928971026432i128 * 2i128") == "85070591730234615865843651857942052864q");
+    CHECK_THROWS_EC(interpret_std("42535295865117307932921825928971026432i128 * 4i128"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("-42535295865117307932921825928971026432i128 * -4i128"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("-42535295865117307932921825928971026432i128 * 4i128") == "-170141183460469231731687303715884105728q");
+    CHECK(interpret_std("3 ** 39") == "4052555153018976267");
+    CHECK_THROWS_EC(interpret_std("3 ** 40"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("3i128 ** 80i128") == "147808829414345923316083210206383297601q");
+    CHECK(interpret_std("2 ** 62") == "4611686018427387904");
+    CHECK_THROWS_EC(interpret_std("2 ** 63"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("(-2) ** 63") == "-9223372036854775808");
+    CHECK(interpret_std("(2 ** -1, (-1) ** -3, 1 ** -4)") == "(0, -1, 1)");
+    CHECK_THROWS_EC(interpret_std("0 ** -1"), ValueOutOfRange, "Division by zero");
+
     CHECK(interpret_std("sign -32") == "-1");
     CHECK(interpret_std("32 .sign") == "1");
 
@@ -1259,6 +1588,149 @@ TEST_CASE( "List map", "[script][interpreter]" )
     CHECK(interpret_std("map (succ, []:[Int])") == "[]");
     CHECK(interpret_std("map (succ, [41])") == "[42]");
     CHECK(interpret_std("map (succ, [1,2,3])") == "[2, 3, 4]");
+    CHECK(interpret_std("map (fun x:Int -> String { \"long enough string to be on heap\" }, [1,2]) ! 1") == "\"long enough string to be on heap\"");
+    CHECK(interpret_std("a = 10; map (fun x:Int -> Int { x + a }, [1,2,3])") == "[11, 12, 13]");  // closure
+    CHECK(interpret_std("len (map (succ, range (0, 100000)))") == "100000u");  // no deep recursion
+}
+
+
+TEST_CASE( "List filter, fold, zip, range", "[script][interpreter]" )
+{
+    CHECK(interpret_std("range (0, 5)") == "[0, 1, 2, 3, 4]");
+    CHECK(interpret_std("range (3, 3)") == "[]");
+    CHECK(interpret_std("range (3, -3)") == "[]");
+    CHECK(interpret_std("filter (fun x:Int -> Bool { x % 2 == 0 }, range (0, 10))") == "[0, 2, 4, 6, 8]");
+    CHECK(interpret_std("filter (fun x:Int -> Bool { false }, [1,2,3])") == "[]");
+    CHECK(interpret_std("filter (fun s:String -> Bool { s != \"\" }, [\"a\", \"\", \"b\"])") == "[\"a\", \"b\"]");
+    CHECK(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + x }, 0, range (1, 101))") == "5050");
+    CHECK(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + x }, 42, []:[Int])") == "42");
+    CHECK(interpret_std("fold (fun (acc:[Int], x:Int) -> [Int] { [x] + acc }, []:[Int], [1,2,3])") == "[3, 2, 1]");
+    CHECK(interpret_std("zip ([1,2,3], [\"a\", \"b\"])") == "[(1, \"a\"), (2, \"b\")]");
+    CHECK(interpret_std("zip ([]:[Int], [1])") == "[]");
+}
+
+
+TEST_CASE( "List ops with throwing function", "[script][interpreter]" )
+{
+    // the values held by the native loop are released when the called function throws
+    auto& cc = CycleCollector::thread_instance();
+    cc.set_enabled(true);
+    cc.set_threshold(0);
+    const auto tracked = cc.num_tracked();
+    // the list from `range` and a partial result `[[-10]]`
+    CHECK_THROWS_EC(interpret_std("map (fun x:Int -> [Int] { [10 / (x - 1)] }, range (0, 3))"),
+                    ValueOutOfRange, "Division by zero");
+    CHECK_THROWS_EC(interpret_std("filter (fun x:Int -> Bool { 10 / (x - 1) > 0 }, range (0, 3))"),
+                    ValueOutOfRange, "Division by zero");
+    CHECK_THROWS_EC(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + 10 / (x - 1) }, 0, range (0, 3))"),
+                    ValueOutOfRange, "Division by zero");
+    CHECK_THROWS_EC(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + 10 / (x - 1) }, 0, iter (range (0, 3)))"),
+                    ValueOutOfRange, "Division by zero");
+    // the element tested by lazy `filter`, the elements collected so far
+    CHECK_THROWS_EC(interpret_std("collect (filter (fun x:[Int] -> Bool { 10 / (x ! 0 - 1) > 0 }, iter [[0], [1], [2]]))"),
+                    ValueOutOfRange, "Division by zero");
+    CHECK_THROWS_EC(interpret_std("collect (map (fun x:Int -> [Int] { [10 / (x - 1)] }, iter_range (0, 3)))"),
+                    ValueOutOfRange, "Division by zero");
+    CHECK_THROWS_EC(interpret_std("collect (take (5, iterate (fun x:[Int] -> [Int] { [10 / (x ! 0 - 1)] }, [2])))"),
+                    ValueOutOfRange, "Division by zero");
+    context().interpreter.module_manager().clear();
+    CHECK(cc.num_tracked() == tracked);
+    cc.set_threshold(CycleCollector::default_threshold);
+    cc.set_enabled(false);
+}
+
+
+TEST_CASE( "Lazy sequences", "[script][interpreter]" )
+{
+    CHECK(interpret_std("iter_range (0, 5)") == "[..]");
+    CHECK(interpret_std("collect (iter_range (0, 5))") == "[0, 1, 2, 3, 4]");
+    CHECK(interpret_std("collect (iter_range (3, -3))") == "[]");
+    CHECK(interpret_std("collect (iter [\"a\", \"b\"])") == "[\"a\", \"b\"]");
+    CHECK(interpret_std("collect (map (succ, iter [1,2,3]))") == "[2, 3, 4]");
+    CHECK(interpret_std("collect (filter (fun x:Int -> Bool { x % 3 == 0 }, iter_range (0, 10)))") == "[0, 3, 6, 9]");
+    CHECK(interpret_std("collect (take (4, iterate (fun x:Int -> Int { x * 2 }, 1)))") == "[1, 2, 4, 8]");
+    CHECK(interpret_std("collect (map (succ, map (succ, iter_range (0, 3))))") == "[2, 3, 4]");  // fused
+    // elements are generated on demand, the whole sequence is never in memory
+    CHECK(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + x }, 0, iter_range (1, 1000001))") == "500000500000");
+    CHECK(interpret_std("fold (fun (acc:Int, x:Int) -> Int { acc + x }, 0, "
+                        "take (3, filter (fun x:Int -> Bool { x > 10 }, iterate (succ, 0))))") == "36");
+}
+
+
+TEST_CASE( "Map", "[script][interpreter]" )
+{
+    CHECK(interpret_std("map_from_list []:[(String, Int)]") == "[:]");
+    CHECK(interpret_std("map_from_list [(\"a\", 1)]") == "[\"a\": 1]");
+    CHECK(interpret_std("map_from_list [(\"a\", 1), (\"b\", 2), (\"a\", 3)] .map_len") == "2");
+    CHECK(interpret_std("m = map_from_list [(1, \"one\"), (2, \"two\")]; (map_get (m, 2, \"?\"), map_get (m, 3, \"?\"))") == "(\"two\", \"?\")");
+    CHECK(interpret_std("m = map_from_list [('x', 1.5)]; (map_has (m, 'x'), map_has (m, 'y'))") == "(true, false)");
+    CHECK(interpret_std("m = map_from_list [((1, 2), \"pair\")]; map_get (m, (1, 2), \"\")") == "\"pair\"");
+    // insert / remove return a new map, the original is not modified
+    CHECK(interpret_std("m = map_from_list [(1, 10)]; n = map_insert (m, 2, 20); (m.map_len, n.map_len, map_get (n, 2, 0))") == "(1u, 2u, 20)");
+    CHECK(interpret_std("m = map_from_list [(1, 10), (2, 20)]; n = map_remove (m, 1); (m.map_len, n.map_items)") == "(2u, [(2, 20)])");
+    CHECK(interpret_std("map_from_list [(1, [1, 2])] .map_items") == "[(1, [1, 2])]");
+    CHECK(interpret_std("f = fun m:[Int: Int] -> Bool { map_has (m, 42) }; f (map_from_list [(42, 0)])") == "true");
+}
+
+
+TEST_CASE( "Memoization", "[script][interpreter]" )
+{
+    MemoCache& cache = context().interpreter.machine().memo_cache();
+    const auto orig_stats = cache.stats();
+    // each fib is computed once (naive recursion would take forever)
+    CHECK(interpret_std("fib = fun n:Int -> Int { if n < 2 then n else memo (fib, n - 1) + memo (fib, n - 2) }; fib 90") == "2880067194370816120");
+    CHECK(cache.stats().misses - orig_stats.misses == 90);
+    CHECK(cache.stats().hits - orig_stats.hits == 88);
+    // closure - captured values are part of the key, tuple arg, heap-allocated result
+    CHECK(interpret_std("a = 10; f = fun n:Int -> Int { n + a }; (memo (f, 1), memo (f, 2))") == "(11, 12)");
+    CHECK(interpret_std("g = fun (a:Int, b:Int) -> Int { a * b }; memo (g, (6, 7))") == "42");
+    CHECK(interpret_std("f = fun n:Int -> String { \"long enough string to be on heap\" }; (memo (f, 1), memo (f, 1)).1") == "\"long enough string to be on heap\"");
+    // LRU eviction
+    const auto capacity = cache.capacity();
+    cache.clear();
+    cache.set_capacity(2);
+    const auto orig_evictions = cache.stats().evictions;
+    CHECK(interpret_std("f = fun n:Int -> Int { n * n }; (memo (f, 1), memo (f, 2), memo (f, 3), memo (f, 1))") == "(1, 4, 9, 1)");
+    CHECK(cache.stats().evictions - orig_evictions == 2);
+    CHECK(cache.size() == 2);
+    cache.set_capacity(capacity);
+    // impure functions are rejected by the compiler
+    CHECK_THROWS_EC(interpret_std("f = fun n:Int -> Void { write \"x\" }; memo (f, 1)"), MemoFunctionError);
+    CHECK_THROWS_EC(interpret_std("w = fun n:Int -> Void { write \"x\" }; f = fun n:Int -> Void { w n }; memo (f, 1)"), MemoFunctionError);
+    CHECK_THROWS_EC(interpret_std("f = fun s:String -> Int { 1 }; memo (f, \"key\")"), MemoFunctionError);  // key must be plain data
+    // ... or by the machine, when the function is not known at compile time
+    CHECK_THROWS_EC(interpret_std("m = fun g:(Int -> Void) -> Void { memo (g, 1) }; m (fun x:Int -> Void { write \"x\" })"), MemoFunctionError);
+}
+
+
+TEST_CASE( "Numeric list builtins", "[script][interpreter]" )
+{
+    CHECK(interpret_std("list_sum [1,2,3,4,5,6,7,8,9,10]") == "55");
+    CHECK(interpret_std("list_sum []:[Int]") == "0");
+    CHECK(interpret_std("list_sum [1d,2d,3d]") == "6d");
+    CHECK(interpret_std("list_sum [0.5f,1.5f,2.0f]") == "4.0f");
+    CHECK(interpret_std("list_min [3,-7,5,1,9,2,8,4,6]") == "-7");
+    CHECK(interpret_std("list_max [3,-7,5,1,9,2,8,4,6]") == "9");
+    CHECK(interpret_std("list_max [1.5, -2.5, 0.5]") == "1.5");
+    CHECK_THROWS_EC(interpret_std("list_min []:[Int]"), IndexOutOfBounds);
+    CHECK(interpret_std("list_dot ([1,2,3], [4,5,6])") == "32");
+    CHECK_THROWS_EC(interpret_std("list_dot ([1,2,3], [4,5])"), ValueOutOfRange);
+    CHECK(interpret_std("list_add ([1,2,3,4,5], [10,20,30,40,50])") == "[11, 22, 33, 44, 55]");
+    CHECK(interpret_std("list_sub ([1d,2d,3d], [3d,2d,1d])") == "[-2d, 0d, 2d]");
+    CHECK(interpret_std("list_mul ([1.5,2.0], [2.0,0.5])") == "[3.0, 1.0]");
+    CHECK(interpret_std("l = [1,2,3]; list_add (l, l) + l") == "[2, 4, 6, 1, 2, 3]");  // `l` is shared, not modified
+    // integer overflow is checked, like with the scalar operators
+    CHECK_THROWS_EC(interpret_std("list_sum [9223372036854775807, 1, 2, 3, 4, 5, 6, 7, 8]"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("list_sum [9223372036854775807, 1, 2, 3, 4, 5, 6, 7, -28]") == "9223372036854775807");  // partial sums don't matter
+    CHECK_THROWS_EC(interpret_std("list_dot ([4294967296, 1], [2147483648, 1])"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("list_add ([1d,2d,3d,4d,5d,6d,7d,8d,9d], [1d,1d,1d,1d,1d,2147483647d,1d,1d,1d])"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("list_sub ([-9223372036854775807, 0], [2, 0])"), ValueOutOfRange, "Integer overflow");
+    CHECK_THROWS_EC(interpret_std("list_mul ([65536d, 1d], [32768d, 1d])"), ValueOutOfRange, "Integer overflow");
+    CHECK(interpret_std("list_find ([5,6,7,8,9,10,11,12,13], 12)") == "7");
+    CHECK(interpret_std("list_find ([5,6,7], 42)") == "-1");
+    CHECK(interpret_std("list_equal ([1,2,3], [1,2,3])") == "true");
+    CHECK(interpret_std("list_equal ([1,2,3], [1,2,4])") == "false");
+    CHECK(interpret_std("list_equal ([1,2,3], [1,2])") == "false");
 }
 
 
@@ -1318,6 +1790,84 @@ TEST_CASE( "With expression, I/O streams", "[script][interpreter]" )
     CHECK(interpret("with (in=(open (\""s + escape(filename.string()) + "\", \"r\")))\n"
                     "    read 9u") == "\"this goes\"");
     CHECK(fs::remove(filename));
+
+    // buffered FD stream: small writes are coalesced, the order is kept
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    Stream out(Stream::FdRef{fds[1]});
+    Stream in(Stream::FdRef{fds[0]});
+    {
+        OutputBuffers buffers;
+        CHECK(buffers.buffering(out) == OutputBuffers::Buffering::Full);  // not a terminal
+        buffers.set_buffering(out, OutputBuffers::Buffering::Full, 8);
+        CHECK(buffers.write(out, "abc"sv) == 3);
+        CHECK(buffers.write(out, "def"sv) == 3);
+        CHECK(buffers.write(out, "ghijk"sv) == 5);  // doesn't fit - writes all, in order
+        CHECK(in.read(11) == "abcdefghijk");
+        CHECK(buffers.write(out, "xy"sv) == 2);
+        CHECK(buffers.read(in, 2) == "xy");  // reading flushes the output
+        buffers.set_buffering(out, OutputBuffers::Buffering::None);
+        CHECK(buffers.write(out, "z"sv) == 1);
+        CHECK(in.read(1) == "z");
+        // flush_all keeps the explicit settings, forget drops them
+        CHECK(buffers.write(out, "w"sv) == 1);
+        buffers.flush_all();
+        CHECK(in.read(1) == "w");
+        CHECK(buffers.buffering(out) == OutputBuffers::Buffering::None);
+        buffers.forget(out);
+        CHECK(buffers.buffering(out) == OutputBuffers::Buffering::Full);
+        CHECK(buffers.write(out, "v"sv) == 1);
+    }  // the buffers are flushed when destroyed, before the fds are closed
+    CHECK(in.read(1) == "v");
+    close(fds[0]);
+    close(fds[1]);
+
+    // owned fd is buffered, too, and flushed before it's closed
+    REQUIRE(pipe(fds) == 0);
+    in = Stream(Stream::FdRef{fds[0]});
+    {
+        OutputBuffers buffers;
+        value::Stream owned {Stream(Stream::Fd{fds[1]})};
+        CHECK(buffers.write(owned.value(), "abc"sv) == 3);
+        owned.decref();  // the last reference - closes the fd
+    }
+    CHECK(in.read(4) == "abc");
+    CHECK(in.read(1).empty());  // EOF - the write end is closed
+    close(fds[0]);
+
+    // a machine writes out its buffered output at the end of each invocation,
+    // the explicit settings are kept
+    REQUIRE(pipe(fds) == 0);
+    out = Stream(Stream::FdRef{fds[1]});
+    in = Stream(Stream::FdRef{fds[0]});
+    auto& machine_buffers = context().interpreter.machine().stack().output_buffers();
+    machine_buffers.set_buffering(out, OutputBuffers::Buffering::Line);
+    CHECK(machine_buffers.write(out, "abc"sv) == 3);  // no newline - stays in the buffer
+    CHECK(interpret("42") == "42");
+    CHECK(in.read(3) == "abc");
+    CHECK(machine_buffers.buffering(out) == OutputBuffers::Buffering::Line);
+    machine_buffers.forget(out);  // forget the fd before it's closed
+    close(fds[0]);
+    close(fds[1]);
+
+    // a script writing to an owned fd, setting the buffering mode
+    REQUIRE(pipe(fds) == 0);
+    in = Stream(Stream::FdRef{fds[0]});
+    {
+        auto& mm = context().interpreter.module_manager();
+        auto module = std::make_shared<Module>(mm, intern("fd_out"));
+        module->import_module("builtin");
+        module->symtab().add({intern("fd"), Symbol::Value,
+                              module->add_value(TypedValue{value::Stream(Stream(Stream::Fd{fds[1]}))})});
+        auto result = context().interpreter.eval(module,
+                "set_buffering (fd, \"line\"); with fd { write \"abc\"; write \"def\\n\" }");
+        result.decref();
+        CHECK(in.read(7) == "abcdef\n");
+        CHECK(machine_buffers.buffering(Stream(Stream::Fd{fds[1]})) == OutputBuffers::Buffering::Line);
+        mm.clear();
+    }  // the module is released, closing the fd and dropping its settings
+    CHECK(in.read(1).empty());
+    close(fds[0]);
 }
 
 
@@ -1428,6 +1978,351 @@ TEST_CASE( "Build module", "[script][module]" )
 }
 
 
+TEST_CASE( "Module file format version", "[script][module]" )
+{
+    Context& ctx = context();
+    auto module_name = intern("<input>");
+    const auto src_id = ctx.interpreter.source_manager().add_source(module_name,
+            "f = fun x:Int -> Int { x + 1 }; g = fun m:[Int: Int] -> [Int: Int] { m }; f 2");
+    auto module = std::make_shared<Module>(ctx.interpreter.module_manager(), module_name);
+    module->import_module("builtin");
+    REQUIRE(ctx.interpreter.module_manager().replace_module(module_name, module) != no_index);
+    ast::Module ast;
+    ctx.interpreter.parser().parse(src_id, ast);
+    ctx.interpreter.compiler().compile(module->get_main_scope(), ast);
+
+    const auto filename = (fs::temp_directory_path() / "xci_test_script.firm").string();
+    REQUIRE(module->save_to_file(filename));
+    {
+        Module loaded(ctx.interpreter.module_manager(), intern("loaded"));
+        CHECK(loaded.load_from_file(filename));
+        CHECK(loaded.num_functions() == module->num_functions());
+    }
+
+    // different version is rejected
+    {
+        std::ofstream f(filename, std::ios::binary);
+        xci::data::BinaryWriter writer(f, true);
+        writer(uint32_t(Module::format_version + 1));
+    }
+    {
+        Module loaded(ctx.interpreter.module_manager(), intern("loaded"));
+        CHECK(!loaded.load_from_file(filename));
+    }
+
+    // unversioned file (the first chunk are the imported modules)
+    {
+        std::ofstream f(filename, std::ios::binary);
+        xci::data::BinaryWriter writer(f, true);
+        std::vector<std::string> modules {"builtin"};
+        writer(modules);
+    }
+    {
+        Module loaded(ctx.interpreter.module_manager(), intern("loaded"));
+        CHECK(!loaded.load_from_file(filename));
+    }
+
+    fs::remove(filename);
+    ctx.interpreter.module_manager().clear();
+}
+
+
+TEST_CASE( "Bytecode verifier", "[script][module]" )
+{
+    // std is compiled by the same compiler, all its functions pass
+    check_verified(context().interpreter.module_manager());
+    const auto std_module = context().interpreter.module_manager().import_module("std");
+    CHECK(std_module->num_functions() > 0);
+    check_verified(context().interpreter.module_manager());
+
+    Context& ctx = context();
+    auto module_name = intern("<input>");
+    const char* module_source = "f = fun (a:Int, b:Int) -> Int { if a > b then a - b else b - a }; f (3, 5)";
+    const auto src_id = ctx.interpreter.source_manager().add_source(module_name, module_source);
+    auto module = std::make_shared<Module>(ctx.interpreter.module_manager(), module_name);
+    module->import_module("builtin");
+    module->import_module("std");
+    REQUIRE(ctx.interpreter.module_manager().replace_module(module_name, module) != no_index);
+    ast::Module ast;
+    ctx.interpreter.parser().parse(src_id, ast);
+    ctx.interpreter.compiler().compile(module->get_main_scope(), ast);
+
+    // the compiled functions pass, they run without runtime checks
+    const auto& main_fn = module->get_main_function();
+    CHECK(main_fn.is_verified());
+    const auto f = module->find_function(intern("f"));
+    REQUIRE(f);
+    CHECK(module->get_function(f)->is_verified());
+    ctx.interpreter.machine().call(main_fn);
+    const auto result = ctx.interpreter.machine().stack().pull_typed(main_fn.effective_return_type());
+    CHECK(result.value().to_int64() == 2);
+
+    // bad bytecode is rejected
+    auto& symtab = module->symtab().add_child(intern("bad"));
+    const auto bad_id = module->add_function(Function{*module, symtab});
+    Function& bad = module->get_function(bad_id.index);
+    bad.signature().set_parameter(ti_int());
+    bad.signature().set_return_type(ti_int());
+    bad.set_bytecode();
+    auto check_bad = [&bad](std::initializer_list<uint8_t> code) {
+        bad.set_bytecode();
+        for (auto b : code)
+            bad.bytecode().add(b);
+        CHECK_THROWS_EC(verify_bytecode(bad), BadBytecode);
+        CHECK(!bad.is_verified());
+    };
+    const auto op = [](Opcode opcode) { return uint8_t(opcode); };
+    check_bad({});  // missing RET
+    check_bad({op(Opcode::Noop)});
+    check_bad({0xff, op(Opcode::Ret)});  // bad opcode
+    check_bad({op(Opcode::Copy), 0x80});  // truncated operand
+    check_bad({op(Opcode::Jump), 5, op(Opcode::Ret)});  // jump out of code
+    check_bad({op(Opcode::Jump), 1, op(Opcode::Copy), 0, 8, op(Opcode::Ret)});  // jump inside instruction
+    check_bad({op(Opcode::Call0), 100, op(Opcode::Ret)});  // function index
+    check_bad({op(Opcode::Call), 10, 0, op(Opcode::Ret)});  // module index
+    check_bad({op(Opcode::Add), 0x98, op(Opcode::Ret)});  // operand types differ
+    check_bad({op(Opcode::Copy), 0, 16, op(Opcode::Ret)});  // copy out of frame
+    check_bad({op(Opcode::Drop), 0, 16, op(Opcode::Ret)});  // stack underflow
+    check_bad({op(Opcode::Cast), 0x98, op(Opcode::Ret)});  // returns Int32 instead of Int
+    check_bad({op(Opcode::LoadStatic), 0xff, 0x7f, op(Opcode::Ret)});  // static index
+
+    // RET with the parameter returned back
+    bad.set_bytecode();
+    bad.bytecode().add_opcode(Opcode::Ret);
+    verify_bytecode(bad);
+    CHECK(bad.is_verified());
+
+    // unverified bytecode is checked at runtime: MakeClosure pulls nonlocals of wrong size
+    auto& closure_symtab = module->symtab().add_child(intern("closure"));
+    const auto closure_id = module->add_function(Function{*module, closure_symtab});
+    Function& closure = module->get_function(closure_id.index);
+    closure.set_bytecode();
+    closure.bytecode().add_opcode(Opcode::Ret);
+    REQUIRE(closure_id.index < 0x80);  // single byte LEB128
+    auto check_make_closure = [&](std::vector<TypeInfo> nonlocals, ErrorCode expected) {
+        closure.signature().nonlocals = std::move(nonlocals);
+        Function unverified {*module, symtab};
+        unverified.signature().set_parameter(ti_int());
+        unverified.signature().set_return_type(ti_int());
+        unverified.set_bytecode();
+        unverified.bytecode().add_B1(Opcode::MakeClosure, uint8_t(closure_id.index));
+        unverified.bytecode().add_opcode(Opcode::Ret);
+        Machine machine;
+        machine.stack().push(value::Int(1));
+        CHECK_THROWS_MATCHES(machine.call(unverified), ScriptError, MatchScriptError(expected));
+    };
+    check_make_closure({ti_int(), ti_int()}, ErrorCode::StackUnderflow);
+    check_make_closure({ti_int32()}, ErrorCode::BadInstruction);
+
+    ctx.interpreter.module_manager().clear();
+}
+
+
+TEST_CASE( "Tree shaking", "[script][module]" )
+{
+    Context& ctx = context();
+    auto module_name = intern("<input>");
+    const char* module_source =
+            "unused = fun x:Int -> String { \"long enough string to be on heap\" }; "
+            "id = fun<T> x:T -> T { x }; "
+            "adder = fun a:Int { fun b:Int { a + b } }; "
+            "adder (id 1) 2";
+    const auto src_id = ctx.interpreter.source_manager().add_source(module_name, module_source);
+    auto module = std::make_shared<Module>(ctx.interpreter.module_manager(), module_name);
+    module->import_module("builtin");
+    module->import_module("std");
+    REQUIRE(ctx.interpreter.module_manager().replace_module(module_name, module) != no_index);
+    ast::Module ast;
+    ctx.interpreter.parser().parse(src_id, ast);
+    ctx.interpreter.compiler().compile(module->get_main_scope(), ast);
+
+    const auto stats = tree_shake(*module);
+    CHECK(stats.functions.after == module->num_functions());
+    CHECK(stats.functions.after < stats.functions.before);  // unused, generic id
+    CHECK(stats.values.after < stats.values.before);
+    CHECK(stats.code_bytes.after < stats.code_bytes.before);
+    CHECK(!module->find_function(intern("unused")));
+    CHECK(module->find_function(intern("adder")));
+
+    // the renumbered functions run and pass the verifier
+    const auto& main_fn = module->get_main_function();
+    CHECK(main_fn.is_verified());
+    ctx.interpreter.machine().call(main_fn);
+    const auto result = ctx.interpreter.machine().stack().pull_typed(main_fn.effective_return_type());
+    CHECK(result.value().to_int64() == 3);
+
+    ctx.interpreter.module_manager().clear();
+}
+
+
+TEST_CASE( "Prepared call", "[script][machine]" )
+{
+    Context& ctx = context();
+    auto module_name = intern("<input>");
+    const char* module_source =
+            "sub = fun (a:Int, b:Int) -> Int { a - b }; "
+            "scale = fun (x:Float, n:Int32) -> Float { x * n.Float }; "
+            "is_pos = fun x:Int -> Bool { x > 0 }; "
+            "greet = fun n:Int -> String { \"Hello, \" + to_string n + \" times, and it's long enough\" }; "
+            "say = fun n:Int -> Int { write \"hi\"; n }; "
+            "sub (3, 2)";
+    const auto src_id = ctx.interpreter.source_manager().add_source(module_name, module_source);
+    auto module = std::make_shared<Module>(ctx.interpreter.module_manager(), module_name);
+    module->import_module("builtin");
+    module->import_module("std");
+    REQUIRE(ctx.interpreter.module_manager().replace_module(module_name, module) != no_index);
+    ast::Module ast;
+    ctx.interpreter.parser().parse(src_id, ast);
+    ctx.interpreter.compiler().compile(module->get_main_scope(), ast);
+    const auto get_fn = [&module](std::string_view name) -> const Function& {
+        const auto* fn = module->get_function(module->find_function(intern(name)));
+        REQUIRE(fn);
+        return *fn;
+    };
+    Machine& machine = ctx.interpreter.machine();
+
+    // plain data args and result, the first arg is on top
+    PreparedCall sub {machine, get_fn("sub")};
+    CHECK(sub.is_plain());
+    CHECK(sub.param_size() == 16);
+    CHECK(sub.return_size() == 8);
+    for (int64_t i = 0; i != 100; ++i)
+        CHECK(sub.call<int64_t>(i, int64_t{3}) == i - 3);
+    CHECK(machine.stack().empty());
+    CHECK(machine.stack().n_values() == 0);
+
+    PreparedCall scale {machine, get_fn("scale")};
+    CHECK(scale.call<double>(1.5, int32_t{4}) == 6.0);
+    PreparedCall is_pos {machine, get_fn("is_pos")};
+    CHECK(is_pos.call<bool>(int64_t{5}));
+    CHECK(!is_pos.call<bool>(int64_t{-5}));
+
+    // heap value in result - read it with call_raw, take over the reference
+    PreparedCall greet {machine, get_fn("greet")};
+    CHECK(!greet.is_plain());
+    std::string greeting;
+    greet.call_raw([](std::byte* p) { value::Int(3).write(p); },
+                   [&greeting](const std::byte* p) {
+                       value::String s;
+                       s.read(p);
+                       greeting = s.value();
+                       s.decref();
+                   });
+    CHECK(greeting == "Hello, 3 times, and it's long enough");
+    CHECK(machine.stack().empty());
+
+    // buffered output is written out after each call
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    Stream in(Stream::FdRef{fds[0]});
+    value::Stream out {Stream(Stream::FdRef{fds[1]})};
+    machine.stack().swap_stream_out(out);
+    PreparedCall say {machine, get_fn("say")};
+    CHECK(say.flush_output());
+    CHECK(say.call<int64_t>(int64_t{7}) == 7);
+    CHECK(in.read(2) == "hi");
+    // ... unless disabled, then it's flushed explicitly
+    say.set_flush_output(false);
+    CHECK(say.call<int64_t>(int64_t{8}) == 8);
+    CHECK(say.call<int64_t>(int64_t{9}) == 9);
+    machine.stack().output_buffers().flush_all();
+    CHECK(in.read(4) == "hihi");
+    machine.stack().swap_stream_out(out);
+    out.decref();
+    close(fds[0]);
+    close(fds[1]);
+
+    ctx.interpreter.module_manager().clear();
+}
+
+
+TEST_CASE( "Constant pool", "[script][module]" )
+{
+    ModuleManager& mm = context().interpreter.module_manager();
+    const ConstantPool& pool = *mm.constant_pool();
+    const auto stats_before = pool.stats();
+    const std::string_view long_str = "long enough string to be on heap";
+
+    // the same string in two modules shares the heap slot
+    Module m1 {mm, intern("m1")};
+    Module m2 {mm, intern("m2")};
+    const auto s1 = m1.add_value(TypedValue(value::String(long_str)));
+    const auto s2 = m2.add_value(TypedValue(value::String(long_str)));
+    const auto& v1 = m1.get_value(s1).get<StringV>();
+    const auto& v2 = m2.get_value(s2).get<StringV>();
+    CHECK(v1.is_same(v2));
+    CHECK(v1.slot.is_immortal());
+    CHECK(pool.stats().hits == stats_before.hits + 1);
+    CHECK(pool.stats().bytes_saved == stats_before.bytes_saved + long_str.size());
+
+    // refcounting doesn't affect the pooled slot
+    TypedValue copy = m1.get_value(s1);
+    copy.incref();
+    copy.decref();
+    copy.decref();
+    CHECK(v2.slot.is_immortal());
+    CHECK(m2.get_value(s2).get<StringV>().value() == long_str);
+
+    // lists of plain data are compared by content
+    value::List l1(3, ti_int32());
+    value::List l2(3, ti_int32());
+    for (int i = 0; i != 3; ++i) {
+        l1.set_value(i, value::Int32(i));
+        l2.set_value(i, value::Int32(i));
+    }
+    const auto i1 = m1.add_value(TypedValue(l1, ti_list(ti_int32())));
+    const auto i2 = m2.add_value(TypedValue(l2, ti_list(ti_int32())));
+    CHECK(m1.get_value(i1).value().heapslot() == m2.get_value(i2).value().heapslot());
+    // ... and deduplicated in the module, too
+    value::List l3(3, ti_int32());
+    for (int i = 0; i != 3; ++i)
+        l3.set_value(i, value::Int32(i));
+    CHECK(m1.add_value(TypedValue(l3, ti_list(ti_int32()))) == i1);
+
+    // inline strings and plain values are not pooled
+    const auto size_before = pool.size();
+    m1.add_value(TypedValue(value::String("short")));
+    m1.add_value(TypedValue(value::Int32(42)));
+    CHECK(pool.size() == size_before);
+
+    // string literals in scripts are pooled, and released with the module
+    const auto misses_before = pool.stats().misses;
+    const auto pool_size = pool.size();
+    CHECK(interpret("\"another string which is stored on heap\"") == "\"another string which is stored on heap\"");
+    CHECK(pool.size() == pool_size);
+    CHECK(interpret("\"another string which is stored on heap\"") == "\"another string which is stored on heap\"");
+    CHECK(pool.stats().misses == misses_before + 2);
+
+    // a constant returned from the VM is not tied to the module
+    auto result = context().interpreter.eval("\"another string which is stored on heap\"", false);
+    CHECK(!result.get<StringV>().slot.is_immortal());
+    mm.clear();
+    CHECK(result.get<StringV>().value() == "another string which is stored on heap");
+    result.decref();
+}
+
+
+TEST_CASE( "Constant pool: release", "[script][module]" )
+{
+    ModuleManager& mm = context().interpreter.module_manager();
+    const ConstantPool& pool = *mm.constant_pool();
+    const auto size_before = pool.size();
+    const std::string_view long_str = "long enough string to be on heap";
+    {
+        Module m1 {mm, intern("m1")};
+        m1.add_value(TypedValue(value::String(long_str)));
+        {
+            Module m2 {mm, intern("m2")};
+            m2.add_value(TypedValue(value::String(long_str)));
+            CHECK(pool.size() == size_before + 1);
+        }
+        // still used by m1
+        CHECK(pool.size() == size_before + 1);
+    }
+    CHECK(pool.size() == size_before);
+}
+
+
 TEST_CASE( "Format", "[script][std]")
 {
     CHECK(interpret_std("to_string false") == R"("false")");
@@ -1524,6 +2419,46 @@ TEST_CASE( "Native functions: lambda", "[script][native]" )
 }
 
 
+TEST_CASE( "Native functions: scalar args", "[script][native]" )
+{
+    Context& ctx = context();
+    const auto orig_flags = ctx.interpreter.compiler().flags();
+    int64_t state = 0;
+    // with O1, the native calls are compiled to CALL_NATIVE
+    for (auto flags : {orig_flags, Compiler::Flags::O1}) {
+        ctx.interpreter.configure(flags);
+        auto module = ctx.interpreter.module_manager().make_module("native");
+
+        // args of all sizes are read directly from stack (no Values)
+        module->add_native_function("mix",
+                [](bool b, char c, uint8_t u, int16_t h, float f, double d) -> double
+                { return (b ? 1 : -1) * (double(c) + u + h + f + d); });
+        module->add_native_function("next_char", [](char32_t c) { return char32_t(c + 1); });
+        module->add_native_function("is_neg", [](int32_t a) { return a < 0; });
+        module->add_native_function("accum",
+                [](void* s, int64_t a) { *(int64_t*)(s) += a; },
+                &state);
+
+        auto result = ctx.interpreter.eval(std::move(module), R"(
+            accum 5; accum 7;
+            (mix (false, 'a', 200b, -300h, 0.5f, 0.25), next_char 'x', is_neg (-1d), is_neg 1d)
+        )");
+        std::ostringstream os;
+        os << result;
+        CHECK(os.str() == "(2.25, 'y', true, false)");
+        result.decref();
+        ctx.interpreter.module_manager().clear();
+    }
+    CHECK(state == 24);
+    ctx.interpreter.configure(orig_flags);
+
+    // check generated code
+    CHECK(optimize_code(Compiler::Flags::OptimizeNativeCall, R"(string_concat ("a", "b"))").find(
+            "CALL_NATIVE         1 ") != std::string::npos);
+    CHECK(optimize_code(Compiler::Flags::OptimizeNativeCall, "1 + 2").find("CALL_NATIVE") == std::string::npos);
+}
+
+
 TEST_CASE( "Fold const expressions", "[script][optimizer]" )
 {
     // fold constant if-expression
@@ -1561,6 +2496,33 @@ TEST_CASE( "Fold const expressions", "[script][optimizer]" )
 }
 
 
+TEST_CASE( "Fuse list operations", "[script][optimizer]" )
+{
+    CHECK(optimize("f = fun l:[Int] -> [Int] { map (succ, map (pred, l)) }") == "f = fun l:[Int] -> [Int] {map_compose (succ, pred, l)}; ()");
+    // longer chains are fused into single map_compose, the functions are composed
+    CHECK(optimize("f = fun l:[Int] -> [Int] { map (succ, map (succ, map (pred, l))) }") == "f = fun l:[Int] -> [Int] {map_compose (succ, compose (succ, pred), l)}; ()");
+    CHECK(optimize("f = fun l:[Int] -> [Int] { map (succ, map (succ, map (pred, map (pred, l)))) }") == "f = fun l:[Int] -> [Int] {map_compose (succ, compose (succ, compose (pred, pred)), l)}; ()");
+    // map over filter, fold over map
+    CHECK(optimize("f = fun l:[Int] -> [Int] { map (succ, filter (fun x:Int -> Bool { x > 0 }, l)) }") == "f = fun l:[Int] -> [Int] {map_filter (succ, fun x:Int -> Bool {(>) (x, 0)}, l)}; ()");
+    CHECK(optimize("f = fun l:[Int] -> Int { fold (add, 0, map (succ, l)) }") == "f = fun l:[Int] -> Int {fold_map (add, 0, succ, l)}; ()");
+    CHECK(optimize("f = fun l:[Int] -> Int { fold (add, 0, map (succ, map (pred, l))) }") == "f = fun l:[Int] -> Int {fold_map (add, 0, compose (succ, pred), l)}; ()");
+
+    // the fused call computes the same result
+    const auto orig_flags = context().interpreter.compiler().flags();
+    context().interpreter.configure(Compiler::Flags::O2);
+    CHECK(interpret_std("map (succ, map (succ, [1,2,3]))") == "[3, 4, 5]");
+    CHECK(interpret_std("l = [1,2,3]; map (fun x:Int -> (Int, Int) { (x, x * x) }, map (succ, l))") == "[(2, 4), (3, 9), (4, 16)]");
+    CHECK(interpret_std("map (succ, map (fun x:Int { x * 10 }, map (pred, [1,2,3])))") == "[1, 11, 21]");
+    CHECK(interpret_std("map (succ, filter (fun x:Int { x > 1 }, [1,2,3]))") == "[3, 4]");
+    CHECK(interpret_std("map (succ, map (pred, filter (fun x:Int { x > 1 }, [1,2,3])))") == "[2, 3]");
+    CHECK(interpret_std("fold (fun (a:Int, x:Int) -> Int { a + x }, 0, map (succ, map (succ, [1,2,3])))") == "12");
+    CHECK(interpret_std("collect (map (succ, filter (fun x:Int { x > 1 }, iter_range (0, 4))))") == "[3, 4]");
+    // user-defined function of the same name is not fused
+    CHECK(interpret_std("map = fun (f:Int->Int, l:[Int]) -> [Int] { l }; map (succ, map (pred, [1]))") == "[1]");
+    context().interpreter.configure(orig_flags);
+}
+
+
 TEST_CASE( "Optimize copy-drop, tail call", "[script][optimizer]" )
 {
     // tail call optimization - fewer frames pushed on stack
@@ -1583,4 +2545,63 @@ TEST_CASE( "Optimize copy-drop, tail call", "[script][optimizer]" )
          SWAP                8 4
          TAIL_CALL0          1 (f2 (b: Int32, a: Int64) -> Int32)
     )");
+    // self tail call (also from if-branch) is a loop - no CALL, no frame
+    const auto loop_code = optimize_code(opt, "f=fun (acc:Int, n:Int) -> Int { if n == 0 then acc else f (acc + n, n - 1) }", "f");
+    CHECK(loop_code.find("JUMP_BACK") != std::string::npos);
+    CHECK(loop_code.find("CALL0") == std::string::npos);
+    context().interpreter.configure(Compiler::Flags::O1);
+    CHECK(interpret_std("f=fun (acc:Int, n:Int) -> Int { if n == 0 then acc else f (acc + n, n - 1) }; f (0, 100000)") == "5000050000");
+    CHECK(interpret_std("f=fun n:Int -> UInt { if n == 0 then __n_frames else f (n - 1) }; f 10") == "1u");
+    context().interpreter.configure(orig_flags);
+}
+
+
+TEST_CASE( "Struct field access", "[script][compiler]" )
+{
+    // field of a param or nonlocal is copied directly from the frame, other fields are not touched
+    const auto field_code = optimize_code(Compiler::Flags{}, "f=fun a:(x:Int,y:Float) { a.y }", "f");
+    CHECK(field_code.find("COPY                8 8") != std::string::npos);
+    CHECK(field_code.find("DROP                0") == std::string::npos);
+    const auto nested_code = optimize_code(Compiler::Flags{}, "f=fun (c:(a:Int,b:(u:Int32,v:String)),d:Int) { c.b.v }", "f");
+    CHECK(nested_code.find("COPY                12 16") != std::string::npos);
+    CHECK(nested_code.find("DROP                0") == std::string::npos);
+    // heap fields, nested structs, static values, captured structs
+    CHECK(interpret("f=fun (c:(a:Int,b:(u:Int32,v:String)),d:Int) { c.b.v }; f ((1,(2d,\"abc\")),3)") == "\"abc\"");
+    CHECK(interpret("f=fun (c:(a:Int,b:(u:Int32,v:String)),d:Int) { c.b.u }; f ((1,(2d,\"abc\")),3)") == "2d");
+    CHECK(interpret("r=(a=1, b=(u=2d, v=\"abc\")); r.b.v") == "\"abc\"");
+    CHECK(interpret("f=fun s:(a:Int,b:String) { fun x:Int { s.b } }; f (1,\"abc\") 2") == "\"abc\"");
+    CHECK(interpret("f=fun s:(a:Int,b:String) { fun x:Int { (s.a, x) } }; f (1,\"abc\") 2") == "(1, 2)");
+}
+
+
+TEST_CASE( "JIT compiler", "[script][jit]" )
+{
+    if (!jit::is_available())
+        return;
+    Machine& machine = context().interpreter.machine();
+    const auto orig_threshold = machine.jit_threshold();
+    const auto orig_compiled = machine.jit_stats().compiled;
+    machine.set_jit_threshold(1);  // compile on first call
+
+    // arithmetic, comparisons (intrinsics are inlined)
+    CHECK(interpret_std("f=fun (a:Int, b:Int) -> Int { a * b - 3 }; f (6, 7)") == "39");
+    CHECK(interpret_std("f=fun (a:Int, b:Int) -> Int { (a / b, a % b, -a) }.0; f (-7, 2)") == "-3");
+    CHECK(interpret_std("f=fun (a:UInt, b:UInt) -> Bool { a > b }; (f (2u, 1u), f (1u, 2u))") == "(true, false)");
+    CHECK(interpret_std("f=fun x:Float -> Float { x * 2.0 + 0.5 }; f 1.5") == "3.5");
+    CHECK(interpret_std("f=fun x:Float -> Bool { x < 1.0 }; (f 0.5, f 1.0)") == "(true, false)");
+    // branches, recursion
+    CHECK(interpret_std("f=fun n:Int->Int { if n == 1 then 1 else n * f (n-1) }; f 7") == "5040");
+    CHECK(interpret_std("f=fun x:Int->Int { if x < 2 then x else f (x-1) + f (x-2) }; f 20") == "6765");
+    // errors are reported like in interpreter, the stack is unwound
+    CHECK_THROWS_EC(interpret_std("f=fun (a:Int, b:Int) -> Int { a / b }; f (1, 0)"), ValueOutOfRange);
+    CHECK_THROWS_EC(interpret_std("f=fun x:Int -> Int { x * x }; f 4294967296"), ValueOutOfRange);
+    CHECK(machine.jit_stats().compiled > orig_compiled);
+
+    // self tail call is a jump - no stack frames, no native recursion
+    const auto orig_flags = context().interpreter.compiler().flags();
+    context().interpreter.configure(Compiler::Flags::O1);
+    CHECK(interpret_std("fi=fun (acc:Int, n:Int) -> Int { if n == 0 then acc else fi (acc + n, n - 1) }; fi (0, 1000000)") == "500000500000");
+    context().interpreter.configure(orig_flags);
+
+    machine.set_jit_threshold(orig_threshold);
 }
@@ -15,6 +15,7 @@
 #include <xci/core/TermCtl.h>
 #include <xci/core/mixin.h>
 #include <xci/compat/macros.h>
+#include <xci/config.h>
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
@@ -23,14 +24,23 @@
 #include <hs/hs.h>
 
 #include <cstring>
+#include <cstdlib>
 #include <utility>
 #include <string_view>
 #include <atomic>
 #include <charconv>
+#include <optional>
+#include <deque>
 
 #include <unistd.h>
 #include <ctype.h>
 
+#ifdef HAVE_IO_URING
+#include <xci/core/IoRing.h>
+#include <linux/io_uring.h>  // IORING_OP_*
+#include <sys/resource.h>  // getrlimit
+#endif
+
 using namespace xci::core;
 using namespace xci::core::argparser;
 
@@ -582,7 +592,7 @@ static void print_bin_table(const Theme& theme)
 
 
 static void print_path_with_attrs(const std::string& name, const FileTree::PathNode& path,
-                                  struct stat& st)
+                                  const struct stat& st)
 {
     // Adaptive column width for user, group
     static std::atomic<size_t> w_user = 0;
@@ -672,6 +682,76 @@ private:
 };
 
 
+/// Hyperscan stream scan of a file, which is read in chunks.
+/// The reader maintains two buffers, so the previous one can be saved
+/// and used together with current one to complete lines that span through buffer boundary.
+class HyperscanStream: private NonCopyable {
+public:
+    // id == IdNewline is special pattern for matching newlines
+    // \return 1 to stop matching, 0 to continue
+    using Callback = std::function<int(const ScanFileBuffers& bufs,
+                                       PatternId id, uint64_t from, uint64_t to)>;
+
+    HyperscanStream(const hs_database_t* db, hs_scratch_t* scratch, Callback&& cb)
+        : m_scratch(scratch), m_cb(std::move(cb))
+    {
+        m_result = hs_open_stream(db, 0, &m_stream);
+        if (m_result != HS_SUCCESS)
+            m_stream = nullptr;
+    }
+
+    ~HyperscanStream() {
+        // no longer interested in matches or errors, just close it
+        if (m_stream != nullptr)
+            hs_close_stream(m_stream, m_scratch, nullptr, nullptr);
+    }
+
+    /// False after an error or when the callback stopped the scan
+    bool ok() const { return m_result == HS_SUCCESS; }
+
+    /// Scan next chunk of the file. The previous chunk must still be valid.
+    void scan(const char* data, size_t size) {
+        // Pass the buffers to the callback
+        auto& buf0 = m_bufs.buffer[0];
+        auto& buf1 = m_bufs.buffer[1];
+        buf0 = buf1;
+        buf1.data = data;
+        buf1.size = size;
+        buf1.offset += buf0.size;
+
+        m_result = hs_scan_stream(m_stream, data, unsigned(size), 0, m_scratch, handler, this);
+
+        // notify: swapping buffers
+        (void) m_cb(m_bufs, IdFinishBuffer, 0, 0);
+    }
+
+    /// Finish the scan at end of file
+    /// \returns HS_SUCCESS, or HS_SCAN_TERMINATED when stopped by the callback, or other error
+    hs_error_t finish() {
+        if (m_result == HS_SUCCESS) {
+            m_result = hs_close_stream(m_stream, m_scratch, handler, this);
+            m_stream = nullptr;
+            // notify: end of stream
+            (void) m_cb(m_bufs, IdEndOfStream, 0, 0);
+        }
+        return m_result;
+    }
+
+private:
+    static int handler(unsigned int id, unsigned long long from,
+                       unsigned long long to, unsigned int flags, void *ctx_p) {
+        auto& self = *static_cast<HyperscanStream*>(ctx_p);
+        return self.m_cb(self.m_bufs, PatternId(id), from, to);
+    }
+
+    hs_stream_t* m_stream = nullptr;
+    hs_scratch_t* m_scratch;
+    Callback m_cb;
+    ScanFileBuffers m_bufs {};
+    hs_error_t m_result;
+};
+
+
 class HyperscanDatabase: private NonCopyable {
 public:
     ~HyperscanDatabase() { hs_free_database(m_db); }
@@ -740,15 +820,8 @@ public:
         hs_error_t hs_result = HS_INVALID;
     };
 
-    // id == IdNewline is special pattern for matching newlines
-    // The reader maintains two buffers, so the previous one can be saved
-    // and used together with current one to complete lines that span through buffer boundary.
-    // \return 1 to stop matching, 0 to continue
-    using ScanFileCallback = std::function<int(const ScanFileBuffers& bufs,
-                                               PatternId id, uint64_t from, uint64_t to)>;
-
     ScanResult scan_file(const FileTree::PathNode& path, hs_scratch_t* scratch,
-                         const ScanFileCallback& cb) {
+                         HyperscanStream::Callback&& cb) const {
         int fd = path.open();
         if (fd == -1) {
             if (errno != ELOOP)  // ELOOP = a symlink when opening with O_NOFOLLOW
@@ -756,63 +829,28 @@ public:
             return {false};
         }
 
-        struct Context {
-            const ScanFileCallback& cb;
-            ScanFileBuffers bufs;
-        };
-        Context ctx { .cb = cb };
-
-        auto handler = [] (unsigned int id, unsigned long long from,
-                           unsigned long long to, unsigned int flags, void *ctx_p) {
-            auto& ctx = *static_cast<struct Context*>(ctx_p);
-            return ctx.cb(ctx.bufs, PatternId(id), from, to);
-        };
-
         constexpr size_t bufsize = 4096;
         char buffers[2][bufsize];
         unsigned int current_buffer = 1u;
 
-        hs_stream_t* hs_stream;
-        auto r = hs_open_stream(m_db, 0, &hs_stream);
-        while (r == HS_SUCCESS) {
+        HyperscanStream stream(m_db, scratch, std::move(cb));
+        while (stream.ok()) {
             // Read into the other buffer
             current_buffer ^= 1u;
-            // Blocking read - not optimal
+            // Blocking read - see GrepRing for async alternative
             auto size = ::read(fd, buffers[current_buffer], bufsize);
             if (size == -1) {
                 fmt::print(stderr,"ff: read({}): {}\n", path.file_path(), error_str());
                 ::close(fd);
-                hs_close_stream(hs_stream, scratch, nullptr, nullptr);
                 return {false};
             }
             if (size == 0)
                 break;
-
-            // Pass the buffers to the callback
-            auto& buf0 = ctx.bufs.buffer[0];
-            auto& buf1 = ctx.bufs.buffer[1];
-            buf0 = buf1;
-            buf1.data = buffers[current_buffer];
-            buf1.size = size;
-            buf1.offset += buf0.size;
-
-            r = hs_scan_stream(hs_stream, buffers[current_buffer], unsigned(size),
-                    0, scratch, handler, &ctx);
-
-            // notify: swapping buffers
-            (void) ctx.cb(ctx.bufs, IdFinishBuffer, 0, 0);
-        }
-        if (r == HS_SUCCESS) {
-            r = hs_close_stream(hs_stream, scratch, handler, &ctx);
-            // notify: end of stream
-            (void) ctx.cb(ctx.bufs, IdEndOfStream, 0, 0);
-        } else {
-            // no longer interested in matches or errors, just close it
-            hs_close_stream(hs_stream, scratch, nullptr, nullptr);
+            stream.scan(buffers[current_buffer], size);
         }
 
         ::close(fd);
-        return {true, r};
+        return {true, stream.finish()};
     }
 
 private:
@@ -823,6 +861,304 @@ private:
 };
 
 
+#ifdef HAVE_IO_URING
+/// Grep many files concurrently, using io_uring for openat/read/close.
+/// Keeps up to `max_files` files open, each with one read in flight,
+/// so the thread doesn't sit blocked on I/O of a single file.
+/// Completed buffers are fed to Hyperscan stream scan, in order of the file.
+/// The finished files are reported (FinishCallback) in the order they were added,
+/// a file which finished early waits for the previous ones.
+/// If the ring fails, the files in flight and all following files
+/// are scanned with blocking reads (HyperscanDatabase::scan_file).
+/// Use one instance per worker thread (the ring is not thread-safe).
+class GrepRing: private NonCopyable {
+public:
+    static constexpr unsigned bufsize = 16 * 1024;
+
+    // File being scanned
+    struct Job {
+        FileTree::RcPtr<const FileTree::PathNode> path;
+        std::string out;  // highlighted path
+        struct stat st;
+        std::string content;  // grep output
+        std::optional<GrepContext> ctx;
+        std::optional<HyperscanStream> stream;
+        std::unique_ptr<char[]> buffers;  // two buffers of bufsize
+        unsigned current_buffer = 1u;
+        uint64_t offset = 0;
+        int fd = -1;
+        bool done = false;  // finished, waiting to be reported in order
+        bool report = false;  // call FinishCallback (not on open or read error)
+        hs_error_t hs_result = HS_SUCCESS;
+    };
+
+    // Process the scanned data (see HyperscanStream::Callback)
+    using EventCallback = std::function<int(Job& job, const ScanFileBuffers& bufs,
+                                            PatternId id, uint64_t from, uint64_t to)>;
+    // Called when the scan of a file is finished (not called on open or read error)
+    using FinishCallback = std::function<void(Job& job, hs_error_t hs_result)>;
+
+    GrepRing(unsigned max_files, const HyperscanDatabase& db, hs_scratch_t* scratch,
+             const Theme& theme, const EventCallback& event_cb, const FinishCallback& finish_cb)
+        : m_jobs(std::make_unique<Job[]>(max_files)), m_ring(2 * max_files),
+          m_max_files(max_files), m_db(db), m_scratch(scratch), m_theme(theme),
+          m_event_cb(event_cb), m_finish_cb(finish_cb)
+    {
+        m_free.reserve(max_files);
+        for (unsigned i = max_files; i != 0; --i)
+            m_free.push_back(i - 1);
+    }
+
+    ~GrepRing() {
+        // After a failure, close the files whose open completed too late
+        if (m_failed)
+            process_completions();
+    }
+
+    /// Is io_uring available, with all required operations?
+    bool is_supported() const {
+        return m_ring && m_ring.supports(IORING_OP_OPENAT)
+               && m_ring.supports(IORING_OP_READ) && m_ring.supports(IORING_OP_CLOSE);
+    }
+
+    /// Start grepping the file. Blocks only when all slots are busy.
+    void add(const FileTree::PathNode& path, std::string&& out, const struct stat& st) {
+        while (m_free.empty())
+            wait();
+        const unsigned idx = m_free.back();
+        m_free.pop_back();
+
+        m_order.push_back(idx);
+
+        Job& job = m_jobs[idx];
+        job.path = path.share();
+        job.done = false;
+        job.out = std::move(out);
+        job.st = st;
+        job.content.clear();
+        job.ctx.emplace(GrepContext{ .theme = m_theme });
+        if (!job.buffers)
+            job.buffers = std::make_unique<char[]>(2 * bufsize);
+        job.current_buffer = 1u;
+        job.offset = 0;
+        if (m_failed) {
+            scan_blocking(job);
+            return;
+        }
+        // The path is NUL-terminated and stays valid (held by the job).
+        // Not using parent FD - it may be closed before the operation runs.
+        prep([&] { return m_ring.prep_openat(AT_FDCWD, job.path->file_path().data(),
+                                             O_RDONLY | O_NOFOLLOW | O_CLOEXEC, user_data(idx, OpOpen)); });
+        if (!m_failed && m_ring.num_prepared() >= submit_batch)
+            submit(0);
+        process_completions();
+    }
+
+    /// Finish all files in flight
+    void drain() {
+        while (m_free.size() != m_max_files || m_closing != 0)
+            wait();
+    }
+
+private:
+    enum Op: uint64_t { OpOpen = 1, OpRead = 2, OpClose = 3 };
+    static constexpr unsigned submit_batch = 8;
+
+    static uint64_t user_data(unsigned idx, Op op) { return (uint64_t(idx) << 2) | op; }
+    unsigned index(const Job& job) const { return unsigned(&job - m_jobs.get()); }
+
+    /// \returns false if the ring failed (the operation was not prepared)
+    template <class F>
+    bool prep(F&& prep_fn) {
+        while (!m_failed) {
+            if (prep_fn())
+                return true;
+            // the submission queue is full - submit it (the kernel copies the entries)
+            submit(0);
+        }
+        return false;
+    }
+
+    void submit(unsigned wait_nr) {
+        while (!m_failed && !m_ring.submit(wait_nr)) {
+            if (errno != EAGAIN && errno != EBUSY) {
+                fmt::print(stderr,"ff: io_uring_enter: {}\n", error_str());
+                fail();
+                return;
+            }
+            // the completion queue is full
+            process_completions();
+            wait_nr = 0;
+        }
+    }
+
+    void wait() {
+        submit(1);
+        process_completions();
+    }
+
+    // The ring is unusable: finish the files in flight with blocking reads
+    // and switch to blocking reads for the following files.
+    void fail() {
+        m_failed = true;
+        m_closing = 0;  // not waiting for the closes in flight
+        std::vector<uint64_t> discarded;
+        m_ring.discard_prepared(discarded);
+        for (const uint64_t ud : discarded) {
+            if (Op(ud & 3) == OpClose)
+                ::close(int(ud >> 2));
+        }
+        // in order, the scanned files are reported immediately (m_order is modified)
+        const std::vector<unsigned> in_flight(m_order.begin(), m_order.end());
+        for (const unsigned idx : in_flight) {
+            Job& job = m_jobs[idx];
+            if (!job.done)
+                scan_blocking(job);
+        }
+    }
+
+    void scan_blocking(Job& job) {
+        if (job.fd != -1) {
+            // a read might be in flight - the kernel holds its own reference to the file
+            ::close(job.fd);
+            job.fd = -1;
+        }
+        // rescan from start
+        job.stream.reset();
+        job.content.clear();
+        job.ctx.emplace(GrepContext{ .theme = m_theme });
+        const auto [read_ok, hs_res] = m_db.scan_file(*job.path, m_scratch,
+                [this, &job](const ScanFileBuffers& bufs, PatternId id, uint64_t from, uint64_t to) {
+                    return m_event_cb(job, bufs, id, from, to);
+                });
+        complete(job, read_ok, hs_res);
+    }
+
+    void process_completions() {
+        IoRing::Completion c;
+        while (m_ring.pop(c)) {
+            const auto op = Op(c.user_data & 3);
+            if (m_failed) {
+                // the job was already rescanned, only close a late opened file
+                if (op == OpOpen && c.res >= 0)
+                    ::close(c.res);
+                continue;
+            }
+            if (op == OpClose) {
+                --m_closing;
+                continue;
+            }
+            Job& job = m_jobs[c.user_data >> 2];
+            if (op == OpOpen)
+                opened(job, c.res);
+            else
+                read_done(job, c.res);
+        }
+    }
+
+    void opened(Job& job, int res) {
+        if (res < 0) {
+            if (res != -ELOOP)  // ELOOP = a symlink when opening with O_NOFOLLOW
+                fmt::print(stderr,"ff: open({}): {}\n", job.path->file_path(), error_str(-res));
+            complete(job, false);
+            return;
+        }
+        job.fd = res;
+        job.stream.emplace(m_db, m_scratch,
+                [this, &job](const ScanFileBuffers& bufs, PatternId id, uint64_t from, uint64_t to) {
+                    return m_event_cb(job, bufs, id, from, to);
+                });
+        if (!job.stream->ok()) {
+            finish(job);
+            return;
+        }
+        read_next(job);
+    }
+
+    void read_next(Job& job) {
+        // Read into the other buffer
+        job.current_buffer ^= 1u;
+        prep([&] { return m_ring.prep_read(job.fd, job.buffers.get() + job.current_buffer * bufsize,
+                                           bufsize, job.offset, user_data(index(job), OpRead)); });
+    }
+
+    void read_done(Job& job, int res) {
+        if (res < 0) {
+            fmt::print(stderr,"ff: read({}): {}\n", job.path->file_path(), error_str(-res));
+            complete(job, false);
+            return;
+        }
+        if (res == 0) {
+            finish(job);
+            return;
+        }
+        job.stream->scan(job.buffers.get() + job.current_buffer * bufsize, size_t(res));
+        if (!job.stream->ok()) {
+            finish(job);
+            return;
+        }
+        job.offset += unsigned(res);
+        read_next(job);
+    }
+
+    void finish(Job& job) {
+        complete(job, true, job.stream->finish());
+    }
+
+    // The file is done: close it, report it (and the following done files)
+    // when all previously added files were reported
+    void complete(Job& job, bool report, hs_error_t hs_result = HS_SUCCESS) {
+        job.done = true;
+        job.report = report;
+        job.hs_result = hs_result;
+        job.stream.reset();
+        close(job);
+        report_done();
+    }
+
+    void report_done() {
+        while (!m_order.empty() && m_jobs[m_order.front()].done) {
+            const unsigned idx = m_order.front();
+            m_order.pop_front();
+            Job& job = m_jobs[idx];
+            if (job.report)
+                m_finish_cb(job, job.hs_result);
+            job.ctx.reset();
+            job.path = {};
+            m_free.push_back(idx);
+        }
+    }
+
+    void close(Job& job) {
+        const int fd = job.fd;
+        job.fd = -1;
+        if (fd != -1) {
+            // close asynchronously, the completion is only counted
+            // (user_data carries the FD, to close it when the ring fails before submitting)
+            if (prep([&] { return m_ring.prep_close(fd, user_data(unsigned(fd), OpClose)); }))
+                ++m_closing;
+            else
+                ::close(fd);
+        }
+    }
+
+    // The buffers must outlive the ring (reads in flight after a failure)
+    std::unique_ptr<Job[]> m_jobs;
+    IoRing m_ring;
+    std::vector<unsigned> m_free;  // indexes of free jobs
+    std::deque<unsigned> m_order;  // indexes of jobs in flight or done, in order of `add`
+    unsigned m_max_files;
+    unsigned m_closing = 0;  // close operations in flight
+    bool m_failed = false;  // io_uring_enter failed, using blocking reads
+    const HyperscanDatabase& m_db;
+    hs_scratch_t* m_scratch;
+    const Theme& m_theme;
+    const EventCallback& m_event_cb;
+    const FinishCallback& m_finish_cb;
+};
+#endif
+
+
 static auto analyze_pattern(const char* pattern, int flags)
         -> std::unique_ptr<hs_expr_info_t, decltype(&free)>
 {
@@ -938,6 +1274,7 @@ int main(int argc, char* argv[])
         bool grep_skip_binary = false;
         bool quiet = false;
         bool filter_xmagic = false;
+        bool no_io_uring = false;
     } args;
 
     TermCtl& term = TermCtl::stdout_instance();
@@ -971,6 +1308,7 @@ int main(int argc, char* argv[])
             Option("-b, --binary", "Grep: Show detailed matches in binary files.", args.grep_binary),
             Option("--binary-table", "Print table of color-coded binary characters, as used in -b (binary grep)", args.show_bin_table),
             Option("-Q, --quiet-grep", "Grep: Filter files, don't show matched lines. Stops on first match, making filtering faster.", args.quiet_grep),
+            Option("--no-io-uring", "Grep: Read files with blocking syscalls instead of io_uring (Linux)", args.no_io_uring),
             Option("-q, --quiet", "Do not print file names. Exit status: 0 = match, 1 = no match", args.quiet),
             Option("-c, --color", "Force color output (default: auto)", [&term]{ term.set_is_tty(TermCtl::IsTty::Always); }),
             Option("-C, --no-color", "Disable color output (default: auto)", [&term]{ term.set_is_tty(TermCtl::IsTty::Never); }),
@@ -1149,9 +1487,147 @@ int main(int argc, char* argv[])
     FlatSet<dev_t> dev_ids;
     Counters counters;
 
+    // Process grep events from Hyperscan, write the output to `content`
+    // \return 1 to stop matching, 0 to continue
+    const auto grep_event = [&args = std::as_const(args)]
+            (GrepContext& ctx, std::string& content,
+             const ScanFileBuffers& bufs, PatternId id, uint64_t from, uint64_t to)
+    {
+        if (ctx.binary && args.grep_skip_binary)
+            return 1;  // -> HS_SCAN_TERMINATED
+
+        if (ctx.binary && !args.grep_binary) {
+            // stop if a match was found in binary file
+            if (id == IdMatch) {
+                content = fmt::format("Binary file matched at {:08x}\n", from);
+                ctx.matched = true;
+                return 1;  // -> HS_SCAN_TERMINATED
+            }
+            return 0;
+        }
+
+        if (args.quiet_grep) {
+            // stop if a match was found
+            if (id == IdMatch) {
+                ctx.matched = true;
+                return 1;  // -> HS_SCAN_TERMINATED
+            }
+            return 0;
+        }
+
+        switch (id) {
+            // match found
+            case IdMatch:
+                ctx.highlight_line(content, bufs, from, to);
+                ctx.matched = true;
+                return 0;
+
+            // newline found
+            case IdNewline:
+                if (ctx.binary)
+                    return 0;
+                // special newline pattern, for counting lines
+                ctx.finish_buffer0(content, bufs);
+                ctx.finish_line(content, bufs, to);
+                return 0;
+
+            case IdBinary:
+                // found a byte which is classified as binary
+                ctx.binary = true;
+                return 0;
+
+            // buffers will be swapped
+            case IdFinishBuffer:
+                // there are two buffers, new data are read to the other buffer
+                ctx.finish_buffer0(content, bufs);
+                return 0;
+
+            // end of stream
+            case IdEndOfStream:
+                ctx.finish_buffer0(content, bufs);
+                ctx.finish_buffer1(content, bufs);
+                return 0;
+
+            default:
+                assert(!"pattern ID not handled");
+                return 0;
+        }
+    };
+
+    // Count the match and print it, unless quiet
+    const auto report_match = [&args = std::as_const(args), &counters]
+            (FileTree::Type t, const FileTree::PathNode& path, const std::string& out,
+             const struct stat& st, const std::string& content)
+    {
+        if (t == FileTree::Directory) {
+            counters.matched_dirs.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            counters.matched_files.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (args.quiet)
+            return;
+
+        flockfile(stdout);
+        if (args.long_form)
+            print_path_with_attrs(out, path, st);
+        else
+            std::cout << out;
+        std::cout << '\n';
+        if (!content.empty()) {
+            std::cout << content << '\n';
+        }
+        funlockfile(stdout);
+    };
+
+    // Grep files asynchronously with io_uring, if available (one ring per thread)
+    FileTree::IdleCallback idle_cb;
+#ifdef HAVE_IO_URING
+    const GrepRing::EventCallback grep_ring_event =
+            [&grep_event](GrepRing::Job& job, const ScanFileBuffers& bufs, PatternId id, uint64_t from, uint64_t to) {
+                return grep_event(*job.ctx, job.content, bufs, id, from, to);
+            };
+    const GrepRing::FinishCallback grep_finish = [&report_match](GrepRing::Job& job, hs_error_t hs_res) {
+        if (!job.ctx->matched)
+            return;
+        if (hs_res != HS_SUCCESS && hs_res != HS_SCAN_TERMINATED) {
+            fmt::print(stderr,"ff: {}: scan failed ({})\n", job.path->name(), hs_res);
+            return;
+        }
+        report_match(FileTree::File, *job.path, job.out, job.st, job.content);
+    };
+    std::vector<std::unique_ptr<GrepRing>> grep_rings;
+    if (grep_db && !args.no_io_uring) {
+        // Each file in flight holds an open FD, leave most of the limit for directories
+        struct rlimit rlim;
+        rlim_t max_fds = 1024;
+        if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur != RLIM_INFINITY)
+            max_fds = rlim.rlim_cur;
+        const auto max_files = unsigned(std::clamp<rlim_t>(max_fds / 4 / args.jobs, 1, 32));
+        for (int i = 0; i != args.jobs; ++i) {
+            grep_rings.push_back(std::make_unique<GrepRing>(max_files, grep_db, re_scratch[i],
+                                                            theme, grep_ring_event, grep_finish));
+            if (!grep_rings.back()->is_supported()) {
+                // fall back to blocking reads
+                grep_rings.clear();
+                break;
+            }
+        }
+    }
+    if (!grep_rings.empty()) {
+        // finish the files in flight before the worker goes to sleep
+        idle_cb = [&grep_rings](int tn) { grep_rings[tn]->drain(); };
+    }
+#endif
+
     FileTree ft(args.jobs - 1,
                 [&args = std::as_const(args), highlight_match, re_exclusion_only,
-                 &re_db, &grep_db, &re_scratch, &theme, &dev_ids, &counters]
+                 &re_db, &grep_db, &re_scratch, &theme, &dev_ids, &counters,
+                 &grep_event, &report_match
+#ifdef HAVE_IO_URING
+                 , &grep_rings
+#endif
+                ]
                 (int tn, const FileTree::PathNode& path, FileTree::Type t)
     {
         switch (t) {
@@ -1264,15 +1740,30 @@ int main(int argc, char* argv[])
                     highlight_path(out, t, path, theme);
                 }
 
-                struct stat st;
+                struct stat st {};
                 if (args.long_form || args.type_mask || args.size_from || args.size_to) {
-                    // need stat
-                    if (!path.stat(st)) {
-                        fmt::print(stderr,"ff: stat({}): {}\n", path.file_path(), error_str());
-                        return descend;
+                    // Stat only the fields we need. Type alone is usually known from the directory entry.
+                    unsigned fields = 0;
+                    if (args.long_form)
+                        fields = FileTree::PathNode::StatAll;
+                    if (args.size_from || args.size_to || args.show_stats)
+                        fields |= FileTree::PathNode::StatSize;
+                    if (args.type_mask & 07777)
+                        fields |= FileTree::PathNode::StatMode;
+                    else if (args.type_mask) {
+                        // stat() overwrites st_mode, request the type when stat is needed anyway
+                        st.st_mode = path.type_hint();
+                        if (st.st_mode == 0 || fields != 0)
+                            fields |= FileTree::PathNode::StatType;
+                    }
+                    if (fields != 0) {
+                        if (!path.stat(st, fields)) {
+                            fmt::print(stderr,"ff: stat({}): {}\n", path.file_path(), error_str());
+                            return descend;
+                        }
+                        counters.total_size.fetch_add(st.st_size, std::memory_order_relaxed);
+                        counters.total_blocks.fetch_add(st.st_blocks, std::memory_order_relaxed);
                     }
-                    counters.total_size.fetch_add(st.st_size, std::memory_order_relaxed);
-                    counters.total_blocks.fetch_add(st.st_blocks, std::memory_order_relaxed);
                 }
 
                 if (args.type_mask) {
@@ -1298,70 +1789,19 @@ int main(int argc, char* argv[])
 
                 std::string content;
                 if (t == FileTree::File && grep_db) {
+#ifdef HAVE_IO_URING
+                    if (!grep_rings.empty()) {
+                        // the match is reported when the scan finishes (see grep_finish)
+                        grep_rings[tn]->add(path, std::move(out), st);
+                        return false;
+                    }
+#endif
                     GrepContext ctx { .theme = theme };
                     auto [read_ok, hs_res] = grep_db.scan_file(path, re_scratch[tn],
-                            [&args, &content, &ctx]
-                            (const ScanFileBuffers& bufs, PatternId id, uint32_t from, uint32_t to)
+                            [&grep_event, &content, &ctx]
+                            (const ScanFileBuffers& bufs, PatternId id, uint64_t from, uint64_t to)
                             {
-                                if (ctx.binary && args.grep_skip_binary)
-                                    return 1;  // -> HS_SCAN_TERMINATED
-
-                                if (ctx.binary && !args.grep_binary) {
-                                    // stop if a match was found in binary file
-                                    if (id == IdMatch) {
-                                        content = fmt::format("Binary file matched at {:08x}\n", from);
-                                        ctx.matched = true;
-                                        return 1;  // -> HS_SCAN_TERMINATED
-                                    }
-                                    return 0;
-                                }
-
-                                if (args.quiet_grep) {
-                                    // stop if a match was found
-                                    if (id == IdMatch) {
-                                        ctx.matched = true;
-                                        return 1;  // -> HS_SCAN_TERMINATED
-                                    }
-                                    return 0;
-                                }
-
-                                switch (id) {
-                                    // match found
-                                    case IdMatch:
-                                        ctx.highlight_line(content, bufs, from, to);
-                                        ctx.matched = true;
-                                        return 0;
-
-                                    // newline found
-                                    case IdNewline:
-                                        if (ctx.binary)
-                                            return 0;
-                                        // special newline pattern, for counting lines
-                                        ctx.finish_buffer0(content, bufs);
-                                        ctx.finish_line(content, bufs, to);
-                                        return 0;
-
-                                    case IdBinary:
-                                        // found a byte which is classified as binary
-                                        ctx.binary = true;
-                                        return 0;
-
-                                    // buffers will be swapped
-                                    case IdFinishBuffer:
-                                        // there are two buffers, new data are read to the other buffer
-                                        ctx.finish_buffer0(content, bufs);
-                                        return 0;
-
-                                    // end of stream
-                                    case IdEndOfStream:
-                                        ctx.finish_buffer0(content, bufs);
-                                        ctx.finish_buffer1(content, bufs);
-                                        return 0;
-
-                                    default:
-                                        assert(!"pattern ID not handled");
-                                        return 0;
-                                }
+                                return grep_event(ctx, content, bufs, id, from, to);
                             });
                     if (!read_ok || !ctx.matched)
                         return false;
@@ -1371,25 +1811,9 @@ int main(int argc, char* argv[])
                     }
                 }
 
-                if (t == FileTree::Directory) {
-                    counters.matched_dirs.fetch_add(1, std::memory_order_relaxed);
-                } else {
-                    counters.matched_files.fetch_add(1, std::memory_order_relaxed);
-                }
-
+                report_match(t, path, out, st, content);
                 if (args.quiet)
                     return false;
-
-                flockfile(stdout);
-                if (args.long_form)
-                    print_path_with_attrs(out, path, st);
-                else
-                    std::cout << out;
-                std::cout << '\n';
-                if (!content.empty()) {
-                    std::cout << content << '\n';
-                }
-                funlockfile(stdout);
                 return descend;
             }
             case FileTree::OpenError:
@@ -1403,7 +1827,7 @@ int main(int argc, char* argv[])
                 return true;
         }
         XCI_UNREACHABLE;
-    });
+    }, std::move(idle_cb));
 
     if (args.paths.empty()) {
         ft.walk_cwd();
@@ -182,6 +182,9 @@ struct Block: seq< BraceOpen, NSC, opt<SepList<StatementB>, NSC>, BraceClose > {
 // The main rule, grammar entry point
 struct Main: must< NSC, sor<ReplCommand, SepList<Statement>, success>, NSC, eof > {};
 
+// Entry point for continued input (a line following already highlighted lines)
+struct MainCont: must< NSC, sor<SepList<Statement>, success>, NSC, eof > {};
+
 // ----------------------------------------------------------------------------
 
 
@@ -252,6 +255,7 @@ template< typename Rule >
 using HighlightSelector = tao::pegtl::parse_tree::selector< Rule,
         tao::pegtl::parse_tree::store_content::on<
                 Main,
+                MainCont,
                 ValidCommand,
                 InvalidCommand,
                 FunnyKeyword,
@@ -302,6 +306,7 @@ struct Node: private xci::core::NonCopyable, private xci::core::NonMovable
     bool is_fully_bracketed : 1;
     bool is_open_bracket_or_string: 1;
     bool is_invalid_close_bracket: 1;
+    bool is_incomplete: 1;
 
     template< typename Rule >
     void apply_rule() {
@@ -321,6 +326,13 @@ struct Node: private xci::core::NonCopyable, private xci::core::NonMovable
         is_invalid_close_bracket =
                 std::is_same_v<Rule, InvalidCloseBracket> ||
                 std::is_same_v<Rule, InvalidCloseBrace>;
+        is_incomplete =
+                std::is_same_v<Rule, OpenBracket> ||
+                std::is_same_v<Rule, OpenBrace> ||
+                std::is_same_v<Rule, PartialCharLiteral> ||
+                std::is_same_v<Rule, PartialStringLiteral> ||
+                std::is_same_v<Rule, PartialRawStringLiteral> ||
+                std::is_same_v<Rule, OpenBlockComment>;
     }
 
     // normal color
@@ -428,6 +440,10 @@ HighlightColor Highlighter::highlight_node(
     if (node.is_invalid_close_bracket)
         m_open_bracket = false;
 
+    // Anything unfinished may continue on next line
+    if (node.is_incomplete)
+        m_incomplete = true;
+
     for (const auto& child : node.children) {
         m_output.append(pos, child->begin.data - pos);
         auto child_color = highlight_node(*child, color, cursor, child_hl_bracket);
@@ -445,7 +461,7 @@ HighlightColor Highlighter::highlight_node(
 }
 
 
-auto Highlighter::highlight(std::string_view input, unsigned cursor) -> HlResult
+std::string Highlighter::highlight_chunk(std::string_view chunk, unsigned cursor, bool first)
 {
     using namespace parser;
 
@@ -453,20 +469,100 @@ auto Highlighter::highlight(std::string_view input, unsigned cursor) -> HlResult
             tao::pegtl::tracking_mode::eager,
             tao::pegtl::eol::lf_crlf,
             const char*>  // pass source filename as non-owning char*
-    in(input, "<input>");
+    in(chunk, "<input>");
 
-    m_output.clear();
+    m_open_bracket = false;
+    m_incomplete = false;
     try {
-        auto root = tao::pegtl::parse_tree::parse< Main, Node, HighlightSelector, tao::pegtl::nothing, Control >( in );
+        auto root = first
+                ? tao::pegtl::parse_tree::parse< Main, Node, HighlightSelector, tao::pegtl::nothing, Control >( in )
+                : tao::pegtl::parse_tree::parse< MainCont, Node, HighlightSelector, tao::pegtl::nothing, Control >( in );
         if (root->children.size() != 1)
-            return {std::string{input} + m_term.format("\n<*red><bold>highlighter parse error:<normal> <*red>no match<normal>"), false};
+            return "no match";
         auto last_color = highlight_node(*root->children[0], HighlightColor{}, cursor);
         switch_color(last_color, HighlightColor{});
-        return {m_output, m_open_bracket};
+        return {};
     } catch (tao::pegtl::parse_error& e) {
         // The grammar is build in a way that parse error should never happen
-        return {std::string{input} + m_term.format("\n<*red><bold>highlighter parse error:<normal> <*red>{}<normal>", e.what()), false};
+        return e.what();
+    }
+}
+
+
+auto Highlighter::error_result(std::string_view input, const std::string& msg) -> HlResult
+{
+    m_line_cache.clear();
+    return {std::string{input} + m_term.format("\n<*red><bold>highlighter parse error:<normal> <*red>{}<normal>", msg), false};
+}
+
+
+auto Highlighter::highlight_all(std::string_view input, unsigned cursor) -> HlResult
+{
+    m_output.clear();
+    m_open_bracket = false;
+    m_line_cache.clear();
+    auto err = highlight_chunk(input, cursor, true);
+    if (!err.empty())
+        return error_result(input, err);
+    return {m_output, m_open_bracket};
+}
+
+
+auto Highlighter::highlight(std::string_view input, unsigned cursor) -> HlResult
+{
+    m_output.clear();
+    m_open_bracket = false;
+
+    // Reuse complete lines from previous run, as long as they match the input.
+    // The line with cursor needs to be highlighted again (brackets under cursor).
+    size_t pos = 0;
+    size_t n_lines = 0;
+    for (auto& line : m_line_cache) {
+        if (input.substr(pos, line.source.size()) != line.source)
+            break;
+        const bool has_cursor = cursor >= pos && cursor < pos + line.source.size();
+        if (has_cursor || line.output.empty()) {
+            const auto output_begin = m_output.size();
+            auto err = highlight_chunk(line.source, cursor - unsigned(pos), pos == 0);
+            if (!err.empty())
+                return error_result(input, err);
+            if (!has_cursor)
+                line.output = m_output.substr(output_begin);
+        } else {
+            m_output += line.output;
+        }
+        pos += line.source.size();
+        ++n_lines;
+    }
+    m_line_cache.resize(n_lines);
+
+    // Parse new lines one by one, add complete lines to the cache
+    for (;;) {
+        const auto eol = input.find('\n', pos);
+        if (eol == std::string_view::npos)
+            break;
+        const auto line = input.substr(pos, eol + 1 - pos);
+        const auto output_begin = m_output.size();
+        const bool has_cursor = cursor >= pos && cursor <= eol;
+        auto err = highlight_chunk(line, cursor - unsigned(pos), pos == 0);
+        if (!err.empty())
+            return error_result(input, err);
+        if (m_incomplete) {
+            // The line continues on next line (open bracket etc.),
+            // parse the rest of input at once
+            m_output.resize(output_begin);
+            break;
+        }
+        m_line_cache.push_back({std::string(line),
+                has_cursor ? std::string{} : m_output.substr(output_begin)});
+        pos = eol + 1;
     }
+
+    // The last line, or the rest of input beginning with an incomplete line
+    auto err = highlight_chunk(input.substr(pos), cursor - unsigned(pos), pos == 0);
+    if (!err.empty())
+        return error_result(input, err);
+    return {m_output, m_open_bracket};
 }
 
 
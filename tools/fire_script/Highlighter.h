@@ -10,6 +10,7 @@
 #include <xci/core/TermCtl.h>
 #include <string_view>
 #include <string>
+#include <vector>
 
 namespace xci::script::tool {
 
@@ -32,17 +33,42 @@ public:
         std::string highlighted_input;
         bool is_open;  // true if the input has open bracket or is otherwise expecting some more input (ENTER will add a new line)
     };
+
+    /// Highlight the input, reusing the results from previous call for unchanged lines.
+    /// Only the lines starting from the first changed one are parsed again.
     HlResult highlight(std::string_view input, unsigned cursor);
 
+    /// Highlight the whole input at once, without the line cache.
+    /// This is the reference for `highlight`, which must give the same result.
+    HlResult highlight_all(std::string_view input, unsigned cursor);
+
 private:
+    HlResult error_result(std::string_view input, const std::string& msg);
+
+    // Parse and highlight a chunk of input, append the result to m_output.
+    // The chunk must start at top level (not inside brackets, strings, comments).
+    // Cursor is relative to the chunk, it may be out of the chunk.
+    // Returns error message on parse error (should never happen).
+    std::string highlight_chunk(std::string_view chunk, unsigned cursor, bool first);
+
     void switch_color(const HighlightColor& from, const HighlightColor& to);
     HighlightColor highlight_node(const parser::Node& node,
                                   const HighlightColor& prev_color,
                                   unsigned cursor, bool hl_bracket = false);
 
+    // A line which was parsed as complete statement(s), i.e. it doesn't end
+    // inside an open bracket, string or comment. Next line can be parsed
+    // separately, starting at top level.
+    struct CachedLine {
+        std::string source;
+        std::string output;  // empty if the cursor was on the line (not cached)
+    };
+
     xci::core::TermCtl& m_term;
+    std::vector<CachedLine> m_line_cache;
     std::string m_output;
     bool m_open_bracket = false;
+    bool m_incomplete = false;  // the chunk ended inside some open construct
 };
 
 
@@ -41,6 +41,8 @@ static PassItem pass_names[] = {
         {"assemble", Flags::CPAssemble},
         {"optimize_copy_drop", Flags::OPCopyDrop},
         {"optimize_tail_call", Flags::OPTailCall},
+        {"optimize_native_call", Flags::OPNativeCall},
+        {"fuse_list_ops", Flags::OPFuseListOps},
 };
 
 
@@ -98,6 +100,7 @@ void Options::parse(char* argv[])
             Option("-h, --help", "Show help", show_help),
             Option("-v, --verbose", "Print compilation progress and timing stats", po.verbose),
             Option("-c, --compile", "Compile a module (don't run anything)", po.compile),
+            Option("--tree-shake", "With -c: drop functions and values unreachable from main before writing the module", po.tree_shake),
             Option("-o, --output FILE", "Output file for compiled module (default is <source basename>.firm)", po.output_file),
             Option("-e, --eval EXPR", "Execute EXPR as main input", po.expr),
             Option("-O LEVEL, --optimization", "Set optimization level (default: 1)", ro.optimization),
@@ -37,6 +37,7 @@ struct ProgramOptions {
     std::string schema_file;
     const char* expr = nullptr;
     bool compile = false;
+    bool tree_shake = false;
     bool verbose = false;
 };
 
@@ -7,12 +7,15 @@
 #include "Program.h"
 #include "Highlighter.h"
 #include <xci/script/Error.h>
+#include <xci/script/code/tree_shake.h>
 #include <xci/core/log.h>
 #include <xci/core/string.h>
 #include <xci/core/file.h>
 #include <xci/core/sys.h>
 #include <xci/config.h>
 
+#include <chrono>
+
 namespace xci::script::tool {
 
 using namespace xci::core;
@@ -30,6 +33,29 @@ Program::Program(bool log_debug)
 }
 
 
+static void print_tree_shake_stats(ModuleManager& module_manager,
+                                   const TreeShakeStats& stats, const std::string& out_path)
+{
+    const auto print_count = [](const char* what, const TreeShakeStats::Count& count) {
+        std::clog << fmt::format("Tree shaking: {:<11} {:>7} -> {:>7}", what, count.before, count.after) << std::endl;
+    };
+    print_count("functions", stats.functions);
+    print_count("instances", stats.instances);
+    print_count("values", stats.values);
+    print_count("code bytes", stats.code_bytes);
+
+    // Measure the cost of loading the module back (deserialization + bytecode verification)
+    std::error_code ec;
+    const auto file_size = fs::file_size(out_path, ec);
+    Module loaded(module_manager);
+    const auto start = std::chrono::steady_clock::now();
+    if (!loaded.load_from_file(out_path))
+        return;
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::clog << fmt::format("Module file: {} bytes, loads in {:.3f} ms", ec ? 0u : file_size, elapsed.count()) << std::endl;
+}
+
+
 void Program::process_args(char* argv[])
 {
     opts.parse(argv);
@@ -85,10 +111,16 @@ void Program::process_args(char* argv[])
                     else
                         out_path += ".firm";
                 }
+                Module& module = *ctx.input_modules.back();
+                TreeShakeStats shake_stats;
+                if (opts.prog_opts.tree_shake)
+                    shake_stats = tree_shake(module);
                 if (opts.prog_opts.verbose)
                     std::clog << "Writing module: " << out_path << std::endl;
-                if (!ctx.input_modules.back()->save_to_file(out_path))
+                if (!module.save_to_file(out_path))
                     exit(1);
+                if (opts.prog_opts.verbose && opts.prog_opts.tree_shake)
+                    print_tree_shake_stats(ctx.interpreter.module_manager(), shake_stats, out_path);
             }
         }
         exit(0);
@@ -106,8 +138,9 @@ void Program::repl_init()
     TermCtl& t = ctx.term_out;
     auto history_file = xci::core::home_directory_path() / ".xci_fire_history";
     edit_line().open_history_file(history_file);
-    edit_line().set_highlight_callback([&t](std::string_view data, unsigned cursor) {
-        auto [hl_data, is_open] = Highlighter(t).highlight(data, cursor);
+    // The highlighter keeps state between calls, to reuse results for unchanged lines
+    edit_line().set_highlight_callback([hl = Highlighter(t)](std::string_view data, unsigned cursor) mutable {
+        auto [hl_data, is_open] = hl.highlight(data, cursor);
         return EditLine::HighlightResult{hl_data, is_open};
     });
 
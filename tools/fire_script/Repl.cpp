@@ -13,8 +13,11 @@
 #include <xci/script/dump.h>
 #include <xci/core/ResourceUsage.h>
 
+#include <algorithm>
 #include <ranges>
 #include <iostream>
+#include <sstream>
+#include <cctype>
 
 namespace xci::script::tool {
 
@@ -48,8 +51,21 @@ bool Repl::evaluate(NameId module_name, std::string module_source, EvalMode mode
             t.stream() << "Raw AST:" << endl << dump_tree << ast << endl;
         }
 
-        // create new module for the input
-        auto module = prepare_module(module_name);
+        // split leading definitions to a module which can be reused by next input
+        std::shared_ptr<Module> defs_module;
+        std::vector<NameId> defined_names;
+        if (mode == EvalMode::Repl) {
+            rusage.start_if(m_opts.print_rusage, "definitions compiled");
+            defs_module = compile_definitions(module_name, ast, defined_names);
+            rusage.stop();
+        }
+
+        // create new module for the input, import only the input modules it refers to
+        const auto& source = source_manager.get_source(src_id);
+        auto module = prepare_module(module_name,
+                input_dependencies({source.data(), source.size()}, defined_names));
+        if (defs_module)
+            module->add_imported_module(defs_module);
         const auto r = module_manager.replace_module(module_name, module);
         assert(r != no_index); (void) r;
 
@@ -69,8 +85,11 @@ bool Repl::evaluate(NameId module_name, std::string module_source, EvalMode mode
 
         const bool res = evaluate_module(*module, mode);
 
-        if (mode == EvalMode::Compile || mode == EvalMode::Repl)
-            m_ctx.input_modules.push_back(std::move(module));
+        if (mode == EvalMode::Compile || mode == EvalMode::Repl) {
+            if (defs_module)
+                add_input_module(std::move(defs_module));
+            add_input_module(std::move(module));
+        }
 
         return res;
     } catch (const ScriptError& e) {
@@ -80,7 +99,7 @@ bool Repl::evaluate(NameId module_name, std::string module_source, EvalMode mode
 }
 
 
-std::shared_ptr<Module> Repl::prepare_module(NameId module_name)
+std::shared_ptr<Module> Repl::prepare_module(NameId module_name, const std::vector<size_t>& deps)
 {
     auto module = std::make_shared<Module>(m_ctx.interpreter.module_manager(), module_name);
     ResourceUsage rusage;
@@ -95,13 +114,120 @@ std::shared_ptr<Module> Repl::prepare_module(NameId module_name)
         rusage.stop();
     }
 
-    for (auto& m : m_ctx.input_modules)
-        module->add_imported_module(m);
+    for (size_t idx : deps)
+        module->add_imported_module(m_ctx.input_modules[idx]);
 
     return module;
 }
 
 
+std::vector<size_t> Repl::input_dependencies(std::string_view source,
+                                             const std::vector<NameId>& own_names) const
+{
+    std::vector<size_t> deps = m_instance_modules;
+    const auto is_ident_char = [](char c) { return std::isalnum((unsigned char) c) || c == '_'; };
+    size_t pos = 0;
+    while (pos != source.size()) {
+        if (!is_ident_char(source[pos])) {
+            ++pos;
+            continue;
+        }
+        const size_t begin = pos;
+        while (pos != source.size() && is_ident_char(source[pos]))
+            ++pos;
+        const auto word = source.substr(begin, pos - begin);
+        if (std::isdigit((unsigned char) word[0]))
+            continue;  // a number
+        if (std::ranges::any_of(own_names, [word](NameId n) { return n.view() == word; }))
+            continue;
+        if (auto it = m_defined_names.find(word); it != m_defined_names.end())
+            deps.insert(deps.end(), it->second.begin(), it->second.end());
+    }
+    // import in input order - later definitions take precedence
+    std::ranges::sort(deps);
+    const auto [first, last] = std::ranges::unique(deps);
+    deps.erase(first, last);
+    return deps;
+}
+
+
+void Repl::add_input_module(std::shared_ptr<Module> module)
+{
+    // reused definitions module is already there
+    if (std::ranges::find(m_ctx.input_modules, module) != m_ctx.input_modules.end())
+        return;
+    const size_t idx = m_ctx.input_modules.size();
+    const auto add_name = [this, idx](std::string_view name) {
+        auto& mods = m_defined_names[std::string(name)];
+        if (mods.empty() || mods.back() != idx)
+            mods.push_back(idx);
+    };
+    add_name(module->name().view());  // `_N` refers to result of N-th input
+    bool has_instance = false;
+    for (const auto& sym : module->symtab()) {
+        if (sym.type() == Symbol::Module)
+            continue;  // imports
+        if (sym.type() == Symbol::Instance)
+            has_instance = true;
+        add_name(sym.name().view());
+    }
+    if (has_instance)
+        m_instance_modules.push_back(idx);
+    m_ctx.input_modules.push_back(std::move(module));
+}
+
+
+std::shared_ptr<Module> Repl::compile_definitions(NameId module_name, ast::Module& ast,
+                                                  std::vector<NameId>& names)
+{
+    auto& statements = ast.body.statements;
+
+    // The last statement is always Return, it stays in the main module
+    size_t n_defs = 0;
+    while (n_defs + 1 < statements.size()
+           && dynamic_cast<const ast::Definition*>(statements[n_defs].get()) != nullptr)
+        ++n_defs;
+    if (n_defs == 0)
+        return nullptr;
+
+    std::ostringstream os;
+    std::vector<NameId> defs_names;
+    for (size_t i = 0; i != n_defs; ++i) {
+        const auto& def = static_cast<const ast::Definition&>(*statements[i]);
+        os << def << '\n';
+        defs_names.push_back(def.variable.identifier.name);
+    }
+    std::string source = std::move(os).str();
+    auto deps = input_dependencies(source, defs_names);
+
+    if (m_defs_cache.module == nullptr || m_defs_cache.source != source
+        || m_defs_cache.deps != deps
+        || m_defs_cache.compiler_flags != m_opts.compiler_flags)
+    {
+        // Compile a copy, the original AST is untouched in case of failure
+        ast::Module defs_ast;
+        for (size_t i = 0; i != n_defs; ++i)
+            defs_ast.body.statements.push_back(statements[i]->make_copy());
+        defs_ast.body.finish();
+
+        auto module = prepare_module(intern(fmt::format("{}.defs", module_name)), deps);
+        try {
+            m_ctx.interpreter.compiler().compile(module->get_main_scope(), defs_ast);
+        } catch (const ScriptError&) {
+            // Compile the whole input together, report errors from there
+            m_defs_cache = {};
+            return nullptr;
+        }
+        m_defs_cache = {std::move(source), std::move(module),
+                        std::move(deps), m_opts.compiler_flags};
+    }
+
+    statements.erase(statements.begin(), statements.begin() + ptrdiff_t(n_defs));
+    names.insert(names.end(), defs_names.begin(), defs_names.end());
+    return m_defs_cache.module;
+}
+
+
 bool Repl::evaluate_module(Module& module, EvalMode mode)
 {
     core::TermCtl& t = m_ctx.term_out;
@@ -11,10 +11,13 @@
 #include "Options.h"
 
 #include <xci/script/Error.h>
+#include <xci/script/ast/AST.h>
 #include <xci/vfs/Vfs.h>
 
+#include <map>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace xci::script::tool {
 
@@ -34,15 +37,56 @@ public:
         { return evaluate(intern(module_name), std::move(module_source), mode); }
     bool evaluate(NameId module_name, std::string module_source, EvalMode mode);
 
-    std::shared_ptr<Module> prepare_module(NameId module_name);
+    /// Create a module for new input, importing builtin, std and the previous
+    /// input modules listed in `deps` (see `input_dependencies`).
+    std::shared_ptr<Module> prepare_module(NameId module_name, const std::vector<size_t>& deps = {});
     bool evaluate_module(Module& module, EvalMode mode);
 
+    /// Previous input modules (indexes to Context::input_modules) which
+    /// define a name appearing in `source`, except `own_names`, which are defined
+    /// by the source itself. The modules with instances are always included.
+    /// The names are found by scanning the source for identifiers, which
+    /// is a superset of the referenced names (e.g. words in comments).
+    std::vector<size_t> input_dependencies(std::string_view source,
+                                           const std::vector<NameId>& own_names = {}) const;
+
+    /// Add a module to Context::input_modules, index the names it defines
+    void add_input_module(std::shared_ptr<Module> module);
+
+    /// The module with leading definitions of last REPL input (see `compile_definitions`)
+    const std::shared_ptr<Module>& definitions_module() const { return m_defs_cache.module; }
+
 private:
+    /// Compile leading definitions from REPL input into a separate module
+    /// and remove them from `ast`. Their names are appended to `names`.
+    /// When the definitions and their dependencies are the same as in
+    /// previous input (e.g. the user edited a later line), the module
+    /// compiled previously is reused and only the rest of input is compiled.
+    /// Returns null if there are no leading definitions or they can't be compiled
+    /// separately (e.g. they refer to a later statement).
+    std::shared_ptr<Module> compile_definitions(NameId module_name, ast::Module& ast,
+                                                std::vector<NameId>& names);
+
     void print_error(const ScriptError& e);
     void print_runtime_error(const RuntimeError& e);
 
     Context& m_ctx;
     const ReplOptions& m_opts;
+
+    // Leading definitions from last REPL input, with their compiled module.
+    // Valid only while their dependencies and compiler flags didn't change.
+    struct DefinitionsCache {
+        std::string source;  // the definitions, dumped back as source code
+        std::shared_ptr<Module> module;
+        std::vector<size_t> deps;  // imported input modules
+        Compiler::Flags compiler_flags = Compiler::Flags::Default;
+    };
+    DefinitionsCache m_defs_cache;
+
+    // Names defined by input modules -> indexes of the modules, in input order
+    std::map<std::string, std::vector<size_t>, std::less<>> m_defined_names;
+    // Input modules with instances - these are imported by each new input
+    std::vector<size_t> m_instance_modules;
 };
 
 }  // namespace xci::script::tool